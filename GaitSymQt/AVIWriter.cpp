@@ -14,8 +14,13 @@
 #include <QDebug>
 #include <QImage>
 #include <QByteArray>
+#include <QFileInfo>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QtCore/QBuffer>
 
+#include <algorithm>
+
 AVIWriter::AVIWriter()
 {
     m_gwavi = nullptr;
@@ -26,7 +31,7 @@ AVIWriter::AVIWriter()
 
 AVIWriter::~AVIWriter()
 {
-    if (m_gwavi) CloseFile();
+    CloseFile();
 }
 
 int AVIWriter::InitialiseFile(const QString &aviFilename, unsigned int width, unsigned int height, unsigned int fps)
@@ -35,6 +40,7 @@ int AVIWriter::InitialiseFile(const QString &aviFilename, unsigned int width, un
     m_height = height;
     m_fps = fps;
     m_aviFilename = aviFilename;
+    m_imageSequence = false;
 
     const char *fourcc = "MJPG";          /* set fourcc used */
 
@@ -49,6 +55,20 @@ int AVIWriter::InitialiseFile(const QString &aviFilename, unsigned int width, un
         qDebug("Error: call to gwavi_open(%s) failed!\n", qPrintable(m_aviFilename));
         return __LINE__;
     }
+    StartEncoders();
+    return 0;
+}
+
+int AVIWriter::InitialiseImageSequence(const QString &filename, unsigned int width, unsigned int height)
+{
+    m_width = width;
+    m_height = height;
+    m_aviFilename = filename;
+    m_imageSequence = true;
+    QFileInfo info(filename);
+    m_imageSequenceBase = QDir(info.path()).absoluteFilePath(info.completeBaseName());
+    m_imageSequenceSuffix = info.suffix().isEmpty() ? QString("png") : info.suffix();
+    StartEncoders();
     return 0;
 }
 
@@ -59,42 +79,111 @@ int AVIWriter::WriteAVI(unsigned int width, unsigned int height, const unsigned
         qDebug("Error: width or height has changed since starting video %s\n", qPrintable(m_aviFilename));
         return __LINE__;
     }
+    // the image needs its own copy of the data because rgb is not valid once this function returns
     QImage image(rgb, int(m_width), int(m_height), int(m_width * 3), QImage::Format_RGB888);
-    QByteArray ba;
-    QBuffer buffer(&ba);
-    buffer.open(QIODevice::WriteOnly);
-    image.save(&buffer, "JPG", quality); // this saves the JPG file data to a QByteArray
-
-    if (gwavi_add_frame(m_gwavi, reinterpret_cast<const unsigned char *>(buffer.data().data()), size_t(buffer.size())) == -1)
-    {
-        qDebug("Error: cannot add frame to video %s\n", qPrintable(m_aviFilename));
-        return __LINE__;
-    }
-    return 0;
+    return WriteAVI(image.copy(), quality);
 }
 
-int AVIWriter::WriteAVI(const QImage &image, int quality)
+int AVIWriter::WriteAVI(const QImage &image, int quality, bool mirrored)
 {
     if (image.width() != int(m_width) || image.height() != int(m_height))
     {
         qDebug("Error: width or height has changed since starting video %s\n", qPrintable(m_aviFilename));
         return __LINE__;
     }
-    QByteArray ba;
-    QBuffer buffer(&ba);
-    buffer.open(QIODevice::WriteOnly);
-    image.save(&buffer, "JPG", quality); // this saves the JPG file data to a QByteArray
+    if (m_threads.size() == 0) return __LINE__;
 
-    if (gwavi_add_frame(m_gwavi, reinterpret_cast<const unsigned char *>(buffer.data().data()), size_t(buffer.size())) == -1)
+    QElapsedTimer waitTimer;
+    waitTimer.start();
     {
-        qDebug("Error: cannot add frame to video %s\n", qPrintable(m_aviFilename));
-        return __LINE__;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_queueChanged.wait(lock, [this] { return m_queue.size() < m_queueLength; });
+        Frame frame;
+        frame.index = m_nextFrameIndex++;
+        frame.image = image; // QImage is implicitly shared so this is cheap
+        frame.quality = quality;
+        frame.mirrored = mirrored;
+        m_queue.push_back(std::move(frame));
+        m_waitTime += double(waitTimer.nsecsElapsed()) / 1e9;
     }
+    m_queueChanged.notify_all();
+    return 0;
+}
+
+int AVIWriter::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queueChanged.wait(lock, [this] { return m_nextFrameToWrite == m_nextFrameIndex || m_threads.size() == 0; });
     return 0;
 }
 
+void AVIWriter::StartEncoders()
+{
+    m_finish = false;
+    for (size_t i = 0; i < std::max(m_encoderThreads, size_t(1)); i++) m_threads.push_back(std::thread(&AVIWriter::EncoderLoop, this));
+}
+
+void AVIWriter::EncoderLoop()
+{
+    while (true)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queueChanged.wait(lock, [this] { return m_queue.size() || m_finish; });
+            if (m_queue.empty()) return; // only happens when finishing and everything has been taken
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_queueChanged.notify_all();
+
+        QElapsedTimer encodeTimer;
+        encodeTimer.start();
+        QImage image = frame.mirrored ? frame.image.mirrored() : frame.image;
+        if (m_imageSequence)
+        {
+            QString filename = QString("%1%2.%3").arg(m_imageSequenceBase).arg(frame.index, 6, 10, QChar('0')).arg(m_imageSequenceSuffix);
+            if (image.save(filename, nullptr, frame.quality) == false) qDebug("Error: cannot write frame %s\n", qPrintable(filename));
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_nextFrameToWrite++; // order does not matter for image sequences so this just counts
+            m_framesWritten++;
+            m_encodeTime += double(encodeTimer.nsecsElapsed()) / 1e9;
+        }
+        else
+        {
+            QByteArray ba;
+            QBuffer buffer(&ba);
+            buffer.open(QIODevice::WriteOnly);
+            image.save(&buffer, "JPG", frame.quality); // this saves the JPG file data to a QByteArray
+            buffer.close();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_encodedFrames[frame.index] = ba;
+            // write out as many frames as are now available in the right order
+            for (auto it = m_encodedFrames.find(m_nextFrameToWrite); it != m_encodedFrames.end(); it = m_encodedFrames.find(m_nextFrameToWrite))
+            {
+                if (gwavi_add_frame(m_gwavi, reinterpret_cast<const unsigned char *>(it->second.constData()), size_t(it->second.size())) == -1)
+                    qDebug("Error: cannot add frame to video %s\n", qPrintable(m_aviFilename));
+                m_encodedFrames.erase(it);
+                m_nextFrameToWrite++;
+                m_framesWritten++;
+            }
+            m_encodeTime += double(encodeTimer.nsecsElapsed()) / 1e9;
+        }
+        m_queueChanged.notify_all();
+    }
+}
+
 int AVIWriter::CloseFile()
 {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finish = true;
+    }
+    m_queueChanged.notify_all();
+    for (auto &&it : m_threads) it.join(); // the encoder threads empty the queue before they finish
+    m_threads.clear();
+    if (m_gwavi == nullptr) return 0;
     if (gwavi_close(m_gwavi) == -1)
     {
         qDebug("Error: call to gwavi_close() failed! %s\n", qPrintable(m_aviFilename));
@@ -104,5 +193,40 @@ int AVIWriter::CloseFile()
     return 0;
 }
 
+size_t AVIWriter::encoderThreads() const
+{
+    return m_encoderThreads;
+}
+
+void AVIWriter::setEncoderThreads(size_t encoderThreads)
+{
+    m_encoderThreads = encoderThreads;
+}
+
+size_t AVIWriter::queueLength() const
+{
+    return m_queueLength;
+}
+
+void AVIWriter::setQueueLength(size_t queueLength)
+{
+    m_queueLength = std::max(queueLength, size_t(1));
+}
 
+size_t AVIWriter::framesWritten()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_framesWritten;
+}
 
+double AVIWriter::encodeTime()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_encodeTime;
+}
+
+double AVIWriter::waitTime()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_waitTime;
+}
@@ -11,8 +11,19 @@
 #define AVIWRITER_H
 
 #include <QString>
+#include <QImage>
+#include <QByteArray>
 
-class QImage;
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <vector>
+
+// AVIWriter queues frames and encodes them on its own threads so that the caller only pays for the copy
+// frames are always added to the AVI file in the order they were queued
+// if the output is an image sequence then each frame is written as a separately numbered image file instead
 
 class AVIWriter
 {
@@ -20,17 +31,55 @@ public:
     AVIWriter();
     virtual ~AVIWriter();
     int InitialiseFile(const QString &aviFilename, unsigned int width, unsigned int height, unsigned int fps);
+    int InitialiseImageSequence(const QString &filename, unsigned int width, unsigned int height); // e.g. Frame.png gives Frame000000.png, Frame000001.png etc.
     int WriteAVI(unsigned int width, unsigned int height, const unsigned char *rgb, int quality);
-    int WriteAVI(const QImage &image, int quality);
+    int WriteAVI(const QImage &image, int quality, bool mirrored = false);
+    int Flush(); // returns once every queued frame has been written
+
+    size_t encoderThreads() const;
+    void setEncoderThreads(size_t encoderThreads); // must be set before the file is initialised
+    size_t queueLength() const;
+    void setQueueLength(size_t queueLength);
+
+    size_t framesWritten();
+    double encodeTime(); // total time spent encoding and writing frames on the encoder threads (s)
+    double waitTime(); // total time the caller spent waiting for space in the queue (s)
 
 private:
+    struct Frame
+    {
+        uint64_t index = 0;
+        QImage image;
+        int quality = 0;
+        bool mirrored = false;
+    };
+
     int CloseFile();
+    void StartEncoders();
+    void EncoderLoop();
 
     struct gwavi_t *m_gwavi;
     unsigned int m_width;
     unsigned int m_height;
     unsigned int m_fps;
     QString m_aviFilename;
+    bool m_imageSequence = false;
+    QString m_imageSequenceBase;
+    QString m_imageSequenceSuffix;
+
+    size_t m_encoderThreads = 2;
+    size_t m_queueLength = 8;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_queueChanged;
+    std::deque<Frame> m_queue;
+    std::map<uint64_t, QByteArray> m_encodedFrames; // encoded frames waiting for their turn to be written
+    uint64_t m_nextFrameIndex = 0;
+    uint64_t m_nextFrameToWrite = 0;
+    bool m_finish = false;
+    size_t m_framesWritten = 0;
+    double m_encodeTime = 0;
+    double m_waitTime = 0;
 };
 
 #endif // AVIWRITER_H
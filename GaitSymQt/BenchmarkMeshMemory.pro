@@ -0,0 +1,18 @@
+#/*
+# *  BenchmarkMeshMemory.pro
+# *  GaitSymODE2019
+# *
+# */
+
+# builds ../tests/BenchmarkMeshMemory.cpp with the GUI sources because FacetedObject and MeshStore need Qt
+# usage: BenchmarkMeshMemory --numInstances 4 *.obj (ArgParse needs an option before the end arguments)
+
+include(GaitSym2019.pro)
+
+TARGET = BenchmarkMeshMemory
+OBJECTS_DIR = obj_benchmark_mesh_memory
+CONFIG += console
+macx: CONFIG -= app_bundle
+
+SOURCES -= main.cpp
+SOURCES += ../tests/BenchmarkMeshMemory.cpp
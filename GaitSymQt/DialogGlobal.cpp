@@ -113,6 +113,13 @@ void DialogGlobal::accept() // this catches OK and return/enter
     {
         m_outputGlobal->setColour1(m_inputGlobal->colour1());
         m_outputGlobal->setSize1(m_inputGlobal->size1());
+        // there are no widgets for the collision space settings so keep the current ones
+        m_outputGlobal->setSpaceType(m_inputGlobal->spaceType());
+        m_outputGlobal->setSpaceHashLevels(m_inputGlobal->SpaceHashMinLevel(), m_inputGlobal->SpaceHashMaxLevel());
+        m_outputGlobal->setSpaceQuadTreeCenter(m_inputGlobal->SpaceQuadTreeCenter());
+        m_outputGlobal->setSpaceQuadTreeExtents(m_inputGlobal->SpaceQuadTreeExtents());
+        m_outputGlobal->setSpaceQuadTreeDepth(m_inputGlobal->SpaceQuadTreeDepth());
+        m_outputGlobal->setSpaceSweepAndPruneAxes(m_inputGlobal->SpaceSweepAndPruneAxes());
     }
     else
     {
@@ -251,6 +251,8 @@ void DialogMuscles::accept() // this catches OK and return/enter
         muscle->SetActivationRate(activationRate);
         muscle->SetStartActivation(startActivation);
         muscle->SetMinimumActivation(minimumActivation);
+        MAMuscleComplete *inputMuscle = dynamic_cast<MAMuscleComplete *>(m_inputMuscle);
+        if (inputMuscle) muscle->setSolver(inputMuscle->solver()); // there is no widget for the solver so keep the current one
         m_outputMuscle = std::move(muscle);
     }
     else if (muscleTab == "Damped Spring")
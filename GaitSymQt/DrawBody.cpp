@@ -11,7 +11,9 @@
 #include "Body.h"
 #include "FacetedAxes.h"
 #include "FacetedObject.h"
+#include "MeshLoader.h"
 #include "Preferences.h"
+#include "SimulationSnapshot.h"
 
 #include <QString>
 #include <QDir>
@@ -82,6 +84,37 @@ void DrawBody::setBody(Body *body)
     m_body = body;
 }
 
+// returns an empty string if the file cannot be found
+QString DrawBody::findMeshFile(const QString &filename, const QStringList &meshSearchPath)
+{
+    if (QDir::isAbsolutePath(filename)) return filename;
+    for (int i = 0; i < meshSearchPath.size(); i++)
+    {
+        QDir dir(meshSearchPath[i]);
+        if (dir.exists(filename)) return dir.absoluteFilePath(filename);
+    }
+    return QString();
+}
+
+// queues the meshes that initialise() will load so that they can be parsed before they are needed
+// the paths and colours must match the ones used in initialise() for the loaded meshes to be used
+void DrawBody::requestMeshes(Body *body, MeshLoader *meshLoader)
+{
+    QStringList meshSearchPath;
+    for (size_t i = 0; i < body->simulation()->GetGlobal()->MeshSearchPath()->size(); i++)
+        meshSearchPath.append(QString::fromStdString(body->simulation()->GetGlobal()->MeshSearchPath()->at(i)));
+    std::vector<std::string> graphicFiles = {body->GetGraphicFile1(), body->GetGraphicFile2(), body->GetGraphicFile3()};
+    std::vector<Colour> colours = {body->colour1(), body->colour2(), body->colour3()};
+    for (size_t i = 0; i < graphicFiles.size(); i++)
+    {
+        if (graphicFiles[i].empty()) continue;
+        QString absoluteFilename = findMeshFile(QString::fromStdString(graphicFiles[i]), meshSearchPath);
+        if (!absoluteFilename.endsWith(".ply", Qt::CaseInsensitive) && !absoluteFilename.endsWith(".obj", Qt::CaseInsensitive)) continue;
+        QColor blendColour = QColor::fromRgbF(qreal(colours[i].r()), qreal(colours[i].g()), qreal(colours[i].b()), qreal(colours[i].alpha()));
+        meshLoader->addMesh(absoluteFilename.toStdString(), blendColour);
+    }
+}
+
 void DrawBody::initialise(SimulationWidget *simulationWidget)
 {
     if (!m_body) return;
@@ -115,25 +148,9 @@ void DrawBody::initialise(SimulationWidget *simulationWidget)
     m_meshEntity1 = std::make_unique<FacetedObject>();
     m_meshEntity1->setSimulationWidget(simulationWidget);
     QString filename = QString::fromStdString(m_body->GetGraphicFile1());
-    QString absoluteFilename;
     if (filename.size())
     {
-        if (QDir::isAbsolutePath(filename))
-        {
-            absoluteFilename = filename;
-        }
-        else
-        {
-            for (int i = 0; i < m_meshSearchPath.size(); i++)
-            {
-                QDir dir(m_meshSearchPath[i]);
-                if (dir.exists(filename))
-                {
-                    absoluteFilename = dir.absoluteFilePath(filename);
-                    break;
-                }
-            }
-        }
+        QString absoluteFilename = findMeshFile(filename, m_meshSearchPath);
         m_meshEntity1->setBlendColour(m_bodyColour1, 1);
         if (absoluteFilename.endsWith(".ply", Qt::CaseInsensitive)) m_meshEntity1->ParsePLYFile(absoluteFilename.toStdString());
         if (absoluteFilename.endsWith(".obj", Qt::CaseInsensitive)) m_meshEntity1->ParseOBJFile(absoluteFilename.toStdString());
@@ -146,22 +163,7 @@ void DrawBody::initialise(SimulationWidget *simulationWidget)
     filename = QString::fromStdString(m_body->GetGraphicFile2());
     if (filename.size())
     {
-        if (QDir::isAbsolutePath(filename))
-        {
-            absoluteFilename = filename;
-        }
-        else
-        {
-            for (int i = 0; i < m_meshSearchPath.size(); i++)
-            {
-                QDir dir(m_meshSearchPath[i]);
-                if (dir.exists(filename))
-                {
-                    absoluteFilename = dir.absoluteFilePath(filename);
-                    break;
-                }
-            }
-        }
+        QString absoluteFilename = findMeshFile(filename, m_meshSearchPath);
         m_meshEntity2->setBlendColour(m_bodyColour2, 1);
         if (absoluteFilename.endsWith(".ply", Qt::CaseInsensitive)) m_meshEntity2->ParsePLYFile(absoluteFilename.toStdString());
         if (absoluteFilename.endsWith(".obj", Qt::CaseInsensitive)) m_meshEntity2->ParseOBJFile(absoluteFilename.toStdString());
@@ -174,22 +176,7 @@ void DrawBody::initialise(SimulationWidget *simulationWidget)
     filename = QString::fromStdString(m_body->GetGraphicFile3());
     if (filename.size())
     {
-        if (QDir::isAbsolutePath(filename))
-        {
-            absoluteFilename = filename;
-        }
-        else
-        {
-            for (int i = 0; i < m_meshSearchPath.size(); i++)
-            {
-                QDir dir(m_meshSearchPath[i]);
-                if (dir.exists(filename))
-                {
-                    absoluteFilename = dir.absoluteFilePath(filename);
-                    break;
-                }
-            }
-        }
+        QString absoluteFilename = findMeshFile(filename, m_meshSearchPath);
         m_meshEntity3->setBlendColour(m_bodyColour3, 1);
         if (absoluteFilename.endsWith(".ply", Qt::CaseInsensitive)) m_meshEntity3->ParsePLYFile(absoluteFilename.toStdString());
         if (absoluteFilename.endsWith(".obj", Qt::CaseInsensitive)) m_meshEntity3->ParseOBJFile(absoluteFilename.toStdString());
@@ -203,12 +190,12 @@ void DrawBody::initialise(SimulationWidget *simulationWidget)
     m_facetedObjectList.push_back(m_meshEntity3.get());
 }
 
-void DrawBody::updateEntityPose()
+void DrawBody::updateEntityPose(const SimulationSnapshot *snapshot)
 {
-    const double *quaternion = m_body->GetQuaternion();
-    const double *position = m_body->GetPosition();
-    SetDisplayRotationFromQuaternion(quaternion);
-    SetDisplayPosition(position[0], position[1], position[2]);
+    const SimulationSnapshot::Pose *pose = snapshot->bodyPose(m_body->name());
+    if (!pose) return;
+    SetDisplayRotationFromQuaternion(pose->quaternion.constData());
+    SetDisplayPosition(pose->position.x, pose->position.y, pose->position.z);
     m_axes->SetDisplayScale(m_body->size1(), m_body->size1(), m_body->size1());
 }
 
@@ -242,7 +229,6 @@ void DrawBody::Draw()
         m_meshEntity3->setBlendColour(m_bodyColour3, m_body->size2());
         m_meshEntity3->Draw();
     }
-    m_body->setRedraw(false);
 }
 
 
@@ -19,7 +19,9 @@
 
 class Body;
 class FacetedObject;
+class MeshLoader;
 class SimulationWidget;
+class SimulationSnapshot;
 
 class DrawBody : public Drawable
 {
@@ -31,7 +33,7 @@ public:
     virtual void Draw();
     virtual std::string name();
 
-    void updateEntityPose();
+    void updateEntityPose(const SimulationSnapshot *snapshot);
 
     Body *body() const;
     void setBody(Body *body);
@@ -47,6 +49,9 @@ public:
 
     FacetedObject *axes() const;
 
+    static QString findMeshFile(const QString &filename, const QStringList &meshSearchPath);
+    static void requestMeshes(Body *body, MeshLoader *meshLoader);
+
 private:
     Body *m_body = nullptr;
     QStringList m_meshSearchPath;
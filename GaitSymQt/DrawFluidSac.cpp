@@ -13,6 +13,8 @@
 #include "PGDMath.h"
 #include "Preferences.h"
 #include "FacetedPolyline.h"
+#include "SimulationWidget.h"
+#include "SimulationSnapshot.h"
 
 #include <QString>
 #include <QDir>
@@ -60,35 +62,73 @@ void DrawFluidSac::initialise(SimulationWidget *simulationWidget)
     m_fluidSacForceRadius  = m_fluidSac->size1();
     m_fluidSacForceScale  = m_fluidSac->size2();
 
+    // the geometry always comes from the snapshot that is being drawn
+    const SimulationSnapshot *snapshot = simulationWidget ? simulationWidget->snapshot() : nullptr;
+    const SimulationSnapshot::FluidSacGeometry *geometry = snapshot ? snapshot->fluidSacGeometry(m_fluidSac->name()) : nullptr;
+    if (!geometry) return;
+    m_lastSnapshotSerial = snapshot->serial();
+
     m_facetedObject = std::make_unique<FacetedObject>();
     m_facetedObject->setSimulationWidget(simulationWidget);
     m_facetedObject->setBlendColour(m_fluidSacColour, 1);
-    m_facetedObject->AllocateMemory(m_fluidSac->numTriangles());
-    double vertices[9];
-    for (size_t i = 0; i < m_fluidSac->numTriangles(); i++)
+    size_t numTriangles = geometry->triangles.size() / 9;
+    m_facetedObject->AllocateMemory(numTriangles);
+    for (size_t i = 0; i < numTriangles; i++)
     {
-        m_fluidSac->triangleVertices(i, vertices);
-        m_facetedObject->AddTriangle(vertices);
+        m_facetedObject->AddTriangle(geometry->triangles.data() + i * 9);
     }
 //    qDebug() << "DrawFluidSac " << facetedObject->GetNumTriangles() << " triangles created\n";
 
     if (m_displayFluidSacForces)
     {
-        const std::vector<PointForce> &pointForceList = m_fluidSac->pointForceList();
-        for (size_t i = 0; i < pointForceList.size(); i++)
+        for (auto &&pointForce : geometry->pointForces)
         {
             std::vector<pgd::Vector3> polyline;
-            polyline.clear();
-            pgd::Vector3 f = pgd::Vector3(pointForceList.at(i).vector[0], pointForceList.at(i).vector[1], pointForceList.at(i).vector[2]) * m_fluidSacForceScale;
-            polyline.push_back(pgd::Vector3(pointForceList.at(i).point[0], pointForceList.at(i).point[1], pointForceList.at(i).point[2]));
-            polyline.push_back(pgd::Vector3(pointForceList.at(i).point[0], pointForceList.at(i).point[1], pointForceList.at(i).point[2]) + f);
-            std::unique_ptr<FacetedObject> facetedPolyline = std::make_unique<FacetedPolyline>(&polyline, m_fluidSacForceRadius, m_fluidSacForceSegments, m_fluidSacForceColour, 1);
+            pgd::Vector3 f = pointForce.vector * m_fluidSacForceScale;
+            polyline.push_back(pointForce.point);
+            polyline.push_back(pointForce.point + f);
+            std::unique_ptr<FacetedPolyline> facetedPolyline = std::make_unique<FacetedPolyline>(&polyline, m_fluidSacForceRadius, m_fluidSacForceSegments, m_fluidSacForceColour, 1);
+            facetedPolyline->setSimulationWidget(simulationWidget);
             m_facetedObjectForceList.push_back(std::move(facetedPolyline));
         }
     }
     m_facetedObjectList.push_back(m_facetedObject.get());
 }
 
+bool DrawFluidSac::updateEntityPose(const SimulationSnapshot *snapshot)
+{
+    if (!m_fluidSac || snapshot->serial() == m_lastSnapshotSerial) return true;
+    const SimulationSnapshot::FluidSacGeometry *geometry = snapshot->fluidSacGeometry(m_fluidSac->name());
+    if (!geometry || !m_facetedObject) return false;
+
+    // the meshes can only be refilled if they will have the same topology
+    size_t numTriangles = geometry->triangles.size() / 9;
+    if (numTriangles != m_facetedObject->GetNumTriangles()) return false;
+    if (m_displayFluidSacForces && geometry->pointForces.size() != m_facetedObjectForceList.size()) return false;
+    m_lastSnapshotSerial = snapshot->serial();
+
+    m_facetedObject->ClearTriangles();
+    for (size_t i = 0; i < numTriangles; i++)
+    {
+        m_facetedObject->AddTriangle(geometry->triangles.data() + i * 9);
+    }
+
+    if (m_displayFluidSacForces)
+    {
+        std::vector<pgd::Vector3> polyline;
+        for (size_t i = 0; i < geometry->pointForces.size(); i++)
+        {
+            const SimulationSnapshot::ForceVector &pointForce = geometry->pointForces[i];
+            polyline.clear();
+            pgd::Vector3 f = pointForce.vector * m_fluidSacForceScale;
+            polyline.push_back(pointForce.point);
+            polyline.push_back(pointForce.point + f);
+            m_facetedObjectForceList[i]->Update(&polyline, m_fluidSacForceColour);
+        }
+    }
+    return true;
+}
+
 FluidSac *DrawFluidSac::fluidSac() const
 {
     return m_fluidSac;
@@ -136,7 +176,6 @@ void DrawFluidSac::Draw()
     {
         m_facetedObjectForceList.at(i)->Draw();
     }
-    m_fluidSac->setRedraw(false);
 }
 
 
@@ -16,10 +16,13 @@
 
 #include <memory>
 #include <vector>
+#include <cstdint>
 
 class FluidSac;
 class FacetedObject;
+class FacetedPolyline;
 class SimulationWidget;
+class SimulationSnapshot;
 
 class DrawFluidSac : public Drawable
 {
@@ -31,6 +34,9 @@ public:
     virtual void Draw();
     virtual std::string name();
 
+    // refills the existing meshes from a new snapshot and returns false if the fluid sac needs to be initialised again
+    bool updateEntityPose(const SimulationSnapshot *snapshot);
+
     FluidSac *fluidSac() const;
     void setFluidSac(FluidSac *fluidSac);
 
@@ -48,7 +54,7 @@ private:
     FluidSac *m_fluidSac = nullptr;
 
     std::unique_ptr<FacetedObject> m_facetedObject;
-    std::vector<std::unique_ptr<FacetedObject>> m_facetedObjectForceList;
+    std::vector<std::unique_ptr<FacetedPolyline>> m_facetedObjectForceList;
 
     QColor m_fluidSacColour;
     QColor m_fluidSacForceColour;
@@ -56,6 +62,7 @@ private:
     double m_fluidSacForceScale;
     double m_fluidSacForceRadius;
     size_t m_fluidSacForceSegments;
+    uint64_t m_lastSnapshotSerial = 0;
 };
 
 #endif // DRAWFLUIDSAC_H
@@ -25,6 +25,7 @@
 #include "FacetedCheckerboard.h"
 #include "PGDMath.h"
 #include "Preferences.h"
+#include "SimulationSnapshot.h"
 
 #include <QString>
 #include <QDir>
@@ -162,13 +163,13 @@ void DrawGeom::initialise(SimulationWidget *simulationWidget)
     qDebug() << "Error in DrawGeom::initialise: Unsupported GEOM type";
 }
 
-void DrawGeom::updateEntityPose()
+void DrawGeom::updateEntityPose(const SimulationSnapshot *snapshot)
 {
     Marker *marker = m_geom->geomMarker();
-    pgd::Quaternion q = marker->GetWorldQuaternion();
-    pgd::Vector3 p = marker->GetWorldPosition();
-    SetDisplayRotationFromQuaternion(q.data());
-    SetDisplayPosition(p.x, p.y, p.z);
+    const SimulationSnapshot::Pose *pose = snapshot->markerPose(marker->name());
+    if (!pose) return;
+    SetDisplayRotationFromQuaternion(pose->quaternion.constData());
+    SetDisplayPosition(pose->position.x, pose->position.y, pose->position.z);
 
 //    SphereGeom *sphereGeom = dynamic_cast<SphereGeom *>(m_geom);
 //    if (sphereGeom)
@@ -207,6 +208,5 @@ void DrawGeom::updateEntityPose()
 void DrawGeom::Draw()
 {
     if (m_facetedObject) m_facetedObject->Draw();
-    m_geom->setRedraw(false);
 }
 
@@ -19,6 +19,7 @@
 class Geom;
 class FacetedObject;
 class SimulationWidget;
+class SimulationSnapshot;
 
 class DrawGeom : public Drawable
 {
@@ -30,7 +31,7 @@ public:
     virtual void Draw();
     virtual std::string name();
 
-    void updateEntityPose();
+    void updateEntityPose(const SimulationSnapshot *snapshot);
 
     Geom *geom() const;
     void setGeom(Geom *geom);
@@ -21,6 +21,7 @@
 #include "PGDMath.h"
 #include "Preferences.h"
 #include "Colour.h"
+#include "SimulationSnapshot.h"
 
 #include <QString>
 #include <QDir>
@@ -139,43 +140,41 @@ void DrawJoint::initialise(SimulationWidget *simulationWidget)
         m_facetedObject1 = std::make_unique<FacetedRect>(fixedJoint->width(), fixedJoint->height(), m_jointColor, 1);
         m_facetedObject1->setSimulationWidget(simulationWidget);
         m_facetedObject1->Move((fixedJoint->width() / 2) - fixedJoint->xOrigin(), (fixedJoint->height() / 2) - fixedJoint->yOrigin(), 0);
-        fixedJoint->CalculatePixmap();
         std::unique_ptr<QOpenGLTexture> texture = std::make_unique<QOpenGLTexture>(QOpenGLTexture::Target2D);
         texture->setAutoMipMapGenerationEnabled(false);
         texture->setFormat(QOpenGLTexture::RGBA8_UNorm); // this maps to QImage::Format_RGBA8888
         texture->setSize(int(fixedJoint->nx()), int(fixedJoint->ny()), 1);
         texture->setMipLevels(1);
         texture->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
-        QOpenGLPixelTransferOptions uploadOptions;
-        uploadOptions.setAlignment(1);
-        texture->setData(0, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, fixedJoint->pixMap().data(), &uploadOptions);
         texture->setMinificationFilter(QOpenGLTexture::Nearest);
         texture->setMagnificationFilter(QOpenGLTexture::Nearest);
         texture->setWrapMode(QOpenGLTexture::ClampToEdge);
         m_facetedObject1->setTexture(std::move(texture));
         m_facetedObject1->setDecal(1);
         m_facetedObjectList.push_back(m_facetedObject1.get());
+        // the pixmap is uploaded from the snapshot by updateEntityPose
+        m_lastPixMapSerial = 0;
         return;
     }
 
     qDebug() << "Error in DrawJoint::initialise: Unsupported JOINT type \"" << m_joint->name().c_str() << "\"";
 }
 
-void DrawJoint::updateEntityPose()
+void DrawJoint::updateEntityPose(const SimulationSnapshot *snapshot)
 {
-    Marker *marker = m_joint->body1Marker();
-    pgd::Quaternion q = marker->GetWorldQuaternion();
-    pgd::Vector3 p = marker->GetWorldPosition();
-    SetDisplayRotationFromQuaternion(q.data());
-    SetDisplayPosition(p.x, p.y, p.z);
-    FixedJoint *fixedJoint = dynamic_cast<FixedJoint *>(m_joint);
-    if (fixedJoint && fixedJoint->CalculatePixmapNeeded() && m_facetedObject1->texture())
-    {
-        fixedJoint->CalculatePixmap();
-        QOpenGLPixelTransferOptions uploadOptions;
-        uploadOptions.setAlignment(1);
-        m_facetedObject1->texture()->setData(0, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, fixedJoint->pixMap().data(), &uploadOptions);
-    }
+    const SimulationSnapshot::Pose *pose = snapshot->markerPose(m_joint->body1Marker()->name());
+    if (!pose) return;
+    SetDisplayRotationFromQuaternion(pose->quaternion.constData());
+    SetDisplayPosition(pose->position.x, pose->position.y, pose->position.z);
+    if (!m_facetedObject1 || !m_facetedObject1->texture() || snapshot->serial() == m_lastPixMapSerial) return;
+    // the pixmap was calculated when the snapshot was captured so it only needs uploading when there is a new snapshot
+    const std::vector<unsigned char> *pixMap = snapshot->jointPixMap(m_joint->name());
+    size_t pixMapSize = size_t(m_facetedObject1->texture()->width()) * size_t(m_facetedObject1->texture()->height()) * 4;
+    if (!pixMap || pixMap->size() != pixMapSize) return;
+    m_lastPixMapSerial = snapshot->serial();
+    QOpenGLPixelTransferOptions uploadOptions;
+    uploadOptions.setAlignment(1);
+    m_facetedObject1->texture()->setData(0, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, pixMap->data(), &uploadOptions);
 }
 
 void DrawJoint::Draw()
@@ -183,7 +182,6 @@ void DrawJoint::Draw()
     if (m_facetedObject1.get()) m_facetedObject1->Draw();
     if (m_facetedObject2.get()) m_facetedObject2->Draw();
     if (m_facetedObject3.get()) m_facetedObject3->Draw();
-    m_joint->setRedraw(false);
 }
 
 
@@ -15,10 +15,12 @@
 #include <QColor>
 
 #include <memory>
+#include <cstdint>
 
 class Joint;
 class FacetedObject;
 class SimulationWidget;
+class SimulationSnapshot;
 class TexturedQuad;
 
 class DrawJoint : public Drawable
@@ -31,7 +33,7 @@ public:
     virtual void Draw();
     virtual std::string name();
 
-    void updateEntityPose();
+    void updateEntityPose(const SimulationSnapshot *snapshot);
 
     Joint *joint() const;
     void setJoint(Joint *joint);
@@ -47,6 +49,7 @@ private:
     double m_jointAxisSize;
     QColor m_jointColor;
     size_t m_jointSegments;
+    uint64_t m_lastPixMapSerial = 0;
 
 };
 
@@ -12,6 +12,7 @@
 #include "FacetedObject.h"
 #include "PGDMath.h"
 #include "Preferences.h"
+#include "SimulationSnapshot.h"
 #include "FacetedSphere.h"
 
 #include <QString>
@@ -56,19 +57,18 @@ void DrawMarker::initialise(SimulationWidget *simulationWidget)
     m_facetedObjectList.push_back(m_facetedObject.get());
 }
 
-void DrawMarker::updateEntityPose()
+void DrawMarker::updateEntityPose(const SimulationSnapshot *snapshot)
 {
-    pgd::Vector3 p = m_marker->GetWorldPosition();
-    pgd::Quaternion q = m_marker->GetWorldQuaternion();
+    const SimulationSnapshot::Pose *pose = snapshot->markerPose(m_marker->name());
+    if (!pose) return;
     SetDisplayScale(m_marker->size1(), m_marker->size1(), m_marker->size1());
-    SetDisplayRotationFromQuaternion(q.constData());
-    SetDisplayPosition(p.x, p.y, p.z);
+    SetDisplayRotationFromQuaternion(pose->quaternion.constData());
+    SetDisplayPosition(pose->position.x, pose->position.y, pose->position.z);
 }
 
 void DrawMarker::Draw()
 {
     m_facetedObject->Draw();
-    m_marker->setRedraw(false);
 }
 
 
@@ -16,6 +16,7 @@
 
 class Marker;
 class SimulationWidget;
+class SimulationSnapshot;
 
 class DrawMarker : public Drawable
 {
@@ -27,7 +28,7 @@ public:
     virtual void Draw();
     virtual std::string name();
 
-    void updateEntityPose();
+    void updateEntityPose(const SimulationSnapshot *snapshot);
 
     Marker *marker() const;
     void setMarker(Marker *marker);
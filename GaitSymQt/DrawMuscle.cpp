@@ -25,11 +25,15 @@
 #include "GSUtil.h"
 #include "Marker.h"
 #include "TwoCylinderWrapStrap.h"
+#include "SimulationWidget.h"
+#include "SimulationSnapshot.h"
 
 #include <QString>
 #include <QDir>
 #include <QDebug>
 
+#include <algorithm>
+
 DrawMuscle::DrawMuscle()
 {
 #if defined(GAITSYM_DEBUG_BUILD) && defined(GAITSYM_MEMORY_ALLOCATION_DEBUG)
@@ -177,6 +181,76 @@ void DrawMuscle::initialise(SimulationWidget *simulationWidget)
 {
     if (!m_muscle) return;
 
+    // the geometry always comes from the snapshot that is being drawn
+    const SimulationSnapshot *snapshot = simulationWidget ? simulationWidget->snapshot() : nullptr;
+    const SimulationSnapshot::MuscleGeometry *geometry = snapshot ? snapshot->muscleGeometry(m_muscle->name()) : nullptr;
+    if (!geometry) return;
+    m_lastSnapshotSerial = snapshot->serial();
+
+    UpdateStrapColour(geometry->activation, geometry->length, geometry->tension);
+
+    m_strapCylinderColor.setRedF(qreal(m_muscle->GetStrap()->colour2().r()));
+    m_strapCylinderColor.setGreenF(qreal(m_muscle->GetStrap()->colour2().g()));
+    m_strapCylinderColor.setBlueF(qreal(m_muscle->GetStrap()->colour2().b()));
+    m_strapCylinderColor.setAlphaF(qreal(m_muscle->GetStrap()->colour2().alpha()));
+
+    m_strapForceColor.setRedF(qreal(m_muscle->colour1().r()));
+    m_strapForceColor.setGreenF(qreal(m_muscle->colour1().g()));
+    m_strapForceColor.setBlueF(qreal(m_muscle->colour1().b()));
+    m_strapForceColor.setAlphaF(qreal(m_muscle->colour1().alpha()));
+
+    m_strapRadius = m_muscle->GetStrap()->size1();
+    m_strapCylinderLength  = m_muscle->GetStrap()->size2();
+    m_strapForceRadius  = m_muscle->size1();
+    m_strapForceScale  = m_muscle->size2();
+
+    if (geometry->path.size() == 0 && geometry->cylinders.size() == 0)
+        qDebug() << "Error in DrawMuscle::initialise: Unsupported STRAP type";
+
+    std::vector<pgd::Vector3> polyline = geometry->path;
+    if (polyline.size())
+    {
+        m_facetedObject1 = std::make_unique<FacetedPolyline>(&polyline, m_strapRadius, m_strapNumSegments, m_strapColor, 1);
+        m_facetedObject1->setSimulationWidget(simulationWidget);
+        m_facetedObjectList.push_back(m_facetedObject1.get());
+    }
+
+    // the wrapping cylinders are drawn along their own x axes
+    for (size_t i = 0; i < geometry->cylinders.size() && i < 2; i++)
+    {
+        const pgd::Vector3 &position = geometry->cylinders[i].position;
+        pgd::Vector3 cylinderVecWorld = pgd::QVRotate(geometry->cylinders[i].quaternion, pgd::Vector3(m_strapCylinderLength / 2, 0, 0));
+        polyline.clear();
+        polyline.push_back(position - cylinderVecWorld);
+        polyline.push_back(position + cylinderVecWorld);
+        std::unique_ptr<FacetedPolyline> &facetedObject = (i == 0) ? m_facetedObject2 : m_facetedObject3;
+        facetedObject = std::make_unique<FacetedPolyline>(&polyline, geometry->cylinderRadii[i], m_strapCylinderSegments, m_strapCylinderColor, 1);
+        facetedObject->setSimulationWidget(simulationWidget);
+        m_facetedObjectList.push_back(facetedObject.get());
+    }
+
+    if (m_displayMuscleForces)
+    {
+        for (auto &&pointForce : geometry->pointForces)
+        {
+            polyline.clear();
+            pgd::Vector3 f = pointForce.vector * geometry->tension * m_strapForceScale;
+            polyline.push_back(pointForce.point);
+            polyline.push_back(pointForce.point + f);
+            std::unique_ptr<FacetedPolyline>facetedPolyline = std::make_unique<FacetedPolyline>(&polyline, m_strapForceRadius, m_strapNumSegments, m_strapForceColor, 1);
+            facetedPolyline->setSimulationWidget(simulationWidget);
+            m_facetedObjectList.push_back(facetedPolyline.get());
+            m_facetedObjectForceList.push_back(std::move(facetedPolyline));
+        }
+    }
+
+//    qDebug() << "DrawMuscle::initialise: finished " << m_muscle->name().c_str();
+
+    return;
+}
+
+void DrawMuscle::UpdateStrapColour(double activation, double length, double tension)
+{
     Colour colour(m_muscle->GetStrap()->colour1());
     switch (m_muscle->strapColourControl())
     {
@@ -187,173 +261,70 @@ void DrawMuscle::initialise(SimulationWidget *simulationWidget)
         m_strapColor.setAlphaF(qreal(m_muscle->GetStrap()->colour1().alpha()));
         break;
     case Muscle::activationMap:
-        Colour::SetColourFromMap(float(m_muscle->GetActivation()), m_strapColourMap, &colour, false);
+        Colour::SetColourFromMap(float(activation), m_strapColourMap, &colour, false);
         m_strapColor = QColor(QString::fromStdString(colour.GetHexArgb()));
         break;
     case Muscle::strainMap:
-        if (dynamic_cast<DampedSpringMuscle *>(m_muscle)) Colour::SetColourFromMap(float(m_muscle->GetLength() / dynamic_cast<DampedSpringMuscle *>(m_muscle)->GetUnloadedLength()) - 0.5f, m_strapColourMap, &colour, false);
+        if (dynamic_cast<DampedSpringMuscle *>(m_muscle)) Colour::SetColourFromMap(float(length / dynamic_cast<DampedSpringMuscle *>(m_muscle)->GetUnloadedLength()) - 0.5f, m_strapColourMap, &colour, false);
         else if (dynamic_cast<MAMuscleComplete *>(m_muscle)) Colour::SetColourFromMap(
-                    float(m_muscle->GetLength() / (dynamic_cast<MAMuscleComplete *>(m_muscle)->fibreLength() + dynamic_cast<MAMuscleComplete *>(m_muscle)->tendonLength())) - 0.5f, m_strapColourMap, &colour, false);
-        else if (dynamic_cast<MAMuscle *>(m_muscle)) Colour::SetColourFromMap(float(m_muscle->GetLength() / (dynamic_cast<MAMuscle *>(m_muscle)->fibreLength())) - 0.5f, m_strapColourMap, &colour, false);
+                    float(length / (dynamic_cast<MAMuscleComplete *>(m_muscle)->fibreLength() + dynamic_cast<MAMuscleComplete *>(m_muscle)->tendonLength())) - 0.5f, m_strapColourMap, &colour, false);
+        else if (dynamic_cast<MAMuscle *>(m_muscle)) Colour::SetColourFromMap(float(length / (dynamic_cast<MAMuscle *>(m_muscle)->fibreLength())) - 0.5f, m_strapColourMap, &colour, false);
         m_strapColor = QColor(QString::fromStdString(colour.GetHexArgb()));
         break;
     case Muscle::forceMap:
         if (dynamic_cast<DampedSpringMuscle *>(m_muscle)) Colour::SetColourFromMap(
-                    float(m_muscle->GetTension() / (dynamic_cast<DampedSpringMuscle *>(m_muscle)->GetUnloadedLength() * dynamic_cast<DampedSpringMuscle *>(m_muscle)->GetSpringConstant())), m_strapColourMap, &colour, false);
+                    float(tension / (dynamic_cast<DampedSpringMuscle *>(m_muscle)->GetUnloadedLength() * dynamic_cast<DampedSpringMuscle *>(m_muscle)->GetSpringConstant())), m_strapColourMap, &colour, false);
         else if (dynamic_cast<MAMuscleComplete *>(m_muscle)) Colour::SetColourFromMap(
-                    float(m_muscle->GetTension() / (dynamic_cast<MAMuscleComplete *>(m_muscle)->forcePerUnitArea() * dynamic_cast<MAMuscleComplete *>(m_muscle)->pca())), m_strapColourMap, &colour, false);
+                    float(tension / (dynamic_cast<MAMuscleComplete *>(m_muscle)->forcePerUnitArea() * dynamic_cast<MAMuscleComplete *>(m_muscle)->pca())), m_strapColourMap, &colour, false);
         else if (dynamic_cast<MAMuscle *>(m_muscle)) Colour::SetColourFromMap(
-                    float(m_muscle->GetLength() / (dynamic_cast<MAMuscle *>(m_muscle)->forcePerUnitArea() * dynamic_cast<MAMuscle *>(m_muscle)->pca())), m_strapColourMap, &colour, false);
+                    float(length / (dynamic_cast<MAMuscle *>(m_muscle)->forcePerUnitArea() * dynamic_cast<MAMuscle *>(m_muscle)->pca())), m_strapColourMap, &colour, false);
         m_strapColor = QColor(QString::fromStdString(colour.GetHexArgb()));
         break;
     }
-    m_strapCylinderColor.setRedF(qreal(m_muscle->GetStrap()->colour2().r()));
-    m_strapCylinderColor.setGreenF(qreal(m_muscle->GetStrap()->colour2().g()));
-    m_strapCylinderColor.setBlueF(qreal(m_muscle->GetStrap()->colour2().b()));
-    m_strapCylinderColor.setAlphaF(qreal(m_muscle->GetStrap()->colour2().alpha()));
+}
 
-    m_strapForceColor.setRedF(qreal(m_muscle->colour1().r()));
-    m_strapForceColor.setGreenF(qreal(m_muscle->colour1().g()));
-    m_strapForceColor.setBlueF(qreal(m_muscle->colour1().b()));
-    m_strapForceColor.setAlphaF(qreal(m_muscle->colour1().alpha()));
+bool DrawMuscle::updateEntityPose(const SimulationSnapshot *snapshot)
+{
+    if (!m_muscle || snapshot->serial() == m_lastSnapshotSerial) return true;
+    const SimulationSnapshot::MuscleGeometry *geometry = snapshot->muscleGeometry(m_muscle->name());
+    if (!geometry) return false;
 
-    m_strapRadius = m_muscle->GetStrap()->size1();
-    m_strapCylinderLength  = m_muscle->GetStrap()->size2();
-    m_strapForceRadius  = m_muscle->size1();
-    m_strapForceScale  = m_muscle->size2();
+    // the meshes can only be refilled if they will have the same topology
+    size_t numCylinders = std::min(geometry->cylinders.size(), size_t(2));
+    if ((geometry->path.size() != 0) != bool(m_facetedObject1)) return false;
+    if ((numCylinders > 0) != bool(m_facetedObject2) || (numCylinders > 1) != bool(m_facetedObject3)) return false;
+    if (m_displayMuscleForces && geometry->pointForces.size() != m_facetedObjectForceList.size()) return false;
+    m_lastSnapshotSerial = snapshot->serial();
+
+    UpdateStrapColour(geometry->activation, geometry->length, geometry->tension);
 
-    for (bool first = true; first; first = false) // this loop runs once to avoid nasty nested if-else statements
+    std::vector<pgd::Vector3> polyline = geometry->path;
+    if (m_facetedObject1 && !m_facetedObject1->Update(&polyline, m_strapColor)) return false;
+
+    for (size_t i = 0; i < numCylinders; i++)
     {
-        TwoPointStrap *twoPointStrap = dynamic_cast<TwoPointStrap *>(m_muscle->GetStrap());
-        if (twoPointStrap)
-        {
-            std::vector<std::unique_ptr<PointForce >> *pointForceList = twoPointStrap->GetPointForceList();
-            std::vector<pgd::Vector3> polyline;
-            polyline.reserve(pointForceList->size());
-            polyline.push_back(pgd::Vector3(pointForceList->at(0)->point[0], pointForceList->at(0)->point[1], pointForceList->at(0)->point[2]));
-            polyline.push_back(pgd::Vector3(pointForceList->at(1)->point[0], pointForceList->at(1)->point[1], pointForceList->at(1)->point[2]));
-            m_facetedObject1 = std::make_unique<FacetedPolyline>(&polyline, m_strapRadius, m_strapNumSegments, m_strapColor, 1);
-            m_facetedObject1->setSimulationWidget(simulationWidget);
-            m_facetedObjectList.push_back(m_facetedObject1.get());
-            break;
-        }
-        NPointStrap *nPointStrap = dynamic_cast<NPointStrap *>(m_muscle->GetStrap());
-        if (nPointStrap)
-        {
-            std::vector<std::unique_ptr<PointForce >> *pointForceList = nPointStrap->GetPointForceList();
-            std::vector<pgd::Vector3> polyline;
-            polyline.reserve(pointForceList->size());
-            polyline.push_back(pgd::Vector3(pointForceList->at(0)->point[0], pointForceList->at(0)->point[1], pointForceList->at(0)->point[2]));
-            for (size_t i = 2; i < pointForceList->size(); i++)
-                polyline.push_back(pgd::Vector3(pointForceList->at(i)->point[0], pointForceList->at(i)->point[1], pointForceList->at(i)->point[2]));
-            polyline.push_back(pgd::Vector3(pointForceList->at(1)->point[0], pointForceList->at(1)->point[1], pointForceList->at(1)->point[2]));
-            m_facetedObject1 = std::make_unique<FacetedPolyline>(&polyline, m_strapRadius, m_strapNumSegments, m_strapColor, 1);
-            m_facetedObject1->setSimulationWidget(simulationWidget);
-            m_facetedObjectList.push_back(m_facetedObject1.get());
-            break;
-        }
-        CylinderWrapStrap *cylinderWrapStrap = dynamic_cast<CylinderWrapStrap *>(m_muscle->GetStrap());
-        if (cylinderWrapStrap)
-        {
-            if (cylinderWrapStrap->GetNumWrapSegments() != int(m_strapCylinderWrapSegments))
-            {
-                cylinderWrapStrap->SetNumWrapSegments(int(m_strapCylinderWrapSegments));
-                cylinderWrapStrap->Calculate();
-            }
-            std::vector<pgd::Vector3> polyline = *cylinderWrapStrap->GetPathCoordinates();
-            if (polyline.size())
-            {
-                m_facetedObject1 = std::make_unique<FacetedPolyline>(&polyline, m_strapRadius, m_strapNumSegments, m_strapColor, 1);
-                m_facetedObject1->setSimulationWidget(simulationWidget);
-                m_facetedObjectList.push_back(m_facetedObject1.get());
-            }
-
-            // calculate the quaternion that rotates from cylinder coordinates to world coordinates
-//            const Body *body;
-//            dVector3 pos;
-//            dQuaternion qq;
-//            double radius;
-//            cylinderWrapStrap->GetCylinder(&body, pos, &radius, qq);
-//            const double *q = dBodyGetQuaternion(body->GetBodyID());
-//            pgd::Quaternion qBody(q[0], q[1], q[2], q[3]);
-//            pgd::Quaternion cylinderToWorldQuaternion =  qBody * pgd::Quaternion(qq[0], qq[1], qq[2], qq[3]);
-//            pgd::Vector3 cylinderVecWorld = pgd::QVRotate(cylinderToWorldQuaternion, pgd::Vector3(0, 0, m_strapCylinderLength / 2));
-//            // calculate the cylinder world position
-//            dVector3 position;
-//            dBodyGetRelPointPos(body->GetBodyID(), pos[0], pos[1], pos[2], position);
-            pgd::Vector3 position = cylinderWrapStrap->GetCylinderMarker()->GetWorldPosition();
-//            pgd::Vector3 cylinderVecWorld = pgd::QVRotate(cylinderWrapStrap->GetCylinderMarker()->GetWorldQuaternion(), pgd::Vector3(0, 0, m_strapCylinderLength / 2));
-            pgd::Vector3 cylinderVecWorld = pgd::QVRotate(cylinderWrapStrap->GetCylinderMarker()->GetWorldQuaternion(), pgd::Vector3(m_strapCylinderLength / 2, 0, 0));
-            double radius = cylinderWrapStrap->cylinderRadius();
-            // and draw it
-            polyline.clear();
-            polyline.push_back(pgd::Vector3(position[0] - cylinderVecWorld.x, position[1] - cylinderVecWorld.y, position[2] - cylinderVecWorld.z));
-            polyline.push_back(pgd::Vector3(position[0] + cylinderVecWorld.x, position[1] + cylinderVecWorld.y, position[2] + cylinderVecWorld.z));
-            m_facetedObject2 = std::make_unique<FacetedPolyline>(&polyline, radius, m_strapCylinderSegments, m_strapCylinderColor, 1);
-            m_facetedObject2->setSimulationWidget(simulationWidget);
-            m_facetedObjectList.push_back(m_facetedObject2.get());
-            break;
-        }
-        TwoCylinderWrapStrap *twoCylinderWrapStrap = dynamic_cast<TwoCylinderWrapStrap *>(m_muscle->GetStrap());
-        if (twoCylinderWrapStrap)
-        {
-            if (twoCylinderWrapStrap->GetNumWrapSegments() != int(m_strapCylinderWrapSegments))
-            {
-                twoCylinderWrapStrap->SetNumWrapSegments(int(m_strapCylinderWrapSegments));
-                twoCylinderWrapStrap->Calculate();
-            }
-            std::vector<pgd::Vector3> polyline = *twoCylinderWrapStrap->GetPathCoordinates();
-            if (polyline.size())
-            {
-                m_facetedObject1 = std::make_unique<FacetedPolyline>(&polyline, m_strapRadius, m_strapNumSegments, m_strapColor, 1);
-                m_facetedObject1->setSimulationWidget(simulationWidget);
-                m_facetedObjectList.push_back(m_facetedObject1.get());
-            }
-            pgd::Vector3 position = twoCylinderWrapStrap->GetCylinder1Marker()->GetWorldPosition();
-            pgd::Vector3 cylinderVecWorld = pgd::QVRotate(twoCylinderWrapStrap->GetCylinder1Marker()->GetWorldQuaternion(), pgd::Vector3(m_strapCylinderLength / 2, 0, 0));
-            double radius = twoCylinderWrapStrap->Cylinder1Radius();
-            // and draw it
-            polyline.clear();
-            polyline.push_back(pgd::Vector3(position[0] - cylinderVecWorld.x, position[1] - cylinderVecWorld.y, position[2] - cylinderVecWorld.z));
-            polyline.push_back(pgd::Vector3(position[0] + cylinderVecWorld.x, position[1] + cylinderVecWorld.y, position[2] + cylinderVecWorld.z));
-            m_facetedObject2 = std::make_unique<FacetedPolyline>(&polyline, radius, m_strapCylinderSegments, m_strapCylinderColor, 1);
-            m_facetedObject2->setSimulationWidget(simulationWidget);
-            m_facetedObjectList.push_back(m_facetedObject2.get());
-            position = twoCylinderWrapStrap->GetCylinder2Marker()->GetWorldPosition();
-            radius = twoCylinderWrapStrap->Cylinder2Radius();
-            // and draw it
-            polyline.clear();
-            polyline.push_back(pgd::Vector3(position[0] - cylinderVecWorld.x, position[1] - cylinderVecWorld.y, position[2] - cylinderVecWorld.z));
-            polyline.push_back(pgd::Vector3(position[0] + cylinderVecWorld.x, position[1] + cylinderVecWorld.y, position[2] + cylinderVecWorld.z));
-            m_facetedObject3 = std::make_unique<FacetedPolyline>(&polyline, radius, m_strapCylinderSegments, m_strapCylinderColor, 1);
-            m_facetedObject3->setSimulationWidget(simulationWidget);
-            m_facetedObjectList.push_back(m_facetedObject3.get());
-            break;
-        }
-        qDebug() << "Error in DrawMuscle::initialise: Unsupported STRAP type";
+        const pgd::Vector3 &position = geometry->cylinders[i].position;
+        pgd::Vector3 cylinderVecWorld = pgd::QVRotate(geometry->cylinders[i].quaternion, pgd::Vector3(m_strapCylinderLength / 2, 0, 0));
+        polyline.clear();
+        polyline.push_back(position - cylinderVecWorld);
+        polyline.push_back(position + cylinderVecWorld);
+        FacetedPolyline *facetedObject = (i == 0) ? m_facetedObject2.get() : m_facetedObject3.get();
+        facetedObject->Update(&polyline, m_strapCylinderColor);
     }
 
     if (m_displayMuscleForces)
     {
-        std::vector<std::unique_ptr<PointForce >> *pointForceList = m_muscle->GetPointForceList();
-        for (size_t i = 0; i < pointForceList->size(); i++)
+        for (size_t i = 0; i < geometry->pointForces.size(); i++)
         {
-            std::vector<pgd::Vector3> polyline;
-            polyline.reserve(2);
+            const SimulationSnapshot::ForceVector &pointForce = geometry->pointForces[i];
             polyline.clear();
-            pgd::Vector3 f = pgd::Vector3(pointForceList->at(i)->vector[0], pointForceList->at(i)->vector[1], pointForceList->at(i)->vector[2]) * m_muscle->GetTension() * m_strapForceScale;
-            polyline.push_back(pgd::Vector3(pointForceList->at(i)->point[0], pointForceList->at(i)->point[1], pointForceList->at(i)->point[2]));
-            polyline.push_back(pgd::Vector3(pointForceList->at(i)->point[0], pointForceList->at(i)->point[1], pointForceList->at(i)->point[2]) + f);
-            std::unique_ptr<FacetedPolyline>facetedPolyline = std::make_unique<FacetedPolyline>(&polyline, m_strapForceRadius, m_strapNumSegments, m_strapForceColor, 1);
-            facetedPolyline->setSimulationWidget(simulationWidget);
-            m_facetedObjectForceList.push_back(std::move(facetedPolyline));
-            m_facetedObjectList.push_back(facetedPolyline.get());
+            pgd::Vector3 f = pointForce.vector * geometry->tension * m_strapForceScale;
+            polyline.push_back(pointForce.point);
+            polyline.push_back(pointForce.point + f);
+            m_facetedObjectForceList[i]->Update(&polyline, m_strapForceColor);
         }
     }
-
-//    qDebug() << "DrawMuscle::initialise: finished " << m_muscle->name().c_str();
-
-    return;
+    return true;
 }
 
 void DrawMuscle::Draw()
@@ -365,7 +336,6 @@ void DrawMuscle::Draw()
     {
         m_facetedObjectForceList.at(i)->Draw();
     }
-    m_muscle->setRedraw(false);
 }
 
 
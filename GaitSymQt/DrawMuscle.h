@@ -18,10 +18,12 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
 
 class Muscle;
-class FacetedObject;
+class FacetedPolyline;
 class SimulationWidget;
+class SimulationSnapshot;
 
 class DrawMuscle : public Drawable
 {
@@ -33,6 +35,9 @@ public:
     virtual void Draw();
     virtual std::string name();
 
+    // refills the existing meshes from a new snapshot and returns false if the muscle needs to be initialised again
+    bool updateEntityPose(const SimulationSnapshot *snapshot);
+
     Muscle *muscle() const;
     void setMuscle(Muscle *muscle);
 
@@ -68,12 +73,14 @@ public:
     void setStrapColourMap(const Colour::ColourMap &strapColourMap);
 
 private:
+    void UpdateStrapColour(double activation, double length, double tension);
+
     Muscle *m_muscle = nullptr;
 
-    std::unique_ptr<FacetedObject> m_facetedObject1;
-    std::unique_ptr<FacetedObject> m_facetedObject2;
-    std::unique_ptr<FacetedObject> m_facetedObject3;
-    std::vector<std::unique_ptr<FacetedObject>> m_facetedObjectForceList;
+    std::unique_ptr<FacetedPolyline> m_facetedObject1;
+    std::unique_ptr<FacetedPolyline> m_facetedObject2;
+    std::unique_ptr<FacetedPolyline> m_facetedObject3;
+    std::vector<std::unique_ptr<FacetedPolyline>> m_facetedObjectForceList;
 
     double m_strapRadius = 0;
     size_t m_strapNumSegments = 0;
@@ -87,6 +94,7 @@ private:
     QColor m_strapColor;
     QColor m_strapCylinderColor;
     Colour::ColourMap m_strapColourMap = Colour::ColourMap::JetColourMap;
+    uint64_t m_lastSnapshotSerial = 0;
 };
 
 #endif // DRAWMUSCLE_H
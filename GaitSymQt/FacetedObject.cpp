@@ -10,6 +10,7 @@
 // #pragma warning( disable : 4100 )
 
 #include "FacetedObject.h"
+#include "MeshCache.h"
 #include "DataFile.h"
 #include "GSUtil.h"
 #include "PGDMath.h"
@@ -56,6 +57,8 @@
 #include <sstream>
 #include <cstdlib>
 #include <regex>
+#include <algorithm>
+#include <cstring>
 
 using namespace std::literals::string_literals;
 
@@ -92,21 +95,10 @@ int FacetedObject::ParseMeshFile(const std::string &filename)
 int FacetedObject::ParseOBJFile(const std::string &filename)
 {
     m_filename = filename;
-    MeshStoreObject *meshStoreObject = m_meshStore.getMesh(filename);
-    if (meshStoreObject)
-    {
-        m_vertexList = meshStoreObject->vertexList;
-        m_normalList = meshStoreObject->normalList;
-        m_colourList = meshStoreObject->colourList;
-        m_uvList = meshStoreObject->uvList;
-        m_lowerBound[0] = meshStoreObject->lowerBound[0];
-        m_lowerBound[1] = meshStoreObject->lowerBound[1];
-        m_lowerBound[2] = meshStoreObject->lowerBound[2];
-        m_upperBound[0] = meshStoreObject->upperBound[0];
-        m_upperBound[1] = meshStoreObject->upperBound[1];
-        m_upperBound[2] = meshStoreObject->upperBound[2];
-        return 0;
-    }
+    if (UseStoredMesh(filename)) return 0;
+    if (UseCachedMesh(filename)) return 0;
+    MeshStoreObject *mesh = NewMesh(filename);
+    std::vector<std::string> sourceFiles = {filename};
 
     // read the whole file into memory
     DataFile theFile;
@@ -174,6 +166,7 @@ int FacetedObject::ParseOBJFile(const std::string &filename)
             if (pystring::startswith(line, "mtllib "s))
             {
                 std::string materialsFile = pystring::os::path::join(pystring::os::path::dirname(filename), line.substr("mtllib "s.size(), std::string::npos));
+                sourceFiles.push_back(materialsFile);
                 if (ParseOBJMaterialFile(materialsFile, &materialMap))
                 {
                     qDebug() << "Error reading material file \"" << materialsFile.c_str() << "\"";
@@ -215,12 +208,12 @@ int FacetedObject::ParseOBJFile(const std::string &filename)
                 if (ptr >= endPtr) continue;
                 vertex.z = GSUtil::fast_a_to_double(ptr, &ptr);
                 vertexList.push_back(vertex);
-                if (vertex.x < m_lowerBound[0]) m_lowerBound[0] = vertex.x;
-                if (vertex.y < m_lowerBound[1]) m_lowerBound[1] = vertex.y;
-                if (vertex.z < m_lowerBound[2]) m_lowerBound[2] = vertex.z;
-                if (vertex.x > m_upperBound[0]) m_upperBound[0] = vertex.x;
-                if (vertex.y > m_upperBound[1]) m_upperBound[1] = vertex.y;
-                if (vertex.z > m_upperBound[2]) m_upperBound[2] = vertex.z;
+                if (vertex.x < mesh->lowerBound[0]) mesh->lowerBound[0] = vertex.x;
+                if (vertex.y < mesh->lowerBound[1]) mesh->lowerBound[1] = vertex.y;
+                if (vertex.z < mesh->lowerBound[2]) mesh->lowerBound[2] = vertex.z;
+                if (vertex.x > mesh->upperBound[0]) mesh->upperBound[0] = vertex.x;
+                if (vertex.y > mesh->upperBound[1]) mesh->upperBound[1] = vertex.y;
+                if (vertex.z > mesh->upperBound[2]) mesh->upperBound[2] = vertex.z;
                 ptr++;
                 continue;
             }
@@ -410,84 +403,23 @@ int FacetedObject::ParseOBJFile(const std::string &filename)
         ptr++;
     }
 
-    m_vertexList.clear();
-    m_vertexList.reserve(triangleList.size() * 9);
-    m_normalList.clear();
-    m_normalList.reserve(triangleList.size() * 9);
-    m_colourList.clear();
-    m_colourList.reserve(triangleList.size() * 9);
-    m_uvList.clear();
-    m_uvList.reserve(triangleList.size() * 6);
+    mesh->reserve(triangleList.size());
     double colour[3] = {m_blendColour.redF(), m_blendColour.greenF(), m_blendColour.blueF() };
+    double zeroUV[2] = {0, 0};
     for (auto &&it : triangleList)
     {
-        m_vertexList.push_back(vertexList[it.vertex[0]].x);
-        m_vertexList.push_back(vertexList[it.vertex[0]].y);
-        m_vertexList.push_back(vertexList[it.vertex[0]].z);
-        m_vertexList.push_back(vertexList[it.vertex[1]].x);
-        m_vertexList.push_back(vertexList[it.vertex[1]].y);
-        m_vertexList.push_back(vertexList[it.vertex[1]].z);
-        m_vertexList.push_back(vertexList[it.vertex[2]].x);
-        m_vertexList.push_back(vertexList[it.vertex[2]].y);
-        m_vertexList.push_back(vertexList[it.vertex[2]].z);
-        if (it.normal[0] != SIZE_MAX)
-        {
-            m_normalList.push_back(normalList[it.normal[0]].x);
-            m_normalList.push_back(normalList[it.normal[0]].y);
-            m_normalList.push_back(normalList[it.normal[0]].z);
-            m_normalList.push_back(normalList[it.normal[1]].x);
-            m_normalList.push_back(normalList[it.normal[1]].y);
-            m_normalList.push_back(normalList[it.normal[1]].z);
-            m_normalList.push_back(normalList[it.normal[2]].x);
-            m_normalList.push_back(normalList[it.normal[2]].y);
-            m_normalList.push_back(normalList[it.normal[2]].z);
-        }
-        else
+        if (it.normal[0] == SIZE_MAX) ComputeFaceNormal(vertexList[it.vertex[0]].data(), vertexList[it.vertex[1]].data(), vertexList[it.vertex[2]].data(), normal.data());
+        for (size_t i = 0; i < 3; i++)
         {
-            ComputeFaceNormal(vertexList[it.vertex[0]].data(), vertexList[it.vertex[1]].data(), vertexList[it.vertex[2]].data(), normal.data());
-            m_normalList.push_back(normal.x);
-            m_normalList.push_back(normal.y);
-            m_normalList.push_back(normal.z);
-            m_normalList.push_back(normal.x);
-            m_normalList.push_back(normal.y);
-            m_normalList.push_back(normal.z);
-            m_normalList.push_back(normal.x);
-            m_normalList.push_back(normal.y);
-            m_normalList.push_back(normal.z);
-        }
-        if (it.material)
-        {
-            for (size_t i = 0; i < 9; i++)
-            {
-                m_colourList.push_back(it.material->Kd[i % 3]);
-            }
-        }
-        else
-        {
-            for (size_t i = 0; i < 9; i++) m_colourList.push_back(colour[i % 3]);
-        }
-        if (it.uv[0] != SIZE_MAX)
-        {
-            m_uvList.push_back(uvList[it.uv[0]].x);
-            m_uvList.push_back(uvList[it.uv[0]].y);
-            m_uvList.push_back(uvList[it.uv[1]].x);
-            m_uvList.push_back(uvList[it.uv[1]].y);
-            m_uvList.push_back(uvList[it.uv[2]].x);
-            m_uvList.push_back(uvList[it.uv[2]].y);
-        }
-        else
-        {
-            m_uvList.push_back(0);
-            m_uvList.push_back(0);
-            m_uvList.push_back(0);
-            m_uvList.push_back(0);
-            m_uvList.push_back(0);
-            m_uvList.push_back(0);
+            mesh->addVertex(vertexList[it.vertex[i]].data(),
+                            it.normal[0] != SIZE_MAX ? normalList[it.normal[i]].data() : normal.data(),
+                            it.material ? it.material->Kd : colour,
+                            it.uv[0] != SIZE_MAX ? uvList[it.uv[i]].data() : zeroUV);
         }
     }
-
-    m_meshStore.setTargetMemory(Preferences::valueDouble("MeshStoreMemoryFraction"));
-    m_meshStore.addMesh(filename, m_vertexList, m_normalList, m_colourList, m_uvList, m_lowerBound, m_upperBound);
+    mesh->weld();
+    MeshCache::Write(*mesh, sourceFiles, m_blendColour);
+    StoreMesh();
 
     return 0;
 }
@@ -594,21 +526,9 @@ int FacetedObject::ParseOBJMaterialFile(const std::string &filename, std::map<st
 int FacetedObject::ParsePLYFile(const std::string &filename)
 {
     m_filename = filename;
-    MeshStoreObject *meshStoreObject = m_meshStore.getMesh(filename);
-    if (meshStoreObject)
-    {
-        m_vertexList = meshStoreObject->vertexList;
-        m_normalList = meshStoreObject->normalList;
-        m_colourList = meshStoreObject->colourList;
-        m_uvList = meshStoreObject->uvList;
-        m_lowerBound[0] = meshStoreObject->lowerBound[0];
-        m_lowerBound[1] = meshStoreObject->lowerBound[1];
-        m_lowerBound[2] = meshStoreObject->lowerBound[2];
-        m_upperBound[0] = meshStoreObject->upperBound[0];
-        m_upperBound[1] = meshStoreObject->upperBound[1];
-        m_upperBound[2] = meshStoreObject->upperBound[2];
-        return 0;
-    }
+    if (UseStoredMesh(filename)) return 0;
+    if (UseCachedMesh(filename)) return 0;
+    NewMesh(filename);
     try
     {
         std::ifstream ss;
@@ -745,8 +665,9 @@ int FacetedObject::ParsePLYFile(const std::string &filename)
             }
         }
 
-        m_meshStore.setTargetMemory(Preferences::valueDouble("MeshStoreMemoryFraction"));
-        m_meshStore.addMesh(filename, m_vertexList, m_normalList, m_colourList, m_uvList, m_lowerBound, m_upperBound);
+        m_ownedMesh->weld();
+        MeshCache::Write(*m_ownedMesh, {filename}, m_blendColour);
+        StoreMesh();
     }
     catch (const std::exception &e)
     {
@@ -759,156 +680,69 @@ int FacetedObject::ParsePLYFile(const std::string &filename)
 int FacetedObject::ReadFromMemory(const char *data, size_t len, bool binary, const std::string &meshName)
 {
     m_filename = meshName;
-    MeshStoreObject *meshStoreObject = m_meshStore.getMesh(meshName);
-    if (meshStoreObject)
-    {
-        m_vertexList = meshStoreObject->vertexList;
-        m_normalList = meshStoreObject->normalList;
-        m_colourList = meshStoreObject->colourList;
-        m_uvList = meshStoreObject->uvList;
-        m_lowerBound[0] = meshStoreObject->lowerBound[0];
-        m_lowerBound[1] = meshStoreObject->lowerBound[1];
-        m_lowerBound[2] = meshStoreObject->lowerBound[2];
-        m_upperBound[0] = meshStoreObject->upperBound[0];
-        m_upperBound[1] = meshStoreObject->upperBound[1];
-        m_upperBound[2] = meshStoreObject->upperBound[2];
-        return 0;
-    }
+    if (UseStoredMesh(meshName)) return 0;
+    MeshStoreObject *mesh = NewMesh(meshName);
 
-    m_vertexList.clear();
-    m_normalList.clear();
-    m_colourList.clear();
-    m_uvList.clear();
+    // the data is a triangle soup: number of triangles, bounds, then the vertex, normal, colour and uv blocks
+    size_t numTriangles;
+    std::vector<double> values;
     if (binary)
     {
         if (len < sizeof(size_t) + 6 * sizeof(double)) return __LINE__;
-        const char *ptr = data;
-        size_t numTriangles = *reinterpret_cast<size_t *>(*ptr);
-        ptr += sizeof(size_t);
-        if (len < sizeof(size_t) + 6 * sizeof(double) + numTriangles * 3 * 11 * sizeof(double)) return __LINE__;
-        m_lowerBound[0] = *reinterpret_cast<double *>(*ptr);
-        ptr += sizeof(double);
-        m_lowerBound[1] = *reinterpret_cast<double *>(*ptr);
-        ptr += sizeof(double);
-        m_lowerBound[2] = *reinterpret_cast<double *>(*ptr);
-        ptr += sizeof(double);
-        m_upperBound[0] = *reinterpret_cast<double *>(*ptr);
-        ptr += sizeof(double);
-        m_upperBound[1] = *reinterpret_cast<double *>(*ptr);
-        ptr += sizeof(double);
-        m_upperBound[2] = *reinterpret_cast<double *>(*ptr);
-        ptr += sizeof(double);
-        size_t numElements = numTriangles * 9;
-        m_vertexList.reserve(numElements);
-        m_normalList.reserve(numElements);
-        m_colourList.reserve(numElements);
-        m_uvList.reserve(numTriangles * 6);
-        for (size_t i = 0; i < numElements; i++)
-        {
-            m_vertexList.push_back(*reinterpret_cast<double *>(*ptr));
-            ptr += sizeof(double);
-        }
-        for (size_t i = 0; i < numElements; i++)
-        {
-            m_normalList.push_back(*reinterpret_cast<double *>(*ptr));
-            ptr += sizeof(double);
-        }
-        for (size_t i = 0; i < numElements; i++)
-        {
-            m_colourList.push_back(*reinterpret_cast<double *>(*ptr));
-            ptr += sizeof(double);
-        }
-        for (size_t i = 0; i < numTriangles * 6; i++)
-        {
-            m_uvList.push_back(*reinterpret_cast<double *>(*ptr));
-            ptr += sizeof(double);
-        }
+        std::memcpy(&numTriangles, data, sizeof(size_t));
+        size_t numValues = 6 + numTriangles * 33;
+        if (len < sizeof(size_t) + numValues * sizeof(double)) return __LINE__;
+        values.resize(numValues);
+        std::memcpy(values.data(), data + sizeof(size_t), numValues * sizeof(double));
     }
     else
     {
         if (data[len]) return __LINE__; // must be null terminated for ASCII case
         const char *endPtr;
-        size_t numTriangles = GSUtil::fast_a_to_uint64_t(data, &endPtr);
-        m_lowerBound[0] = GSUtil::fast_a_to_double(endPtr, &endPtr);
-        m_lowerBound[1] = GSUtil::fast_a_to_double(endPtr, &endPtr);
-        m_lowerBound[2] = GSUtil::fast_a_to_double(endPtr, &endPtr);
-        m_upperBound[0] = GSUtil::fast_a_to_double(endPtr, &endPtr);
-        m_upperBound[1] = GSUtil::fast_a_to_double(endPtr, &endPtr);
-        m_upperBound[2] = GSUtil::fast_a_to_double(endPtr, &endPtr);
-        size_t numElements = numTriangles * 9;
-        m_vertexList.reserve(numElements);
-        m_normalList.reserve(numElements);
-        m_colourList.reserve(numElements);
-        m_uvList.reserve(numTriangles * 6);
-        for (size_t i = 0; i < numElements; i++) m_vertexList.push_back(GSUtil::fast_a_to_double(endPtr, &endPtr));
-        for (size_t i = 0; i < numElements; i++) m_normalList.push_back(GSUtil::fast_a_to_double(endPtr, &endPtr));
-        for (size_t i = 0; i < numElements; i++) m_colourList.push_back(GSUtil::fast_a_to_double(endPtr, &endPtr));
-        for (size_t i = 0; i < numTriangles * 6; i++) m_uvList.push_back(GSUtil::fast_a_to_double(endPtr, &endPtr));
+        numTriangles = GSUtil::fast_a_to_uint64_t(data, &endPtr);
+        size_t numValues = 6 + numTriangles * 33;
+        values.reserve(numValues);
+        for (size_t i = 0; i < numValues; i++) values.push_back(GSUtil::fast_a_to_double(endPtr, &endPtr));
     }
-    m_meshStore.setTargetMemory(Preferences::valueDouble("MeshStoreMemoryFraction"));
-    m_meshStore.addMesh(meshName, m_vertexList, m_normalList, m_colourList, m_uvList, m_lowerBound, m_upperBound);
+    const double *vertices = values.data() + 6;
+    const double *normals = vertices + numTriangles * 9;
+    const double *colours = normals + numTriangles * 9;
+    const double *uvs = colours + numTriangles * 9;
+    mesh->reserve(numTriangles);
+    for (size_t i = 0; i < numTriangles * 3; i++) mesh->addVertex(vertices + i * 3, normals + i * 3, colours + i * 3, uvs + i * 2);
+    mesh->weld();
+    StoreMesh();
     return 0;
 }
 
 void FacetedObject::SaveToMemory(std::vector<char> *data, bool binary)
 {
+    // written as a triangle soup so that the format does not depend on the indexing
+    size_t numTriangles = m_mesh->numTriangles();
+    std::vector<double> values;
+    values.reserve(6 + numTriangles * 33);
+    for (size_t i = 0; i < 3; i++) values.push_back(m_mesh->lowerBound[i]);
+    for (size_t i = 0; i < 3; i++) values.push_back(m_mesh->upperBound[i]);
+    for (size_t i = 0; i < numTriangles * 3; i++) { const float *v = m_mesh->vertex(m_mesh->index(i)); values.insert(values.end(), v, v + 3); }
+    for (size_t i = 0; i < numTriangles * 3; i++) { const float *v = m_mesh->normal(m_mesh->index(i)); values.insert(values.end(), v, v + 3); }
+    for (size_t i = 0; i < numTriangles * 3; i++) { const float *v = m_mesh->colour(m_mesh->index(i)); values.insert(values.end(), v, v + 3); }
+    for (size_t i = 0; i < numTriangles * 3; i++) { const float *v = m_mesh->uv(m_mesh->index(i)); values.insert(values.end(), v, v + 2); }
+
+    data->clear();
     if (binary)
     {
-        data->clear();
-        data->resize(sizeof(size_t) + 6 * sizeof(double) + m_vertexList.size() * sizeof(double) +
-                     m_normalList.size() * sizeof(double) +
-                     m_colourList.size() * sizeof(double) +
-                     m_uvList.size() * sizeof(double));
-        size_t *ptr = reinterpret_cast<size_t *>(data->data());
-        *ptr++ = m_vertexList.size() / 3;
-        double *dPtr = reinterpret_cast<double *>(ptr);
-        *dPtr++ = m_lowerBound[0];
-        *dPtr++ = m_lowerBound[1];
-        *dPtr++ = m_lowerBound[2];
-        *dPtr++ = m_upperBound[0];
-        *dPtr++ = m_upperBound[1];
-        *dPtr++ = m_upperBound[2];
-        for (size_t i = 0; i < m_vertexList.size(); i++) *dPtr++ = m_vertexList[i];
-        for (size_t i = 0; i < m_normalList.size(); i++) *dPtr++ = m_normalList[i];
-        for (size_t i = 0; i < m_colourList.size(); i++) *dPtr++ = m_colourList[i];
-        for (size_t i = 0; i < m_uvList.size(); i++) *dPtr++ = m_uvList[i];
+        data->resize(sizeof(size_t) + values.size() * sizeof(double));
+        std::memcpy(data->data(), &numTriangles, sizeof(size_t));
+        std::memcpy(data->data() + sizeof(size_t), values.data(), values.size() * sizeof(double));
     }
     else
     {
-        data->clear();
         char buf[32];
-        int l = std::sprintf(buf, "%zud\n", m_vertexList.size() / 3);
-        std::copy_n(buf, l, std::back_inserter(*data));
-        l = std::sprintf(buf, "%.18g\n", m_lowerBound[0]);
-        std::copy_n(buf, l, std::back_inserter(*data));
-        l = std::sprintf(buf, "%.18g\n", m_lowerBound[1]);
-        std::copy_n(buf, l, std::back_inserter(*data));
-        l = std::sprintf(buf, "%.18g\n", m_lowerBound[2]);
+        int l = std::sprintf(buf, "%zu\n", numTriangles);
         std::copy_n(buf, l, std::back_inserter(*data));
-        l = std::sprintf(buf, "%.18g\n", m_upperBound[0]);
-        std::copy_n(buf, l, std::back_inserter(*data));
-        l = std::sprintf(buf, "%.18g\n", m_upperBound[1]);
-        std::copy_n(buf, l, std::back_inserter(*data));
-        l = std::sprintf(buf, "%.18g\n", m_upperBound[2]);
-        std::copy_n(buf, l, std::back_inserter(*data));
-        for (size_t i = 0; i < m_vertexList.size(); i++)
-        {
-            l = std::sprintf(buf, "%.18g\n", m_vertexList[i]);
-            std::copy_n(buf, l, std::back_inserter(*data));
-        }
-        for (size_t i = 0; i < m_normalList.size(); i++)
-        {
-            l = std::sprintf(buf, "%.18g\n", m_normalList[i]);
-            std::copy_n(buf, l, std::back_inserter(*data));
-        }
-        for (size_t i = 0; i < m_colourList.size(); i++)
+        for (size_t i = 0; i < values.size(); i++)
         {
-            l = std::sprintf(buf, "%.18g\n", m_colourList[i]);
-            std::copy_n(buf, l, std::back_inserter(*data));
-        }
-        for (size_t i = 0; i < m_uvList.size(); i++)
-        {
-            l = std::sprintf(buf, "%.18g\n", m_uvList[i]);
+            l = std::sprintf(buf, "%.18g\n", values[i]);
             std::copy_n(buf, l, std::back_inserter(*data));
         }
         data->push_back('\0');
@@ -918,21 +752,7 @@ void FacetedObject::SaveToMemory(std::vector<char> *data, bool binary)
 int FacetedObject::ReadFromResource(const QString &resourceName)
 {
     m_filename = resourceName.toStdString();
-    MeshStoreObject *meshStoreObject = m_meshStore.getMesh(resourceName.toStdString());
-    if (meshStoreObject)
-    {
-        m_vertexList = meshStoreObject->vertexList;
-        m_normalList = meshStoreObject->normalList;
-        m_colourList = meshStoreObject->colourList;
-        m_uvList = meshStoreObject->uvList;
-        m_lowerBound[0] = meshStoreObject->lowerBound[0];
-        m_lowerBound[1] = meshStoreObject->lowerBound[1];
-        m_lowerBound[2] = meshStoreObject->lowerBound[2];
-        m_upperBound[0] = meshStoreObject->upperBound[0];
-        m_upperBound[1] = meshStoreObject->upperBound[1];
-        m_upperBound[2] = meshStoreObject->upperBound[2];
-        return 0;
-    }
+    if (UseStoredMesh(resourceName.toStdString())) return 0;
 
     QFile file(resourceName);
     if (!file.open(QIODevice::ReadOnly)) return __LINE__;
@@ -940,10 +760,7 @@ int FacetedObject::ReadFromResource(const QString &resourceName)
     file.close();
     QTextStream dataStream(data, QIODevice::ReadOnly);
 
-    m_vertexList.clear();
-    m_normalList.clear();
-    m_colourList.clear();
-    m_uvList.clear();
+    MeshStoreObject *mesh = NewMesh(resourceName.toStdString());
 
     QString key;
     dataStream >> key;
@@ -952,24 +769,18 @@ int FacetedObject::ReadFromResource(const QString &resourceName)
     dataStream >> numTriangles;
     if (numTriangles <= 0) return __LINE__;
     size_t numVertices = numTriangles * 3;
-    size_t numElements = numVertices * 3;
-    dataStream >> m_lowerBound[0] >> m_lowerBound[1] >> m_lowerBound[2] >> m_upperBound[0] >> m_upperBound[1] >> m_upperBound[2];
-
-    m_vertexList.reserve(numElements);
-    m_normalList.reserve(numElements);
-    m_colourList.reserve(numElements);
-    m_uvList.reserve(numVertices * 2);
-    double x, y, z, nx, ny, nz, r, g, b;
+    double bounds[6];
+    dataStream >> bounds[0] >> bounds[1] >> bounds[2] >> bounds[3] >> bounds[4] >> bounds[5]; // the bounds are recalculated from the vertices
+
+    mesh->reserve(numTriangles);
+    double vertex[3], normal[3], colour[3], uv[2] = {0, 0};
     for (size_t i = 0; i < numVertices; i++)
     {
-        dataStream >> x >> y >> z >> nx >> ny >> nz >> r >> g >> b;
-        m_vertexList.push_back(x); m_vertexList.push_back(y); m_vertexList.push_back(z);
-        m_normalList.push_back(nx); m_normalList.push_back(ny); m_normalList.push_back(nz);
-        m_colourList.push_back(r); m_colourList.push_back(g); m_colourList.push_back(b);
-        m_uvList.push_back(0); m_uvList.push_back(0);
+        dataStream >> vertex[0] >> vertex[1] >> vertex[2] >> normal[0] >> normal[1] >> normal[2] >> colour[0] >> colour[1] >> colour[2];
+        mesh->addVertex(vertex, normal, colour, uv);
     }
-    m_meshStore.setTargetMemory(Preferences::valueDouble("MeshStoreMemoryFraction"));
-    m_meshStore.addMesh(resourceName.toStdString(), m_vertexList, m_normalList, m_colourList, m_uvList, m_lowerBound, m_upperBound);
+    mesh->weld();
+    StoreMesh();
     return 0;
 }
 
@@ -1000,41 +811,23 @@ void FacetedObject::InitialiseEntity()
     // vec3 for position
     // vec3 for normals
     // vec3 for colors
-    size_t numVertices = m_vertexList.size() / 3;
-    Q_ASSERT_X(numVertices == m_normalList.size() / 3, "FacetedObject::InitialiseEntity()",
-               "numVertices != m_normalList.size() / 3");
+    size_t numVertices = m_mesh->numVertices();
+    size_t numIndices = m_mesh->numIndices();
     QByteArray vertexData;
     vertexData.resize(int(numVertices * (3 + 3 + 3) * sizeof(float)));
     float *vertexDataPtr = reinterpret_cast<float *>(vertexData.data());
     for (size_t i = 0; i < numVertices; i++)
     {
-        vertexDataPtr[i * (3 + 3 + 3) + 0] = float(m_vertexList[i * 3 + 0]);
-        vertexDataPtr[i * (3 + 3 + 3) + 1] = float(m_vertexList[i * 3 + 1]);
-        vertexDataPtr[i * (3 + 3 + 3) + 2] = float(m_vertexList[i * 3 + 2]);
-        vertexDataPtr[i * (3 + 3 + 3) + 3] = float(m_normalList[i * 3 + 0]);
-        vertexDataPtr[i * (3 + 3 + 3) + 4] = float(m_normalList[i * 3 + 1]);
-        vertexDataPtr[i * (3 + 3 + 3) + 5] = float(m_normalList[i * 3 + 2]);
-        vertexDataPtr[i * (3 + 3 + 3) + 6] = float(m_colourList[i * 3 + 0]);
-        vertexDataPtr[i * (3 + 3 + 3) + 7] = float(m_colourList[i * 3 + 1]);
-        vertexDataPtr[i * (3 + 3 + 3) + 8] = float(m_colourList[i * 3 + 2]);
-//        qDebug("Vertex %d (%f,%f,%f) (%f,%f,%f) (%f,%f,%f)", i,
-//               double(vertexDataPtr[i * (3 + 3 + 3) + 0]),
-//                double(vertexDataPtr[i * (3 + 3 + 3) + 1]),
-//                double(vertexDataPtr[i * (3 + 3 + 3) + 2]),
-//                double(vertexDataPtr[i * (3 + 3 + 3) + 3]),
-//                double(vertexDataPtr[i * (3 + 3 + 3) + 4]),
-//                double(vertexDataPtr[i * (3 + 3 + 3) + 5]),
-//                double(vertexDataPtr[i * (3 + 3 + 3) + 6]),
-//                double(vertexDataPtr[i * (3 + 3 + 3) + 7]),
-//                double(vertexDataPtr[i * (3 + 3 + 3) + 8]));
+        std::copy_n(m_mesh->vertex(i), 3, vertexDataPtr + i * (3 + 3 + 3) + 0);
+        std::copy_n(m_mesh->normal(i), 3, vertexDataPtr + i * (3 + 3 + 3) + 3);
+        std::copy_n(m_mesh->colour(i), 3, vertexDataPtr + i * (3 + 3 + 3) + 6);
     }
 
-    // the index data is just a list of uint32_t values
-    // and is the same length as the number of vertices because vertices are not shared
+    // the index data is a list of uint32_t values because vertices are shared between triangles
     QByteArray vertexIndexData;
-    vertexIndexData.resize(int(numVertices * sizeof(uint32_t)));
+    vertexIndexData.resize(int(numIndices * sizeof(uint32_t)));
     uint32_t *vertexIndexDataPtr = reinterpret_cast<uint32_t *>(vertexIndexData.data());
-    for (size_t i = 0; i < numVertices; i++) vertexIndexDataPtr[i] = uint32_t(i);
+    for (size_t i = 0; i < numIndices; i++) vertexIndexDataPtr[i] = m_mesh->index(i);
 
     Qt3DCore::QBuffer *vertexDataBuffer = new Qt3DCore::QBuffer(customGeometry);
     Qt3DCore::QBuffer *indexDataBuffer = new Qt3DCore::QBuffer(customGeometry);
@@ -1081,7 +874,7 @@ void FacetedObject::InitialiseEntity()
     indexAttribute->setVertexSize(1);
     indexAttribute->setByteOffset(0);
     indexAttribute->setByteStride(sizeof(uint32_t));
-    indexAttribute->setCount(uint(numVertices));
+    indexAttribute->setCount(uint(numIndices));
 
     customGeometry->addAttribute(positionAttribute);
     customGeometry->addAttribute(normalAttribute);
@@ -1093,7 +886,7 @@ void FacetedObject::InitialiseEntity()
     customMeshRenderer->setFirstInstance(0);
     customMeshRenderer->setPrimitiveType(Qt3DRender::QGeometryRenderer::Triangles);
     customMeshRenderer->setGeometry(customGeometry);
-    customMeshRenderer->setVertexCount(int(numVertices));
+    customMeshRenderer->setVertexCount(int(numIndices));
 
     this->addComponent(customMeshRenderer);
     this->addComponent(m_transform);
@@ -1112,37 +905,66 @@ void FacetedObject::Draw()
     QOpenGLFunctions_3_3_Core *f = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_3_Core>();
 #endif
 
-    if (m_VBOAllocated == false)
-    {
+    if (m_VBOAllocated == false && !m_ownedMesh)
+    {
+        // shared meshes are drawn from a single pair of buffers that belong to the mesh
+        QOpenGLContextGroup *contextGroup = QOpenGLContext::currentContext()->shareGroup();
+        if (!m_mesh->vertexBuffer.isCreated() || m_mesh->vertexBufferContextGroup != contextGroup)
+        {
+            m_mesh->vertexBuffer = QOpenGLBuffer();
+            m_mesh->vertexBuffer.create();
+            m_mesh->vertexBuffer.bind();
+            m_mesh->vertexBuffer.allocate(m_mesh->vertexList.data(), int(m_mesh->vertexList.size() * sizeof(GLfloat)));
+            m_mesh->vertexBuffer.release();
+            m_mesh->indexBuffer = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+            m_mesh->indexBuffer.create();
+            m_mesh->indexBuffer.bind();
+            m_mesh->indexBuffer.allocate(m_mesh->indexData(), int(m_mesh->indexDataSize()));
+            m_mesh->indexBuffer.release();
+            m_mesh->vertexBufferContextGroup = contextGroup;
+        }
+        m_VBO = m_mesh->vertexBuffer;
+        m_IBO = m_mesh->indexBuffer;
         m_VBOAllocated = true;
-        // order vertex data as x, y, z, xn, yn, zn, r, g, b, u, v
-        size_t vertBufSize = m_vertexList.size() + m_normalList.size() + m_colourList.size()  + m_uvList.size();
-        std::unique_ptr<GLfloat []> vertBuf = std::make_unique<GLfloat []>(vertBufSize);
-        GLfloat *vertBufPtr = vertBuf.get();
-        double *vertexListPtr = m_vertexList.data();
-        double *normalListPtr = m_normalList.data();
-        double *colourListPtr = m_colourList.data();
-        double *uvListPtr = m_uvList.data();
-        for (size_t i = 0; i < m_vertexList.size() / 3; i++)
+        m_VBOUpdateNeeded = false;
+    }
+    if (m_VBOAllocated && m_VBOUpdateNeeded)
+    {
+        // refilled objects reuse their buffers and only reallocate them if the size has changed
+        m_VBOUpdateNeeded = false;
+        int vertBufSize = int(m_mesh->vertexList.size() * sizeof(GLfloat));
+        m_VBO.bind();
+        if (m_VBO.size() == vertBufSize) m_VBO.write(0, m_mesh->vertexList.data(), vertBufSize);
+        else
+        {
+            m_VBO.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+            m_VBO.allocate(m_mesh->vertexList.data(), vertBufSize);
+        }
+        m_VBO.release();
+        int indexBufSize = int(m_mesh->indexDataSize());
+        m_IBO.bind();
+        if (m_IBO.size() == indexBufSize) m_IBO.write(0, m_mesh->indexData(), indexBufSize);
+        else
         {
-            *vertBufPtr++ = GLfloat(*vertexListPtr++);
-            *vertBufPtr++ = GLfloat(*vertexListPtr++);
-            *vertBufPtr++ = GLfloat(*vertexListPtr++);
-            *vertBufPtr++ = GLfloat(*normalListPtr++);
-            *vertBufPtr++ = GLfloat(*normalListPtr++);
-            *vertBufPtr++ = GLfloat(*normalListPtr++);
-            *vertBufPtr++ = GLfloat(*colourListPtr++);
-            *vertBufPtr++ = GLfloat(*colourListPtr++);
-            *vertBufPtr++ = GLfloat(*colourListPtr++);
-            *vertBufPtr++ = GLfloat(*uvListPtr++);
-            *vertBufPtr++ = GLfloat(*uvListPtr++);
+            m_IBO.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+            m_IBO.allocate(m_mesh->indexData(), indexBufSize);
         }
+        m_IBO.release();
+    }
+    if (m_VBOAllocated == false)
+    {
+        m_VBOAllocated = true;
+        m_VBOUpdateNeeded = false;
 
-        // Setup our vertex buffer object.
+        // Setup our vertex and index buffer objects.
         m_VBO.create();
         m_VBO.bind();
-        m_VBO.allocate(vertBuf.get(), int(vertBufSize * sizeof(GLfloat)));
+        m_VBO.allocate(m_mesh->vertexList.data(), int(m_mesh->vertexList.size() * sizeof(GLfloat)));
         m_VBO.release();
+        m_IBO.create();
+        m_IBO.bind();
+        m_IBO.allocate(m_mesh->indexData(), int(m_mesh->indexDataSize()));
+        m_IBO.release();
     }
     if (m_visible == false) return;
 
@@ -1166,6 +988,7 @@ void FacetedObject::Draw()
     m_simulationWidget->facetedObjectShader()->setAttributeBuffer("vertexUV", GL_FLOAT, offset, 2, stride);
 
     m_VBO.release();
+    if (m_mesh->indexed()) m_IBO.bind();
 
     // set the uniforms
     QMatrix4x4 model = this->model(); // this recalculates the model matrix
@@ -1204,22 +1027,35 @@ void FacetedObject::Draw()
         m_simulationWidget->facetedObjectShader()->setUniformValue("textureSampler", 0);
         m_simulationWidget->facetedObjectShader()->setUniformValue("hasTexture", true);
         m_texture->bind();
-        f->glDrawArrays(GL_TRIANGLES, 0, GLsizei(m_vertexList.size() / 3));
+        DrawTriangles(f);
         m_texture->release();
     }
     else
     {
         m_simulationWidget->facetedObjectShader()->setUniformValue("hasTexture", false);
-        f->glDrawArrays(GL_TRIANGLES, 0, GLsizei(m_vertexList.size() / 3));
+        DrawTriangles(f);
     }
 
     m_simulationWidget->facetedObjectShader()->disableAttributeArray("vertex");
     m_simulationWidget->facetedObjectShader()->disableAttributeArray("vertexNormal");
     m_simulationWidget->facetedObjectShader()->disableAttributeArray("vertexColour");
     m_simulationWidget->facetedObjectShader()->disableAttributeArray("vertexUV");
+    if (m_mesh->indexed()) m_IBO.release();
 
     m_simulationWidget->facetedObjectShader()->release();
 }
+
+// draws using the indices if the mesh has any otherwise the vertices are drawn in order
+void FacetedObject::DrawTriangles(QOpenGLFunctions_3_3_Core *f)
+{
+    if (m_mesh->indexed())
+    {
+        f->glDrawElements(GL_TRIANGLES, GLsizei(m_mesh->numIndices()), m_mesh->indexList16.size() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, nullptr);
+        return;
+    }
+    f->glDrawArrays(GL_TRIANGLES, 0, GLsizei(m_mesh->numVertices()));
+}
+
 #endif
 
 // Write a FacetedObject out as a POVRay file
@@ -1259,14 +1095,15 @@ void FacetedObject::WritePOVRay(std::ostringstream &theString)
     theString << "  mesh {\n";
 
     // first faces
-    for (i = 0; i < m_vertexList.size() / 9; i++)
+    for (i = 0; i < m_mesh->numTriangles(); i++)
     {
         theString << "    triangle {\n";
         for (j = 0; j < 3; j++)
         {
-            prel[0] = m_vertexList[i * 9 + j * 3];
-            prel[1] = m_vertexList[i * 9 + j * 3 + 1];
-            prel[2] = m_vertexList[i * 9 + j * 3 + 2];
+            const float *vertex = m_mesh->triangleVertex(i, j);
+            prel[0] = double(vertex[0]);
+            prel[1] = double(vertex[1]);
+            prel[2] = double(vertex[2]);
             prel[3] = 0;
             dMULTIPLY0_331(p, m_displayRotation, prel);
             result[0] = p[0] + m_displayPosition[0];
@@ -1327,47 +1164,40 @@ const double *FacetedObject::GetDisplayScale() const
 
 size_t FacetedObject::GetNumVertices() const
 {
-    return m_vertexList.size() / 3;
+    return m_mesh->numVertices();
 }
 
-const double *FacetedObject::GetVertex(size_t i) const
+pgd::Vector3 FacetedObject::GetVertex(size_t i) const
 {
-    return &m_vertexList.at(3 * i);
+    const float *vertex = m_mesh->vertex(i);
+    return pgd::Vector3(double(vertex[0]), double(vertex[1]), double(vertex[2]));
 }
 
-const double *FacetedObject::GetNormal(size_t i) const
+pgd::Vector3 FacetedObject::GetNormal(size_t i) const
 {
-    return &m_normalList.at(3 * i);
-}
-
-const double *FacetedObject::GetVertexList() const
-{
-    return m_vertexList.data();
-}
-
-const double *FacetedObject::GetNormalList() const
-{
-    return m_normalList.data();
-}
-
-const double *FacetedObject::GetColourList() const
-{
-    return m_colourList.data();
+    const float *normal = m_mesh->normal(i);
+    return pgd::Vector3(double(normal[0]), double(normal[1]), double(normal[2]));
 }
 
 size_t FacetedObject::GetNumTriangles() const
 {
-    return m_vertexList.size() / 9;
+    return m_mesh->numTriangles();
 }
 
-const double *FacetedObject::GetTriangle(size_t i) const
+void FacetedObject::GetTriangle(size_t i, double triangle[9]) const
 {
-    return &m_vertexList.at(9 * i);
+    for (size_t j = 0; j < 3; j++)
+    {
+        const float *vertex = m_mesh->triangleVertex(i, j);
+        triangle[j * 3] = double(vertex[0]);
+        triangle[j * 3 + 1] = double(vertex[1]);
+        triangle[j * 3 + 2] = double(vertex[2]);
+    }
 }
 
-double *FacetedObject::upperBound()
+const double *FacetedObject::upperBound() const
 {
-    return m_upperBound;
+    return m_mesh->upperBound;
 }
 
 SimulationWidget *FacetedObject::simulationWidget() const
@@ -1388,9 +1218,9 @@ void FacetedObject::setBlendColour(const QColor &blendColour, double blendFracti
     m_blendFraction = blendFraction;
 }
 
-double *FacetedObject::lowerBound()
+const double *FacetedObject::lowerBound() const
 {
-    return m_lowerBound;
+    return m_mesh->lowerBound;
 }
 
 // Write a FacetedObject out as a OBJ
@@ -1405,13 +1235,14 @@ void FacetedObject::WriteOBJFile(std::ostringstream &out)
     {
         // write out the vertices, faces, groups and objects
         // this is the relative version - inefficient but allows concatenation of objects
-        for (i = 0; i < m_vertexList.size() / 9; i++)
+        for (i = 0; i < m_mesh->numTriangles(); i++)
         {
             for (j = 0; j < 3; j++)
             {
-                prel[0] = m_vertexList[i * 9 + j * 3];
-                prel[1] = m_vertexList[i * 9 + j * 3 + 1];
-                prel[2] = m_vertexList[i * 9 + j * 3 + 2];
+                const float *vertex = m_mesh->triangleVertex(i, j);
+                prel[0] = double(vertex[0]);
+                prel[1] = double(vertex[1]);
+                prel[2] = double(vertex[2]);
                 ApplyDisplayTransformation(*reinterpret_cast<pgd::Vector3 *>(prel), reinterpret_cast<pgd::Vector3 *>(result));
                 out << "v " << result[0] << " " << result[1] << " " << result[2] << "\n";
             }
@@ -1428,31 +1259,30 @@ void FacetedObject::WriteOBJFile(std::ostringstream &out)
     }
     else
     {
-        for (i = 0; i < m_vertexList.size() / 9; i++)
+        // the shared vertices are written once and the faces refer to them by index
+        for (i = 0; i < m_mesh->numVertices(); i++)
         {
-            for (j = 0; j < 3; j++)
-            {
-                prel[0] = m_vertexList[i * 9 + j * 3];
-                prel[1] = m_vertexList[i * 9 + j * 3 + 1];
-                prel[2] = m_vertexList[i * 9 + j * 3 + 2];
-                ApplyDisplayTransformation(*reinterpret_cast<pgd::Vector3 *>(prel), reinterpret_cast<pgd::Vector3 *>(result));
-                out << "v " << result[0] << " " << result[1] << " " << result[2] << "\n";
-            }
+            const float *vertex = m_mesh->vertex(i);
+            prel[0] = double(vertex[0]);
+            prel[1] = double(vertex[1]);
+            prel[2] = double(vertex[2]);
+            ApplyDisplayTransformation(*reinterpret_cast<pgd::Vector3 *>(prel), reinterpret_cast<pgd::Vector3 *>(result));
+            out << "v " << result[0] << " " << result[1] << " " << result[2] << "\n";
         }
 
-        for (i = 0; i < m_vertexList.size() / 9; i++)
+        for (i = 0; i < m_mesh->numTriangles(); i++)
         {
             out << "f ";
             for (j = 0; j < 3; j++)
             {
                 // note this files vertex list start at 1 not zero
                 if (j == 2)
-                    out << i * 3 + j + 1 + m_vertexOffset << "\n";
+                    out << m_mesh->index(i * 3 + j) + 1 + m_vertexOffset << "\n";
                 else
-                    out << i * 3 + j + 1 + m_vertexOffset << " ";
+                    out << m_mesh->index(i * 3 + j) + 1 + m_vertexOffset << " ";
             }
         }
-        m_vertexOffset += m_vertexList.size() / 3;
+        m_vertexOffset += m_mesh->numVertices();
     }
 }
 
@@ -1465,8 +1295,8 @@ void FacetedObject::WriteUSDFile(std::ostringstream &out, const std::string &nam
 
     // create the extent string
     pgd::Vector3 lb, ub;
-    ApplyDisplayTransformation(m_lowerBound, &lb);
-    ApplyDisplayTransformation(m_upperBound, &ub);
+    ApplyDisplayTransformation(m_mesh->lowerBound, &lb);
+    ApplyDisplayTransformation(m_mesh->upperBound, &ub);
     std::vector<char> buffer(512);
     size_t l = std::snprintf(buffer.data(), buffer.size(), "(%g,%g,%g),(%g,%g,%g)", lb.x, lb.y, lb.z, ub.x, ub.y, ub.z);
     std::string extent(buffer.data(), l);
@@ -1474,16 +1304,16 @@ void FacetedObject::WriteUSDFile(std::ostringstream &out, const std::string &nam
     // now we need to split the mesh into triangles with the same colours
     pgd::Vector3 v;
     std::map<pgd::Vector3, std::vector<size_t>> colourMap;
-    size_t numVertices =  m_vertexList.size() / 3;
-    size_t numTriangles = numVertices / 3;
+    size_t numTriangles = m_mesh->numTriangles();
     for (size_t i = 0; i < numTriangles; i++)
     {
-        v.x = m_colourList[i * 9];
-        v.y = m_colourList[i * 9 + 1];
-        v.z = m_colourList[i * 9 + 2];
+        const float *colour = m_mesh->colour(m_mesh->index(i * 3));
+        v.x = double(colour[0]);
+        v.y = double(colour[1]);
+        v.z = double(colour[2]);
         auto it = colourMap.find(v);
         if (it == colourMap.end()) { colourMap[v] = std::vector<size_t>(); colourMap[v].reserve(numTriangles); }
-        colourMap[v].push_back(i * 3);
+        colourMap[v].push_back(i);
     }
 
     // output the materials
@@ -1540,16 +1370,19 @@ void FacetedObject::WriteUSDFile(std::ostringstream &out, const std::string &nam
 
             for (size_t j = 0; j < 3; j++)
             {
-                v1.x = m_vertexList[(it.second[i] + j) * 3]; // qDebug() << (it.second[i] + j) * 3;
-                v1.y = m_vertexList[(it.second[i] + j) * 3 + 1]; // qDebug() << (it.second[i] + j) * 3 + 1;
-                v1.z = m_vertexList[(it.second[i] + j) * 3 + 2]; // qDebug() << (it.second[i] + j) * 3 + 2;
+                size_t index = m_mesh->index(it.second[i] * 3 + j);
+                const float *vertex = m_mesh->vertex(index);
+                v1.x = double(vertex[0]);
+                v1.y = double(vertex[1]);
+                v1.z = double(vertex[2]);
                 ApplyDisplayTransformation(v1, &v2);
                 std::snprintf(buffer.data(), buffer.size(), "(%g,%g,%g),", v2.x, v2.y, v2.z);
                 for (char *ptr = buffer.data(); *ptr != 0; ptr++) { points.push_back(*ptr); }
 
-                v1.x = m_normalList[(it.second[i] + j) * 3];
-                v1.y = m_normalList[(it.second[i] + j) * 3 + 1];
-                v1.z = m_normalList[(it.second[i] + j) * 3 + 2];
+                const float *normal = m_mesh->normal(index);
+                v1.x = double(normal[0]);
+                v1.y = double(normal[1]);
+                v1.z = double(normal[2]);
                 ApplyDisplayTransformation(v1, &v2);
                 std::snprintf(buffer.data(), buffer.size(), "(%g,%g,%g),", v2.x, v2.y, v2.z);
                 for (char *ptr = buffer.data(); *ptr != 0; ptr++) { normals.push_back(*ptr); }
@@ -1627,18 +1460,33 @@ void FacetedObject::ComputeFaceNormal(const double *v1, const double *v2, const
 void FacetedObject::Move(double x, double y, double z)
 {
     if (x == 0.0 && y == 0.0 && z == 0.0) return;
-    for (size_t i = 0; i < m_vertexList.size() / 3; i++)
+    // stored meshes are moved into a new stored mesh so that objects using the same file with the same offset still share
+    std::string movedPath;
+    if (!m_ownedMesh && m_mesh->path.size())
+    {
+        char buf[128];
+        std::snprintf(buf, sizeof(buf), "\nMove %.17g %.17g %.17g", x, y, z);
+        movedPath = m_mesh->path + buf;
+        if (UseStoredMesh(movedPath)) return;
+    }
+    MeshStoreObject *mesh = mutableMesh();
+    for (size_t i = 0; i < mesh->vertexList.size(); i += MeshStoreObject::vertexStride)
     {
-        m_vertexList[i * 3] += x;
-        m_vertexList[i * 3 + 1] += y;
-        m_vertexList[i * 3 + 2] += z;
+        mesh->vertexList[i] = float(double(mesh->vertexList[i]) + x);
+        mesh->vertexList[i + 1] = float(double(mesh->vertexList[i + 1]) + y);
+        mesh->vertexList[i + 2] = float(double(mesh->vertexList[i + 2]) + z);
+    }
+    mesh->lowerBound[0] += x;
+    mesh->lowerBound[1] += y;
+    mesh->lowerBound[2] += z;
+    mesh->upperBound[0] += x;
+    mesh->upperBound[1] += y;
+    mesh->upperBound[2] += z;
+    if (movedPath.size())
+    {
+        mesh->path = movedPath;
+        StoreMesh();
     }
-    m_lowerBound[0] += x;
-    m_lowerBound[1] += y;
-    m_lowerBound[2] += z;
-    m_upperBound[0] += x;
-    m_upperBound[1] += y;
-    m_upperBound[2] += z;
 }
 
 // scale the object
@@ -1646,18 +1494,19 @@ void FacetedObject::Move(double x, double y, double z)
 void FacetedObject::Scale(double x, double y, double z)
 {
     if (x == 1.0 && y == 1.0 && z == 1.0) return;
-    for (size_t i = 0; i < m_vertexList.size() / 3; i++)
+    MeshStoreObject *mesh = mutableMesh();
+    for (size_t i = 0; i < mesh->vertexList.size(); i += MeshStoreObject::vertexStride)
     {
-        m_vertexList[i * 3] *= x;
-        m_vertexList[i * 3 + 1] *= y;
-        m_vertexList[i * 3 + 2] *= z;
+        mesh->vertexList[i] = float(double(mesh->vertexList[i]) * x);
+        mesh->vertexList[i + 1] = float(double(mesh->vertexList[i + 1]) * y);
+        mesh->vertexList[i + 2] = float(double(mesh->vertexList[i + 2]) * z);
     }
-    m_lowerBound[0] *= x;
-    m_lowerBound[1] *= y;
-    m_lowerBound[2] *= z;
-    m_upperBound[0] *= x;
-    m_upperBound[1] *= y;
-    m_upperBound[2] *= z;
+    mesh->lowerBound[0] *= x;
+    mesh->lowerBound[1] *= y;
+    mesh->lowerBound[2] *= z;
+    mesh->upperBound[0] *= x;
+    mesh->upperBound[1] *= y;
+    mesh->upperBound[2] *= z;
 }
 
 // rotate the object
@@ -1666,23 +1515,24 @@ void FacetedObject::Rotate(double x, double y, double z, double angleDegrees)
 {
     Q_ASSERT_X(x != 0 || y != 0 || z != 0, "Axis must be non-zero", "FacetedObject::Rotate");
     if (angleDegrees == 0) return;
+    MeshStoreObject *mesh = mutableMesh();
     pgd::Quaternion q = pgd::MakeQFromAxisAngle(x, y, z, pgd::DegreesToRadians(angleDegrees));
     pgd::Vector3 v;
-    for (size_t i = 0; i < m_vertexList.size() / 3; i++)
+    for (size_t i = 0; i < mesh->vertexList.size(); i += MeshStoreObject::vertexStride)
     {
-        v = pgd::QVRotate(q, pgd::Vector3(m_vertexList[i * 3], m_vertexList[i * 3 + 1], m_vertexList[i * 3 + 2]));
-        m_vertexList[i * 3] = v.x;
-        m_vertexList[i * 3 + 1] = v.y;
-        m_vertexList[i * 3 + 2] = v.z;
+        v = pgd::QVRotate(q, pgd::Vector3(double(mesh->vertexList[i]), double(mesh->vertexList[i + 1]), double(mesh->vertexList[i + 2])));
+        mesh->vertexList[i] = float(v.x);
+        mesh->vertexList[i + 1] = float(v.y);
+        mesh->vertexList[i + 2] = float(v.z);
     }
-    v = pgd::QVRotate(q, m_lowerBound);
-    m_lowerBound[0] = v.x;
-    m_lowerBound[1] = v.y;
-    m_lowerBound[2] = v.z;
-    v = pgd::QVRotate(q, m_upperBound);
-    m_upperBound[0] = v.x;
-    m_upperBound[1] = v.y;
-    m_upperBound[2] = v.z;
+    v = pgd::QVRotate(q, mesh->lowerBound);
+    mesh->lowerBound[0] = v.x;
+    mesh->lowerBound[1] = v.y;
+    mesh->lowerBound[2] = v.z;
+    v = pgd::QVRotate(q, mesh->upperBound);
+    mesh->upperBound[0] = v.x;
+    mesh->upperBound[1] = v.y;
+    mesh->upperBound[2] = v.z;
 }
 
 
@@ -1821,44 +1671,17 @@ void FacetedObject::AddPolygon(const double *vertices, size_t nSides, const doub
 // x1, y1, z1, x2, y2, z2, x3, y3, z3
 void FacetedObject::AddTriangle(const double *vertices, const double *normals, const double *UVs)
 {
-    Q_ASSERT_X(m_vertexList.capacity() - m_vertexList.size() >= 9, "FacetedObject::AddTriangle", "Warning: not enough triangle space reserved");
-    pgd::Vector3 vertex;
-    for (size_t i = 0; i < 3; i++)
-    {
-        vertex.x = vertices[i * 3 + 0];
-        vertex.y = vertices[i * 3 + 1];
-        vertex.z = vertices[i * 3 + 2];
-        m_vertexList.push_back(vertex.x);
-        m_vertexList.push_back(vertex.y);
-        m_vertexList.push_back(vertex.z);
-        if (vertex.x < m_lowerBound[0]) m_lowerBound[0] = vertex.x;
-        if (vertex.y < m_lowerBound[1]) m_lowerBound[1] = vertex.y;
-        if (vertex.z < m_lowerBound[2]) m_lowerBound[2] = vertex.z;
-        if (vertex.x > m_upperBound[0]) m_upperBound[0] = vertex.x;
-        if (vertex.y > m_upperBound[1]) m_upperBound[1] = vertex.y;
-        if (vertex.z > m_upperBound[2]) m_upperBound[2] = vertex.z;
-    }
-    if (normals)
-    {
-        for (size_t i = 0; i < 9; i++) m_normalList.push_back(normals[i]);
-    }
-    else
-    {
-        // calculate the normals
-        double normal[3];
-        ComputeFaceNormal(vertices, vertices + 3, vertices + 6, normal);
-        for (size_t i = 0; i < 9; i++) m_normalList.push_back(normal[i % 3]);
-    }
-    if (UVs)
-    {
-        for (size_t i = 0; i < 6; i++) m_uvList.push_back(UVs[i]);
-    }
-    else
-    {
-        for (size_t i = 0; i < 6; i++) m_uvList.push_back(0);
-    }
+    MeshStoreObject *mesh = mutableMesh();
+    Q_ASSERT_X(mesh->vertexList.capacity() - mesh->vertexList.size() >= 3 * MeshStoreObject::vertexStride, "FacetedObject::AddTriangle", "Warning: not enough triangle space reserved");
+    // procedurally generated triangles are not welded so each triangle gets its own vertices
+    double normal[3];
+    if (!normals) ComputeFaceNormal(vertices, vertices + 3, vertices + 6, normal);
+    const double zeroUV[2] = {0, 0};
     double colour[3] = {m_blendColour.redF(), m_blendColour.greenF(), m_blendColour.blueF() };
-    for (size_t i = 0; i < 9; i++) m_colourList.push_back(colour[i % 3]);
+    uint32_t firstIndex = uint32_t(mesh->numVertices());
+    for (size_t i = 0; i < 3; i++)
+        mesh->addVertex(vertices + i * 3, normals ? normals + i * 3 : normal, colour, UVs ? UVs + i * 2 : zeroUV);
+    if (mesh->indexed()) mesh->addTriangleIndices(firstIndex, firstIndex + 1, firstIndex + 2);
 }
 
 // this routine triangulates the polygon and calls AddTriangle to do the actual data adding
@@ -1953,10 +1776,16 @@ void FacetedObject::AddTriangle(const float *floatVertices, const float *floatNo
 void FacetedObject::AllocateMemory(size_t numTriangles)
 {
 //    qDebug() << "Allocated " << numTriangles << " triangles\n";
-    m_vertexList.reserve(numTriangles * 9);
-    m_normalList.reserve(numTriangles * 9);
-    m_colourList.reserve(numTriangles * 9);
-    m_uvList.reserve(numTriangles * 6);
+    MeshStoreObject *mesh = mutableMesh();
+    mesh->reserve(numTriangles);
+}
+
+void FacetedObject::ClearTriangles()
+{
+    if (!m_ownedMesh) NewMesh(std::string()); // no point copying a shared mesh just to clear it
+    MeshStoreObject *mesh = m_ownedMesh.get();
+    mesh->clear();
+    m_VBOUpdateNeeded = true;
 }
 
 // return an ODE style trimesh
@@ -1969,22 +1798,23 @@ void FacetedObject::CalculateTrimesh(double **vertices, int *numVertices, int *v
     *vertexStride = 3 * sizeof(double);
     *triStride = 3 * sizeof(dTriIndex);
 
-    *numVertices = int((m_vertexList.size() / 3));
-    *numTriIndexes = int((m_vertexList.size() / 3));
+    *numVertices = int(m_mesh->numVertices());
+    *numTriIndexes = int(m_mesh->numIndices());
 
-    *vertices = new double[(m_vertexList.size() / 3) * 3];
-    *triIndexes = new dTriIndex[(m_vertexList.size() / 3)];
+    *vertices = new double[m_mesh->numVertices() * 3];
+    *triIndexes = new dTriIndex[m_mesh->numIndices()];
 
-    for (i = 0; i < (m_vertexList.size() / 3); i++)
+    for (i = 0; i < m_mesh->numVertices(); i++)
     {
-        (*vertices)[i * 3] = m_vertexList[i * 3];
-        (*vertices)[i * 3 + 1] = m_vertexList[i * 3 + 1];
-        (*vertices)[i * 3 + 2] = m_vertexList[i * 3 + 2];
+        const float *vertex = m_mesh->vertex(i);
+        (*vertices)[i * 3] = double(vertex[0]);
+        (*vertices)[i * 3 + 1] = double(vertex[1]);
+        (*vertices)[i * 3 + 2] = double(vertex[2]);
     }
 
-    for (i = 0; i < (m_vertexList.size() / 3); i++)
+    for (i = 0; i < m_mesh->numIndices(); i++)
     {
-        (*triIndexes)[i] = dTriIndex(i);
+        (*triIndexes)[i] = dTriIndex(m_mesh->index(i));
     }
 }
 
@@ -1998,22 +1828,23 @@ void FacetedObject::CalculateTrimesh(float **vertices, int *numVertices, int *ve
     *vertexStride = 3 * sizeof(float);
     *triStride = 3 * sizeof(dTriIndex);
 
-    *numVertices = int((m_vertexList.size() / 3));
-    *numTriIndexes = int((m_vertexList.size() / 3));
+    *numVertices = int(m_mesh->numVertices());
+    *numTriIndexes = int(m_mesh->numIndices());
 
-    *vertices = new float[(m_vertexList.size() / 3) * 3];
-    *triIndexes = new dTriIndex[(m_vertexList.size() / 3)];
+    *vertices = new float[m_mesh->numVertices() * 3];
+    *triIndexes = new dTriIndex[m_mesh->numIndices()];
 
-    for (i = 0; i < (m_vertexList.size() / 3); i++)
+    for (i = 0; i < m_mesh->numVertices(); i++)
     {
-        (*vertices)[i * 3] = float(m_vertexList[i * 3]);
-        (*vertices)[i * 3 + 1] = float(m_vertexList[i * 3 + 1]);
-        (*vertices)[i * 3 + 2] = float(m_vertexList[i * 3 + 2]);
+        const float *vertex = m_mesh->vertex(i);
+        (*vertices)[i * 3] = vertex[0];
+        (*vertices)[i * 3 + 1] = vertex[1];
+        (*vertices)[i * 3 + 2] = vertex[2];
     }
 
-    for (i = 0; i < (m_vertexList.size() / 3); i++)
+    for (i = 0; i < m_mesh->numIndices(); i++)
     {
-        (*triIndexes)[i] = dTriIndex(i);
+        (*triIndexes)[i] = dTriIndex(m_mesh->index(i));
     }
 }
 
@@ -2038,7 +1869,7 @@ void FacetedObject::CalculateMassProperties(dMass *m, double density, bool clock
 
     // assumes anticlockwise winding
 
-    unsigned int triangles = static_cast<unsigned int>((m_vertexList.size() / 3) / 3);
+    unsigned int triangles = static_cast<unsigned int>(m_mesh->numTriangles());
 
     double nx, ny, nz;
     unsigned int i, j, A, B, C;
@@ -2060,18 +1891,20 @@ void FacetedObject::CalculateMassProperties(dMass *m, double density, bool clock
         {
             for (j = 0; j < 3; j++)
             {
-                v[j][0] = m_vertexList[i * 9 + j * 3] + translation[0];
-                v[j][1] = m_vertexList[i * 9 + j * 3 + 1] + translation[1];
-                v[j][2] = m_vertexList[i * 9 + j * 3 + 2] + translation[2];
+                const float *vertex = m_mesh->triangleVertex(i, j);
+                v[j][0] = double(vertex[0]) + translation[0];
+                v[j][1] = double(vertex[1]) + translation[1];
+                v[j][2] = double(vertex[2]) + translation[2];
             }
         }
         else
         {
             for (j = 0; j < 3; j++)
             {
-                v[j][2] = m_vertexList[i * 9 + j * 3] + translation[0];
-                v[j][1] = m_vertexList[i * 9 + j * 3 + 1] + translation[1];
-                v[j][0] = m_vertexList[i * 9 + j * 3 + 2] + translation[2];
+                const float *vertex = m_mesh->triangleVertex(i, j);
+                v[j][2] = double(vertex[0]) + translation[0];
+                v[j][1] = double(vertex[1]) + translation[1];
+                v[j][0] = double(vertex[2]) + translation[2];
             }
         }
 
@@ -2270,19 +2103,22 @@ void FacetedObject::CalculateMassProperties(dMass *m, double density, bool clock
 // reverse the face winding
 void FacetedObject::ReverseWinding()
 {
-    double t;
-    size_t numTriangles = (m_vertexList.size() / 3) / 3;
-    size_t i, j;
-    for (i = 0; i < numTriangles; i++)
+    MeshStoreObject *mesh = mutableMesh();
+    size_t i;
+    for (i = 0; i + 2 < mesh->indexList16.size(); i += 3) std::swap(mesh->indexList16[i + 1], mesh->indexList16[i + 2]);
+    for (i = 0; i + 2 < mesh->indexList32.size(); i += 3) std::swap(mesh->indexList32[i + 1], mesh->indexList32[i + 2]);
+    if (!mesh->indexed())
     {
-        for (j = 0; j < 3; j++)
-        {
-            t = m_vertexList[i * 9 + 3 + j];
-            m_vertexList[i * 9 + 3 + j] = m_vertexList[i * 9 + 6 + j];
-            m_vertexList[i * 9 + 6 + j] = t;
-        }
+        const size_t stride = MeshStoreObject::vertexStride;
+        for (i = 0; i + 3 * stride <= mesh->vertexList.size(); i += 3 * stride)
+            std::swap_ranges(mesh->vertexList.begin() + std::ptrdiff_t(i + stride), mesh->vertexList.begin() + std::ptrdiff_t(i + 2 * stride), mesh->vertexList.begin() + std::ptrdiff_t(i + 2 * stride));
+    }
+    for (i = 0; i < mesh->vertexList.size(); i += MeshStoreObject::vertexStride)
+    {
+        mesh->vertexList[i + 3] = -mesh->vertexList[i + 3];
+        mesh->vertexList[i + 4] = -mesh->vertexList[i + 4];
+        mesh->vertexList[i + 5] = -mesh->vertexList[i + 5];
     }
-    for (i = 0; i < m_normalList.size(); i++) m_normalList[i] = -m_normalList[i];
 }
 
 // add the faces from one faceted object to another
@@ -2290,54 +2126,41 @@ void FacetedObject::ReverseWinding()
 // there is probably no good reason currently not to use useDirectAccess
 void FacetedObject::AddFacetedObject(const FacetedObject *object, bool useDisplayRotation, bool useDirectAccess)
 {
+    MeshStoreObject *mesh = mutableMesh();
     if (useDirectAccess)
     {
-        size_t offset = m_vertexList.size();
-        m_vertexList.resize(offset + object->m_vertexList.size());
-        m_normalList.resize(offset + object->m_normalList.size());
-        m_colourList.resize(offset + object->m_colourList.size());
-        size_t offsetUV = m_uvList.size();
-        m_uvList.resize(offsetUV + object->m_uvList.size());
-        if (useDisplayRotation)
-        {
-            for (size_t i = 0; i < object->m_vertexList.size(); i += 3)
-            {
-                ApplyDisplayTransformation(&object->m_vertexList[i], reinterpret_cast<pgd::Vector3 *>(&m_vertexList[i + offset]));
-                ApplyDisplayRotation(&object->m_normalList[i], reinterpret_cast<pgd::Vector3 *>(&m_normalList[i + offset]));
-            }
-            for (size_t i = 0; i < object->m_colourList.size(); i++) m_colourList[i + offset] = object->m_colourList[i];
-            for (size_t i = 0; i < object->m_uvList.size(); i++) m_uvList[i + offsetUV] = object->m_uvList[i];
-            pgd::Vector3 lower, upper;
-            ApplyDisplayTransformation(m_lowerBound, &lower);
-            ApplyDisplayTransformation(m_upperBound, &upper);
-            if (lower.x < m_lowerBound[0]) m_lowerBound[0] = lower.x;
-            if (lower.y < m_lowerBound[1]) m_lowerBound[1] = lower.y;
-            if (lower.z < m_lowerBound[2]) m_lowerBound[2] = lower.z;
-            if (upper.x > m_upperBound[0]) m_upperBound[0] = upper.x;
-            if (upper.y > m_upperBound[1]) m_upperBound[1] = upper.y;
-            if (upper.z > m_upperBound[2]) m_upperBound[2] = upper.z;
-        }
-        else
-        {
-            for (size_t i = 0; i < object->m_vertexList.size(); i++)
+        // the vertices are appended as they are and any indices are offset to point at them
+        const MeshStoreObject *other = object->m_mesh.get();
+        bool indexed = mesh->indexed() || other->indexed();
+        if (indexed) mesh->useIndexList32();
+        uint32_t offset = uint32_t(mesh->numVertices());
+        mesh->vertexList.reserve(mesh->vertexList.size() + other->vertexList.size());
+        pgd::Vector3 vertex, normal;
+        double colour[3], uv[2];
+        for (size_t i = 0; i < other->numVertices(); i++)
+        {
+            const float *p = other->vertex(i);
+            vertex.Set(double(p[0]), double(p[1]), double(p[2]));
+            p = other->normal(i);
+            normal.Set(double(p[0]), double(p[1]), double(p[2]));
+            p = other->colour(i);
+            colour[0] = double(p[0]); colour[1] = double(p[1]); colour[2] = double(p[2]);
+            p = other->uv(i);
+            uv[0] = double(p[0]); uv[1] = double(p[1]);
+            if (useDisplayRotation)
             {
-                m_vertexList[i + offset] = object->m_vertexList[i];
-                m_normalList[i + offset] = object->m_normalList[i];
-                m_colourList[i + offset] = object->m_colourList[i];
+                ApplyDisplayTransformation(vertex, &vertex);
+                ApplyDisplayRotation(normal, &normal);
             }
-            for (size_t i = 0; i < object->m_uvList.size(); i++) m_uvList[i + offsetUV] = object->m_uvList[i];
-            if (object->m_lowerBound[0] < m_lowerBound[0]) m_lowerBound[0] = object->m_lowerBound[0];
-            if (object->m_lowerBound[1] < m_lowerBound[1]) m_lowerBound[1] = object->m_lowerBound[1];
-            if (object->m_lowerBound[2] < m_lowerBound[2]) m_lowerBound[2] = object->m_lowerBound[2];
-            if (object->m_upperBound[0] > m_upperBound[0]) m_upperBound[0] = object->m_upperBound[0];
-            if (object->m_upperBound[1] > m_upperBound[1]) m_upperBound[1] = object->m_upperBound[1];
-            if (object->m_upperBound[2] > m_upperBound[2]) m_upperBound[2] = object->m_upperBound[2];
+            mesh->addVertex(vertex.constData(), normal.constData(), colour, uv);
         }
+        for (size_t i = 0; indexed && i < other->numTriangles(); i++)
+            mesh->addTriangleIndices(offset + other->index(i * 3), offset + other->index(i * 3 + 1), offset + other->index(i * 3 + 2));
     }
     else
     {
         size_t numTriangles = object->GetNumTriangles();
-        const double *triangle;
+        double triangle[9];
         const double *p1;
         double *p2;
         double triangle2[9];
@@ -2347,7 +2170,7 @@ void FacetedObject::AddFacetedObject(const FacetedObject *object, bool useDispla
         {
             for (size_t i = 0; i < numTriangles; i++)
             {
-                triangle = object->GetTriangle(i);
+                object->GetTriangle(i, triangle);
                 for (int j = 0; j < 3; j++)
                 {
                     p1 = triangle + 3 * j;
@@ -2368,7 +2191,7 @@ void FacetedObject::AddFacetedObject(const FacetedObject *object, bool useDispla
         {
             for (size_t i = 0; i < numTriangles; i++)
             {
-                triangle = object->GetTriangle(i);
+                object->GetTriangle(i, triangle);
                 AddTriangle(triangle);
             }
         }
@@ -2509,43 +2332,34 @@ bool FacetedObject::HitBoundingBox(const double minB[HITBOUNDINBOX_NUMDIM], cons
 // this routine works in model coordinates and rayVector must be unit length
 int FacetedObject::FindIntersection(const pgd::Vector3 &rayOrigin, const pgd::Vector3 &rayVector, std::vector<pgd::Vector3> *intersectionCoordList, std::vector<size_t> *intersectionIndexList) const
 {
-    if (!m_visible || !m_vertexList.size()) return 0;
+    if (!m_visible || !m_mesh->numTriangles()) return 0;
 
     // first check bounding box
     double coord[3];
-    bool bbHit = HitBoundingBox(m_lowerBound, m_upperBound, rayOrigin.constData(), rayVector.constData(), coord);
+    bool bbHit = HitBoundingBox(m_mesh->lowerBound, m_mesh->upperBound, rayOrigin.constData(), rayVector.constData(), coord);
     if (!bbHit) return 0;
 
-    // now loop through the triangles
+    // now test the triangles whose bounding boxes are hit
+    std::vector<uint32_t> candidates;
+    m_mesh->bvh()->FindCandidates(rayOrigin.constData(), rayVector.constData(), &candidates);
     bool triHit;
     int hitCount = 0;
     pgd::Vector3 outIntersectionPoint;
-    for (size_t i = 0; i < m_vertexList.size(); i += 9)
+    pgd::Vector3 v[3];
+    for (auto &&i : candidates)
     {
-#ifdef PRECHECK_BOUNDINGBOX
-        double lowerBound[3] = {std::min({m_vertexList[i], m_vertexList[i + 3], m_vertexList[i + 6]}), std::min({m_vertexList[i + 1], m_vertexList[i + 4], m_vertexList[i + 7]}), std::min({m_vertexList[i + 2], m_vertexList[i + 5], m_vertexList[i + 8]})};
-        double upperBound[3] = {std::max({m_vertexList[i], m_vertexList[i + 3], m_vertexList[i + 6]}), std::max({m_vertexList[i + 1], m_vertexList[i + 4], m_vertexList[i + 7]}), std::max({m_vertexList[i + 2], m_vertexList[i + 5], m_vertexList[i + 8]})};
-        bbHit = HitBoundingBox(lowerBound, upperBound, rayOrigin.constData(), rayVector.constData(), coord);
-        if (bbHit)
+        for (size_t j = 0; j < 3; j++)
         {
-            triHit = RayIntersectsTriangle(rayOrigin, rayVectorNorm, &m_vertexList[i], &m_vertexList[i + 3], &m_vertexList[i + 6], &outIntersectionPoint);
-            if (triHit)
-            {
-                hitCount++;;
-                if (intersectionCoordList) intersectionCoordList->push_back(outIntersectionPoint);
-                if (intersectionIndexList) intersectionIndexList->push_back(i);
-            }
+            const float *vertex = m_mesh->triangleVertex(i, j);
+            v[j].Set(double(vertex[0]), double(vertex[1]), double(vertex[2]));
         }
-#else
-        triHit = RayIntersectsTriangle(rayOrigin, rayVector, &m_vertexList[i], &m_vertexList[i + 3], &m_vertexList[i + 6], &outIntersectionPoint);
+        triHit = RayIntersectsTriangle(rayOrigin, rayVector, v[0], v[1], v[2], &outIntersectionPoint);
         if (triHit)
         {
             hitCount++;
             if (intersectionCoordList) intersectionCoordList->push_back(outIntersectionPoint);
             if (intersectionIndexList) intersectionIndexList->push_back(i);
         }
-#endif
-
     }
     return hitCount;
 }
@@ -2597,6 +2411,86 @@ void FacetedObject::ClearMeshStore()
     m_meshStore.clear();
 }
 
+bool FacetedObject::IsMeshStored(const std::string &path)
+{
+    return m_meshStore.getMesh(path) != nullptr;
+}
+
+void FacetedObject::AddMeshToStore(const std::shared_ptr<const MeshStoreObject> &mesh)
+{
+    m_meshStore.setTargetMemory(Preferences::valueDouble("MeshStoreMemoryFraction"));
+    m_meshStore.addMesh(mesh);
+}
+
+// use the stored copy of a mesh if there is one
+bool FacetedObject::UseStoredMesh(const std::string &path)
+{
+    if (!m_useMeshStore) return false;
+    std::shared_ptr<const MeshStoreObject> mesh = m_meshStore.getMesh(path);
+    if (!mesh) return false;
+    m_mesh = std::move(mesh);
+    m_ownedMesh.reset();
+    ResetVertexBuffer();
+    return true;
+}
+
+// use the copy of a mesh in the disk cache if it is up to date
+bool FacetedObject::UseCachedMesh(const std::string &path)
+{
+    std::shared_ptr<MeshStoreObject> mesh = MeshCache::Read(path, m_blendColour);
+    if (!mesh) return false;
+    m_ownedMesh = std::move(mesh);
+    m_mesh = m_ownedMesh;
+    ResetVertexBuffer();
+    StoreMesh();
+    return true;
+}
+
+// start a new empty mesh that belongs to this object
+MeshStoreObject *FacetedObject::NewMesh(const std::string &path)
+{
+    m_ownedMesh = std::make_shared<MeshStoreObject>();
+    m_ownedMesh->path = path;
+    m_mesh = m_ownedMesh;
+    ResetVertexBuffer();
+    return m_ownedMesh.get();
+}
+
+// hand the mesh over to the MeshStore after which it is shared and will not be changed
+void FacetedObject::StoreMesh()
+{
+    if (!m_useMeshStore) return;
+    AddMeshToStore(m_mesh);
+    m_ownedMesh.reset();
+}
+
+// copy on write so that a shared mesh is never changed
+MeshStoreObject *FacetedObject::mutableMesh()
+{
+    if (m_ownedMesh)
+    {
+        m_ownedMesh->bvhCache.reset();
+        return m_ownedMesh.get();
+    }
+    m_ownedMesh = std::make_shared<MeshStoreObject>();
+    m_ownedMesh->vertexList = m_mesh->vertexList;
+    m_ownedMesh->indexList16 = m_mesh->indexList16;
+    m_ownedMesh->indexList32 = m_mesh->indexList32;
+    std::copy_n(m_mesh->lowerBound, 3, m_ownedMesh->lowerBound);
+    std::copy_n(m_mesh->upperBound, 3, m_ownedMesh->upperBound);
+    m_mesh = m_ownedMesh;
+    ResetVertexBuffer();
+    return m_ownedMesh.get();
+}
+
+void FacetedObject::ResetVertexBuffer()
+{
+    m_VBO = QOpenGLBuffer();
+    m_IBO = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+    m_VBOAllocated = false;
+    m_VBOUpdateNeeded = false;
+}
+
 bool FacetedObject::visible() const
 {
     return m_visible;
@@ -2658,6 +2552,21 @@ std::string FacetedObject::filename() const
     return m_filename;
 }
 
+std::shared_ptr<const MeshStoreObject> FacetedObject::mesh() const
+{
+    return m_mesh;
+}
+
+bool FacetedObject::useMeshStore() const
+{
+    return m_useMeshStore;
+}
+
+void FacetedObject::setUseMeshStore(bool useMeshStore)
+{
+    m_useMeshStore = useMeshStore;
+}
+
 QColor FacetedObject::blendColour() const
 {
     return m_blendColour;
@@ -2670,11 +2579,11 @@ double FacetedObject::blendFraction() const
 
 double FacetedObject::boundingBoxVolume()
 {
-    return (m_upperBound[0] - m_lowerBound[0]) * (m_upperBound[1] - m_lowerBound[1]) * (m_upperBound[2] - m_lowerBound[2]);
+    return (m_mesh->upperBound[0] - m_mesh->lowerBound[0]) * (m_mesh->upperBound[1] - m_mesh->lowerBound[1]) * (m_mesh->upperBound[2] - m_mesh->lowerBound[2]);
 }
 
 pgd::Vector3 FacetedObject::boundingBoxSize()
 {
-    return pgd::Vector3(m_upperBound[0] - m_lowerBound[0], m_upperBound[1] - m_lowerBound[1], m_upperBound[2] - m_lowerBound[2]);
+    return pgd::Vector3(m_mesh->upperBound[0] - m_mesh->lowerBound[0], m_mesh->upperBound[1] - m_mesh->lowerBound[1], m_mesh->upperBound[2] - m_mesh->lowerBound[2]);
 }
 
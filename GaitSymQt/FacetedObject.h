@@ -21,6 +21,7 @@ class SimulationWidget;
 class DataFile;
 class TrimeshGeom;
 class QOpenGLTexture;
+class QOpenGLFunctions_3_3_Core;
 
 #ifdef USE_QT3D
 #include <Qt3DCore>
@@ -81,13 +82,10 @@ public:
     virtual void WriteUSDFile(std::ostringstream &out, const std::string &name);
 
     size_t GetNumVertices() const;
-    const double *GetVertex(size_t i) const;
-    const double *GetNormal(size_t i) const;
-    const double *GetVertexList() const;
-    const double *GetNormalList() const;
-    const double *GetColourList() const;
+    pgd::Vector3 GetVertex(size_t i) const;
+    pgd::Vector3 GetNormal(size_t i) const;
     size_t GetNumTriangles() const;
-    const double *GetTriangle(size_t i) const;
+    void GetTriangle(size_t i, double triangle[9]) const;
     const double *GetDisplayPosition() const;
     const double *GetDisplayRotation() const;
     const double *GetDisplayScale() const;
@@ -101,6 +99,8 @@ public:
     // static utilities
     static void ComputeFaceNormal(const double *v1, const double *v2, const double *v3, double normal[3]);
     static void ClearMeshStore();
+    static bool IsMeshStored(const std::string &path);
+    static void AddMeshToStore(const std::shared_ptr<const MeshStoreObject> &mesh);
 
     // manipulation functions
     void Move(double x, double y, double z);
@@ -112,6 +112,7 @@ public:
     // utility
     void ReverseWinding();
     void AllocateMemory(size_t numTriangles);
+    void ClearTriangles(); // keeps the memory and the GPU buffer so that the object can be refilled with the same topology
     void ApplyDisplayTransformation(const pgd::Vector3 inVec, pgd::Vector3 *outVec);
     void ApplyDisplayRotation(const pgd::Vector3 inVec, pgd::Vector3 *outVec);
 
@@ -120,8 +121,8 @@ public:
     void CalculateTrimesh(float **vertices, int *numVertices, int *vertexStride, dTriIndex **triIndexes, int *numTriIndexes, int *triStride);
     void CalculateMassProperties(dMass *m, double density, bool clockwise, double *translation);
 
-    double *lowerBound();
-    double *upperBound();
+    const double *lowerBound() const;
+    const double *upperBound() const;
     double boundingBoxVolume();
     pgd::Vector3 boundingBoxSize();
 
@@ -156,16 +157,31 @@ public:
 
     std::string filename() const;
 
-private:
+    std::shared_ptr<const MeshStoreObject> mesh() const;
+
+    // objects that do not use the mesh store do not touch any shared state when parsing
+    // so they can be used to load meshes on worker threads
+    bool useMeshStore() const;
+    void setUseMeshStore(bool useMeshStore);
 
-    std::vector<double> m_vertexList;
-    std::vector<double> m_normalList;
-    std::vector<double> m_colourList;
-    std::vector<double> m_uvList;
+private:
+#ifndef USE_QT3D
+    void DrawTriangles(QOpenGLFunctions_3_3_Core *f);
+#endif
+    bool UseStoredMesh(const std::string &path);
+    bool UseCachedMesh(const std::string &path);
+    MeshStoreObject *NewMesh(const std::string &path);
+    void StoreMesh();
+    MeshStoreObject *mutableMesh();
+    void ResetVertexBuffer();
+
+    // the mesh can be shared with the MeshStore and other FacetedObjects so it is only changed via mutableMesh()
+    // which makes a private copy first if necessary. m_ownedMesh is set when this object is the only user.
+    std::shared_ptr<const MeshStoreObject> m_mesh = std::make_shared<const MeshStoreObject>();
+    std::shared_ptr<MeshStoreObject> m_ownedMesh;
     bool m_useRelativeOBJ = false;
+    bool m_useMeshStore = true;
     bool m_badMesh = false;
-    dVector3 m_lowerBound = {DBL_MAX, DBL_MAX, DBL_MAX, 0};
-    dVector3 m_upperBound = {-DBL_MAX, -DBL_MAX, -DBL_MAX, 0};
 
     dVector3 m_displayPosition = {0, 0, 0, 0};
     dVector3 m_displayScale = {1, 1, 1, 0};
@@ -184,7 +200,9 @@ private:
     double m_blendFraction = 0;
     SimulationWidget *m_simulationWidget = nullptr;
     QOpenGLBuffer m_VBO;
+    QOpenGLBuffer m_IBO = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
     bool m_VBOAllocated = false;
+    bool m_VBOUpdateNeeded = false;
     std::unique_ptr<QOpenGLTexture> m_texture;
     double m_decal = 0;
 
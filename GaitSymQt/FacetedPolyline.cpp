@@ -24,35 +24,13 @@ FacetedPolyline::FacetedPolyline(std::vector<pgd::Vector3> *polyline, double rad
 #endif
 {
     setBlendColour(blendColour, blendFraction);
+    m_radius = radius;
+    m_numSides = n;
+    m_numPolylinePoints = polyline->size();
     if (internal)
     {
-        std::vector<pgd::Vector3> profile;
         AllocateMemory(n * (polyline->size() * 2 + 2));
-
-        // need to add extra tails to the polyline for direction padding
-        std::vector<pgd::Vector3> newPolyline;
-        newPolyline.reserve(polyline->size() + 2);
-        pgd::Vector3 v0 = (*polyline)[1] - (*polyline)[0];
-        pgd::Vector3 v1 = (*polyline)[0] - v0;
-        newPolyline.push_back(v1);
-        for (size_t i = 0; i < polyline->size(); i++) newPolyline.push_back((*polyline)[i]);
-        v0 = (*polyline)[polyline->size() - 1] - (*polyline)[polyline->size() - 2];
-        v1 = (*polyline)[polyline->size() - 1] + v0;
-        newPolyline.push_back(v1);
-
-        // create the profile
-        double delTheta = 2 * M_PI / n;
-        double theta = M_PI / 2;
-        for (size_t i = 0; i < n; i++)
-        {
-            v0.x = cos(theta) * radius;
-            v0.y = sin(theta) * radius;
-            v0.z = 0;
-            theta -= delTheta;
-            profile.push_back(v0);
-        }
-
-        Extrude(&newPolyline, &profile);
+        ExtrudeTube(polyline);
     }
     else
     {
@@ -90,6 +68,47 @@ FacetedPolyline::FacetedPolyline(std::vector<pgd::Vector3> *polyline, double rad
 
 }
 
+bool FacetedPolyline::Update(std::vector<pgd::Vector3> *polyline, const QColor &blendColour)
+{
+    if (polyline->size() != m_numPolylinePoints) return false;
+    // the tube topology only depends on the number of points so the existing memory and vertex buffer can be refilled
+    ClearTriangles();
+    setBlendColour(blendColour, blendFraction());
+    ExtrudeTube(polyline);
+    return true;
+}
+
+void FacetedPolyline::ExtrudeTube(std::vector<pgd::Vector3> *polyline)
+{
+    std::vector<pgd::Vector3> profile;
+    profile.reserve(m_numSides);
+
+    // need to add extra tails to the polyline for direction padding
+    std::vector<pgd::Vector3> newPolyline;
+    newPolyline.reserve(polyline->size() + 2);
+    pgd::Vector3 v0 = (*polyline)[1] - (*polyline)[0];
+    pgd::Vector3 v1 = (*polyline)[0] - v0;
+    newPolyline.push_back(v1);
+    for (size_t i = 0; i < polyline->size(); i++) newPolyline.push_back((*polyline)[i]);
+    v0 = (*polyline)[polyline->size() - 1] - (*polyline)[polyline->size() - 2];
+    v1 = (*polyline)[polyline->size() - 1] + v0;
+    newPolyline.push_back(v1);
+
+    // create the profile
+    double delTheta = 2 * M_PI / m_numSides;
+    double theta = M_PI / 2;
+    for (size_t i = 0; i < m_numSides; i++)
+    {
+        v0.x = cos(theta) * m_radius;
+        v0.y = sin(theta) * m_radius;
+        v0.z = 0;
+        theta -= delTheta;
+        profile.push_back(v0);
+    }
+
+    Extrude(&newPolyline, &profile);
+}
+
 // extrude profile along a poly line using sharp corners
 // profile is a 2D shape with z = 0 for all values.
 // polyline needs to have no parallel neighbouring segements
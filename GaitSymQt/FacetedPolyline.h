@@ -100,8 +100,18 @@ public:
     FacetedPolyline(std::vector<pgd::Vector3> *polyline, double radius, size_t n, const QColor &blendColour, double blendFraction, bool internal = true);
 #endif
 
+    // regenerates the tube in place and returns false if the polyline no longer has the same number of points
+    bool Update(std::vector<pgd::Vector3> *polyline, const QColor &blendColour);
+
     void Extrude(std::vector<pgd::Vector3> *polyline, std::vector<pgd::Vector3> *profile);
     static bool Intersection(Line3D *line, Plane3D *plane, pgd::Vector3 *intersection);
+
+private:
+    void ExtrudeTube(std::vector<pgd::Vector3> *polyline);
+
+    double m_radius = 0;
+    size_t m_numSides = 0;
+    size_t m_numPolylinePoints = 0;
 };
 
 
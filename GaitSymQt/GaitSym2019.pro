@@ -319,6 +319,7 @@ SOURCES += \
     ../src/DataTargetVector.cpp \
     ../src/Drivable.cpp \
     ../src/Driver.cpp \
+    ../src/DumpFile.cpp \
     ../src/ErrorHandler.cpp \
     ../src/Filter.cpp \
     ../src/FixedDriver.cpp \
@@ -413,8 +414,13 @@ SOURCES += \
     LineEditUniqueName.cpp \
     MainWindow.cpp \
     MainWindowActions.cpp \
+    MeshBVH.cpp \
+    MeshCache.cpp \
+    MeshLoader.cpp \
     MeshStore.cpp \
     Preferences.cpp \
+    SimulationSnapshot.cpp \
+    SimulationThread.cpp \
     SimulationWidget.cpp \
     StrokeFont.cpp \
     TextEditDialog.cpp \
@@ -639,6 +645,7 @@ HEADERS += \
     ../src/DataTargetVector.h \
     ../src/Drivable.h \
     ../src/Driver.h \
+    ../src/DumpFile.h \
     ../src/ErrorHandler.h \
     ../src/Filter.h \
     ../src/FixedDriver.h \
@@ -738,8 +745,13 @@ HEADERS += \
     LineEditUniqueName.h \
     MainWindow.h \
     MainWindowActions.h \
+    MeshBVH.h \
+    MeshCache.h \
+    MeshLoader.h \
     MeshStore.h \
     Preferences.h \
+    SimulationSnapshot.h \
+    SimulationThread.h \
     SimulationWidget.h \
     StrokeFont.h \
     TextEditDialog.h \
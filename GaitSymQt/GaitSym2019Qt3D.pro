@@ -320,6 +320,7 @@ SOURCES += \
     ../src/DataTargetVector.cpp \
     ../src/Drivable.cpp \
     ../src/Driver.cpp \
+    ../src/DumpFile.cpp \
     ../src/ErrorHandler.cpp \
     ../src/Filter.cpp \
     ../src/FixedDriver.cpp \
@@ -414,8 +415,13 @@ SOURCES += \
     LineEditUniqueName.cpp \
     MainWindow.cpp \
     MainWindowActions.cpp \
+    MeshBVH.cpp \
+    MeshCache.cpp \
+    MeshLoader.cpp \
     MeshStore.cpp \
     Preferences.cpp \
+    SimulationSnapshot.cpp \
+    SimulationThread.cpp \
     SimulationWidget.cpp \
     SimulationWindowQt3D.cpp \
     StrokeFont.cpp \
@@ -641,6 +647,7 @@ HEADERS += \
     ../src/DataTargetVector.h \
     ../src/Drivable.h \
     ../src/Driver.h \
+    ../src/DumpFile.h \
     ../src/ErrorHandler.h \
     ../src/Filter.h \
     ../src/FixedDriver.h \
@@ -740,8 +747,13 @@ HEADERS += \
     LineEditUniqueName.h \
     MainWindow.h \
     MainWindowActions.h \
+    MeshBVH.h \
+    MeshCache.h \
+    MeshLoader.h \
     MeshStore.h \
     Preferences.h \
+    SimulationSnapshot.h \
+    SimulationThread.h \
     SimulationWidget.h \
     SimulationWindowQt3D.h \
     StrokeFont.h \
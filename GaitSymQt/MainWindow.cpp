@@ -20,6 +20,8 @@
 #include "Geom.h"
 #include "Muscle.h"
 #include "Driver.h"
+#include "SimulationThread.h"
+#include "SimulationSnapshot.h"
 
 #ifdef USE_QT3D
 #include "SimulationWindowQt3D.h"
@@ -53,22 +55,6 @@
 
 using namespace std::literals::string_literals;
 
-// simple guard class for std::cerr stream capture
-class cerrRedirect
-{
-public:
-    cerrRedirect(std::streambuf *newBuffer)
-    {
-        oldBuffer = std::cerr.rdbuf(newBuffer);
-    }
-    ~cerrRedirect()
-    {
-        std::cerr.rdbuf(oldBuffer);
-    }
-private:
-    std::streambuf *oldBuffer;
-};
-
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow)
 {
@@ -217,8 +203,10 @@ MainWindow::MainWindow(QWidget *parent)
     // the treeWidgetElements needs to know about this window
     ui->treeWidgetElements->setMainWindow(this);
 
-    // set up the timer
+    // set up the timer (it only polls the simulation thread for new snapshots so it does not need to run flat out
+    // except when recording because then the simulation thread waits for every snapshot to be taken)
     m_timer = new QTimer(this);
+    m_timer->setInterval(16);
     connect(m_timer, SIGNAL(timeout()), this, SLOT(processOneThing()));
 
     // zero the timer display
@@ -253,6 +241,7 @@ MainWindow::~MainWindow()
 {
     m_timer->stop();
 
+    stopSimulationThread();
     if (m_simulation) delete m_simulation;
     delete ui;
 
@@ -296,40 +285,47 @@ void MainWindow::closeEvent(QCloseEvent *event)
 
 void MainWindow::processOneThing()
 {
-    if (m_simulation)
+    if (m_simulation && m_simulationThread)
     {
-        std::stringstream capturedCerr;
-        cerrRedirect redirect(capturedCerr.rdbuf());
-        if (m_simulation->ShouldQuit() || m_simulation->TestForCatastrophy())
+        size_t movieSkip = size_t(std::max(Preferences::valueInt("MovieSkip"), 1));
+        bool recording = m_movieFlag || m_saveOBJFileSequenceFlag;
+        m_simulationThread->setSnapshotInterval(movieSkip);
+        m_simulationThread->setFrameLocked(recording);
+        int interval = recording ? 0 : 16;
+        if (m_timer->interval() != interval) m_timer->setInterval(interval);
+
+        const SimulationSnapshot *snapshot = m_simulationThread->TakeSnapshot();
+        if (!snapshot) return; // nothing new has been published since the last time
+        // a snapshot refreshed after an edit whilst paused has the same step count and must not be recorded again
+        bool newStep = snapshot->stepCount() != m_stepCount;
+        m_stepCount = snapshot->stepCount();
+        m_simulationWidget->setSnapshot(snapshot);
+        if (snapshot->log().size()) log(QString::fromStdString(snapshot->log()));
+
+        if (snapshot->status() == SimulationSnapshot::unableToStart)
         {
-            log(QString::fromStdString(capturedCerr.str()));
             setStatusString(tr("Unable to start simulation"), 1);
             ui->actionRun->setChecked(false);
             m_mainWindowActions->run();
             return;
         }
 
-        m_simulation->UpdateSimulation();
-        m_stepCount++;
-
-        if ((m_stepCount % size_t(Preferences::valueInt("MovieSkip"))) == 0)
+        handleTracking();
+        if (m_stepFlag && snapshot->status() != SimulationSnapshot::running)
+        {
+            m_stepFlag = false;
+            m_timer->stop();
+        }
+        m_simulationWidget->update(); // muscles and fluid sacs refill their meshes from the new snapshot when they are drawn
+        if (newStep && m_stepCount && (m_stepCount % movieSkip) == 0)
         {
-            handleTracking();
-            if (m_stepFlag)
-            {
-                m_stepFlag = false;
-                m_timer->stop();
-            }
-            m_simulationWidget->getDrawMuscleMap()->clear(); // force a redraw of all muscles
-            m_simulationWidget->getDrawFluidSacMap()->clear(); // force a redraw of all fluid sacs
-            m_simulationWidget->update();
             if (m_movieFlag)
             {
                 m_simulationWidget->WriteMovieFrame();
             }
             if (m_saveOBJFileSequenceFlag)
             {
-                QString filename = QString("%1%2").arg("Frame").arg(m_simulation->GetTime(), 12, 'f', 7, QChar('0'));
+                QString filename = QString("%1%2").arg("Frame").arg(snapshot->time(), 12, 'f', 7, QChar('0'));
                 QString path = QDir(m_objFileSequenceFolder).filePath(filename);
                 if (m_objFileFormat == usda) { path.append(".usda"); }
                 log(QString("Writing \"%1\"\n").arg(path));
@@ -343,43 +339,50 @@ void MainWindow::processOneThing()
                     break;
                 }
             }
-            QString time = QString("%1").arg(m_simulation->GetTime(), 0, 'f', 5);
-            ui->lcdNumberTime->display(time);
-//            qDebug() << m_simulation->CalculateInstantaneousFitness() << "\n";
         }
+        QString time = QString("%1").arg(snapshot->time(), 0, 'f', 5);
+        ui->lcdNumberTime->display(time);
 
-        if (m_simulation->ShouldQuit())
+        if (snapshot->status() == SimulationSnapshot::ended)
         {
-            log(QString::fromStdString(capturedCerr.str()));
             setStatusString(tr("Simulation ended normally"), 1);
-            log(QString("Fitness = %1\n").arg(m_simulation->CalculateInstantaneousFitness(), 0, 'f', 5));
-            log(QString("Time = %1\n").arg(m_simulation->GetTime(), 0, 'f', 5));
-            log(QString("Metabolic Energy = %1\n").arg(m_simulation->GetMetabolicEnergy(), 0, 'f', 5));
-            log(QString("Mechanical Energy = %1\n").arg(m_simulation->GetMechanicalEnergy(), 0, 'f', 5));
-            m_simulationWidget->update();
-            QString time = QString("%1").arg(m_simulation->GetTime(), 0, 'f', 5);
-            ui->lcdNumberTime->display(time);
+            log(QString("Fitness = %1\n").arg(snapshot->fitness(), 0, 'f', 5));
+            log(QString("Time = %1\n").arg(snapshot->time(), 0, 'f', 5));
+            log(QString("Metabolic Energy = %1\n").arg(snapshot->metabolicEnergy(), 0, 'f', 5));
+            log(QString("Mechanical Energy = %1\n").arg(snapshot->mechanicalEnergy(), 0, 'f', 5));
             ui->actionRun->setChecked(false);
             m_mainWindowActions->run();
             return;
         }
-        if (m_simulation->TestForCatastrophy())
+        if (snapshot->status() == SimulationSnapshot::aborted)
         {
-            log(QString::fromStdString(capturedCerr.str()));
             setStatusString(tr("Simulation aborted"), 1);
-            ui->textEditLog->append(QString("Fitness = %1\n").arg(m_simulation->CalculateInstantaneousFitness(), 0, 'f', 5));
-            m_simulationWidget->update();
-            QString time = QString("%1").arg(m_simulation->GetTime(), 0, 'f', 5);
-            ui->lcdNumberTime->display(time);
+            ui->textEditLog->append(QString("Fitness = %1\n").arg(snapshot->fitness(), 0, 'f', 5));
             ui->actionRun->setChecked(false);
             m_mainWindowActions->run();
             return;
         }
-        log(QString::fromStdString(capturedCerr.str()));
     }
     updateEnable();
 }
 
+void MainWindow::startSimulationThread()
+{
+    if (!m_simulation || m_simulationThread) return;
+    m_simulationThread = std::make_unique<SimulationThread>(m_simulation, size_t(Preferences::valueInt("StrapCylinderWrapSegments")));
+    m_simulationWidget->setSnapshot(m_simulationThread->TakeSnapshot());
+    // the timer is not running when the simulation is paused so the refreshed snapshot is taken straight away instead
+    m_simulationThread->setRefreshCallback([this]() { QTimer::singleShot(0, this, SLOT(processOneThing())); });
+}
+
+void MainWindow::stopSimulationThread()
+{
+    if (!m_simulationThread) return;
+    m_simulationThread.reset();
+    m_simulationWidget->setSnapshot(nullptr);
+    m_simulationWidget->update();
+}
+
 void MainWindow::handleCommandLineArguments()
 {
     QStringList arguments = QCoreApplication::arguments();
@@ -397,7 +400,9 @@ void MainWindow::handleTracking()
     Marker *marker = m_simulation->GetMarker(ui->comboBoxTrackingMarker->currentText().toStdString());
     if (marker)
     {
-        pgd::Vector3 position = marker->GetWorldPosition();
+        const SimulationSnapshot *snapshot = m_simulationWidget->snapshot();
+        const SimulationSnapshot::Pose *pose = snapshot ? snapshot->markerPose(marker->name()) : nullptr;
+        pgd::Vector3 position = pose ? pose->position : marker->GetWorldPosition();
         if (ui->radioButtonTrackingX->isChecked())
         {
             m_simulationWidget->setCOIx(float(position.x + ui->doubleSpinBoxTrackingOffset->value()));
@@ -514,6 +519,7 @@ void MainWindow::comboBoxMuscleColourMapCurrentTextChanged(const QString &text)
     Preferences::insert("StrapColourControl", static_cast<int>(colourControl));
     if (m_simulation)
     {
+        SimulationThread::PauseGuard pauseGuard(m_simulationThread.get());
         for (auto &&iter : *m_simulation->GetMuscleList()) iter.second->setStrapColourControl(colourControl);
     }
     m_simulationWidget->update();
@@ -526,6 +532,7 @@ void MainWindow::spinboxSkip(int v)
 
 void MainWindow::spinboxTimeMax(double v)
 {
+    SimulationThread::PauseGuard pauseGuard(m_simulationThread.get());
     m_simulation->SetTimeLimit(v);
 }
 
@@ -664,6 +671,11 @@ Simulation *MainWindow::simulation() const
     return m_simulation;
 }
 
+SimulationThread *MainWindow::simulationThread() const
+{
+    return m_simulationThread.get();
+}
+
 void MainWindow::resizeAndCentre(int w, int h)
 {
     QRect available = screen()->availableGeometry();
@@ -13,6 +13,8 @@
 #include <QMainWindow>
 #include <QFileInfo>
 
+#include <memory>
+
 #ifdef USE_QT3D
 class SimulationWindowQt3D;
 #else
@@ -24,6 +26,7 @@ class MainWindow;
 }
 
 class Simulation;
+class SimulationThread;
 class QTreeWidgetItem;
 class MainWindowActions;
 
@@ -41,6 +44,7 @@ public:
 
     Mode mode() const;
     Simulation *simulation() const;
+    SimulationThread *simulationThread() const;
 #ifdef USE_QT3D
     SimulationWindowQt3D *simulationWidget() const;
 #else
@@ -107,6 +111,8 @@ private:
     void resizeSimulationWindow(int openGLWidth, int openGLHeight);
     void updateComboBoxTrackingMarker();
     void handleTracking();
+    void startSimulationThread();
+    void stopSimulationThread();
 
     Ui::MainWindow *ui = nullptr;
 #ifdef USE_QT3D
@@ -128,6 +134,7 @@ private:
 
     QTimer *m_timer = nullptr;
     Simulation *m_simulation = nullptr;
+    std::unique_ptr<SimulationThread> m_simulationThread;
 
     Mode m_mode = constructionMode;
     bool m_noName = true;
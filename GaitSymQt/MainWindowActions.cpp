@@ -21,6 +21,7 @@
 #include "FluidSac.h"
 #include "Driver.h"
 #include "FacetedObject.h"
+#include "MeshCache.h"
 #include "Warehouse.h"
 #include "Preferences.h"
 #include "DialogPreferences.h"
@@ -45,11 +46,13 @@
 #include "TwoHingeJointDriver.h"
 #include "MarkerPositionDriver.h"
 #include "MarkerEllipseDriver.h"
+#include "SimulationThread.h"
 
 #ifdef USE_QT3D
 #include "SimulationWindowQt3D.h"
 #else
 #include "SimulationWidget.h"
+#include "MeshLoader.h"
 #endif
 
 
@@ -62,6 +65,10 @@
 #include <QRegularExpression>
 #include <QMenu>
 #include <QAction>
+#include <QProgressDialog>
+#include <QStandardPaths>
+
+#include <thread>
 
 using namespace std::literals::string_literals;
 
@@ -100,6 +107,7 @@ void MainWindowActions::menuOpen(const QString &fileName, const QByteArray *file
 {
     // dispose any simulation cleanly
     m_mainWindow->m_timer->stop();
+    m_mainWindow->stopSimulationThread();
     m_mainWindow->ui->actionRun->setChecked(false);
     if (m_mainWindow->m_movieFlag) { menuStopAVISave(); }
     m_mainWindow->m_saveOBJFileSequenceFlag = false;
@@ -221,6 +229,34 @@ void MainWindowActions::menuOpen(const QString &fileName, const QByteArray *file
         for (int i = 0; i < searchPath.size(); i++) m_mainWindow->m_simulation->GetGlobal()->MeshSearchPath()->push_back(searchPath[i].toStdString());
     }
 
+    if (Preferences::valueBool("MeshCacheEnabled"))
+        MeshCache::setFolder(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).absoluteFilePath("meshes").toStdString());
+    else
+        MeshCache::setFolder(std::string());
+#ifndef USE_QT3D
+    // parse the body meshes on worker threads so that the interface stays responsive
+    // the bodies then find them in the mesh store when they are first drawn
+    // any that are skipped are loaded when they are drawn as before
+    MeshLoader meshLoader;
+    for (auto &&iter : *m_mainWindow->m_simulation->GetBodyList()) DrawBody::requestMeshes(iter.second.get(), &meshLoader);
+    if (meshLoader.numMeshes())
+    {
+        int meshLoaderThreads = Preferences::valueInt("MeshLoaderThreads");
+        meshLoader.start(meshLoaderThreads > 0 ? size_t(meshLoaderThreads) : size_t(std::max(std::thread::hardware_concurrency(), 1u)));
+        QProgressDialog progress(QString("Loading meshes..."), QString("Skip"), 0, int(meshLoader.numMeshes()), m_mainWindow);
+        progress.setWindowModality(Qt::WindowModal);
+        progress.setMinimumDuration(500);
+        while (meshLoader.wait(50) == false)
+        {
+            progress.setValue(int(meshLoader.numFinished()));
+            if (progress.wasCanceled()) meshLoader.cancel();
+            qApp->processEvents();
+        }
+        progress.setValue(progress.maximum());
+        m_mainWindow->m_simulationWidget->setPreloadedMeshes(meshLoader.finish());
+    }
+#endif
+
     m_mainWindow->m_simulationWidget->setAxesScale(float(m_mainWindow->m_simulation->GetGlobal()->size1()));
     QString backgroundColour = QString::fromStdString(m_mainWindow->m_simulation->GetGlobal()->colour1().GetHexArgb());
     m_mainWindow->m_simulationWidget->setSimulation(m_mainWindow->m_simulation);
@@ -265,6 +301,7 @@ void MainWindowActions::menuRestart()
 
 void MainWindowActions::menuSaveAs()
 {
+    SimulationThread::PauseGuard pauseGuard(m_mainWindow->m_simulationThread.get());
     QString fileName;
     if (m_mainWindow->m_configFile.absoluteFilePath().isEmpty())
     {
@@ -330,6 +367,7 @@ void MainWindowActions::menuSaveAs()
 void MainWindowActions::menuSave()
 {
     if (m_mainWindow->m_noName) return;
+    SimulationThread::PauseGuard pauseGuard(m_mainWindow->m_simulationThread.get());
     if (m_mainWindow->m_mode == MainWindow::constructionMode) // need to put everything into run mode to save properly
     {
         for (auto &&it : *m_mainWindow->m_simulation->GetBodyList()) it.second->EnterRunMode();
@@ -383,11 +421,21 @@ void MainWindowActions::run()
 {
     if (m_mainWindow->ui->actionRun->isChecked())
     {
-        if (m_mainWindow->m_simulation) m_mainWindow->m_timer->start();
+        if (m_mainWindow->m_simulation)
+        {
+            m_mainWindow->startSimulationThread();
+            m_mainWindow->m_simulationThread->Run();
+            m_mainWindow->m_timer->start();
+        }
         m_mainWindow->setStatusString(tr("Simulation running"), 1);
     }
     else
     {
+        if (m_mainWindow->m_simulationThread)
+        {
+            m_mainWindow->m_simulationThread->Pause();
+            m_mainWindow->processOneThing(); // picks up the final snapshot
+        }
         m_mainWindow->m_timer->stop();
         m_mainWindow->setStatusString(tr("Simulation stopped"), 1);
     }
@@ -395,7 +443,12 @@ void MainWindowActions::run()
 void MainWindowActions::step()
 {
     m_mainWindow->m_stepFlag = true;
-    if (m_mainWindow->m_simulation) m_mainWindow->m_timer->start();
+    if (m_mainWindow->m_simulation)
+    {
+        m_mainWindow->startSimulationThread();
+        m_mainWindow->m_simulationThread->Step();
+        m_mainWindow->m_timer->start();
+    }
     m_mainWindow->setStatusString(tr("Simulation stepped"), 2);
 }
 
@@ -474,7 +527,7 @@ void MainWindowActions::menuRecordMovie()
     {
         m_mainWindow->m_movieFlag = true;
         QFileInfo info(Preferences::valueQString("LastFileOpened"));
-        QString fileName = QFileDialog::getSaveFileName(m_mainWindow, tr("Save output as AVI file"), info.absolutePath(), tr("AVI Files (*.avi)"), nullptr);
+        QString fileName = QFileDialog::getSaveFileName(m_mainWindow, tr("Save output as AVI file or image sequence"), info.absolutePath(), tr("AVI Files (*.avi);;Image Sequence (*.png *.jpg *.bmp *.ppm)"), nullptr);
         if (fileName.isNull() == false)
         {
             m_mainWindow->m_movieFlag = true;
@@ -522,6 +575,7 @@ void MainWindowActions::menuPreferences()
 void MainWindowActions::menuOutputs()
 {
     if (m_mainWindow->m_simulation == nullptr) return;
+    SimulationThread::PauseGuard pauseGuard(m_mainWindow->m_simulationThread.get());
     DialogOutputSelect dialogOutputSelect(m_mainWindow);
     dialogOutputSelect.setSimulation(m_mainWindow->m_simulation);
     int status = dialogOutputSelect.exec();
@@ -740,6 +794,8 @@ void MainWindowActions::menuNew()
     if (status == QDialog::Accepted)
     {
         if (m_mainWindow->m_movieFlag) { menuStopAVISave(); }
+        m_mainWindow->m_timer->stop();
+        m_mainWindow->stopSimulationThread();
         if (m_mainWindow->m_simulation) delete m_mainWindow->m_simulation;
         m_mainWindow->m_simulation = nullptr;
         m_mainWindow->m_simulationWidget->setSimulation(m_mainWindow->m_simulation);
@@ -781,6 +837,7 @@ void MainWindowActions::menuStartWarehouseExport()
 
     if (fileName.isNull() == false)
     {
+        SimulationThread::PauseGuard pauseGuard(m_mainWindow->m_simulationThread.get());
         m_mainWindow->ui->actionStartWarehouseExport->setEnabled(false);
         m_mainWindow->ui->actionStopWarehouseExport->setEnabled(true);
         m_mainWindow->m_simulation->SetOutputWarehouseFile(fileName.toStdString());
@@ -790,6 +847,7 @@ void MainWindowActions::menuStartWarehouseExport()
 void MainWindowActions::menuStopWarehouseExport()
 {
     if (m_mainWindow->m_simulation == nullptr) return;
+    SimulationThread::PauseGuard pauseGuard(m_mainWindow->m_simulationThread.get());
 
     m_mainWindow->ui->actionStartWarehouseExport->setEnabled(true);
     m_mainWindow->ui->actionStopWarehouseExport->setEnabled(false);
@@ -930,6 +988,7 @@ void MainWindowActions::menuImportWarehouse()
 
     if (fileName.isNull() == false)
     {
+        SimulationThread::PauseGuard pauseGuard(m_mainWindow->m_simulationThread.get());
         m_mainWindow->m_simulation->AddWarehouse(fileName.toStdString());
         m_mainWindow->setStatusString(QString("Warehouse %1 added").arg(fileName), 1);
     }
@@ -1383,6 +1442,8 @@ void MainWindowActions::enterRunMode()
     for (auto &&it : *m_mainWindow->m_simulation->GetMuscleList()) it.second->LateInitialisation();
     for (auto &&it : *m_mainWindow->m_simulation->GetFluidSacList()) it.second->LateInitialisation();
     for (auto &&it : *m_mainWindow->m_simulation->GetJointList()) it.second->LateInitialisation();
+    m_mainWindow->m_simulation->BuildCollisionSpaces(); // the geoms may have been edited
+    m_mainWindow->m_simulation->BuildContactPairTable();
     m_mainWindow->ui->actionRunMode->setChecked(true);
     m_mainWindow->ui->actionConstructionMode->setChecked(false);
     m_mainWindow->updateEnable();
@@ -1395,6 +1456,7 @@ void MainWindowActions::enterConstructionMode()
 {
     Q_ASSERT_X(m_mainWindow->m_simulation, "MainWindowActions::enterConstructionMode", "m_mainWindow->m_simulation undefined");
     Q_ASSERT_X(m_mainWindow->m_stepCount == 0, "MainWindowActions::enterConstructionMode", "m_mainWindow->m_stepCount not zero");
+    m_mainWindow->stopSimulationThread();
     m_mainWindow->m_mode = MainWindow::constructionMode;
     for (auto &&it : *m_mainWindow->m_simulation->GetBodyList()) it.second->EnterConstructionMode();
     for (auto &&it : *m_mainWindow->m_simulation->GetMuscleList()) it.second->LateInitialisation();
@@ -1473,6 +1535,7 @@ void MainWindowActions::menuDeleteAssembly()
 void MainWindowActions::menuExportMarkers()
 {
     Q_ASSERT_X(m_mainWindow->m_simulation, "MainWindowActions::menuExportMarkers", "m_mainWindow->m_simulation undefined");
+    SimulationThread::PauseGuard pauseGuard(m_mainWindow->m_simulationThread.get());
     DialogMarkerImportExport dialogMarkerImportExport(m_mainWindow);
     dialogMarkerImportExport.setSimulation(m_mainWindow->m_simulation);
     dialogMarkerImportExport.setAllowImport(m_mainWindow->m_mode == MainWindow::constructionMode);
@@ -1684,6 +1747,7 @@ void MainWindowActions::elementInfo(const QString &elementType, const QString &e
     DialogInfo *dialog = new DialogInfo(m_mainWindow);
     dialog->setAttribute(Qt::WA_DeleteOnClose, true); // needed so I can display this modelessly
     dialog->useXMLSyntaxHighlighter();
+    SimulationThread::PauseGuard pauseGuard(m_mainWindow->m_simulationThread.get());
     NamedObject *element = m_mainWindow->m_simulation->GetNamedObject(elementName.toStdString());
     if (!element) return;
     element->saveToAttributes();
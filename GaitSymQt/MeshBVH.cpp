@@ -0,0 +1,189 @@
+/*
+ *  MeshBVH.cpp
+ *  GaitSymODE2019
+ *
+ */
+
+#include "MeshBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+MeshBVH::MeshBVH(const float *vertices, size_t vertexStride, const uint16_t *indices16, const uint32_t *indices32, size_t numTriangles)
+{
+    if (numTriangles == 0) return;
+
+    std::vector<float> triangleBounds(numTriangles * 6);
+    float meshLower[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float meshUpper[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (size_t i = 0; i < numTriangles; i++)
+    {
+        const float *v0 = vertices + size_t(Index(indices16, indices32, i * 3)) * vertexStride;
+        const float *v1 = vertices + size_t(Index(indices16, indices32, i * 3 + 1)) * vertexStride;
+        const float *v2 = vertices + size_t(Index(indices16, indices32, i * 3 + 2)) * vertexStride;
+        for (size_t j = 0; j < 3; j++)
+        {
+            triangleBounds[i * 6 + j] = std::min({v0[j], v1[j], v2[j]});
+            triangleBounds[i * 6 + 3 + j] = std::max({v0[j], v1[j], v2[j]});
+            meshLower[j] = std::min(meshLower[j], triangleBounds[i * 6 + j]);
+            meshUpper[j] = std::max(meshUpper[j], triangleBounds[i * 6 + 3 + j]);
+        }
+    }
+
+    // the triangle boxes are padded slightly so that rounding in the box test can never reject
+    // a triangle that the exact triangle test would accept
+    double maxExtent = 0;
+    for (size_t j = 0; j < 3; j++) maxExtent = std::max(maxExtent, double(meshUpper[j]) - double(meshLower[j]));
+    float padding = float(maxExtent * 1e-6) + FLT_MIN;
+
+    std::vector<Primitive> primitives(numTriangles);
+    for (size_t i = 0; i < numTriangles; i++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            triangleBounds[i * 6 + j] -= padding;
+            triangleBounds[i * 6 + 3 + j] += padding;
+            primitives[i].centroid[j] = (triangleBounds[i * 6 + j] + triangleBounds[i * 6 + 3 + j]) * 0.5f;
+        }
+        primitives[i].triangle = uint32_t(i);
+    }
+
+    // a binary tree with leaves of up to m_maxLeafSize triangles has fewer than this many nodes
+    m_nodes.reserve(2 * (numTriangles / m_maxLeafSize + 1));
+    m_nodes.push_back(Node());
+    Build(0, 0, primitives.data(), primitives.data(), primitives.data() + numTriangles, triangleBounds);
+    m_nodes.shrink_to_fit();
+
+    m_triangles.resize(numTriangles);
+    for (size_t i = 0; i < numTriangles; i++) m_triangles[i] = primitives[i].triangle;
+}
+
+uint32_t MeshBVH::Index(const uint16_t *indices16, const uint32_t *indices32, size_t i)
+{
+    return indices16 ? indices16[i] : indices32 ? indices32[i] : uint32_t(i);
+}
+
+// splits the triangles along the longest axis of their centroids until the leaves are small enough
+// the sorting is done on a compact copy of the centroids and the boxes are filled in on the way back up
+void MeshBVH::Build(uint32_t nodeIndex, uint32_t depth, const Primitive *first, Primitive *begin, Primitive *end, const std::vector<float> &triangleBounds)
+{
+    Node *node = &m_nodes[nodeIndex];
+    if (end - begin <= m_maxLeafSize)
+    {
+        std::fill_n(node->lower, 3, FLT_MAX);
+        std::fill_n(node->upper, 3, -FLT_MAX);
+        for (Primitive *primitive = begin; primitive < end; primitive++)
+        {
+            const float *bounds = &triangleBounds[size_t(primitive->triangle) * 6];
+            for (size_t j = 0; j < 3; j++)
+            {
+                node->lower[j] = std::min(node->lower[j], bounds[j]);
+                node->upper[j] = std::max(node->upper[j], bounds[3 + j]);
+            }
+        }
+        node->first = uint32_t(begin - first);
+        node->count = uint32_t(end - begin);
+        return;
+    }
+
+    float centroidLower[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float centroidUpper[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (Primitive *primitive = begin; primitive < end; primitive++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            centroidLower[j] = std::min(centroidLower[j], primitive->centroid[j]);
+            centroidUpper[j] = std::max(centroidUpper[j], primitive->centroid[j]);
+        }
+    }
+    size_t axis = 0;
+    if (centroidUpper[1] - centroidLower[1] > centroidUpper[axis] - centroidLower[axis]) axis = 1;
+    if (centroidUpper[2] - centroidLower[2] > centroidUpper[axis] - centroidLower[axis]) axis = 2;
+    // the midpoint split is quicker and usually gives tighter boxes but the median split is used if it fails
+    // or once the tree gets deep so that the depth is always less than m_maxSpatialDepth + 32
+    Primitive *middle = end;
+    if (depth < m_maxSpatialDepth)
+    {
+        float split = (centroidLower[axis] + centroidUpper[axis]) * 0.5f;
+        middle = std::partition(begin, end, [axis, split](const Primitive &a) { return a.centroid[axis] < split; });
+    }
+    if (middle == begin || middle == end)
+    {
+        middle = begin + (end - begin) / 2;
+        std::nth_element(begin, middle, end, [axis](const Primitive &a, const Primitive &b) { return a.centroid[axis] < b.centroid[axis]; });
+    }
+
+    uint32_t left = uint32_t(m_nodes.size());
+    m_nodes.push_back(Node());
+    m_nodes.push_back(Node());
+    Build(left, depth + 1, first, begin, middle, triangleBounds);
+    Build(left + 1, depth + 1, first, middle, end, triangleBounds);
+
+    node = &m_nodes[nodeIndex]; // in case m_nodes has moved
+    node->first = left;
+    node->count = 0;
+    for (size_t j = 0; j < 3; j++)
+    {
+        node->lower[j] = std::min(m_nodes[left].lower[j], m_nodes[left + 1].lower[j]);
+        node->upper[j] = std::max(m_nodes[left].upper[j], m_nodes[left + 1].upper[j]);
+    }
+}
+
+void MeshBVH::FindCandidates(const double origin[3], const double vector[3], std::vector<uint32_t> *candidates) const
+{
+    candidates->clear();
+    if (m_nodes.empty()) return;
+
+    double inverseVector[3];
+    bool parallel[3];
+    for (size_t i = 0; i < 3; i++)
+    {
+        parallel[i] = (vector[i] == 0);
+        inverseVector[i] = parallel[i] ? 0 : 1 / vector[i];
+    }
+
+    // every box the ray passes through is visited because the caller wants all the hits and not just the nearest
+    uint32_t stack[m_maxSpatialDepth + 32 + 1];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize)
+    {
+        const Node &node = m_nodes[stack[--stackSize]];
+        if (!HitBox(node, origin, inverseVector, parallel)) continue;
+        if (node.count)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) candidates->push_back(m_triangles[i]);
+            continue;
+        }
+        stack[stackSize++] = node.first;
+        stack[stackSize++] = node.first + 1;
+    }
+}
+
+// slab test for a ray starting at origin
+bool MeshBVH::HitBox(const Node &node, const double origin[3], const double inverseVector[3], const bool parallel[3])
+{
+    double tNear = 0;
+    double tFar = DBL_MAX;
+    for (size_t i = 0; i < 3; i++)
+    {
+        if (parallel[i])
+        {
+            if (origin[i] < double(node.lower[i]) || origin[i] > double(node.upper[i])) return false;
+            continue;
+        }
+        double t1 = (double(node.lower[i]) - origin[i]) * inverseVector[i];
+        double t2 = (double(node.upper[i]) - origin[i]) * inverseVector[i];
+        if (t1 > t2) std::swap(t1, t2);
+        if (t1 > tNear) tNear = t1;
+        if (t2 < tFar) tFar = t2;
+        if (tNear > tFar) return false;
+    }
+    return true;
+}
+
+size_t MeshBVH::size() const
+{
+    return m_nodes.size() * sizeof(Node) + m_triangles.size() * sizeof(uint32_t) + sizeof(MeshBVH);
+}
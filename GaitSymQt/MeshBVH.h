@@ -0,0 +1,60 @@
+/*
+ *  MeshBVH.h
+ *  GaitSymODE2019
+ *
+ */
+
+#ifndef MESHBVH_H
+#define MESHBVH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// MeshBVH is a bounding volume hierarchy over the triangles of a mesh so that ray picking only
+// needs to test the triangles whose bounding boxes the ray actually passes through
+// it only uses the vertex positions so it does not depend on MeshStore or Qt
+
+class MeshBVH
+{
+public:
+    // vertices holds vertexStride floats for each vertex starting with x, y, z
+    // the triangles use indices16 or indices32 if one of them is not null, otherwise the vertices in order
+    MeshBVH(const float *vertices, size_t vertexStride, const uint16_t *indices16, const uint32_t *indices32, size_t numTriangles);
+
+    // fills candidates with the indices of the triangles that the ray might hit
+    // the ray starts at origin and goes in the direction of vector (which does not need to be normalised)
+    void FindCandidates(const double origin[3], const double vector[3], std::vector<uint32_t> *candidates) const;
+
+    size_t size() const;
+
+private:
+    // a node with count == 0 is an interior node whose children are at first and first + 1
+    // otherwise it is a leaf holding the count triangles starting at m_triangles[first]
+    struct Node
+    {
+        float lower[3];
+        float upper[3];
+        uint32_t first;
+        uint32_t count;
+    };
+
+    // only used while building
+    struct Primitive
+    {
+        float centroid[3];
+        uint32_t triangle;
+    };
+
+    static uint32_t Index(const uint16_t *indices16, const uint32_t *indices32, size_t i);
+    void Build(uint32_t nodeIndex, uint32_t depth, const Primitive *first, Primitive *begin, Primitive *end, const std::vector<float> &triangleBounds);
+    static bool HitBox(const Node &node, const double origin[3], const double inverseVector[3], const bool parallel[3]);
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_triangles;
+
+    static const uint32_t m_maxLeafSize = 4;
+    static const uint32_t m_maxSpatialDepth = 64;
+};
+
+#endif // MESHBVH_H
@@ -0,0 +1,136 @@
+/*
+ *  MeshCache.cpp
+ *  GaitSymODE2019
+ *
+ */
+
+#include "MeshCache.h"
+#include "MeshStore.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QCryptographicHash>
+
+#include <algorithm>
+#include <cstring>
+
+std::string MeshCache::m_folder;
+
+void MeshCache::setFolder(const std::string &folder)
+{
+    m_folder = folder;
+}
+
+std::string MeshCache::folder()
+{
+    return m_folder;
+}
+
+// the entries are named after a hash of the absolute path and the path is also stored in the entry
+std::string MeshCache::CacheFilename(const std::string &path)
+{
+    QByteArray hash = QCryptographicHash::hash(QByteArray::fromStdString(path), QCryptographicHash::Md5).toHex();
+    return QDir(QString::fromStdString(m_folder)).absoluteFilePath(QString::fromLatin1(hash) + QString(".gsmesh")).toStdString();
+}
+
+static void GetFileStamp(const std::string &path, int64_t *size, int64_t *lastModified)
+{
+    QFileInfo fileInfo(QString::fromStdString(path));
+    if (!fileInfo.exists())
+    {
+        *size = -1;
+        *lastModified = 0;
+        return;
+    }
+    *size = fileInfo.size();
+    *lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+}
+
+std::shared_ptr<MeshStoreObject> MeshCache::Read(const std::string &path, const QColor &blendColour)
+{
+    if (m_folder.empty()) return nullptr;
+    std::string absolutePath = QFileInfo(QString::fromStdString(path)).absoluteFilePath().toStdString();
+    QFile file(QString::fromStdString(CacheFilename(absolutePath)));
+    if (!file.open(QIODevice::ReadOnly)) return nullptr;
+
+    Header header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(Header)) != qint64(sizeof(Header))) return nullptr;
+    if (std::memcmp(header.magic, "GSMESH\0\0", sizeof(header.magic)) || header.version != m_version || header.numSourceFiles == 0) return nullptr;
+    float colour[3] = {float(blendColour.redF()), float(blendColour.greenF()), float(blendColour.blueF())};
+    if (!std::equal(colour, colour + 3, header.blendColour)) return nullptr;
+
+    for (uint32_t i = 0; i < header.numSourceFiles; i++)
+    {
+        SourceFile sourceFile;
+        if (file.read(reinterpret_cast<char *>(&sourceFile), sizeof(SourceFile)) != qint64(sizeof(SourceFile))) return nullptr;
+        if (sourceFile.pathLength > uint64_t(file.size() - file.pos())) return nullptr;
+        std::string sourcePath(size_t(sourceFile.pathLength), '\0');
+        if (file.read(&sourcePath[0], qint64(sourcePath.size())) != qint64(sourcePath.size())) return nullptr;
+        if (i == 0 && sourcePath != absolutePath) return nullptr; // two paths with the same hash
+        int64_t size, lastModified;
+        GetFileStamp(sourcePath, &size, &lastModified);
+        if (size != sourceFile.size || lastModified != sourceFile.lastModified) return nullptr;
+    }
+
+    // the remainder of the file is exactly the vertex and index data
+    if (header.numFloats % MeshStoreObject::vertexStride) return nullptr;
+    uint64_t dataSize = header.numFloats * sizeof(float) + header.numIndices16 * sizeof(uint16_t) + header.numIndices32 * sizeof(uint32_t);
+    if (uint64_t(file.size() - file.pos()) != dataSize) return nullptr;
+    std::shared_ptr<MeshStoreObject> mesh = std::make_shared<MeshStoreObject>();
+    mesh->path = path;
+    mesh->vertexList.resize(size_t(header.numFloats));
+    mesh->indexList16.resize(size_t(header.numIndices16));
+    mesh->indexList32.resize(size_t(header.numIndices32));
+    qint64 vertexListSize = qint64(mesh->vertexList.size() * sizeof(float));
+    qint64 indexList16Size = qint64(mesh->indexList16.size() * sizeof(uint16_t));
+    qint64 indexList32Size = qint64(mesh->indexList32.size() * sizeof(uint32_t));
+    if (file.read(reinterpret_cast<char *>(mesh->vertexList.data()), vertexListSize) != vertexListSize) return nullptr;
+    if (file.read(reinterpret_cast<char *>(mesh->indexList16.data()), indexList16Size) != indexList16Size) return nullptr;
+    if (file.read(reinterpret_cast<char *>(mesh->indexList32.data()), indexList32Size) != indexList32Size) return nullptr;
+    std::copy_n(header.lowerBound, 3, mesh->lowerBound);
+    std::copy_n(header.upperBound, 3, mesh->upperBound);
+    return mesh;
+}
+
+// QSaveFile only replaces the entry once it is complete so a reader never sees a partial file
+int MeshCache::Write(const MeshStoreObject &mesh, const std::vector<std::string> &sourceFiles, const QColor &blendColour)
+{
+    if (m_folder.empty() || sourceFiles.empty()) return __LINE__;
+    if (!QDir().mkpath(QString::fromStdString(m_folder))) return __LINE__;
+    std::vector<std::string> absolutePaths;
+    for (auto &&it : sourceFiles) absolutePaths.push_back(QFileInfo(QString::fromStdString(it)).absoluteFilePath().toStdString());
+    QSaveFile file(QString::fromStdString(CacheFilename(absolutePaths[0])));
+    if (!file.open(QIODevice::WriteOnly)) return __LINE__;
+
+    Header header = {};
+    std::memcpy(header.magic, "GSMESH\0\0", sizeof(header.magic));
+    header.version = m_version;
+    header.numSourceFiles = uint32_t(absolutePaths.size());
+    header.numFloats = mesh.vertexList.size();
+    header.numIndices16 = mesh.indexList16.size();
+    header.numIndices32 = mesh.indexList32.size();
+    std::copy_n(mesh.lowerBound, 3, header.lowerBound);
+    std::copy_n(mesh.upperBound, 3, header.upperBound);
+    header.blendColour[0] = float(blendColour.redF());
+    header.blendColour[1] = float(blendColour.greenF());
+    header.blendColour[2] = float(blendColour.blueF());
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+
+    for (auto &&it : absolutePaths)
+    {
+        SourceFile sourceFile = {};
+        GetFileStamp(it, &sourceFile.size, &sourceFile.lastModified);
+        sourceFile.pathLength = it.size();
+        file.write(reinterpret_cast<const char *>(&sourceFile), sizeof(SourceFile));
+        file.write(it.data(), qint64(it.size()));
+    }
+
+    file.write(reinterpret_cast<const char *>(mesh.vertexList.data()), qint64(mesh.vertexList.size() * sizeof(float)));
+    file.write(reinterpret_cast<const char *>(mesh.indexList16.data()), qint64(mesh.indexList16.size() * sizeof(uint16_t)));
+    file.write(reinterpret_cast<const char *>(mesh.indexList32.data()), qint64(mesh.indexList32.size() * sizeof(uint32_t)));
+    if (!file.commit()) return __LINE__;
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ *  MeshCache.h
+ *  GaitSymODE2019
+ *
+ */
+
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <QColor>
+
+#include <string>
+#include <vector>
+#include <memory>
+
+struct MeshStoreObject;
+
+// MeshCache keeps a binary copy of each parsed mesh on disk in the same interleaved layout that
+// MeshStoreObject uses so that reopening a model does not need to parse the mesh files again.
+// An entry is only used if the size and modification time of every file that went into the mesh
+// are unchanged and it was made with the same blend colour (which is baked into uncoloured meshes).
+
+class MeshCache
+{
+public:
+    // the cache is not used until a folder has been set and it should only be changed when no meshes are loading
+    static void setFolder(const std::string &folder);
+    static std::string folder();
+
+    // returns nullptr if there is no up to date cached copy of the mesh
+    static std::shared_ptr<MeshStoreObject> Read(const std::string &path, const QColor &blendColour);
+    // sourceFiles are the files that were read to make the mesh, starting with mesh.path
+    static int Write(const MeshStoreObject &mesh, const std::vector<std::string> &sourceFiles, const QColor &blendColour);
+
+private:
+    static std::string CacheFilename(const std::string &path);
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t numSourceFiles;
+        uint64_t numFloats;
+        uint64_t numIndices16;
+        uint64_t numIndices32;
+        double lowerBound[3];
+        double upperBound[3];
+        float blendColour[3];
+        uint32_t padding;
+    };
+
+    struct SourceFile
+    {
+        int64_t size; // -1 if the file did not exist
+        int64_t lastModified; // milliseconds since the epoch
+        uint64_t pathLength;
+    };
+
+    static std::string m_folder;
+    static const uint32_t m_version = 1;
+};
+
+#endif // MESHCACHE_H
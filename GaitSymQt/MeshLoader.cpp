@@ -0,0 +1,113 @@
+/*
+ *  MeshLoader.cpp
+ *  GaitSymODE2019
+ *
+ */
+
+#include "MeshLoader.h"
+#include "FacetedObject.h"
+
+#include <chrono>
+#include <algorithm>
+
+MeshLoader::MeshLoader()
+{
+}
+
+MeshLoader::~MeshLoader()
+{
+    cancel();
+    for (auto &&it : m_threads) it.join();
+}
+
+void MeshLoader::addMesh(const std::string &path, const QColor &blendColour)
+{
+    if (m_threads.size()) return;
+    if (path.empty() || m_requestedPaths.count(path) || FacetedObject::IsMeshStored(path)) return;
+    m_requestedPaths.insert(path);
+    Request request;
+    request.path = path;
+    request.blendColour = blendColour;
+    m_requests.push_back(std::move(request));
+}
+
+void MeshLoader::start(size_t numThreads)
+{
+    if (m_threads.size()) return;
+    numThreads = std::min(std::max(numThreads, size_t(1)), m_requests.size());
+    for (size_t i = 0; i < numThreads; i++) m_threads.push_back(std::thread(&MeshLoader::LoaderLoop, this));
+}
+
+// each thread takes the next unstarted mesh until there are none left
+// the requests are not resized once the threads have started so only the indices need the lock
+void MeshLoader::LoaderLoop()
+{
+    while (true)
+    {
+        size_t requestIndex;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_cancelled || m_nextRequest >= m_requests.size()) return;
+            requestIndex = m_nextRequest++;
+        }
+        FacetedObject facetedObject;
+        facetedObject.setUseMeshStore(false);
+        facetedObject.setBlendColour(m_requests[requestIndex].blendColour, 1);
+        std::shared_ptr<const MeshStoreObject> mesh;
+        if (facetedObject.ParseMeshFile(m_requests[requestIndex].path) == 0) mesh = facetedObject.mesh();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_requests[requestIndex].mesh = std::move(mesh);
+            m_numFinished++;
+        }
+        m_finishedChanged.notify_all();
+    }
+}
+
+bool MeshLoader::Done() const
+{
+    if (m_cancelled) return m_numFinished == std::min(m_nextRequest, m_requests.size());
+    return m_numFinished == m_requests.size();
+}
+
+bool MeshLoader::wait(int milliseconds)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_finishedChanged.wait_for(lock, std::chrono::milliseconds(milliseconds), [this] { return Done(); });
+}
+
+void MeshLoader::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+    }
+    m_finishedChanged.notify_all();
+}
+
+std::vector<std::shared_ptr<const MeshStoreObject>> MeshLoader::finish()
+{
+    for (auto &&it : m_threads) it.join();
+    m_threads.clear();
+    std::vector<std::shared_ptr<const MeshStoreObject>> meshes;
+    for (auto &&it : m_requests)
+    {
+        if (!it.mesh) continue; // failures are left for the FacetedObject to report when it tries again
+        FacetedObject::AddMeshToStore(it.mesh);
+        meshes.push_back(it.mesh);
+    }
+    m_requests.clear();
+    m_requestedPaths.clear();
+    return meshes;
+}
+
+size_t MeshLoader::numMeshes() const
+{
+    return m_requests.size();
+}
+
+size_t MeshLoader::numFinished()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_numFinished;
+}
@@ -0,0 +1,70 @@
+/*
+ *  MeshLoader.h
+ *  GaitSymODE2019
+ *
+ */
+
+#ifndef MESHLOADER_H
+#define MESHLOADER_H
+
+#include <QColor>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct MeshStoreObject;
+
+// MeshLoader parses a list of mesh files on its own threads so that a model with lots of large meshes
+// can be opened without blocking the GUI. The meshes are only added to the mesh store by finish() which
+// must be called from the GUI thread, after which the FacetedObjects that use them find them there.
+// Each MeshLoader is only used for one batch of meshes.
+
+class MeshLoader
+{
+public:
+    MeshLoader();
+    ~MeshLoader();
+
+    MeshLoader(const MeshLoader&) = delete;
+    MeshLoader& operator=(const MeshLoader&) = delete;
+
+    // meshes that are already in the mesh store or have already been added are skipped
+    void addMesh(const std::string &path, const QColor &blendColour);
+    void start(size_t numThreads);
+    // returns true once all the meshes have been loaded or loading has been cancelled
+    bool wait(int milliseconds);
+    // meshes that have not been started yet are not loaded
+    void cancel();
+    // returns the loaded meshes so that the caller can keep them alive until they have been used
+    std::vector<std::shared_ptr<const MeshStoreObject>> finish();
+
+    size_t numMeshes() const;
+    size_t numFinished();
+
+private:
+    void LoaderLoop();
+    bool Done() const; // only call with m_mutex locked
+
+    struct Request
+    {
+        std::string path;
+        QColor blendColour;
+        std::shared_ptr<const MeshStoreObject> mesh;
+    };
+    std::vector<Request> m_requests;
+    std::unordered_set<std::string> m_requestedPaths;
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_finishedChanged;
+    size_t m_nextRequest = 0;
+    size_t m_numFinished = 0;
+    bool m_cancelled = false;
+};
+
+#endif // MESHLOADER_H
@@ -10,6 +10,9 @@
 #include "MeshStore.h"
 #include "FacetedObject.h"
 
+#include <algorithm>
+#include <cstring>
+
 MeshStore FacetedObject::m_meshStore;
 
 MeshStore::MeshStore()
@@ -19,13 +22,14 @@ MeshStore::MeshStore()
 void MeshStore::clear()
 {
     m_meshMap.clear();
+    m_liveMeshMap.clear();
     m_lastAccessedMapByTime.clear();
     m_lastAccessedMapByName.clear();
     m_timeCount = 0;
     m_targetMemory = 0;
 }
 
-MeshStoreObject *MeshStore::getMesh(const std::string &path)
+std::shared_ptr<const MeshStoreObject> MeshStore::getMesh(const std::string &path)
 {
     auto it = m_meshMap.find(path);
     if (it != m_meshMap.end())
@@ -35,65 +39,38 @@ MeshStoreObject *MeshStore::getMesh(const std::string &path)
         timeIt->second = m_timeCount;
         m_lastAccessedMapByTime[m_timeCount] = path;
         m_timeCount++;
-        return it->second.get();
+        return it->second;
     }
+    // meshes that have been evicted or were too big to store can still be shared whilst they are in use
+    auto liveIt = m_liveMeshMap.find(path);
+    if (liveIt != m_liveMeshMap.end()) return liveIt->second.lock();
     return nullptr;
 }
 
-
-void MeshStore::addMesh(const MeshStoreObject &meshStoreObject)
+// the store keeps a reference to the mesh rather than a copy
+// evicting a mesh only drops that reference so any FacetedObject still using it is unaffected
+void MeshStore::addMesh(const std::shared_ptr<const MeshStoreObject> &meshStoreObject)
 {
-    if (meshStoreObject.size() > m_targetMemory) return;
-
-    auto mesh = std::make_unique<MeshStoreObject>();
-    *mesh = meshStoreObject;
-
-    auto timeIt = m_lastAccessedMapByName.find(mesh->path);
-    if (timeIt != m_lastAccessedMapByName.end())
+    for (auto it = m_liveMeshMap.begin(); it != m_liveMeshMap.end();)
     {
-        m_lastAccessedMapByTime.erase(timeIt->second);
-        timeIt->second = m_timeCount;
+        if (it->second.expired()) it = m_liveMeshMap.erase(it);
+        else it++;
     }
-    else m_lastAccessedMapByName[mesh->path] = m_timeCount;
-    m_lastAccessedMapByTime[m_timeCount] = mesh->path;
-    m_timeCount++;
-
-    m_meshMap[meshStoreObject.path] = std::move(mesh);
-}
-
-void MeshStore::addMesh(const std::string &path, const std::vector<double> &vertexList, const std::vector<double> &normalList,
-                        const std::vector<double> &colourList, const std::vector<double> &uvList, const dVector3 &lowerBound, const dVector3 &upperBound)
-{
-    if ((vertexList.size() * sizeof(double) +
-         normalList.size() * sizeof(double) +
-         colourList.size() * sizeof(double) +
-         uvList.size() * sizeof(double) +
-         sizeof(MeshStoreObject)) > m_targetMemory) return;
+    m_liveMeshMap[meshStoreObject->path] = meshStoreObject;
 
-    auto mesh = std::make_unique<MeshStoreObject>();
-    mesh->path = path;
-    mesh->vertexList = vertexList;
-    mesh->normalList = normalList;
-    mesh->colourList = colourList;
-    mesh->uvList = uvList;
-    mesh->lowerBound[0] = lowerBound[0];
-    mesh->lowerBound[1] = lowerBound[1];
-    mesh->lowerBound[2] = lowerBound[2];
-    mesh->upperBound[0] = upperBound[0];
-    mesh->upperBound[1] = upperBound[1];
-    mesh->upperBound[2] = upperBound[2];
+    if (meshStoreObject->size() > m_targetMemory) return;
 
-    auto timeIt = m_lastAccessedMapByName.find(mesh->path);
+    auto timeIt = m_lastAccessedMapByName.find(meshStoreObject->path);
     if (timeIt != m_lastAccessedMapByName.end())
     {
         m_lastAccessedMapByTime.erase(timeIt->second);
         timeIt->second = m_timeCount;
     }
-    else m_lastAccessedMapByName[mesh->path] = m_timeCount;
-    m_lastAccessedMapByTime[m_timeCount] = mesh->path;
+    else m_lastAccessedMapByName[meshStoreObject->path] = m_timeCount;
+    m_lastAccessedMapByTime[m_timeCount] = meshStoreObject->path;
     m_timeCount++;
 
-    m_meshMap[path] = std::move(mesh);
+    m_meshMap[meshStoreObject->path] = meshStoreObject;
 }
 
 uint64_t MeshStore::getCurrentMemory()
@@ -126,6 +103,131 @@ void MeshStore::setTargetMemory(double targetMemoryFraction)
 }
 
 
+void MeshStoreObject::addVertex(const double *vertex, const double *normal, const double *colour, const double *uv)
+{
+    for (size_t i = 0; i < 3; i++) vertexList.push_back(float(vertex[i]));
+    for (size_t i = 0; i < 3; i++) vertexList.push_back(float(normal[i]));
+    for (size_t i = 0; i < 3; i++) vertexList.push_back(float(colour[i]));
+    for (size_t i = 0; i < 2; i++) vertexList.push_back(float(uv[i]));
+    for (size_t i = 0; i < 3; i++)
+    {
+        if (vertex[i] < lowerBound[i]) lowerBound[i] = vertex[i];
+        if (vertex[i] > upperBound[i]) upperBound[i] = vertex[i];
+    }
+}
+
+void MeshStoreObject::addTriangleIndices(uint32_t i0, uint32_t i1, uint32_t i2)
+{
+    if (indexList16.size()) useIndexList32();
+    indexList32.push_back(i0);
+    indexList32.push_back(i1);
+    indexList32.push_back(i2);
+}
+
+// converts 16 bit or implicit indices into explicit 32 bit indices
+void MeshStoreObject::useIndexList32()
+{
+    if (indexList16.size())
+    {
+        indexList32.assign(indexList16.begin(), indexList16.end());
+        indexList16.clear();
+        indexList16.shrink_to_fit();
+        return;
+    }
+    if (indexList32.size()) return;
+    indexList32.resize(numVertices());
+    for (size_t i = 0; i < indexList32.size(); i++) indexList32[i] = uint32_t(i);
+}
+
+void MeshStoreObject::reserve(size_t numTriangles)
+{
+    vertexList.reserve(numTriangles * 3 * vertexStride);
+}
+
+void MeshStoreObject::clear()
+{
+    bvhCache.reset();
+    vertexList.clear();
+    indexList16.clear();
+    indexList32.clear();
+    lowerBound[0] = lowerBound[1] = lowerBound[2] = DBL_MAX;
+    upperBound[0] = upperBound[1] = upperBound[2] = -DBL_MAX;
+}
+
+const MeshBVH *MeshStoreObject::bvh() const
+{
+    if (!bvhCache) bvhCache = std::make_unique<MeshBVH>(vertexList.data(), vertexStride, indexList16.size() ? indexList16.data() : nullptr,
+                                                        indexList32.size() ? indexList32.data() : nullptr, numTriangles());
+    return bvhCache.get();
+}
+
+// merge vertices that are identical in every attribute and switch to 16 bit indices if possible
+// only exact matches are merged so the rendered mesh is unchanged and if nothing is merged the
+// mesh is left without indices since they would only add to its size
+void MeshStoreObject::weld()
+{
+    size_t numOldVertices = numVertices();
+    size_t numOldIndices = numIndices();
+    size_t tableSize = 16;
+    while (tableSize < numOldVertices * 2) tableSize *= 2;
+    std::vector<uint32_t> table(tableSize, UINT32_MAX);
+    std::vector<uint32_t> remap(numOldVertices);
+    size_t numNewVertices = 0;
+    for (size_t i = 0; i < numOldVertices; i++)
+    {
+        const float *v = &vertexList[i * vertexStride];
+        uint64_t hash = 14695981039346656037ull; // FNV-1a style but a word at a time
+        for (size_t j = 0; j < vertexStride; j++)
+        {
+            uint32_t word;
+            std::memcpy(&word, v + j, sizeof(word));
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        size_t slot = size_t(hash ^ (hash >> 32)) & (tableSize - 1);
+        while (true)
+        {
+            uint32_t candidate = table[slot];
+            if (candidate == UINT32_MAX)
+            {
+                table[slot] = uint32_t(numNewVertices);
+                if (numNewVertices != i) std::copy_n(v, vertexStride, &vertexList[numNewVertices * vertexStride]);
+                remap[i] = uint32_t(numNewVertices);
+                numNewVertices++;
+                break;
+            }
+            if (std::memcmp(&vertexList[candidate * vertexStride], v, vertexStride * sizeof(float)) == 0)
+            {
+                remap[i] = candidate;
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+    }
+    if (numNewVertices == numOldVertices && !indexed())
+    {
+        vertexList.shrink_to_fit();
+        return;
+    }
+    vertexList.resize(numNewVertices * vertexStride);
+    vertexList.shrink_to_fit();
+
+    std::vector<uint32_t> indices(numOldIndices);
+    for (size_t i = 0; i < indices.size(); i++) indices[i] = remap[index(i)];
+    indexList16.clear();
+    indexList32.clear();
+    if (numNewVertices <= 65536)
+    {
+        indexList16.assign(indices.begin(), indices.end());
+        indexList32.shrink_to_fit();
+    }
+    else
+    {
+        indexList32.swap(indices);
+        indexList16.shrink_to_fit();
+    }
+}
+
+
 #if defined(_WIN32) || defined(WIN32)
 #include <Windows.h>
 
@@ -11,6 +11,12 @@
 #define MESHSTORE_H
 
 #include "ode/ode.h"
+#include "MeshBVH.h"
+
+#ifndef USE_QT3D
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#endif
 
 #include <vector>
 #include <string>
@@ -18,23 +24,56 @@
 #include <map>
 #include <memory>
 
+// a MeshStoreObject is immutable once it has been added to the MeshStore so that it can be
+// shared between every FacetedObject that uses the same mesh
 struct MeshStoreObject
 {
+    // vertices are interleaved as x, y, z, nx, ny, nz, r, g, b, u, v which is also the layout used on the GPU
+    // if there are no indices then the vertices are used in order, three to a triangle
+    static const size_t vertexStride = 11;
+
     uint64_t size() const
     {
-        return (vertexList.size() * sizeof(double) +
-                normalList.size() * sizeof(double) +
-                colourList.size() * sizeof(double) +
-                uvList.size() * sizeof(double) +
+        return (vertexList.size() * sizeof(float) +
+                indexList16.size() * sizeof(uint16_t) +
+                indexList32.size() * sizeof(uint32_t) +
                 sizeof(MeshStoreObject));
     }
+    size_t numVertices() const { return vertexList.size() / vertexStride; }
+    bool indexed() const { return indexList16.size() || indexList32.size(); }
+    size_t numIndices() const { return indexed() ? indexList16.size() + indexList32.size() : numVertices(); }
+    size_t numTriangles() const { return numIndices() / 3; }
+    uint32_t index(size_t i) const { return indexList16.size() ? indexList16[i] : indexList32.size() ? indexList32[i] : uint32_t(i); }
+    const float *vertex(size_t i) const { return &vertexList[i * vertexStride]; }
+    const float *normal(size_t i) const { return &vertexList[i * vertexStride + 3]; }
+    const float *colour(size_t i) const { return &vertexList[i * vertexStride + 6]; }
+    const float *uv(size_t i) const { return &vertexList[i * vertexStride + 9]; }
+    const float *triangleVertex(size_t triangle, size_t corner) const { return vertex(index(triangle * 3 + corner)); }
+    const void *indexData() const { return indexList16.size() ? static_cast<const void *>(indexList16.data()) : static_cast<const void *>(indexList32.data()); }
+    size_t indexDataSize() const { return indexList16.size() * sizeof(uint16_t) + indexList32.size() * sizeof(uint32_t); }
+
+    void addVertex(const double *vertex, const double *normal, const double *colour, const double *uv);
+    void addTriangleIndices(uint32_t i0, uint32_t i1, uint32_t i2); // only needed for meshes that are already indexed
+    void useIndexList32();
+    void reserve(size_t numTriangles);
+    void clear();
+    void weld();
+    const MeshBVH *bvh() const;
+
     std::string path;
-    std::vector<double> vertexList;
-    std::vector<double> normalList;
-    std::vector<double> colourList;
-    std::vector<double> uvList;
+    std::vector<float> vertexList;
+    std::vector<uint16_t> indexList16; // used instead of indexList32 when a welded mesh has few enough vertices
+    std::vector<uint32_t> indexList32;
     dVector3 lowerBound = {DBL_MAX, DBL_MAX, DBL_MAX, 0};
     dVector3 upperBound = {-DBL_MAX, -DBL_MAX, -DBL_MAX, 0};
+    // the picking hierarchy is built the first time it is needed (from the GUI thread) and is dropped if the mesh changes
+    mutable std::unique_ptr<MeshBVH> bvhCache;
+#ifndef USE_QT3D
+    // the GPU copy is created by the first FacetedObject that draws the mesh and is then used by all of them
+    mutable QOpenGLBuffer vertexBuffer;
+    mutable QOpenGLBuffer indexBuffer = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+    mutable QOpenGLContextGroup *vertexBufferContextGroup = nullptr;
+#endif
 };
 
 class MeshStore
@@ -42,11 +81,8 @@ class MeshStore
 public:
     MeshStore();
 
-    MeshStoreObject *getMesh(const std::string &path);
-    void addMesh(const MeshStoreObject &meshStoreObject);
-    void addMesh(const std::string &path, const std::vector<double> &vertexList, const std::vector<double> &normalList,
-                 const std::vector<double> &colourList, const std::vector<double> &uvList,
-                 const dVector3 &lowerBound, const dVector3 &upperBound);
+    std::shared_ptr<const MeshStoreObject> getMesh(const std::string &path);
+    void addMesh(const std::shared_ptr<const MeshStoreObject> &meshStoreObject);
     void clear();
 
     uint64_t getCurrentMemory();
@@ -56,7 +92,8 @@ public:
 
 
 private:
-    std::unordered_map<std::string, std::unique_ptr<MeshStoreObject>> m_meshMap;
+    std::unordered_map<std::string, std::shared_ptr<const MeshStoreObject>> m_meshMap;
+    std::unordered_map<std::string, std::weak_ptr<const MeshStoreObject>> m_liveMeshMap;
     std::map<uint64_t, std::string> m_lastAccessedMapByTime;
     std::unordered_map<std::string, uint64_t> m_lastAccessedMapByName;
     uint64_t m_timeCount = 0;
@@ -0,0 +1,348 @@
+/*
+ *  SimulationSnapshot.cpp
+ *  GaitSymODE2019
+ *
+ */
+
+#include "SimulationSnapshot.h"
+#include "Simulation.h"
+#include "Body.h"
+#include "Marker.h"
+#include "Muscle.h"
+#include "Strap.h"
+#include "TwoPointStrap.h"
+#include "NPointStrap.h"
+#include "CylinderWrapStrap.h"
+#include "TwoCylinderWrapStrap.h"
+#include "FluidSac.h"
+#include "FixedJoint.h"
+#include "Geom.h"
+#include "Contact.h"
+
+#include <atomic>
+
+namespace
+{
+
+std::atomic<uint64_t> g_lastSerial(0);
+
+// removes the entries for elements that are no longer in the simulation
+template <typename T, typename U> void RemoveMissing(const std::map<std::string, U> &current, std::map<std::string, T> *captured)
+{
+    for (auto it = captured->begin(); it != captured->end();)
+    {
+        if (current.count(it->first)) it++;
+        else it = captured->erase(it);
+    }
+}
+
+template <typename U> void CaptureElements(const std::map<std::string, std::unique_ptr<U>> &current, std::map<std::string, SimulationSnapshot::Element> *captured)
+{
+    RemoveMissing(current, captured);
+    for (auto &&it : current)
+    {
+        SimulationSnapshot::Element &element = (*captured)[it.first];
+        element.object = it.second.get();
+        element.redraw = it.second->redraw();
+        it.second->setRedraw(false);
+    }
+}
+
+void MergeElementRedraw(const std::map<std::string, SimulationSnapshot::Element> &replaced, std::map<std::string, SimulationSnapshot::Element> *captured)
+{
+    for (auto &&it : replaced)
+    {
+        if (!it.second.redraw) continue;
+        auto found = captured->find(it.first);
+        if (found != captured->end()) found->second.redraw = true;
+    }
+}
+
+}
+
+SimulationSnapshot::SimulationSnapshot()
+{
+}
+
+void SimulationSnapshot::Capture(Simulation *simulation, size_t cylinderWrapSegments)
+{
+    m_serial = ++g_lastSerial;
+    m_time = simulation->GetTime();
+    m_fitness = simulation->CalculateInstantaneousFitness();
+    m_metabolicEnergy = simulation->GetMetabolicEnergy();
+    m_mechanicalEnergy = simulation->GetMechanicalEnergy();
+
+    CaptureElements(*simulation->GetBodyList(), &m_bodies);
+    CaptureElements(*simulation->GetJointList(), &m_joints);
+    CaptureElements(*simulation->GetGeomList(), &m_geoms);
+    CaptureElements(*simulation->GetMarkerList(), &m_markers);
+    CaptureElements(*simulation->GetMuscleList(), &m_muscles);
+    CaptureElements(*simulation->GetFluidSacList(), &m_fluidSacs);
+    // a muscle is also redrawn when its strap has been edited
+    for (auto &&it : *simulation->GetMuscleList())
+    {
+        if (!it.second->GetStrap()->redraw()) continue;
+        m_muscles[it.first].redraw = true;
+        it.second->GetStrap()->setRedraw(false);
+    }
+
+    RemoveMissing(*simulation->GetBodyList(), &m_bodyPoses);
+    for (auto &&it : *simulation->GetBodyList())
+    {
+        Pose &pose = m_bodyPoses[it.first];
+        const double *p = it.second->GetPosition();
+        const double *q = it.second->GetQuaternion();
+        pose.position.Set(p[0], p[1], p[2]);
+        pose.quaternion.Set(q[0], q[1], q[2], q[3]);
+    }
+
+    RemoveMissing(*simulation->GetMarkerList(), &m_markerPoses);
+    for (auto &&it : *simulation->GetMarkerList())
+    {
+        Pose &pose = m_markerPoses[it.first];
+        pose.position = it.second->GetWorldPosition();
+        pose.quaternion = it.second->GetWorldQuaternion();
+    }
+
+    RemoveMissing(*simulation->GetMuscleList(), &m_muscleGeometries);
+    for (auto &&it : *simulation->GetMuscleList()) CaptureMuscle(it.second.get(), cylinderWrapSegments, &m_muscleGeometries[it.first]);
+
+    RemoveMissing(*simulation->GetFluidSacList(), &m_fluidSacGeometries);
+    for (auto &&it : *simulation->GetFluidSacList()) CaptureFluidSac(it.second.get(), &m_fluidSacGeometries[it.first]);
+
+    RemoveMissing(*simulation->GetJointList(), &m_jointPixMaps);
+    for (auto &&it : *simulation->GetJointList())
+    {
+        FixedJoint *fixedJoint = dynamic_cast<FixedJoint *>(it.second.get());
+        if (fixedJoint == nullptr || fixedJoint->GetStressCalculationType() == FixedJoint::none)
+        {
+            m_jointPixMaps.erase(it.first);
+            continue;
+        }
+        if (fixedJoint->CalculatePixmapNeeded()) fixedJoint->CalculatePixmap();
+        m_jointPixMaps[it.first] = fixedJoint->pixMap();
+    }
+
+    m_contacts.clear();
+    for (auto &&it : *simulation->GetContactList())
+    {
+        const double *p = it->GetContactPosition();
+        const double *f = it->GetJointFeedback()->f1;
+        m_contacts.push_back({pgd::Vector3(p[0], p[1], p[2]), pgd::Vector3(f[0], f[1], f[2])});
+    }
+}
+
+void SimulationSnapshot::MergeRedraw(const SimulationSnapshot &replaced)
+{
+    MergeElementRedraw(replaced.m_bodies, &m_bodies);
+    MergeElementRedraw(replaced.m_joints, &m_joints);
+    MergeElementRedraw(replaced.m_geoms, &m_geoms);
+    MergeElementRedraw(replaced.m_markers, &m_markers);
+    MergeElementRedraw(replaced.m_muscles, &m_muscles);
+    MergeElementRedraw(replaced.m_fluidSacs, &m_fluidSacs);
+}
+
+void SimulationSnapshot::CaptureMuscle(Muscle *muscle, size_t cylinderWrapSegments, MuscleGeometry *geometry)
+{
+    geometry->path.clear();
+    geometry->cylinders.clear();
+    geometry->cylinderRadii.clear();
+    geometry->pointForces.clear();
+    geometry->activation = muscle->GetActivation();
+    geometry->length = muscle->GetLength();
+    geometry->tension = muscle->GetTension();
+
+    for (bool first = true; first; first = false) // this loop runs once to avoid nasty nested if-else statements
+    {
+        TwoPointStrap *twoPointStrap = dynamic_cast<TwoPointStrap *>(muscle->GetStrap());
+        if (twoPointStrap)
+        {
+            std::vector<std::unique_ptr<PointForce>> *pointForceList = twoPointStrap->GetPointForceList();
+            geometry->path.push_back(pgd::Vector3(pointForceList->at(0)->point[0], pointForceList->at(0)->point[1], pointForceList->at(0)->point[2]));
+            geometry->path.push_back(pgd::Vector3(pointForceList->at(1)->point[0], pointForceList->at(1)->point[1], pointForceList->at(1)->point[2]));
+            break;
+        }
+        NPointStrap *nPointStrap = dynamic_cast<NPointStrap *>(muscle->GetStrap());
+        if (nPointStrap)
+        {
+            std::vector<std::unique_ptr<PointForce>> *pointForceList = nPointStrap->GetPointForceList();
+            geometry->path.push_back(pgd::Vector3(pointForceList->at(0)->point[0], pointForceList->at(0)->point[1], pointForceList->at(0)->point[2]));
+            for (size_t i = 2; i < pointForceList->size(); i++)
+                geometry->path.push_back(pgd::Vector3(pointForceList->at(i)->point[0], pointForceList->at(i)->point[1], pointForceList->at(i)->point[2]));
+            geometry->path.push_back(pgd::Vector3(pointForceList->at(1)->point[0], pointForceList->at(1)->point[1], pointForceList->at(1)->point[2]));
+            break;
+        }
+        CylinderWrapStrap *cylinderWrapStrap = dynamic_cast<CylinderWrapStrap *>(muscle->GetStrap());
+        if (cylinderWrapStrap)
+        {
+            if (cylinderWrapStrap->GetNumWrapSegments() != int(cylinderWrapSegments))
+            {
+                cylinderWrapStrap->SetNumWrapSegments(int(cylinderWrapSegments));
+                cylinderWrapStrap->Calculate();
+            }
+            geometry->path = *cylinderWrapStrap->GetPathCoordinates();
+            Marker *marker = cylinderWrapStrap->GetCylinderMarker();
+            geometry->cylinders.push_back({marker->GetWorldPosition(), marker->GetWorldQuaternion()});
+            geometry->cylinderRadii.push_back(cylinderWrapStrap->cylinderRadius());
+            break;
+        }
+        TwoCylinderWrapStrap *twoCylinderWrapStrap = dynamic_cast<TwoCylinderWrapStrap *>(muscle->GetStrap());
+        if (twoCylinderWrapStrap)
+        {
+            if (twoCylinderWrapStrap->GetNumWrapSegments() != int(cylinderWrapSegments))
+            {
+                twoCylinderWrapStrap->SetNumWrapSegments(int(cylinderWrapSegments));
+                twoCylinderWrapStrap->Calculate();
+            }
+            geometry->path = *twoCylinderWrapStrap->GetPathCoordinates();
+            Marker *marker1 = twoCylinderWrapStrap->GetCylinder1Marker();
+            Marker *marker2 = twoCylinderWrapStrap->GetCylinder2Marker();
+            geometry->cylinders.push_back({marker1->GetWorldPosition(), marker1->GetWorldQuaternion()});
+            geometry->cylinders.push_back({marker2->GetWorldPosition(), marker2->GetWorldQuaternion()});
+            geometry->cylinderRadii.push_back(twoCylinderWrapStrap->Cylinder1Radius());
+            geometry->cylinderRadii.push_back(twoCylinderWrapStrap->Cylinder2Radius());
+            break;
+        }
+    }
+
+    std::vector<std::unique_ptr<PointForce>> *pointForceList = muscle->GetPointForceList();
+    for (size_t i = 0; i < pointForceList->size(); i++)
+    {
+        geometry->pointForces.push_back({pgd::Vector3(pointForceList->at(i)->point[0], pointForceList->at(i)->point[1], pointForceList->at(i)->point[2]),
+                                         pgd::Vector3(pointForceList->at(i)->vector[0], pointForceList->at(i)->vector[1], pointForceList->at(i)->vector[2])});
+    }
+}
+
+void SimulationSnapshot::CaptureFluidSac(FluidSac *fluidSac, FluidSacGeometry *geometry)
+{
+    geometry->triangles.resize(fluidSac->numTriangles() * 9);
+    for (size_t i = 0; i < fluidSac->numTriangles(); i++) fluidSac->triangleVertices(i, geometry->triangles.data() + i * 9);
+    geometry->pointForces.clear();
+    for (auto &&it : fluidSac->pointForceList())
+        geometry->pointForces.push_back({pgd::Vector3(it.point[0], it.point[1], it.point[2]), pgd::Vector3(it.vector[0], it.vector[1], it.vector[2])});
+}
+
+const std::map<std::string, SimulationSnapshot::Element> &SimulationSnapshot::bodies() const
+{
+    return m_bodies;
+}
+
+const std::map<std::string, SimulationSnapshot::Element> &SimulationSnapshot::joints() const
+{
+    return m_joints;
+}
+
+const std::map<std::string, SimulationSnapshot::Element> &SimulationSnapshot::geoms() const
+{
+    return m_geoms;
+}
+
+const std::map<std::string, SimulationSnapshot::Element> &SimulationSnapshot::markers() const
+{
+    return m_markers;
+}
+
+const std::map<std::string, SimulationSnapshot::Element> &SimulationSnapshot::muscles() const
+{
+    return m_muscles;
+}
+
+const std::map<std::string, SimulationSnapshot::Element> &SimulationSnapshot::fluidSacs() const
+{
+    return m_fluidSacs;
+}
+
+const SimulationSnapshot::Pose *SimulationSnapshot::bodyPose(const std::string &name) const
+{
+    auto it = m_bodyPoses.find(name);
+    if (it == m_bodyPoses.end()) return nullptr;
+    return &it->second;
+}
+
+const SimulationSnapshot::Pose *SimulationSnapshot::markerPose(const std::string &name) const
+{
+    auto it = m_markerPoses.find(name);
+    if (it == m_markerPoses.end()) return nullptr;
+    return &it->second;
+}
+
+const SimulationSnapshot::MuscleGeometry *SimulationSnapshot::muscleGeometry(const std::string &name) const
+{
+    auto it = m_muscleGeometries.find(name);
+    if (it == m_muscleGeometries.end()) return nullptr;
+    return &it->second;
+}
+
+const SimulationSnapshot::FluidSacGeometry *SimulationSnapshot::fluidSacGeometry(const std::string &name) const
+{
+    auto it = m_fluidSacGeometries.find(name);
+    if (it == m_fluidSacGeometries.end()) return nullptr;
+    return &it->second;
+}
+
+const std::vector<unsigned char> *SimulationSnapshot::jointPixMap(const std::string &name) const
+{
+    auto it = m_jointPixMaps.find(name);
+    if (it == m_jointPixMaps.end()) return nullptr;
+    return &it->second;
+}
+
+const std::vector<SimulationSnapshot::ForceVector> &SimulationSnapshot::contacts() const
+{
+    return m_contacts;
+}
+
+uint64_t SimulationSnapshot::serial() const
+{
+    return m_serial;
+}
+
+double SimulationSnapshot::time() const
+{
+    return m_time;
+}
+
+uint64_t SimulationSnapshot::stepCount() const
+{
+    return m_stepCount;
+}
+
+void SimulationSnapshot::setStepCount(uint64_t stepCount)
+{
+    m_stepCount = stepCount;
+}
+
+SimulationSnapshot::Status SimulationSnapshot::status() const
+{
+    return m_status;
+}
+
+void SimulationSnapshot::setStatus(Status status)
+{
+    m_status = status;
+}
+
+double SimulationSnapshot::fitness() const
+{
+    return m_fitness;
+}
+
+double SimulationSnapshot::metabolicEnergy() const
+{
+    return m_metabolicEnergy;
+}
+
+double SimulationSnapshot::mechanicalEnergy() const
+{
+    return m_mechanicalEnergy;
+}
+
+const std::string &SimulationSnapshot::log() const
+{
+    return m_log;
+}
+
+void SimulationSnapshot::setLog(const std::string &log)
+{
+    m_log = log;
+}
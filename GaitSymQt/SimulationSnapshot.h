@@ -0,0 +1,130 @@
+/*
+ *  SimulationSnapshot.h
+ *  GaitSymODE2019
+ *
+ */
+
+#ifndef SIMULATIONSNAPSHOT_H
+#define SIMULATIONSNAPSHOT_H
+
+#include "PGDMath.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class Simulation;
+class NamedObject;
+class Muscle;
+class FluidSac;
+
+// SimulationSnapshot holds everything the SimulationWidget needs to draw a simulation
+// it is filled by the simulation thread and is never altered once it has been published
+// so the GUI thread can draw from it while the simulation carries on stepping
+// when there is no simulation thread the SimulationWidget fills its own snapshot
+
+class SimulationSnapshot
+{
+public:
+    SimulationSnapshot();
+
+    enum Status { running, paused, ended, aborted, unableToStart };
+
+    // object is used to build the drawable and the drawable then only reads the parts of the element
+    // that are not changed by stepping (meshes, sizes and colours)
+    // redraw is set when the element has been edited since the previous snapshot
+    struct Element
+    {
+        NamedObject *object = nullptr;
+        bool redraw = false;
+    };
+
+    struct Pose
+    {
+        pgd::Vector3 position;
+        pgd::Quaternion quaternion;
+    };
+
+    struct ForceVector
+    {
+        pgd::Vector3 point;
+        pgd::Vector3 vector;
+    };
+
+    struct MuscleGeometry
+    {
+        std::vector<pgd::Vector3> path;
+        std::vector<Pose> cylinders;
+        std::vector<double> cylinderRadii;
+        std::vector<ForceVector> pointForces;
+        double activation = 0;
+        double length = 0;
+        double tension = 0;
+    };
+
+    struct FluidSacGeometry
+    {
+        std::vector<double> triangles; // 9 values per triangle
+        std::vector<ForceVector> pointForces;
+    };
+
+    // this also clears the redraw flags of the simulation elements
+    void Capture(Simulation *simulation, size_t cylinderWrapSegments);
+    // keeps the redraw flags from a snapshot that was replaced before the GUI took it
+    void MergeRedraw(const SimulationSnapshot &replaced);
+    static void CaptureMuscle(Muscle *muscle, size_t cylinderWrapSegments, MuscleGeometry *geometry);
+    static void CaptureFluidSac(FluidSac *fluidSac, FluidSacGeometry *geometry);
+
+    const std::map<std::string, Element> &bodies() const;
+    const std::map<std::string, Element> &joints() const;
+    const std::map<std::string, Element> &geoms() const;
+    const std::map<std::string, Element> &markers() const;
+    const std::map<std::string, Element> &muscles() const;
+    const std::map<std::string, Element> &fluidSacs() const;
+
+    // these return nullptr if the element was not captured
+    const Pose *bodyPose(const std::string &name) const;
+    const Pose *markerPose(const std::string &name) const;
+    const MuscleGeometry *muscleGeometry(const std::string &name) const;
+    const FluidSacGeometry *fluidSacGeometry(const std::string &name) const;
+    const std::vector<unsigned char> *jointPixMap(const std::string &name) const;
+    const std::vector<ForceVector> &contacts() const;
+
+    uint64_t serial() const; // different for every capture
+    double time() const;
+    uint64_t stepCount() const;
+    void setStepCount(uint64_t stepCount);
+    Status status() const;
+    void setStatus(Status status);
+    double fitness() const;
+    double metabolicEnergy() const;
+    double mechanicalEnergy() const;
+    const std::string &log() const;
+    void setLog(const std::string &log);
+
+private:
+    // the maps are keyed by element name and keep their nodes when a buffer is reused for the next snapshot
+    std::map<std::string, Element> m_bodies;
+    std::map<std::string, Element> m_joints;
+    std::map<std::string, Element> m_geoms;
+    std::map<std::string, Element> m_markers;
+    std::map<std::string, Element> m_muscles;
+    std::map<std::string, Element> m_fluidSacs;
+    std::map<std::string, Pose> m_bodyPoses;
+    std::map<std::string, Pose> m_markerPoses;
+    std::map<std::string, MuscleGeometry> m_muscleGeometries;
+    std::map<std::string, FluidSacGeometry> m_fluidSacGeometries;
+    std::map<std::string, std::vector<unsigned char>> m_jointPixMaps;
+    std::vector<ForceVector> m_contacts;
+
+    uint64_t m_serial = 0;
+    double m_time = 0;
+    uint64_t m_stepCount = 0;
+    Status m_status = running;
+    double m_fitness = 0;
+    double m_metabolicEnergy = 0;
+    double m_mechanicalEnergy = 0;
+    std::string m_log;
+};
+
+#endif // SIMULATIONSNAPSHOT_H
@@ -0,0 +1,243 @@
+/*
+ *  SimulationThread.cpp
+ *  GaitSymODE2019
+ *
+ */
+
+#include "SimulationThread.h"
+#include "Simulation.h"
+
+#include <iostream>
+#include <algorithm>
+
+SimulationThread::SimulationThread(Simulation *simulation, size_t cylinderWrapSegments)
+{
+    m_simulation = simulation;
+    m_cylinderWrapSegments = cylinderWrapSegments;
+
+    // std::cerr is captured for the whole life of the thread rather than every step
+    m_oldCerrBuffer = std::cerr.rdbuf(&m_capturedCerr);
+
+    // the initial state is published before the thread starts so there is always something to draw
+    Publish(SimulationSnapshot::paused);
+
+    m_thread = std::thread(&SimulationThread::ThreadLoop, this);
+}
+
+SimulationThread::~SimulationThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_command = quitCommand;
+    }
+    m_commandChanged.notify_all();
+    m_stateChanged.notify_all();
+    m_thread.join();
+    std::cerr.rdbuf(m_oldCerrBuffer);
+    std::cerr << m_capturedCerr.Take();
+}
+
+void SimulationThread::Run()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_command == quitCommand) return;
+        m_command = runCommand;
+    }
+    m_commandChanged.notify_all();
+}
+
+void SimulationThread::Step()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_command == quitCommand) return;
+        m_command = stepCommand;
+    }
+    m_commandChanged.notify_all();
+}
+
+void SimulationThread::Pause()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_command == quitCommand) return;
+    m_command = pauseCommand;
+    m_stateChanged.notify_all(); // releases a frame locked Publish
+    m_stateChanged.wait(lock, [this] { return m_paused; });
+}
+
+bool SimulationThread::isRunning()
+{
+    return m_command == runCommand;
+}
+
+void SimulationThread::setSnapshotInterval(size_t snapshotInterval)
+{
+    m_snapshotInterval = std::max(snapshotInterval, size_t(1));
+}
+
+void SimulationThread::setFrameLocked(bool frameLocked)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frameLocked = frameLocked;
+    }
+    m_stateChanged.notify_all();
+}
+
+const SimulationSnapshot *SimulationThread::TakeSnapshot()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_readyIsNew) return nullptr;
+        std::swap(m_frontIndex, m_readyIndex);
+        m_readyIsNew = false;
+    }
+    m_stateChanged.notify_all();
+    return &m_snapshots[m_frontIndex];
+}
+
+void SimulationThread::Refresh()
+{
+    SimulationSnapshot::Status status = SimulationSnapshot::paused;
+    {
+        // the thread cannot start again until the GUI asks it to so the simulation and the back buffer are free to use
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_command != pauseCommand || !m_paused) return;
+        // a status the GUI has not seen yet (e.g. ended) is kept
+        if (m_readyIsNew) status = m_snapshots[m_readyIndex].status();
+    }
+    Publish(status);
+    if (m_refreshCallback) m_refreshCallback();
+}
+
+void SimulationThread::setRefreshCallback(const std::function<void()> &refreshCallback)
+{
+    m_refreshCallback = refreshCallback;
+}
+
+void SimulationThread::ThreadLoop()
+{
+    while (true)
+    {
+        Command command;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_paused = true;
+            m_stateChanged.notify_all();
+            m_commandChanged.wait(lock, [this] { return m_command != pauseCommand; });
+            command = m_command;
+            if (command == quitCommand) return;
+            m_paused = false;
+        }
+
+        if (m_simulation->ShouldQuit() || m_simulation->TestForCatastrophy())
+        {
+            Publish(SimulationSnapshot::unableToStart);
+            ReplaceCommand(command, pauseCommand);
+            continue;
+        }
+
+        while (true)
+        {
+            command = m_command;
+            if (command == pauseCommand || command == quitCommand)
+            {
+                Publish(SimulationSnapshot::paused);
+                break;
+            }
+
+            m_simulation->UpdateSimulation();
+            m_stepCount++;
+
+            if (m_simulation->ShouldQuit())
+            {
+                Publish(SimulationSnapshot::ended);
+                ReplaceCommand(command, pauseCommand);
+                break;
+            }
+            if (m_simulation->TestForCatastrophy())
+            {
+                Publish(SimulationSnapshot::aborted);
+                ReplaceCommand(command, pauseCommand);
+                break;
+            }
+            if ((m_stepCount % m_snapshotInterval) == 0)
+            {
+                if (command == stepCommand)
+                {
+                    Publish(SimulationSnapshot::paused);
+                    ReplaceCommand(command, pauseCommand);
+                    break;
+                }
+                Publish(SimulationSnapshot::running);
+            }
+        }
+    }
+}
+
+void SimulationThread::Publish(SimulationSnapshot::Status status)
+{
+    // the back buffer belongs to this thread so it can be filled without the lock
+    SimulationSnapshot *snapshot = &m_snapshots[m_backIndex];
+    snapshot->Capture(m_simulation, m_cylinderWrapSegments);
+    snapshot->setStepCount(m_stepCount);
+    snapshot->setStatus(status);
+    snapshot->setLog(m_capturedCerr.Take());
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_frameLocked && status == SimulationSnapshot::running)
+        m_stateChanged.wait(lock, [this] { return !m_readyIsNew || !m_frameLocked || (m_command != runCommand && m_command != stepCommand); });
+    // make sure no log output or redraw is lost if the GUI never saw the previous snapshot
+    if (m_readyIsNew)
+    {
+        if (m_snapshots[m_readyIndex].log().size()) snapshot->setLog(m_snapshots[m_readyIndex].log() + snapshot->log());
+        snapshot->MergeRedraw(m_snapshots[m_readyIndex]);
+    }
+    std::swap(m_backIndex, m_readyIndex);
+    m_readyIsNew = true;
+}
+
+void SimulationThread::ReplaceCommand(Command oldCommand, Command newCommand)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_command == oldCommand) m_command = newCommand;
+}
+
+SimulationThread::PauseGuard::PauseGuard(SimulationThread *simulationThread)
+{
+    m_simulationThread = simulationThread;
+    if (!m_simulationThread) return;
+    m_resume = m_simulationThread->isRunning();
+    m_simulationThread->Pause();
+}
+
+SimulationThread::PauseGuard::~PauseGuard()
+{
+    if (!m_simulationThread) return;
+    if (m_resume) m_simulationThread->Run();
+    else m_simulationThread->Refresh();
+}
+
+std::string SimulationThread::CapturedStreamBuffer::Take()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string text;
+    text.swap(m_text);
+    return text;
+}
+
+SimulationThread::CapturedStreamBuffer::int_type SimulationThread::CapturedStreamBuffer::overflow(int_type c)
+{
+    if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_text.push_back(traits_type::to_char_type(c));
+    return c;
+}
+
+std::streamsize SimulationThread::CapturedStreamBuffer::xsputn(const char *s, std::streamsize n)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_text.append(s, size_t(n));
+    return n;
+}
@@ -0,0 +1,108 @@
+/*
+ *  SimulationThread.h
+ *  GaitSymODE2019
+ *
+ */
+
+#ifndef SIMULATIONTHREAD_H
+#define SIMULATIONTHREAD_H
+
+#include "SimulationSnapshot.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <streambuf>
+#include <string>
+#include <functional>
+
+class Simulation;
+
+// SimulationThread steps the simulation on a worker thread and publishes a SimulationSnapshot
+// every snapshotInterval steps through a triple buffer so the GUI always draws the latest complete state
+// the GUI must only touch the simulation directly when the thread is paused (see PauseGuard)
+
+class SimulationThread
+{
+public:
+    SimulationThread(Simulation *simulation, size_t cylinderWrapSegments);
+    ~SimulationThread();
+
+    void Run();
+    void Step(); // runs until the next snapshot and then pauses
+    void Pause(); // returns once the simulation thread has stopped using the simulation
+    bool isRunning();
+
+    void setSnapshotInterval(size_t snapshotInterval);
+    void setFrameLocked(bool frameLocked); // waits for each snapshot to be taken before carrying on (needed for movies)
+
+    // returns the newest snapshot or nullptr if nothing has been published since the last call
+    // the snapshot remains valid and unaltered until the next call
+    const SimulationSnapshot *TakeSnapshot();
+
+    // publishes the current state if the thread is paused so that changes made to the simulation are drawn
+    // the callback is called afterwards (on the calling thread) so that the GUI knows there is a snapshot to take
+    void Refresh();
+    void setRefreshCallback(const std::function<void()> &refreshCallback);
+
+    // pauses the simulation thread for the lifetime of the guard and then carries on if it was running
+    // or publishes a fresh snapshot if it was not
+    class PauseGuard
+    {
+    public:
+        PauseGuard(SimulationThread *simulationThread);
+        ~PauseGuard();
+    private:
+        SimulationThread *m_simulationThread = nullptr;
+        bool m_resume = false;
+    };
+
+private:
+    enum Command { pauseCommand, runCommand, stepCommand, quitCommand };
+
+    // collects std::cerr output from any thread so it can be passed to the GUI with the snapshots
+    class CapturedStreamBuffer : public std::streambuf
+    {
+    public:
+        std::string Take();
+    protected:
+        virtual int_type overflow(int_type c);
+        virtual std::streamsize xsputn(const char *s, std::streamsize n);
+    private:
+        std::mutex m_mutex;
+        std::string m_text;
+    };
+
+    void ThreadLoop();
+    void Publish(SimulationSnapshot::Status status);
+    void ReplaceCommand(Command oldCommand, Command newCommand);
+
+    Simulation *m_simulation = nullptr;
+    size_t m_cylinderWrapSegments = 0;
+    uint64_t m_stepCount = 0;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_commandChanged;
+    std::condition_variable m_stateChanged;
+    std::atomic<Command> m_command = {pauseCommand};
+    std::atomic<size_t> m_snapshotInterval = {1};
+    bool m_frameLocked = false;
+    bool m_paused = true;
+
+    // the simulation thread writes m_snapshots[m_backIndex] and the GUI reads m_snapshots[m_frontIndex]
+    // publishing swaps back and ready and taking swaps ready and front
+    SimulationSnapshot m_snapshots[3];
+    size_t m_backIndex = 0;
+    size_t m_readyIndex = 1;
+    size_t m_frontIndex = 2;
+    bool m_readyIsNew = false;
+
+    CapturedStreamBuffer m_capturedCerr;
+    std::streambuf *m_oldCerrBuffer = nullptr;
+
+    std::function<void()> m_refreshCallback;
+};
+
+#endif // SIMULATIONTHREAD_H
@@ -30,6 +30,7 @@
 #include "Preferences.h"
 #include "MainWindow.h"
 #include "GSUtil.h"
+#include "SimulationSnapshot.h"
 
 #include <QApplication>
 #include <QClipboard>
@@ -51,6 +52,7 @@
 #include <QDateTime>
 
 #include <cmath>
+#include <cstring>
 #include <numeric>
 #include <algorithm>
 #include <sstream>
@@ -78,6 +80,10 @@ SimulationWidget::SimulationWidget(QWidget *parent)
     setMouseTracking(true);
 }
 
+SimulationWidget::~SimulationWidget()
+{
+}
+
 
 void SimulationWidget::initializeGL()
 {
@@ -734,24 +740,116 @@ int SimulationWidget::WriteStillFrame(const QString &filename)
     return 0;
 }
 
-// write the current frame out to a file
+// write the current frame out to the movie
 int SimulationWidget::WriteMovieFrame()
 {
     Q_ASSERT(m_aviWriter);
-    QImage image = grabFramebuffer();
-    if (image.sizeInBytes() == 0) return __LINE__; //should always be OK, but you never know. ;)
-    m_aviWriter->WriteAVI(image, m_aviQuality);
-    return 0;
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+    int err = CaptureMovieFrame();
+    m_movieFrameTime += double(frameTimer.nsecsElapsed()) / 1e9;
+    m_movieFrames++;
+    return err;
+}
+
+// renders the current view and starts an asynchronous read back into one of the pixel buffer objects
+// the frame read back into the other buffer last time is then passed on to the AVIWriter
+int SimulationWidget::CaptureMovieFrame()
+{
+    makeCurrent();
+    QSize size(devicePixelRatio() * width(), devicePixelRatio() * height());
+    if (!m_captureFBO || size != m_captureSize)
+    {
+        for (size_t i = 0; i < 2; i++) { if (m_capturePBOPending[i]) CollectMovieFrame(i); }
+        m_captureSize = size;
+        m_captureFBO = std::make_unique<QOpenGLFramebufferObject>(size, QOpenGLFramebufferObject::NoAttachment, GL_TEXTURE_2D, GL_RGBA8);
+        for (size_t i = 0; i < 2; i++)
+        {
+            if (!m_capturePBO[i].isCreated()) m_capturePBO[i].create();
+            m_capturePBO[i].setUsagePattern(QOpenGLBuffer::StreamRead);
+            m_capturePBO[i].bind();
+            m_capturePBO[i].allocate(size.width() * size.height() * 4);
+            m_capturePBO[i].release();
+        }
+    }
+
+    // render into the widget framebuffer in the same way as grabFramebuffer()
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    glViewport(0, 0, size.width(), size.height());
+    paintGL();
+
+    // the blit resolves any multisampling
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, defaultFramebufferObject());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_captureFBO->handle());
+    glBlitFramebuffer(0, 0, size.width(), size.height(), 0, 0, size.width(), size.height(), GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_captureFBO->handle());
+    m_capturePBO[m_capturePBOIndex].bind();
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // returns immediately because the target is a PBO
+    m_capturePBO[m_capturePBOIndex].release();
+    m_capturePBOPending[m_capturePBOIndex] = true;
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+
+    m_capturePBOIndex = 1 - m_capturePBOIndex;
+    int err = CollectMovieFrame(m_capturePBOIndex);
+    doneCurrent();
+    return err;
+}
+
+// the context must be current when this is called
+int SimulationWidget::CollectMovieFrame(size_t index)
+{
+    if (!m_capturePBOPending[index]) return 0;
+    m_capturePBOPending[index] = false;
+    int byteCount = m_captureSize.width() * m_captureSize.height() * 4;
+    m_capturePBO[index].bind();
+    const void *data = m_capturePBO[index].mapRange(0, byteCount, QOpenGLBuffer::RangeRead);
+    if (!data)
+    {
+        m_capturePBO[index].release();
+        return __LINE__;
+    }
+    QImage image(m_captureSize, QImage::Format_RGBX8888);
+    memcpy(image.bits(), data, size_t(byteCount));
+    m_capturePBO[index].unmap();
+    m_capturePBO[index].release();
+    if (!m_aviWriter) return __LINE__;
+    return m_aviWriter->WriteAVI(image, m_aviQuality, true); // OpenGL rows are bottom to top so the encoder flips them
+}
+
+void SimulationWidget::ReleaseMovieCapture()
+{
+    makeCurrent();
+    // the most recent frame is still in its buffer
+    CollectMovieFrame(1 - m_capturePBOIndex);
+    CollectMovieFrame(m_capturePBOIndex);
+    for (size_t i = 0; i < 2; i++) { if (m_capturePBO[i].isCreated()) m_capturePBO[i].destroy(); }
+    m_captureFBO.reset();
+    m_captureSize = QSize();
+    m_capturePBOIndex = 0;
+    doneCurrent();
 }
 
 int SimulationWidget::StartAVISave(const QString &filename)
 {
     m_aviWriter = std::make_unique<AVIWriter>();
     if (m_aviQuality == 0) return __LINE__; // should always be true
-    QImage image = grabFramebuffer();
-    if (image.sizeInBytes() == 0) return __LINE__; //should always be OK, but you never know. ;)
-    m_aviWriter->InitialiseFile(filename, static_cast<unsigned int>(image.size().width()), static_cast<unsigned int>(image.size().height()), m_fps);
-    m_aviWriter->WriteAVI(image, m_aviQuality);
+    m_aviWriter->setEncoderThreads(size_t(std::max(Preferences::valueInt("MovieEncoderThreads"), 1)));
+    m_aviWriter->setQueueLength(size_t(std::max(Preferences::valueInt("MovieFrameQueueLength"), 1)));
+    QSize size(devicePixelRatio() * width(), devicePixelRatio() * height());
+    int err;
+    if (QFileInfo(filename).suffix().compare("avi", Qt::CaseInsensitive) == 0)
+        err = m_aviWriter->InitialiseFile(filename, static_cast<unsigned int>(size.width()), static_cast<unsigned int>(size.height()), m_fps);
+    else
+        err = m_aviWriter->InitialiseImageSequence(filename, static_cast<unsigned int>(size.width()), static_cast<unsigned int>(size.height()));
+    if (err)
+    {
+        m_aviWriter.reset();
+        return __LINE__;
+    }
+    m_movieFrames = 0;
+    m_movieFrameTime = 0;
+    WriteMovieFrame();
     QDir dir(QFileInfo(filename).path()); // note that the path() function for a QFileInfo gives the parent path which is what is wanted
     QString metadataFileName = dir.absoluteFilePath(QFileInfo(filename).completeBaseName() + Preferences::valueQString("MovieMetadataSuffix", "_metadata") + ".xml");
     QFile metadataFile(metadataFileName);
@@ -764,8 +862,8 @@ int SimulationWidget::StartAVISave(const QString &filename)
         a.setAttribute("movieFile", QFileInfo(filename).canonicalFilePath());
         a.setAttribute("movieFileMetaData", QFileInfo(metadataFileName).canonicalFilePath());
         a.setAttribute("timestamp", QDateTime::currentDateTime().toString());
-        a.setAttribute("width", image.size().width());
-        a.setAttribute("height", image.size().height());
+        a.setAttribute("width", size.width());
+        a.setAttribute("height", size.height());
         a.setAttribute("fps", m_fps);
         a.setAttribute("aviQuality", m_aviQuality);
         a.setAttribute("cameraDistance", m_cameraDistance);
@@ -797,6 +895,18 @@ int SimulationWidget::StartAVISave(const QString &filename)
 int SimulationWidget::StopAVISave()
 {
     if (!m_aviWriter) return __LINE__;
+    ReleaseMovieCapture();
+    QElapsedTimer flushTimer;
+    flushTimer.start();
+    m_aviWriter->Flush();
+    double flushTime = double(flushTimer.nsecsElapsed()) / 1e9;
+    if (m_mainWindow && m_movieFrames)
+    {
+        double frames = double(m_movieFrames);
+        m_mainWindow->log(QString("Movie capture: %1 frames, %2 ms per frame on the GUI thread (%3 ms waiting for the encoders), %4 ms per frame encoding on %5 threads, %6 s to flush\n")
+                          .arg(m_movieFrames).arg(1000 * m_movieFrameTime / frames, 0, 'f', 2).arg(1000 * m_aviWriter->waitTime() / frames, 0, 'f', 2)
+                          .arg(1000 * m_aviWriter->encodeTime() / std::max(double(m_aviWriter->framesWritten()), 1.0), 0, 'f', 2).arg(m_aviWriter->encoderThreads()).arg(flushTime, 0, 'f', 3));
+    }
     m_aviWriter.reset(nullptr);
     return 0;
 }
@@ -1049,166 +1159,186 @@ bool SimulationWidget::DeleteDrawBody(const std::string &bodyName)
 void SimulationWidget::drawModel()
 {
     if (!m_simulation) return;
-    auto bodyList = m_simulation->GetBodyList();
+    // everything is drawn from a snapshot so the simulation itself is never read here
+    // when there is no simulation thread the snapshot is captured from the (idle) simulation
+    if (!m_snapshot)
+    {
+        if (!m_localSnapshot) m_localSnapshot = std::make_unique<SimulationSnapshot>();
+        m_localSnapshot->Capture(m_simulation, size_t(Preferences::valueInt("StrapCylinderWrapSegments")));
+    }
+    const SimulationSnapshot *snapshot = this->snapshot();
+    // the redraw flags only apply the first time a snapshot is drawn
+    bool newSnapshot = snapshot->serial() != m_drawnSnapshotSerial;
+    m_drawnSnapshotSerial = snapshot->serial();
+
     auto drawBodyMapIter = m_drawBodyMap.begin();
     while (drawBodyMapIter != m_drawBodyMap.end())
     {
-        auto found = bodyList->find(drawBodyMapIter->first);
-        if (found == bodyList->end() || found->second->redraw() == true)
+        auto found = snapshot->bodies().find(drawBodyMapIter->first);
+        if (found == snapshot->bodies().end() || found->second.object != drawBodyMapIter->second->body() || (newSnapshot && found->second.redraw))
         {
             drawBodyMapIter = m_drawBodyMap.erase(drawBodyMapIter);
         }
         else drawBodyMapIter++;
     }
-    for (auto &&iter : *bodyList)
+    for (auto &&iter : snapshot->bodies())
     {
         auto it = m_drawBodyMap.find(iter.first);
-        if (it == m_drawBodyMap.end() || it->second->body() != iter.second.get())
+        if (it == m_drawBodyMap.end())
         {
             auto drawBody = std::make_unique<DrawBody>();
-            drawBody->setBody(iter.second.get());
+            drawBody->setBody(static_cast<Body *>(iter.second.object));
             drawBody->initialise(this);
             m_drawBodyMap[iter.first] = std::move(drawBody);
             it = m_drawBodyMap.find(iter.first);
         }
-        it->second->updateEntityPose();
-        it->second->axes()->setVisible(iter.second->visible());
-        it->second->meshEntity1()->setVisible(m_drawBodyMesh1 && iter.second->visible());
-        it->second->meshEntity2()->setVisible(m_drawBodyMesh2 && iter.second->visible());
-        it->second->meshEntity3()->setVisible(m_drawBodyMesh3 && iter.second->visible());
+        // visibility is display state that is only changed by the GUI thread
+        bool visible = it->second->body()->visible();
+        it->second->updateEntityPose(snapshot);
+        it->second->axes()->setVisible(visible);
+        it->second->meshEntity1()->setVisible(m_drawBodyMesh1 && visible);
+        it->second->meshEntity2()->setVisible(m_drawBodyMesh2 && visible);
+        it->second->meshEntity3()->setVisible(m_drawBodyMesh3 && visible);
         it->second->Draw();
     }
+    m_preloadedMeshes.clear(); // every body has now initialised its meshes
 
-    auto jointList = m_simulation->GetJointList();
     auto drawJointMapIter = m_drawJointMap.begin();
     while (drawJointMapIter != m_drawJointMap.end())
     {
-        auto found = jointList->find(drawJointMapIter->first);
-        if (found == jointList->end() || found->second->redraw() == true)
+        auto found = snapshot->joints().find(drawJointMapIter->first);
+        if (found == snapshot->joints().end() || found->second.object != drawJointMapIter->second->joint() || (newSnapshot && found->second.redraw))
         {
             drawJointMapIter = m_drawJointMap.erase(drawJointMapIter);
         }
         else drawJointMapIter++;
     }
-    for (auto &&iter : *jointList)
+    for (auto &&iter : snapshot->joints())
     {
         auto it = m_drawJointMap.find(iter.first);
-        if (it == m_drawJointMap.end() || it->second->joint() != iter.second.get())
+        if (it == m_drawJointMap.end())
         {
             auto drawJoint = std::make_unique<DrawJoint>();
-            drawJoint->setJoint(iter.second.get());
+            drawJoint->setJoint(static_cast<Joint *>(iter.second.object));
             drawJoint->initialise(this);
             m_drawJointMap[iter.first] = std::move(drawJoint);
             it = m_drawJointMap.find(iter.first);
         }
-        it->second->updateEntityPose();
-        it->second->setVisible(iter.second->visible());
+        it->second->updateEntityPose(snapshot);
+        it->second->setVisible(it->second->joint()->visible());
         it->second->Draw();
     }
 
-    auto geomList = m_simulation->GetGeomList();
     auto drawGeomMapIter = m_drawGeomMap.begin();
     while (drawGeomMapIter != m_drawGeomMap.end())
     {
-        auto found = geomList->find(drawGeomMapIter->first);
-        if (found == geomList->end() || found->second->redraw() == true)
+        auto found = snapshot->geoms().find(drawGeomMapIter->first);
+        if (found == snapshot->geoms().end() || found->second.object != drawGeomMapIter->second->geom() || (newSnapshot && found->second.redraw))
         {
             drawGeomMapIter = m_drawGeomMap.erase(drawGeomMapIter);
         }
         else drawGeomMapIter++;
     }
-    for (auto &&iter : *geomList)
+    for (auto &&iter : snapshot->geoms())
     {
         auto it = m_drawGeomMap.find(iter.first);
-        if (it == m_drawGeomMap.end() || it->second->geom() != iter.second.get())
+        if (it == m_drawGeomMap.end())
         {
             auto drawGeom = std::make_unique<DrawGeom>();
-            drawGeom->setGeom(iter.second.get());
+            drawGeom->setGeom(static_cast<Geom *>(iter.second.object));
             drawGeom->initialise(this);
             m_drawGeomMap[iter.first] = std::move(drawGeom);
             it = m_drawGeomMap.find(iter.first);
         }
-        it->second->updateEntityPose();
-        it->second->setVisible(iter.second->visible());
+        it->second->updateEntityPose(snapshot);
+        it->second->setVisible(it->second->geom()->visible());
         it->second->Draw();
     }
 
-    auto markerList = m_simulation->GetMarkerList();
     auto drawMarkerMapIter = m_drawMarkerMap.begin();
     while (drawMarkerMapIter != m_drawMarkerMap.end())
     {
-        auto found = markerList->find(drawMarkerMapIter->first);
-        if (found == markerList->end() || found->second->redraw() == true)
+        auto found = snapshot->markers().find(drawMarkerMapIter->first);
+        if (found == snapshot->markers().end() || found->second.object != drawMarkerMapIter->second->marker() || (newSnapshot && found->second.redraw))
         {
             drawMarkerMapIter = m_drawMarkerMap.erase(drawMarkerMapIter);
         }
         else drawMarkerMapIter++;
     }
-    for (auto &&iter : *markerList)
+    for (auto &&iter : snapshot->markers())
     {
         auto it = m_drawMarkerMap.find(iter.first);
-        if (it == m_drawMarkerMap.end() || it->second->marker() != iter.second.get())
+        if (it == m_drawMarkerMap.end())
         {
             auto drawMarker = std::make_unique<DrawMarker>();
-            drawMarker->setMarker(iter.second.get());
+            drawMarker->setMarker(static_cast<Marker *>(iter.second.object));
             drawMarker->initialise(this);
             m_drawMarkerMap[iter.first] = std::move(drawMarker);
             it = m_drawMarkerMap.find(iter.first);
         }
-        it->second->updateEntityPose();
-        it->second->setVisible(iter.second->visible());
+        it->second->updateEntityPose(snapshot);
+        it->second->setVisible(it->second->marker()->visible());
         it->second->Draw();
     }
 
-    auto muscleList = m_simulation->GetMuscleList();
     auto drawMuscleMapIter = m_drawMuscleMap.begin();
     while (drawMuscleMapIter != m_drawMuscleMap.end())
     {
-        auto found = muscleList->find(drawMuscleMapIter->first);
-        if (found == muscleList->end() || found->second->redraw() == true || found->second->GetStrap()->redraw() == true)
+        auto found = snapshot->muscles().find(drawMuscleMapIter->first);
+        if (found == snapshot->muscles().end() || found->second.object != drawMuscleMapIter->second->muscle() || (newSnapshot && found->second.redraw))
         {
             drawMuscleMapIter = m_drawMuscleMap.erase(drawMuscleMapIter);
         }
         else drawMuscleMapIter++;
     }
-    for (auto &&iter : *muscleList)
+    for (auto &&iter : snapshot->muscles())
     {
+        // existing muscles are refilled from the snapshot and only rebuilt if their topology has changed
         auto it = m_drawMuscleMap.find(iter.first);
-        if (it == m_drawMuscleMap.end() || it->second->muscle() != iter.second.get())
+        if (it != m_drawMuscleMap.end() && it->second->updateEntityPose(snapshot) == false)
+        {
+            m_drawMuscleMap.erase(it);
+            it = m_drawMuscleMap.end();
+        }
+        if (it == m_drawMuscleMap.end())
         {
             auto drawMuscle = std::make_unique<DrawMuscle>();
-            drawMuscle->setMuscle(iter.second.get());
+            drawMuscle->setMuscle(static_cast<Muscle *>(iter.second.object));
             drawMuscle->initialise(this);
             m_drawMuscleMap[iter.first] = std::move(drawMuscle);
             it = m_drawMuscleMap.find(iter.first);
         }
-        it->second->setVisible(iter.second->visible());
+        it->second->setVisible(it->second->muscle()->visible());
         it->second->Draw();
     }
 
-    auto fluidSacList = m_simulation->GetFluidSacList();
     auto drawFluidSacMapIter = m_drawFluidSacMap.begin();
     while (drawFluidSacMapIter != m_drawFluidSacMap.end())
     {
-        auto found = fluidSacList->find(drawFluidSacMapIter->first);
-        if (found == fluidSacList->end() || found->second->redraw() == true)
+        auto found = snapshot->fluidSacs().find(drawFluidSacMapIter->first);
+        if (found == snapshot->fluidSacs().end() || found->second.object != drawFluidSacMapIter->second->fluidSac() || (newSnapshot && found->second.redraw))
         {
             drawFluidSacMapIter = m_drawFluidSacMap.erase(drawFluidSacMapIter);
         }
         else drawFluidSacMapIter++;
     }
-    for (auto &&iter : *fluidSacList)
+    for (auto &&iter : snapshot->fluidSacs())
     {
         auto it = m_drawFluidSacMap.find(iter.first);
-        if (it == m_drawFluidSacMap.end() || it->second->fluidSac() != iter.second.get())
+        if (it != m_drawFluidSacMap.end() && it->second->updateEntityPose(snapshot) == false)
+        {
+            m_drawFluidSacMap.erase(it);
+            it = m_drawFluidSacMap.end();
+        }
+        if (it == m_drawFluidSacMap.end())
         {
             auto drawFluidSac = std::make_unique<DrawFluidSac>();
-            drawFluidSac->setFluidSac(iter.second.get());
+            drawFluidSac->setFluidSac(static_cast<FluidSac *>(iter.second.object));
             drawFluidSac->initialise(this);
             m_drawFluidSacMap[iter.first] = std::move(drawFluidSac);
             it = m_drawFluidSacMap.find(iter.first);
         }
-        it->second->setVisible(iter.second->visible());
+        it->second->setVisible(it->second->fluidSac()->visible());
         it->second->Draw();
     }
 
@@ -1421,6 +1551,11 @@ std::map<std::string, std::unique_ptr<DrawBody>> *SimulationWidget::getDrawBodyM
     return &m_drawBodyMap;
 }
 
+void SimulationWidget::setPreloadedMeshes(std::vector<std::shared_ptr<const MeshStoreObject>> &&preloadedMeshes)
+{
+    m_preloadedMeshes = std::move(preloadedMeshes);
+}
+
 QString SimulationWidget::getLastMenuItem() const
 {
     return m_lastMenuItem;
@@ -1529,9 +1664,20 @@ void SimulationWidget::setSimulation(Simulation *simulation)
     m_drawFluidSacMap.clear();
     m_drawMarkerMap.clear();
     m_drawables.clear();
+    m_localSnapshot.reset();
     m_simulation = simulation;
 }
 
+const SimulationSnapshot *SimulationWidget::snapshot() const
+{
+    return m_snapshot ? m_snapshot : m_localSnapshot.get();
+}
+
+void SimulationWidget::setSnapshot(const SimulationSnapshot *snapshot)
+{
+    m_snapshot = snapshot;
+}
+
 bool SimulationWidget::wireFrame() const
 {
     return m_wireFrame;
@@ -22,12 +22,15 @@
 #include <QMatrix4x4>
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLBuffer>
+#include <QOpenGLFramebufferObject>
 #include <QMouseEvent>
 
 #include <memory>
 #include <map>
+#include <cstdint>
 
 class Simulation;
+class SimulationSnapshot;
 class MainWindow;
 
 struct SimpleLight
@@ -49,10 +52,14 @@ class SimulationWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Co
 
 public:
     SimulationWidget(QWidget *parent = nullptr);
+    ~SimulationWidget() override;
 
     Simulation *simulation() const;
     void setSimulation(Simulation *simulation);
 
+    const SimulationSnapshot *snapshot() const;
+    void setSnapshot(const SimulationSnapshot *snapshot);
+
     bool wireFrame() const;
     void setWireFrame(bool wireFrame);
 
@@ -171,6 +178,9 @@ public:
     std::map<std::string, std::unique_ptr<DrawFluidSac>> *getDrawFluidSacMap();
     std::map<std::string, std::unique_ptr<DrawMarker>> *getDrawMarkerMap();
 
+    // keeps meshes that have been loaded in advance alive until the next draw has used them
+    void setPreloadedMeshes(std::vector<std::shared_ptr<const MeshStoreObject>> &&preloadedMeshes);
+
 public slots:
     void SetCameraVec(float x, float y, float z);
     void SetCameraVec(double x, double y, double z);
@@ -211,9 +221,15 @@ protected:
 private:
     void SetupLights();
     void drawModel();
+    int CaptureMovieFrame();
+    int CollectMovieFrame(size_t index);
+    void ReleaseMovieCapture();
     bool intersectModel(float winX, float winY);
 
     Simulation *m_simulation = nullptr;
+    const SimulationSnapshot *m_snapshot = nullptr;
+    std::unique_ptr<SimulationSnapshot> m_localSnapshot; // filled by drawModel when there is no simulation thread
+    uint64_t m_drawnSnapshotSerial = 0;
     MainWindow *m_mainWindow = nullptr;
 
     bool m_wireFrame = false;
@@ -262,6 +278,15 @@ private:
     int m_aviQuality = 80;
     unsigned int m_fps = 25;
 
+    // movie frames are read back through a pair of pixel buffer objects so the GPU copy overlaps the next frame
+    std::unique_ptr<QOpenGLFramebufferObject> m_captureFBO;
+    QOpenGLBuffer m_capturePBO[2] = {QOpenGLBuffer(QOpenGLBuffer::PixelPackBuffer), QOpenGLBuffer(QOpenGLBuffer::PixelPackBuffer)};
+    bool m_capturePBOPending[2] = {false, false};
+    size_t m_capturePBOIndex = 0;
+    QSize m_captureSize;
+    size_t m_movieFrames = 0;
+    double m_movieFrameTime = 0;
+
     std::map<std::string, std::unique_ptr<DrawBody>> m_drawBodyMap;
     std::map<std::string, std::unique_ptr<DrawJoint>> m_drawJointMap;
     std::map<std::string, std::unique_ptr<DrawGeom>> m_drawGeomMap;
@@ -269,6 +294,7 @@ private:
     std::map<std::string, std::unique_ptr<DrawFluidSac>> m_drawFluidSacMap;
     std::map<std::string, std::unique_ptr<DrawMarker>> m_drawMarkerMap;
     std::vector<Drawable *> m_drawables;
+    std::vector<std::shared_ptr<const MeshStoreObject>> m_preloadedMeshes;
     bool m_drawBodyMesh1 = true;
     bool m_drawBodyMesh2 = false;
     bool m_drawBodyMesh3 = false;
@@ -1152,6 +1152,16 @@ void SimulationWindowQt3D::setSimulation(Simulation *simulation)
     m_simulation = simulation;
 }
 
+const SimulationSnapshot *SimulationWindowQt3D::snapshot() const
+{
+    return m_snapshot;
+}
+
+void SimulationWindowQt3D::setSnapshot(const SimulationSnapshot *snapshot)
+{
+    m_snapshot = snapshot;
+}
+
 bool SimulationWindowQt3D::wireFrame() const
 {
     return m_wireFrame;
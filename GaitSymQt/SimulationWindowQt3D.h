@@ -24,6 +24,7 @@
 #include <map>
 
 class Simulation;
+class SimulationSnapshot;
 class FacetedObject;
 class Trackball;
 class AVIWriter;
@@ -56,6 +57,9 @@ public:
     Simulation *simulation() const;
     void setSimulation(Simulation *simulation);
 
+    const SimulationSnapshot *snapshot() const;
+    void setSnapshot(const SimulationSnapshot *snapshot);
+
     bool wireFrame() const;
     void setWireFrame(bool wireFrame);
 
@@ -204,6 +208,7 @@ private:
     void deleteChildrenRecursively(Qt3DCore::QNodeVector vector);
 
     Simulation *m_simulation = nullptr;
+    const SimulationSnapshot *m_snapshot = nullptr;
     MainWindow *m_mainWindow = nullptr;
 
     bool m_wireFrame = false;
@@ -201,7 +201,9 @@ TrimeshCollidersCache *GetTrimeshCollidersCache(unsigned uiTLSKind)
 {
     (void)uiTLSKind; // unused
 
-    extern TrimeshCollidersCache g_ccTrimeshCollidersCache;
+    // wis
+    extern thread_local TrimeshCollidersCache g_ccTrimeshCollidersCache;
+    // ~wis
 
     return &g_ccTrimeshCollidersCache;
 }
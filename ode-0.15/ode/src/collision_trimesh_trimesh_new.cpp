@@ -45,7 +45,10 @@
 
 #if !dTLS_ENABLED
 // Have collider cache instance unconditionally of OPCODE or GIMPACT selection
-/*extern */TrimeshCollidersCache g_ccTrimeshCollidersCache;
+// wis
+// each thread has its own cache because TLS is not enabled and threads colliding trimeshes at the same time would share the OPCODE colliders
+/*extern */thread_local TrimeshCollidersCache g_ccTrimeshCollidersCache;
+// ~wis
 #endif
 
 
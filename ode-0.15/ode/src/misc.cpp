@@ -30,7 +30,10 @@
 //****************************************************************************
 // random numbers
 
-static volatile duint32 seed = 0;
+// wis
+// each thread has its own seed so that simulations stepping on different threads do not race on it
+static thread_local volatile duint32 seed = 0;
+// ~wis
 
 unsigned long dRand()
 {
@@ -45,6 +45,11 @@
 
 static dThreadingImplementationID g_world_default_threading_impl = NULL;
 static const dThreadingFunctionsInfo *g_world_default_threading_functions = NULL;
+// wis
+// the self-threaded implementation is not thread safe so threads that step worlds concurrently each need their own
+static thread_local dThreadingImplementationID g_thread_default_threading_impl = NULL;
+static thread_local const dThreadingFunctionsInfo *g_thread_default_threading_functions = NULL;
+// ~wis
 
 
 dObject::~dObject()
@@ -147,6 +152,43 @@ void dxWorld::FinalizeDefaultThreading()
     }
 }
 
+// wis
+bool dxWorld::InitializeThreadDefaultThreading()
+{
+    if (g_thread_default_threading_impl != NULL)
+    {
+        return true;
+    }
+
+    bool init_result = false;
+
+    dThreadingImplementationID threading_impl = dThreadingAllocateSelfThreadedImplementation();
+
+    if (threading_impl != NULL)
+    {
+        g_thread_default_threading_functions = dThreadingImplementationGetFunctions(threading_impl);
+        g_thread_default_threading_impl = threading_impl;
+
+        init_result = true;
+    }
+
+    return init_result;
+}
+
+void dxWorld::FinalizeThreadDefaultThreading()
+{
+    dThreadingImplementationID threading_impl = g_thread_default_threading_impl;
+
+    if (threading_impl != NULL)
+    {
+        dThreadingFreeImplementation(threading_impl);
+
+        g_thread_default_threading_functions = NULL;
+        g_thread_default_threading_impl = NULL;
+    }
+}
+// ~wis
+
 void dxWorld::AssignThreadingImpl(const dxThreadingFunctionsInfo *functions_info, dThreadingImplementationID threading_impl)
 {
     if (wmem != NULL)
@@ -178,6 +220,13 @@ dxWorldProcessContext *dxWorld::UnsafeGetWorldProcessingContext() const
 
 const dxThreadingFunctionsInfo *dxWorld::RetrieveThreadingDefaultImpl(dThreadingImplementationID &out_default_impl)
 {
+    // wis
+    if (g_thread_default_threading_impl != NULL)
+    {
+        out_default_impl = g_thread_default_threading_impl;
+        return g_thread_default_threading_functions;
+    }
+    // ~wis
     out_default_impl = g_world_default_threading_impl;
     return g_world_default_threading_functions;
 }
@@ -182,6 +182,10 @@ struct dxWorld : public dBase, public dxThreadingBase, private dxIThreadingDefau
 
     static bool InitializeDefaultThreading();
     static void FinalizeDefaultThreading();
+    // wis
+    static bool InitializeThreadDefaultThreading();
+    static void FinalizeThreadDefaultThreading();
+    // ~wis
 
     void AssignThreadingImpl(const dxThreadingFunctionsInfo *functions_info, dThreadingImplementationID threading_impl);
     unsigned GetThreadingIslandsMaxThreadsCount(unsigned *out_active_thread_count_ptr=NULL) const;
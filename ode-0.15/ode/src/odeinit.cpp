@@ -543,6 +543,13 @@ int dAllocateODEDataForThread(unsigned int uiAllocateFlags)
     dUASSERT(g_uiODEInitCounter != 0, "Call dInitODE2 first");
 
     bool bResult = InternalAllocateODEDataForThread(uiAllocateFlags);
+    // wis
+    // worlds stepped on this thread use a threading implementation that belongs to the thread
+    if (bResult && !dxWorld::InitializeThreadDefaultThreading())
+    {
+        bResult = false;
+    }
+    // ~wis
     return bResult;
 }
 
@@ -552,6 +559,9 @@ void dCleanupODEAllDataForThread()
     dUASSERT(g_uiODEInitCounter != 0, "Call dInitODE2 first or delay dCloseODE until all threads exit");
 
     InternalCleanupODEAllDataForThread();
+    // wis
+    dxWorld::FinalizeThreadDefaultThreading();
+    // ~wis
 }
 
 
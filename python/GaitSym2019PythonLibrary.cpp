@@ -12,24 +12,71 @@
 #include "Muscle.h"
 #include "Body.h"
 #include "Geom.h"
+#include "Contact.h"
 #include "ArgParse.h"
 
 #include "pybind11/stl.h"
 #include "pybind11/pybind11.h"
+#include "pybind11/numpy.h"
 
 #include <iostream>
+#include <algorithm>
 
 using namespace std::string_literals;
 
+// the array views the state buffer directly and the owner keeps the buffers alive for as long as any of the arrays exist
+// the views are read only because writing to them would not change the simulation
+// without an owner pybind11 copies the buffer into a new writeable array instead
+static pybind11::array_t<double> StateArray(const std::vector<double> &buffer, size_t columns, const pybind11::capsule &owner)
+{
+    std::vector<pybind11::ssize_t> shape;
+    if (columns == 1) shape = {pybind11::ssize_t(buffer.size())};
+    else shape = {pybind11::ssize_t(buffer.size() / columns), pybind11::ssize_t(columns)};
+    pybind11::array_t<double> array(shape, buffer.data(), owner);
+    if (owner) array.attr("flags").attr("writeable") = false;
+    return array;
+}
+
+static pybind11::dict GetState(GaitSym2019PythonLibrary &library, bool copy)
+{
+    std::shared_ptr<const GaitSym2019PythonLibrary::State> state = library.UpdateState();
+    pybind11::capsule owner;
+    if (!copy) owner = pybind11::capsule(new std::shared_ptr<const GaitSym2019PythonLibrary::State>(state), [](void *ptr) { delete reinterpret_cast<std::shared_ptr<const GaitSym2019PythonLibrary::State> *>(ptr); });
+    pybind11::dict stateDict;
+    stateDict["time"] = library.GetTime();
+    stateDict["body_position"] = StateArray(state->bodyPosition, 3, owner);
+    stateDict["body_quaternion"] = StateArray(state->bodyQuaternion, 4, owner);
+    stateDict["body_linear_velocity"] = StateArray(state->bodyLinearVelocity, 3, owner);
+    stateDict["body_angular_velocity"] = StateArray(state->bodyAngularVelocity, 3, owner);
+    stateDict["muscle_length"] = StateArray(state->muscleLength, 1, owner);
+    stateDict["muscle_velocity"] = StateArray(state->muscleVelocity, 1, owner);
+    stateDict["muscle_tension"] = StateArray(state->muscleTension, 1, owner);
+    stateDict["contact_force"] = StateArray(state->contactForce, 3, owner);
+    return stateDict;
+}
+
 void initGaitsym2019(pybind11::module &m)
 {
+    // the GIL is released whilst the simulation is running so that other python threads can carry on
     pybind11::class_<GaitSym2019PythonLibrary>(m, "GaitSym2019")
         .def(pybind11::init<>())
         .def ("SetArguments", &GaitSym2019PythonLibrary::SetArguments)
-        .def("Run", &GaitSym2019PythonLibrary::Run)
+        .def("Run", &GaitSym2019PythonLibrary::Run, pybind11::call_guard<pybind11::gil_scoped_release>())
         .def("ReadModel", &GaitSym2019PythonLibrary::ReadModel)
         .def("SetXML", &GaitSym2019PythonLibrary::SetXML)
-        .def("GetFitness", &GaitSym2019PythonLibrary::GetFitness);
+        .def("GetFitness", &GaitSym2019PythonLibrary::GetFitness)
+        .def("Reset", &GaitSym2019PythonLibrary::Reset, pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("Step", &GaitSym2019PythonLibrary::Step, pybind11::arg("numSteps") = 1, pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("GetTime", &GaitSym2019PythonLibrary::GetTime)
+        .def("SetDriverValues", [](GaitSym2019PythonLibrary &library, pybind11::array_t<double, pybind11::array::c_style | pybind11::array::forcecast> values)
+            { return library.SetDriverValues(values.data(), size_t(values.size())); })
+        .def("GetDriverValues", [](GaitSym2019PythonLibrary &library)
+            { std::vector<double> values = library.GetDriverValues(); return pybind11::array_t<double>(pybind11::ssize_t(values.size()), values.data()); })
+        .def("GetState", &GetState, pybind11::arg("copy") = false)
+        .def("GetBodyNames", &GaitSym2019PythonLibrary::GetBodyNames)
+        .def("GetMuscleNames", &GaitSym2019PythonLibrary::GetMuscleNames)
+        .def("GetGeomNames", &GaitSym2019PythonLibrary::GetGeomNames)
+        .def("GetDriverNames", &GaitSym2019PythonLibrary::GetDriverNames);
 }
 
 PYBIND11_MODULE(GaitSym2019, m)
@@ -101,6 +148,25 @@ int GaitSym2019PythonLibrary::SetArguments(const std::vector<std::string> &argum
 int GaitSym2019PythonLibrary::Run()
 {
     if (m_debug) std::cerr << "GaitSym2019PythonLibrary::Run\n";
+    int err = CreateSimulation();
+    if (err) return err;
+
+    double startTime = GSUtil::GetTime();
+
+    while(m_runTimeLimit <= 0 || m_simulationTime <= m_runTimeLimit)
+    {
+        if (m_debug > 2) std::cerr << "m_simulation->GetTime() = " << m_simulation->GetTime() << "\n";
+        m_simulationTime = GSUtil::GetTime() - startTime;
+        if (m_simulation->ShouldQuit()) break;
+        if (m_simulation->TestForCatastrophy()) break;
+        m_simulation->UpdateSimulation();
+    }
+
+    return 0;
+}
+
+int GaitSym2019PythonLibrary::CreateSimulation()
+{
     // create the simulation object
     m_simulation = std::make_unique<Simulation>();
     if (m_outputWarehouseFilename.size()) m_simulation->SetOutputWarehouseFile(m_outputWarehouseFilename);
@@ -117,6 +183,7 @@ int GaitSym2019PythonLibrary::Run()
         m_simulation.reset();
         return __LINE__;
     }
+    m_xmlChanged = false;
     if (m_debug) std::cerr << "Success\n";
 
     // late initialisation options
@@ -133,18 +200,6 @@ int GaitSym2019PythonLibrary::Run()
         if (m_simulation->GetDataTargetList()->find(m_outputList[i]) != m_simulation->GetDataTargetList()->end()) (*m_simulation->GetDataTargetList())[m_outputList[i]]->setDump(true);
         if (m_simulation->GetReporterList()->find(m_outputList[i]) != m_simulation->GetReporterList()->end()) (*m_simulation->GetReporterList())[m_outputList[i]]->setDump(true);
     }
-
-    double startTime = GSUtil::GetTime();
-
-    while(m_runTimeLimit <= 0 || m_simulationTime <= m_runTimeLimit)
-    {
-        if (m_debug > 2) std::cerr << "m_simulation->GetTime() = " << m_simulation->GetTime() << "\n";
-        m_simulationTime = GSUtil::GetTime() - startTime;
-        if (m_simulation->ShouldQuit()) break;
-        if (m_simulation->TestForCatastrophy()) break;
-        m_simulation->UpdateSimulation();
-    }
-
     return 0;
 }
 
@@ -160,6 +215,7 @@ int GaitSym2019PythonLibrary::ReadModel(const std::string &configFilename)
         ifs.seekg(0, std::ios::beg);
         m_xmlData.resize(fileSize);
         ifs.read(m_xmlData.data(), fileSize);
+        m_xmlChanged = true;
         return 0;
     }
     catch (...)
@@ -172,6 +228,7 @@ void GaitSym2019PythonLibrary::SetXML(const std::string &xmlString)
 {
     if (m_debug) std::cerr << "GaitSym2019PythonLibrary::SetXML\n";
     m_xmlData = xmlString;
+    m_xmlChanged = true;
 }
 
 double GaitSym2019PythonLibrary::GetFitness()
@@ -181,3 +238,139 @@ double GaitSym2019PythonLibrary::GetFitness()
     if (m_simulation) score = m_simulation->CalculateInstantaneousFitness();
     return score;
 }
+
+// Simulation::Reset is much quicker than loading the model again and it keeps the output list and late initialisation options
+int GaitSym2019PythonLibrary::Reset()
+{
+    if (m_debug) std::cerr << "GaitSym2019PythonLibrary::Reset\n";
+    m_simulationTime = 0;
+    if (!m_simulation || m_xmlChanged) return CreateSimulation();
+    if (std::string *errorMessage = m_simulation->Reset())
+    {
+        std::cerr << *errorMessage << "\n";
+        return __LINE__;
+    }
+    return 0;
+}
+
+// this uses the same tests as Run but leaves the timing to the caller
+int GaitSym2019PythonLibrary::Step(int numSteps)
+{
+    if (m_debug > 2) std::cerr << "GaitSym2019PythonLibrary::Step(" << numSteps << ")\n";
+    if (!m_simulation) return 0;
+    int step = 0;
+    for (; step < numSteps; step++)
+    {
+        if (m_simulation->ShouldQuit()) break;
+        if (m_simulation->TestForCatastrophy()) break;
+        m_simulation->UpdateSimulation();
+    }
+    return step;
+}
+
+double GaitSym2019PythonLibrary::GetTime()
+{
+    if (!m_simulation) return 0;
+    return m_simulation->GetTime();
+}
+
+// drivers that calculate their own values will overwrite these when they are updated
+// so FixedDriver is the one to use for controlling the model from python
+int GaitSym2019PythonLibrary::SetDriverValues(const double *values, size_t numValues)
+{
+    if (m_debug > 2) std::cerr << "GaitSym2019PythonLibrary::SetDriverValues\n";
+    if (!m_simulation) return __LINE__;
+    if (numValues != m_simulation->GetDriverList()->size()) return __LINE__;
+    for (auto &&it : *m_simulation->GetDriverList()) it.second->setValue(*values++);
+    return 0;
+}
+
+std::vector<double> GaitSym2019PythonLibrary::GetDriverValues()
+{
+    std::vector<double> values;
+    if (!m_simulation) return values;
+    for (auto &&it : *m_simulation->GetDriverList()) values.push_back(it.second->value());
+    return values;
+}
+
+std::vector<std::string> GaitSym2019PythonLibrary::GetBodyNames()
+{
+    std::vector<std::string> names;
+    if (m_simulation) for (auto &&it : *m_simulation->GetBodyList()) names.push_back(it.first);
+    return names;
+}
+
+std::vector<std::string> GaitSym2019PythonLibrary::GetMuscleNames()
+{
+    std::vector<std::string> names;
+    if (m_simulation) for (auto &&it : *m_simulation->GetMuscleList()) names.push_back(it.first);
+    return names;
+}
+
+std::vector<std::string> GaitSym2019PythonLibrary::GetGeomNames()
+{
+    std::vector<std::string> names;
+    if (m_simulation) for (auto &&it : *m_simulation->GetGeomList()) names.push_back(it.first);
+    return names;
+}
+
+std::vector<std::string> GaitSym2019PythonLibrary::GetDriverNames()
+{
+    std::vector<std::string> names;
+    if (m_simulation) for (auto &&it : *m_simulation->GetDriverList()) names.push_back(it.first);
+    return names;
+}
+
+// the rows are in the order of the names returned by GetBodyNames, GetMuscleNames and GetGeomNames
+// the contact forces are the sum of the forces on body 1 of each contact which is the same as DataTargetScalar uses
+std::shared_ptr<const GaitSym2019PythonLibrary::State> GaitSym2019PythonLibrary::UpdateState()
+{
+    if (m_debug > 2) std::cerr << "GaitSym2019PythonLibrary::UpdateState\n";
+    size_t numBodies = m_simulation ? m_simulation->GetBodyList()->size() : 0;
+    size_t numMuscles = m_simulation ? m_simulation->GetMuscleList()->size() : 0;
+    size_t numGeoms = m_simulation ? m_simulation->GetGeomList()->size() : 0;
+    // a new set of buffers is only needed if the sizes have changed and any arrays still using the old ones keep them alive
+    if (!m_state || m_state->bodyPosition.size() != numBodies * 3 || m_state->muscleLength.size() != numMuscles || m_state->contactForce.size() != numGeoms * 3)
+    {
+        m_state = std::make_shared<State>();
+        m_state->bodyPosition.resize(numBodies * 3);
+        m_state->bodyQuaternion.resize(numBodies * 4);
+        m_state->bodyLinearVelocity.resize(numBodies * 3);
+        m_state->bodyAngularVelocity.resize(numBodies * 3);
+        m_state->muscleLength.resize(numMuscles);
+        m_state->muscleVelocity.resize(numMuscles);
+        m_state->muscleTension.resize(numMuscles);
+        m_state->contactForce.resize(numGeoms * 3);
+    }
+    if (!m_simulation) return m_state;
+
+    size_t i = 0;
+    for (auto &&it : *m_simulation->GetBodyList())
+    {
+        std::copy_n(it.second->GetPosition(), 3, &m_state->bodyPosition[i * 3]);
+        std::copy_n(it.second->GetQuaternion(), 4, &m_state->bodyQuaternion[i * 4]);
+        std::copy_n(it.second->GetLinearVelocity(), 3, &m_state->bodyLinearVelocity[i * 3]);
+        std::copy_n(it.second->GetAngularVelocity(), 3, &m_state->bodyAngularVelocity[i * 3]);
+        i++;
+    }
+    i = 0;
+    for (auto &&it : *m_simulation->GetMuscleList())
+    {
+        m_state->muscleLength[i] = it.second->GetLength();
+        m_state->muscleVelocity[i] = it.second->GetVelocity();
+        m_state->muscleTension[i] = it.second->GetTension();
+        i++;
+    }
+    i = 0;
+    for (auto &&it : *m_simulation->GetGeomList())
+    {
+        double *force = &m_state->contactForce[i * 3];
+        std::fill_n(force, 3, 0.0);
+        for (auto &&contact : *it.second->GetContactList())
+        {
+            for (size_t j = 0; j < 3; j++) force[j] += contact->GetJointFeedback()->f1[j];
+        }
+        i++;
+    }
+    return m_state;
+}
@@ -25,7 +25,35 @@ public:
 
     double GetFitness();
 
+    // step level interface for controlling the simulation from python
+    int Reset(); // returns to the state immediately after loading and only reloads the model if the XML has changed
+    int Step(int numSteps); // returns the number of steps taken which is less than numSteps once the simulation has finished
+    double GetTime();
+    int SetDriverValues(const double *values, size_t numValues); // in the order of GetDriverNames
+    std::vector<double> GetDriverValues();
+
+    std::vector<std::string> GetBodyNames();
+    std::vector<std::string> GetMuscleNames();
+    std::vector<std::string> GetGeomNames();
+    std::vector<std::string> GetDriverNames();
+
+    // the state is held in contiguous buffers so that python can view it without copying
+    // the buffers are refilled in place by UpdateState and are only replaced if the number of elements changes
+    struct State
+    {
+        std::vector<double> bodyPosition; // x, y, z for each body
+        std::vector<double> bodyQuaternion; // w, x, y, z for each body
+        std::vector<double> bodyLinearVelocity; // x, y, z for each body
+        std::vector<double> bodyAngularVelocity; // x, y, z for each body
+        std::vector<double> muscleLength;
+        std::vector<double> muscleVelocity;
+        std::vector<double> muscleTension;
+        std::vector<double> contactForce; // x, y, z for each geom summed over its contacts
+    };
+    std::shared_ptr<const State> UpdateState();
+
 private:
+    int CreateSimulation();
 
 
     std::vector<std::string> m_outputList;
@@ -46,6 +74,8 @@ private:
     std::string m_scoreFilename;
 
     std::string m_xmlData;
+    bool m_xmlChanged = true;
+    std::shared_ptr<State> m_state;
 
     XMLConverter m_XMLConverter;
     ArgParse m_argparse;
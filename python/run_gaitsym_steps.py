@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+import sys
+import time
+import numpy
+import GaitSym2019
+
+if len(sys.argv) < 2:
+    print('Must define the input XML file')
+    sys.exit(1)
+
+print('Test stepping the simulation from python')
+t1 = time.perf_counter();
+
+g = GaitSym2019.GaitSym2019()
+err = g.SetArguments(sys.argv[0: -1])
+if err:
+    print('Error setting arguments')
+    sys.exit(1)
+err = g.ReadModel(sys.argv[-1])
+if err:
+    print('Error reading file')
+    sys.exit(1)
+err = g.Reset()
+if err:
+    print('Error creating the simulation')
+    sys.exit(1)
+
+print('bodies = ', g.GetBodyNames())
+print('muscles = ', g.GetMuscleNames())
+print('drivers = ', g.GetDriverNames())
+
+# by default the arrays in the state are read only views of buffers inside the library and are not copied
+# every call to GetState refills the same buffers so the arrays from an earlier call change to the new values
+# (the 'time' entry is a plain float and does not change)
+# GetState(copy=True) returns new writeable arrays instead which is what is needed to keep a state
+initial_state = g.GetState(copy=True)
+state = g.GetState()
+driver_values = g.GetDriverValues()
+steps_per_control = 10
+total_steps = 0
+while True:
+    # a controller would calculate the new driver values from the state here
+    err = g.SetDriverValues(driver_values)
+    if err:
+        print('Error setting driver values')
+        sys.exit(1)
+    steps = g.Step(steps_per_control)
+    total_steps += steps
+    if steps < steps_per_control:
+        break
+    state = g.GetState()
+
+state = g.GetState()
+print('steps = ', total_steps, ' time = ', state['time'])
+print('body_position = ', state['body_position'])
+print('initial body_position = ', initial_state['body_position'])
+print('muscle_tension = ', state['muscle_tension'])
+print('fitness = ', g.GetFitness())
+
+t2 = time.perf_counter();
+print('Time elapsed = ', t2 - t1);
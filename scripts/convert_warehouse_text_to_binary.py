@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+import sys
+import os
+import argparse
+import re
+import struct
+import array
+import tempfile
+
+def convert_warehouse_text_to_binary():
+
+    parser = argparse.ArgumentParser(description="Convert a text warehouse file into the binary warehouse format that GaitSym reads and writes directly")
+    parser.add_argument("-i", "--input_text_file", required=True, help="the input text warehouse file")
+    parser.add_argument("-o", "--output_binary_file", required=True, help="the output binary warehouse file")
+    parser.add_argument("-f", "--force", action="store_true", help="force overwrite of destination file")
+    parser.add_argument("-v", "--verbose", action="store_true", help="write out more information whilst processing")
+    args = parser.parse_args()
+
+    if args.verbose:
+        pretty_print_sys_argv(sys.argv)
+        pretty_print_argparse_args(args)
+
+    # preflight
+    if not os.path.exists(args.input_text_file):
+        print("Error: \"%s\" missing" % (args.input_text_file))
+        sys.exit(1)
+    if os.path.exists(args.output_binary_file) and not args.force:
+        print("Error: \"%s\" exists. Use --force to overwrite" % (args.output_binary_file))
+        sys.exit(1)
+
+    # the output is written to a temporary file in the same folder and only renamed once it is complete
+    # so that a failed conversion never leaves a partial output file behind
+    token_re = re.compile(r'"([^"]*)"|(\S+)')
+    output_folder = os.path.dirname(os.path.abspath(args.output_binary_file))
+    (output_fd, temporary_file) = tempfile.mkstemp(dir=output_folder, prefix=os.path.basename(args.output_binary_file) + ".", suffix=".tmp")
+    try:
+        # mkstemp only gives the owner access so use the permissions a normal open would have used
+        umask = os.umask(0)
+        os.umask(umask)
+        os.chmod(temporary_file, 0o666 & ~umask)
+        with open(args.input_text_file, "r") as input_file, os.fdopen(output_fd, "wb") as output_file:
+            num_rows = convert(input_file, output_file, token_re, args)
+        os.replace(temporary_file, args.output_binary_file)
+    except BaseException:
+        os.remove(temporary_file)
+        raise
+
+    if args.verbose:
+        print("%d rows written to \"%s\"" % (num_rows, args.output_binary_file))
+
+def convert(input_file, output_file, token_re, args):
+    # text format is whitespace separated with optionally quoted names
+    # numDrivers name0 name1 name2 ... numBodies name0 name1 name2...
+    # time act0 act1 act2 ... x0 y0 z0 angle0 xaxis0 yaxis0 zaxis0 xv0 yv0 zv0 xav0 yav0 zav0 ...
+    # binary format is the same as the GaitSym output (native byte order)
+    # uint32 0
+    # uint32 numDrivers, then size_t nameLength, char name[nameLength] for each driver
+    # uint32 numBodies, then size_t nameLength, char name[nameLength] for each body
+    # then rows of doubles
+    num_rows = 0
+    tokens = []
+    header_complete = False
+    for line in input_file:
+        tokens.extend([m.group(1) if m.group(1) is not None else m.group(2) for m in token_re.finditer(line)])
+        if len(tokens) > 0:
+            num_drivers = int(tokens[0])
+            if len(tokens) > num_drivers + 1:
+                num_bodies = int(tokens[num_drivers + 1])
+                if len(tokens) >= num_drivers + num_bodies + 2:
+                    header_complete = True
+                    break
+    if not header_complete:
+        print("Error: \"%s\" does not have a complete header" % (args.input_text_file))
+        sys.exit(1)
+    driver_names = tokens[1: 1 + num_drivers]
+    body_names = tokens[2 + num_drivers: 2 + num_drivers + num_bodies]
+    line_length = 1 + num_drivers + num_bodies * 13
+    if args.verbose:
+        print("%d drivers, %d bodies, %d values per row" % (num_drivers, num_bodies, line_length))
+
+    output_file.write(struct.pack("=I", 0))
+    for names in (driver_names, body_names):
+        output_file.write(struct.pack("=I", len(names)))
+        for name in names:
+            encoded_name = name.encode("utf-8")
+            output_file.write(struct.pack("=Q", len(encoded_name)))
+            output_file.write(encoded_name)
+
+    values = array.array("d", [float(v) for v in tokens[2 + num_drivers + num_bodies:]])
+    for line in input_file:
+        values.extend([float(v) for v in line.split()])
+        if len(values) >= line_length * 4096:
+            complete = (len(values) // line_length) * line_length
+            values[:complete].tofile(output_file)
+            num_rows += complete // line_length
+            del values[:complete]
+    if len(values) % line_length:
+        print("Error: \"%s\" has %d values left over which is not a complete row" % (args.input_text_file, len(values) % line_length))
+        sys.exit(1)
+    values.tofile(output_file)
+    num_rows += len(values) // line_length
+    return num_rows
+
+def pretty_print_sys_argv(sys_argv):
+    quoted_sys_argv = quoted_if_necessary(sys_argv)
+    print((" ".join(quoted_sys_argv)))
+
+def pretty_print_argparse_args(argparse_args):
+    for arg in vars(argparse_args):
+        print(("%s: %s" % (arg, getattr(argparse_args, arg))))
+
+def quoted_if_necessary(input_list):
+    output_list = []
+    for item in input_list:
+        if re.search("[^a-zA-Z0-9_\-.]", item):
+            item = "\"" + item + "\""
+        output_list.append(item)
+    return output_list
+
+# program starts here
+if __name__ == "__main__":
+    convert_warehouse_text_to_binary()
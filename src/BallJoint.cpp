@@ -35,6 +35,11 @@ BallJoint::BallJoint(dWorldID worldID, Mode mode) : Joint()
     m_Mode = mode;
 }
 
+BallJoint::~BallJoint()
+{
+    if (m_MotorJointID) dJointDestroy(m_MotorJointID);
+}
+
 void BallJoint::Attach(Body *body1, Body *body2)
 {
     assert(body1 != nullptr || body2 != nullptr);
@@ -24,6 +24,7 @@ public:
 //    enum Mode { AMotorUser = dAMotorUser, AMotorEuler = dAMotorEuler, NoStops };
 
     BallJoint(dWorldID worldID, Mode mode);
+    virtual ~BallJoint();
 
 
     void SetBallAnchor (double x, double y, double z);
@@ -628,6 +628,25 @@ std::string Body::dumpToString()
     return ss.str();
 }
 
+bool Body::dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText)
+{
+    *columnNames = {"Time"s, "XP"s, "YP"s, "ZP"s, "XV"s, "YV"s, "ZV"s, "QW"s, "QX"s, "QY"s, "QZ"s, "RVX"s, "RVY"s, "RVZ"s, "LKEX"s, "LKEY"s, "LKEZ"s, "RKE"s, "GPE"s};
+    columnText->clear();
+    return true;
+}
+
+void Body::dumpToValues(std::vector<double> *values)
+{
+    const double *p = GetPosition();
+    const double *v = GetLinearVelocity();
+    const double *q = GetQuaternion();
+    const double *rv = GetAngularVelocity();
+    dVector3 ke;
+    GetLinearKineticEnergy(ke);
+    *values = {simulation()->GetTime(), p[0], p[1], p[2], v[0], v[1], v[2], q[0], q[1], q[2], q[3], rv[0], rv[1], rv[2],
+               ke[0], ke[1], ke[2], GetRotationalKineticEnergy(), GetGravitationalPotentialEnergy()};
+}
+
 // a utility function to calculate moments of interia given an arbitrary translation and rotation
 // assumes starting point is the moment of inertia at the centre of mass
 // #define _I(i,j) I[(i)*4+(j)]
@@ -128,6 +128,8 @@ public:
     std::string GetGraphicFile3() const { return m_graphicFile3; }
 
     virtual std::string dumpToString() override;
+    virtual bool dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText) override;
+    virtual void dumpToValues(std::vector<double> *values) override;
     virtual std::string *createFromAttributes() override;
     virtual void saveToAttributes() override;
     virtual void appendToAttributes() override;
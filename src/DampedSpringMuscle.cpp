@@ -99,6 +99,20 @@ std::string DampedSpringMuscle::dumpToString()
     return ss.str();
 }
 
+bool DampedSpringMuscle::dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText)
+{
+    *columnNames = {"Time"s, "act"s, "tension"s, "length"s, "velocity"s, "PMECH"s};
+    columnText->clear();
+    return true;
+}
+
+void DampedSpringMuscle::dumpToValues(std::vector<double> *values)
+{
+    *values = {simulation()->GetTime(), m_Activation,
+               GetStrap()->GetTension(), GetStrap()->GetLength(), GetStrap()->GetVelocity(),
+               GetStrap()->GetVelocity() * GetStrap()->GetTension()};
+}
+
 std::string *DampedSpringMuscle::createFromAttributes()
 {
     if (Muscle::createFromAttributes()) return lastErrorPtr();
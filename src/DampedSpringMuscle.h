@@ -41,6 +41,8 @@ public:
     bool ShouldBreak();
 
     virtual std::string dumpToString();
+    virtual bool dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText);
+    virtual void dumpToValues(std::vector<double> *values);
 
     virtual std::string *createFromAttributes();
     virtual void appendToAttributes();
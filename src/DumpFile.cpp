@@ -0,0 +1,274 @@
+/*
+ *  DumpFile.cpp
+ *  GaitSym2019
+ *
+ */
+
+#include "DumpFile.h"
+#include "DataFile.h"
+
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <sstream>
+#include <memory>
+#include <map>
+
+using namespace std::string_literals;
+
+DumpFile::DumpFile()
+{
+}
+
+DumpFile::~DumpFile()
+{
+    Close();
+}
+
+std::string *DumpFile::Open(const std::string &filename, size_t bufferSize)
+{
+    Close();
+    m_filename = filename;
+    m_output.exceptions(std::ios::failbit|std::ios::badbit);
+    try
+    {
+#if defined _WIN32 && defined _MSC_VER // required because windows and visual studio require wstring for full filename support
+        m_output.open(DataFile::ConvertUTF8ToWide(filename), std::ios::binary | std::ios::trunc);
+#else
+        m_output.open(filename, std::ios::binary | std::ios::trunc);
+#endif
+        m_output.write(identifier(), int(strlen(identifier())));
+    }
+    catch (...)
+    {
+        m_lastError = "Error opening dump file \""s + filename + "\""s;
+        return &m_lastError;
+    }
+    m_ringBuffer.resize(std::max(bufferSize, size_t(1024)));
+    m_ringHead = 0;
+    m_ringUsed = 0;
+    m_finished = false;
+    m_writeError = false;
+    m_writerThread = std::thread(&DumpFile::WriterThread, this);
+    return nullptr;
+}
+
+void DumpFile::Close()
+{
+    if (!m_writerThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished = true;
+    }
+    m_dataAvailable.notify_one();
+    m_writerThread.join();
+    try
+    {
+        m_output.close();
+    }
+    catch (...)
+    {
+        m_writeError = true;
+    }
+    if (m_writeError) std::cerr << "Error writing dump file \"" << m_filename << "\"\n";
+    m_ringBuffer.clear();
+    m_ringBuffer.shrink_to_fit();
+}
+
+bool DumpFile::isOpen() const
+{
+    return m_writerThread.joinable();
+}
+
+void DumpFile::WriteLayout(uint32_t objectIndex, const std::string &name, const std::vector<std::string> &columnNames, const std::vector<std::string> &columnText)
+{
+    RecordHeader header = {layoutRecord, objectIndex, uint32_t(columnNames.size())};
+    Push(&header, sizeof(header));
+    PushString(name);
+    for (size_t i = 0; i < columnNames.size(); i++)
+    {
+        PushString(columnNames[i]);
+        PushString(i < columnText.size() ? columnText[i] : ""s);
+    }
+}
+
+void DumpFile::WriteValues(uint32_t objectIndex, const std::vector<double> &values)
+{
+    RecordHeader header = {valuesRecord, objectIndex, uint32_t(values.size())};
+    Push(&header, sizeof(header));
+    Push(values.data(), values.size() * sizeof(double));
+}
+
+void DumpFile::PushString(const std::string &value)
+{
+    uint32_t length = uint32_t(value.size());
+    Push(&length, sizeof(length));
+    Push(value.data(), value.size());
+}
+
+// copies data into the ring buffer waiting for the writer thread if the buffer is full
+void DumpFile::Push(const void *data, size_t size)
+{
+    if (!isOpen()) return;
+    const char *ptr = reinterpret_cast<const char *>(data);
+    while (size)
+    {
+        size_t tail, n;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_spaceAvailable.wait(lock, [this]{ return m_ringUsed < m_ringBuffer.size(); });
+            tail = (m_ringHead + m_ringUsed) % m_ringBuffer.size();
+            n = std::min(size, std::min(m_ringBuffer.size() - m_ringUsed, m_ringBuffer.size() - tail));
+        }
+        // the writer thread never reads beyond m_ringUsed so this can be done without the lock
+        std::copy_n(ptr, n, m_ringBuffer.data() + tail);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_ringUsed += n;
+        }
+        m_dataAvailable.notify_one();
+        ptr += n;
+        size -= n;
+    }
+}
+
+void DumpFile::WriterThread()
+{
+    while (true)
+    {
+        size_t n;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_dataAvailable.wait(lock, [this]{ return m_ringUsed > 0 || m_finished; });
+            if (m_ringUsed == 0 && m_finished) break;
+            n = std::min(m_ringUsed, m_ringBuffer.size() - m_ringHead);
+        }
+        // the producer never writes into the used part of the buffer so this can be done without the lock
+        if (!m_writeError)
+        {
+            try
+            {
+                m_output.write(m_ringBuffer.data() + m_ringHead, std::streamsize(n));
+            }
+            catch (...)
+            {
+                m_writeError = true; // keep draining the buffer so the simulation does not block
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_ringHead = (m_ringHead + n) % m_ringBuffer.size();
+            m_ringUsed -= n;
+        }
+        m_spaceAvailable.notify_one();
+    }
+}
+
+std::string *DumpFile::ConvertToText(const std::string &filename, const std::string &extension)
+{
+    DataFile dataFile;
+    if (dataFile.ReadFile(filename))
+    {
+        m_lastError = "Error reading dump file \""s + filename + "\""s;
+        return &m_lastError;
+    }
+    const char *ptr = dataFile.GetRawData();
+    const char *end = ptr + dataFile.GetSize();
+    size_t identifierLength = strlen(identifier());
+    if (size_t(end - ptr) < identifierLength || strncmp(ptr, identifier(), identifierLength) != 0)
+    {
+        m_lastError = "Error \""s + filename + "\" is not a dump file"s;
+        return &m_lastError;
+    }
+    ptr += identifierLength;
+
+    struct Layout
+    {
+        std::vector<std::string> columnText;
+        size_t valueCount = 0;
+        std::unique_ptr<std::ofstream> output;
+    };
+    std::map<uint32_t, Layout> layouts;
+    auto readString = [&ptr, end](std::string *value) -> bool
+    {
+        uint32_t length;
+        if (size_t(end - ptr) < sizeof(length)) return false;
+        std::memcpy(&length, ptr, sizeof(length));
+        ptr += sizeof(length);
+        if (size_t(end - ptr) < length) return false;
+        value->assign(ptr, length);
+        ptr += length;
+        return true;
+    };
+
+    std::vector<double> values;
+    std::stringstream ss;
+    ss.precision(17);
+    ss.setf(std::ios::scientific);
+    while (ptr < end)
+    {
+        RecordHeader header;
+        if (size_t(end - ptr) < sizeof(header)) break;
+        std::memcpy(&header, ptr, sizeof(header));
+        ptr += sizeof(header);
+        if (header.recordType == layoutRecord)
+        {
+            Layout &layout = layouts[header.objectIndex];
+            std::string name, columnName;
+            if (!readString(&name)) break;
+            layout.columnText.resize(header.count);
+            layout.valueCount = 0;
+            ss.str(""s);
+            size_t i = 0;
+            for (; i < header.count; i++)
+            {
+                if (!readString(&columnName) || !readString(&layout.columnText[i])) break;
+                if (i) ss << "\t";
+                ss << columnName;
+                if (layout.columnText[i].empty()) layout.valueCount++;
+            }
+            if (i < header.count) break;
+            ss << "\n";
+            layout.output = std::make_unique<std::ofstream>();
+#if defined _WIN32 && defined _MSC_VER // required because windows and visual studio require wstring for full filename support
+            layout.output->open(DataFile::ConvertUTF8ToWide(name + extension));
+#else
+            layout.output->open(name + extension);
+#endif
+            if (!layout.output->good())
+            {
+                m_lastError = "Error opening \""s + name + extension + "\""s;
+                return &m_lastError;
+            }
+            *layout.output << ss.str();
+            continue;
+        }
+        if (header.recordType != valuesRecord || size_t(end - ptr) < header.count * sizeof(double)) break;
+        auto layoutIt = layouts.find(header.objectIndex);
+        if (layoutIt == layouts.end() || layoutIt->second.valueCount != header.count) break;
+        values.resize(header.count);
+        std::memcpy(values.data(), ptr, header.count * sizeof(double));
+        ptr += header.count * sizeof(double);
+        ss.str(""s);
+        size_t valueIndex = 0;
+        for (size_t i = 0; i < layoutIt->second.columnText.size(); i++)
+        {
+            if (i) ss << "\t";
+            if (layoutIt->second.columnText[i].size()) ss << layoutIt->second.columnText[i];
+            else ss << values[valueIndex++];
+        }
+        ss << "\n";
+        *layoutIt->second.output << ss.str();
+    }
+    if (ptr < end)
+    {
+        m_lastError = "Error \""s + filename + "\" is truncated or corrupt"s;
+        return &m_lastError;
+    }
+    return nullptr;
+}
+
+std::string DumpFile::lastError() const
+{
+    return m_lastError;
+}
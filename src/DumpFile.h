@@ -0,0 +1,76 @@
+/*
+ *  DumpFile.h
+ *  GaitSym2019
+ *
+ */
+
+// DumpFile.h - binary alternative to the per object tab separated dump files
+
+// The file starts with an 8 byte identifier followed by a sequence of records
+// each record starts with a RecordHeader
+// a layout record then has the object name and count pairs of column name and column text
+// (strings are a uint32_t length followed by the characters)
+// a values record then has count doubles, one for each column with empty column text
+// columns with column text are constant for the whole run so they are only stored in the layout
+
+#ifndef DumpFile_h
+#define DumpFile_h
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+class DumpFile
+{
+public:
+    DumpFile();
+    virtual ~DumpFile();
+
+    // the file is written by a background thread that drains a ring buffer
+    std::string *Open(const std::string &filename, size_t bufferSize = 16 * 1024 * 1024);
+    void Close();
+    bool isOpen() const;
+
+    void WriteLayout(uint32_t objectIndex, const std::string &name, const std::vector<std::string> &columnNames, const std::vector<std::string> &columnText);
+    void WriteValues(uint32_t objectIndex, const std::vector<double> &values);
+
+    // converts a binary dump file into the standard per object files
+    std::string *ConvertToText(const std::string &filename, const std::string &extension);
+
+    enum RecordType { layoutRecord = 1, valuesRecord = 2 };
+    struct RecordHeader
+    {
+        uint32_t recordType;
+        uint32_t objectIndex;
+        uint32_t count;
+    };
+
+    static const char *identifier() { return "GSDUMP01"; }
+
+    std::string lastError() const;
+
+private:
+    void Push(const void *data, size_t size);
+    void PushString(const std::string &value);
+    void WriterThread();
+
+    std::string m_filename;
+    std::ofstream m_output;
+    std::thread m_writerThread;
+    std::mutex m_mutex;
+    std::condition_variable m_dataAvailable;
+    std::condition_variable m_spaceAvailable;
+    std::vector<char> m_ringBuffer;
+    size_t m_ringHead = 0; // next byte to write to disk
+    size_t m_ringUsed = 0; // number of bytes waiting to be written
+    bool m_finished = false;
+    bool m_writeError = false;
+
+    std::string m_lastError;
+};
+
+#endif // DumpFile_h
@@ -11,12 +11,38 @@
 
 #include <stdio.h>
 #include <vector>
-#include <functional>
 
 //std::string ErrorHandler::m_messageText;
 //int ErrorHandler::m_messageNumber = 0;
 //bool ErrorHandler::m_messageFlag = false;
 
+static thread_local ErrorHandler *g_threadErrorHandler = nullptr;
+
+void ErrorHandler::ODEMessageCallback(int num, const char *msg, va_list ap)
+{
+    if (g_threadErrorHandler)
+    {
+        g_threadErrorHandler->ODEMessageTrap(num, msg, ap);
+        return;
+    }
+    fflush (stderr);
+    fflush (stdout);
+    fprintf (stderr,"\n%d: ", num);
+    vfprintf (stderr, msg, ap);
+    fprintf (stderr, "\n");
+    fflush (stderr);
+}
+
+void ErrorHandler::setThreadErrorHandler(ErrorHandler *errorHandler)
+{
+    g_threadErrorHandler = errorHandler;
+}
+
+ErrorHandler *ErrorHandler::threadErrorHandler()
+{
+    return g_threadErrorHandler;
+}
+
 void ErrorHandler::ODEMessageTrap(int num, const char *msg, va_list ap)
 {
     fflush (stderr);
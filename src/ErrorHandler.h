@@ -12,27 +12,18 @@
 
 #include <cstdarg>
 #include <string>
-#include <functional>
-
-// this is glue to allow a C++ function (even a member function) to be called as a C callback
-template <typename T>
-struct Callback;
-
-template <typename Ret, typename... Params>
-struct Callback<Ret(Params...)> {
-    template <typename... Args>
-    static Ret callback(Args... args) { return func(args...); }
-    static std::function<Ret(Params...)> func;
-};
-
-// Initialize the static member.
-template <typename Ret, typename... Params>
-std::function<Ret(Params...)> Callback<Ret(Params...)>::func;
 
 class ErrorHandler
 {
 public:
     void ODEMessageTrap(int num, const char *msg, va_list ap);
+
+    // ODE only has a single global set of message handlers so this static function is installed
+    // and it passes the message on to the handler that is registered for the current thread
+    static void ODEMessageCallback(int num, const char *msg, va_list ap);
+    static void setThreadErrorHandler(ErrorHandler *errorHandler);
+    static ErrorHandler *threadErrorHandler();
+
     bool IsMessage();
     std::string GetLastMessage();
     int GetLastMessageNumber();
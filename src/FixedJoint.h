@@ -57,7 +57,7 @@ class FixedJoint: public Joint
     double GetLowPassMinStress() { return m_lowPassMinStress; }
     double GetLowPassMaxStress() { return m_lowPassMaxStress; }
 
-    const std::vector<double> &GetStress() { return m_stress; }
+    const std::vector<double> &GetStress();
 
     virtual void Update();
     virtual std::string dumpToString();
@@ -97,6 +97,9 @@ class FixedJoint: public Joint
 private:
 
     void CalculateStress();
+    void CalculateStressField();
+    void CalculateSpringStress(const pgd::Vector3 &force, const pgd::Vector3 &torque, double dArea);
+    void CalculateConvexHull();
     static std::vector<unsigned char> AsciiToBitMap(const std::string &buffer, size_t width, size_t height, char setChar, bool reverseY);
 
     bool m_lateFix = false;
@@ -106,6 +109,11 @@ private:
     std::vector<double> m_stress;
     std::vector<double> m_xDistances;
     std::vector<double> m_yDistances;
+    std::vector<size_t> m_hullIndices; // indices of the active pixels on the convex hull of the cross section
+    bool m_stressFieldValid = true;
+    double m_bendingX = 0; // beam stress = -m_bendingX * x + m_bendingY * y + m_linearStress
+    double m_bendingY = 0;
+    double m_linearStress = 0;
     size_t m_nx = 0;
     size_t m_ny = 0;
     size_t m_nActivePixels = 0;
@@ -138,8 +146,6 @@ private:
     double m_cutoffFrequency = 0;
     size_t m_window = 0;
 
-    std::vector<pgd::Vector3> m_vectorList;
-
     std::vector<unsigned char> m_colourMap;
     std::vector<unsigned char> m_pixMap;
     double m_lastDisplayTime = -1;
@@ -91,6 +91,9 @@ public:
     void setGeomID(const dGeomID &GeomID);
     dGeomID GeomID() const;
 
+    void setContactPairIndex(int contactPairIndex) { m_contactPairIndex = contactPairIndex; }
+    int contactPairIndex() const { return m_contactPairIndex; }
+
 private:
 
     dGeomID m_GeomID = {nullptr};
@@ -112,6 +115,8 @@ private:
 
     std::vector<Geom *> m_ExcludeList;
 
+    int m_contactPairIndex = -1; // set by Simulation::BuildContactPairTable
+
     // used for XMLSave
     double m_SpringConstant = 0;
     double m_DampingConstant = 0;
@@ -223,6 +223,65 @@ std::string *Global::createFromAttributes()
         return lastErrorPtr();
     }
 
+    // collision space type (optional)
+    // Simple is best for very few geoms, Hash is a good default, QuadTree needs to know the region of interest
+    // and SweepAndPrune works well when the geoms are spread out along an axis
+    if (findAttribute("SpaceType", &buf))
+    {
+        for (i = 0; i < spaceTypeCount; i++)
+        {
+            if (strcmp(buf.c_str(), spaceTypeStrings(i)) == 0)
+            {
+                m_SpaceType = SpaceType(i);
+                break;
+            }
+        }
+        if (i >= spaceTypeCount)
+        {
+            setLastError("GLOBAL: Unrecognised SpaceType=\""s + buf + "\""s);
+            return lastErrorPtr();
+        }
+    }
+    if (findAttribute("SpaceHashLevels", &buf))
+    {
+        int levels[2];
+        GSUtil::Int(buf, 2, levels);
+        if (levels[0] > levels[1]) { setLastError("Error: GLOBAL SpaceHashLevels minimum must be <= maximum"s); return lastErrorPtr(); }
+        m_SpaceHashMinLevel = levels[0];
+        m_SpaceHashMaxLevel = levels[1];
+    }
+    if (findAttribute("SpaceQuadTreeCenter", &buf))
+    {
+        GSUtil::Double(buf, 3, m_DoubleList);
+        m_SpaceQuadTreeCenter.Set(m_DoubleList);
+    }
+    if (findAttribute("SpaceQuadTreeExtents", &buf))
+    {
+        GSUtil::Double(buf, 3, m_DoubleList);
+        m_SpaceQuadTreeExtents.Set(m_DoubleList);
+    }
+    if (findAttribute("SpaceQuadTreeDepth", &buf))
+    {
+        m_SpaceQuadTreeDepth = GSUtil::Int(buf);
+        if (m_SpaceQuadTreeDepth < 1) { setLastError("Error: GLOBAL SpaceQuadTreeDepth must be >= 1"s); return lastErrorPtr(); }
+    }
+    if (findAttribute("SpaceSweepAndPruneAxes", &buf))
+    {
+        for (i = 0; i < sweepAndPruneAxesCount; i++)
+        {
+            if (strcmp(buf.c_str(), sweepAndPruneAxesStrings(i)) == 0)
+            {
+                m_SpaceSweepAndPruneAxes = SweepAndPruneAxes(i);
+                break;
+            }
+        }
+        if (i >= sweepAndPruneAxesCount)
+        {
+            setLastError("GLOBAL: Unrecognised SpaceSweepAndPruneAxes=\""s + buf + "\""s);
+            return lastErrorPtr();
+        }
+    }
+
     // allow internal collisions
     if (findAttribute("AllowInternalCollisions", &buf) == nullptr) return lastErrorPtr();
     m_AllowInternalCollisions = GSUtil::Bool(buf);
@@ -319,6 +378,19 @@ void Global::appendToAttributes()
     setAttribute("MechanicalEnergyLimit", *GSUtil::ToString(m_MechanicalEnergyLimit, &buf));
     setAttribute("MetabolicEnergyLimit", *GSUtil::ToString(m_MetabolicEnergyLimit, &buf));
     setAttribute("StepType", stepTypeStrings(m_StepType));
+    // the space attributes are optional so they are only written when they differ from the defaults
+    Global defaults;
+    if (m_SpaceType != defaults.m_SpaceType) setAttribute("SpaceType", spaceTypeStrings(m_SpaceType));
+    if (m_SpaceHashMinLevel != defaults.m_SpaceHashMinLevel || m_SpaceHashMaxLevel != defaults.m_SpaceHashMaxLevel)
+    {
+        int levels[2] = {m_SpaceHashMinLevel, m_SpaceHashMaxLevel};
+        setAttribute("SpaceHashLevels", *GSUtil::ToString(levels, 2, &buf));
+    }
+    std::string defaultBuf;
+    if (*GSUtil::ToString(m_SpaceQuadTreeCenter, &buf) != *GSUtil::ToString(defaults.m_SpaceQuadTreeCenter, &defaultBuf)) setAttribute("SpaceQuadTreeCenter", buf);
+    if (*GSUtil::ToString(m_SpaceQuadTreeExtents, &buf) != *GSUtil::ToString(defaults.m_SpaceQuadTreeExtents, &defaultBuf)) setAttribute("SpaceQuadTreeExtents", buf);
+    if (m_SpaceQuadTreeDepth != defaults.m_SpaceQuadTreeDepth) setAttribute("SpaceQuadTreeDepth", *GSUtil::ToString(m_SpaceQuadTreeDepth, &buf));
+    if (m_SpaceSweepAndPruneAxes != defaults.m_SpaceSweepAndPruneAxes) setAttribute("SpaceSweepAndPruneAxes", sweepAndPruneAxesStrings(m_SpaceSweepAndPruneAxes));
     setAttribute("TimeLimit", *GSUtil::ToString(m_TimeLimit, &buf));
     setAttribute("NumericalErrorsScore", *GSUtil::ToString(m_NumericalErrorsScore, &buf));
     setAttribute("PermittedNumericalErrors", *GSUtil::ToString(m_PermittedNumericalErrors, &buf));
@@ -450,6 +522,72 @@ void Global::setStepType(Global::StepType stepType)
     m_StepType = stepType;
 }
 
+Global::SpaceType Global::spaceType() const
+{
+    return m_SpaceType;
+}
+
+void Global::setSpaceType(Global::SpaceType spaceType)
+{
+    m_SpaceType = spaceType;
+}
+
+int Global::SpaceHashMinLevel() const
+{
+    return m_SpaceHashMinLevel;
+}
+
+int Global::SpaceHashMaxLevel() const
+{
+    return m_SpaceHashMaxLevel;
+}
+
+void Global::setSpaceHashLevels(int SpaceHashMinLevel, int SpaceHashMaxLevel)
+{
+    m_SpaceHashMinLevel = SpaceHashMinLevel;
+    m_SpaceHashMaxLevel = SpaceHashMaxLevel;
+}
+
+pgd::Vector3 Global::SpaceQuadTreeCenter() const
+{
+    return m_SpaceQuadTreeCenter;
+}
+
+void Global::setSpaceQuadTreeCenter(const pgd::Vector3 &SpaceQuadTreeCenter)
+{
+    m_SpaceQuadTreeCenter = SpaceQuadTreeCenter;
+}
+
+pgd::Vector3 Global::SpaceQuadTreeExtents() const
+{
+    return m_SpaceQuadTreeExtents;
+}
+
+void Global::setSpaceQuadTreeExtents(const pgd::Vector3 &SpaceQuadTreeExtents)
+{
+    m_SpaceQuadTreeExtents = SpaceQuadTreeExtents;
+}
+
+int Global::SpaceQuadTreeDepth() const
+{
+    return m_SpaceQuadTreeDepth;
+}
+
+void Global::setSpaceQuadTreeDepth(int SpaceQuadTreeDepth)
+{
+    m_SpaceQuadTreeDepth = SpaceQuadTreeDepth;
+}
+
+Global::SweepAndPruneAxes Global::SpaceSweepAndPruneAxes() const
+{
+    return m_SpaceSweepAndPruneAxes;
+}
+
+void Global::setSpaceSweepAndPruneAxes(Global::SweepAndPruneAxes SpaceSweepAndPruneAxes)
+{
+    m_SpaceSweepAndPruneAxes = SpaceSweepAndPruneAxes;
+}
+
 bool Global::AllowConnectedCollisions() const
 {
     return m_AllowConnectedCollisions;
@@ -29,6 +29,8 @@ public:
 //    Global& operator=(const Global&);
 
     SMART_ENUM(StepType, stepTypeStrings, stepTypeCount, World, Quick);
+    SMART_ENUM(SpaceType, spaceTypeStrings, spaceTypeCount, Simple, Hash, QuadTree, SweepAndPrune);
+    SMART_ENUM(SweepAndPruneAxes, sweepAndPruneAxesStrings, sweepAndPruneAxesCount, XYZ, XZY, YXZ, YZX, ZXY, ZYX);
 #ifdef EXPERIMENTAL
     SMART_ENUM(FitnessType, fitnessTypeStrings, fitnessTypeCount, KinematicMatch, KinematicMatchMiniMax, ClosestWarehouse);
 #else
@@ -45,6 +47,25 @@ public:
     StepType stepType() const;
     void setStepType(StepType stepType);
 
+    SpaceType spaceType() const;
+    void setSpaceType(SpaceType spaceType);
+
+    int SpaceHashMinLevel() const;
+    int SpaceHashMaxLevel() const;
+    void setSpaceHashLevels(int SpaceHashMinLevel, int SpaceHashMaxLevel);
+
+    pgd::Vector3 SpaceQuadTreeCenter() const;
+    void setSpaceQuadTreeCenter(const pgd::Vector3 &SpaceQuadTreeCenter);
+
+    pgd::Vector3 SpaceQuadTreeExtents() const;
+    void setSpaceQuadTreeExtents(const pgd::Vector3 &SpaceQuadTreeExtents);
+
+    int SpaceQuadTreeDepth() const;
+    void setSpaceQuadTreeDepth(int SpaceQuadTreeDepth);
+
+    SweepAndPruneAxes SpaceSweepAndPruneAxes() const;
+    void setSpaceSweepAndPruneAxes(SweepAndPruneAxes SpaceSweepAndPruneAxes);
+
     bool AllowConnectedCollisions() const;
     void setAllowConnectedCollisions(bool AllowConnectedCollisions);
 
@@ -127,6 +148,13 @@ public:
 private:
     FitnessType m_FitnessType = KinematicMatch;
     StepType m_StepType = World;
+    SpaceType m_SpaceType = Hash;
+    int m_SpaceHashMinLevel = -3; // these are the ODE defaults
+    int m_SpaceHashMaxLevel = 10;
+    pgd::Vector3 m_SpaceQuadTreeCenter = {0, 0, 0};
+    pgd::Vector3 m_SpaceQuadTreeExtents = {10, 10, 10};
+    int m_SpaceQuadTreeDepth = 4;
+    SweepAndPruneAxes m_SpaceSweepAndPruneAxes = XYZ;
     bool m_AllowConnectedCollisions = false;
     bool m_AllowInternalCollisions = false;
     int m_PermittedNumericalErrors = 0;
@@ -340,5 +340,27 @@ std::string HingeJoint::dumpToString()
     return ss.str();
 }
 
+bool HingeJoint::dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText)
+{
+    *columnNames = {"Time"s, "XP"s, "YP"s, "ZP"s, "XP2"s, "YP2"s, "ZP2"s, "XA"s, "YA"s, "ZA"s, "Angle"s, "AngleRate"s,
+                    "FX1"s, "FY1"s, "FZ1"s, "TX1"s, "TY1"s, "TZ1"s, "FX2"s, "FY2"s, "FZ2"s, "TX2"s, "TY2"s, "TZ2"s, "StopTorque"s};
+    columnText->clear();
+    return true;
+}
+
+void HingeJoint::dumpToValues(std::vector<double> *values)
+{
+    dVector3 p, p2, a;
+    GetHingeAnchor(p);
+    GetHingeAnchor2(p2);
+    GetHingeAxis(a);
+    *values = {simulation()->GetTime(), p[0], p[1], p[2], p2[0], p2[1], p2[2], a[0], a[1], a[2], GetHingeAngle(), GetHingeAngleRate(),
+               JointFeedback()->f1[0], JointFeedback()->f1[1], JointFeedback()->f1[2],
+               JointFeedback()->t1[0], JointFeedback()->t1[1], JointFeedback()->t1[2],
+               JointFeedback()->f2[0], JointFeedback()->f2[1], JointFeedback()->f2[2],
+               JointFeedback()->t2[0], JointFeedback()->t2[1], JointFeedback()->t2[2],
+               m_axisTorque};
+}
+
 
 
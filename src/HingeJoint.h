@@ -43,6 +43,8 @@ public:
 
     virtual void Update();
     virtual std::string dumpToString();
+    virtual bool dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText);
+    virtual void dumpToValues(std::vector<double> *values);
     virtual std::string *createFromAttributes();
     virtual void appendToAttributes();
 
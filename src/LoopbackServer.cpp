@@ -0,0 +1,673 @@
+/*
+ *  LoopbackServer.cpp
+ *  GaitSym2019
+ *
+ */
+
+#include "LoopbackServer.h"
+#include "GSUtil.h"
+#include "MD5.h"
+#include "TCP.h"
+#include "UDP.h"
+#include "TCPIPMessage.h"
+
+#include "asio.hpp"
+#include "enet/enet.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+
+using namespace std::string_literals;
+
+#if defined(USE_LOOPBACK_SERVER)
+int main(int argc, const char **argv)
+{
+    LoopbackServer loopbackServer(argc, argv);
+    return loopbackServer.Run();
+}
+#endif
+
+// builds a data message followed by either the genome or the XML
+// the clients check the length against sizeof(T) plus the payload so that is what is sent
+template <typename T> static std::string DataMessageReply(const char *text, uint32_t runID, const std::vector<double> &genome, const std::string &xml, const std::vector<uint32_t> &md5)
+{
+    size_t payloadLength = genome.size() ? genome.size() * sizeof(double) : xml.size();
+    std::string reply(sizeof(T) + payloadLength, '\0');
+    T *message = reinterpret_cast<T *>(&reply[0]);
+    std::strncpy(message->text, text, sizeof(message->text));
+    message->runID = runID;
+    message->genomeLength = uint32_t(genome.size());
+    message->xmlLength = uint32_t(xml.size());
+    std::copy_n(md5.data(), 4, message->md5);
+    if (genome.size()) std::copy(genome.begin(), genome.end(), message->payload.genome);
+    else std::copy(xml.begin(), xml.end(), message->payload.xml);
+    return reply;
+}
+
+LoopbackServer::LoopbackServer(int argc, const char **argv)
+{
+    std::string compileDate(__DATE__);
+    std::string compileTime(__TIME__);
+    m_argparse.Initialise(argc, argv, "LoopbackServer stand in evolution server for GaitSym2019 clients build "s + compileDate + " "s + compileTime, 0, 0);
+    m_argparse.AddArgument("-pr"s, "--protocol"s, "Client protocol (asio, enet, tcp or udp) asio also serves ASIOAsync and enet also serves ENETThreaded"s, "asio"s, 1, false, ArgParse::String);
+    m_argparse.AddArgument("-po"s, "--port"s, "Port to listen on"s, "8086"s, 1, false, ArgParse::Int);
+    m_argparse.AddArgument("-co"s, "--config"s, "Base config XML filename"s, ""s, 1, true, ArgParse::String);
+    m_argparse.AddArgument("-ge"s, "--genome"s, "Genome filename (AsynchronousGA format, the value is the first token of each gene line)"s, ""s, 1, true, ArgParse::String);
+    m_argparse.AddArgument("-rt"s, "--runTimeLimit"s, "Run time limit in seconds"s, "60"s, 1, false, ArgParse::Double);
+    m_argparse.AddArgument("-ri"s, "--reportInterval"s, "Interval between progress reports in seconds"s, "10"s, 1, false, ArgParse::Double);
+    m_argparse.AddArgument("-cc"s, "--clientCommand"s, "Command used to start each local client (it should include the client's own run time limit)"s, ""s, 1, false, ArgParse::String);
+    m_argparse.AddArgument("-nc"s, "--numClients"s, "Number of local clients to start"s, "0"s, 1, false, ArgParse::Int);
+    m_argparse.AddArgument("-ec"s, "--expectedClients"s, "Number of clients used for the utilisation figure (defaults to numClients)"s, "0"s, 1, false, ArgParse::Int);
+    m_argparse.AddArgument("-mb"s, "--maxBatchSize"s, "Largest batch sent (0 replies to capability requests that batches are not supported)"s, "1024"s, 1, false, ArgParse::Int);
+    m_argparse.AddArgument("-ic"s, "--ignoreCapabilityRequests"s, "Do not reply to capability requests like servers that predate them"s);
+    m_argparse.AddArgument("-de"s, "--debug"s, "Turn debugging on"s);
+
+    int err = m_argparse.Parse();
+    if (err)
+    {
+        m_argparse.Usage();
+        exit(1);
+    }
+
+    m_argparse.Get("--protocol"s, &m_protocol);
+    m_argparse.Get("--port"s, &m_port);
+    m_argparse.Get("--config"s, &m_configFilename);
+    m_argparse.Get("--genome"s, &m_genomeFilename);
+    m_argparse.Get("--runTimeLimit"s, &m_runTimeLimit);
+    m_argparse.Get("--reportInterval"s, &m_reportInterval);
+    m_argparse.Get("--clientCommand"s, &m_clientCommand);
+    m_argparse.Get("--numClients"s, &m_numClients);
+    m_argparse.Get("--expectedClients"s, &m_expectedClients);
+    m_argparse.Get("--maxBatchSize"s, &m_maxBatchSize);
+    m_argparse.Get("--ignoreCapabilityRequests"s, &m_ignoreCapabilityRequests);
+    if (m_maxBatchSize < 0) m_maxBatchSize = 0;
+    m_argparse.Get("--debug"s, &m_debug);
+    if (m_expectedClients <= 0) m_expectedClients = m_numClients;
+}
+
+int LoopbackServer::Run()
+{
+    if (ReadModel()) return __LINE__;
+    std::cerr << "Serving " << m_genome.size() << " gene genome for \"" << m_configFilename << "\" md5 " << hexDigest(m_md5) << " using " << m_protocol << " on port " << m_port << "\n";
+
+    int status;
+    if (m_protocol == "asio"s) status = RunASIO();
+    else if (m_protocol == "enet"s) status = RunENET();
+    else if (m_protocol == "tcp"s) status = RunTCP();
+    else if (m_protocol == "udp"s) status = RunUDP();
+    else
+    {
+        std::cerr << "Error: unrecognised protocol \"" << m_protocol << "\"\n";
+        return __LINE__;
+    }
+    if (status == 0) Report(true);
+    JoinClients();
+    return status;
+}
+
+int LoopbackServer::ReadModel()
+{
+    std::ifstream configFile(m_configFilename, std::ios::binary);
+    if (!configFile)
+    {
+        std::cerr << "Error: unable to read \"" << m_configFilename << "\"\n";
+        return __LINE__;
+    }
+    std::stringstream configData;
+    configData << configFile.rdbuf();
+    m_xml = configData.str();
+    m_md5 = md5(m_xml.data(), int(m_xml.size()));
+
+    // genome files start with the genome type and the number of genes followed by a line per gene
+    std::ifstream genomeFile(m_genomeFilename);
+    std::string line;
+    int genomeType = 0;
+    size_t numGenes = 0;
+    if (!std::getline(genomeFile, line) || !(std::istringstream(line) >> genomeType) || !std::getline(genomeFile, line) || !(std::istringstream(line) >> numGenes))
+    {
+        std::cerr << "Error: unable to read the genome header from \"" << m_genomeFilename << "\"\n";
+        return __LINE__;
+    }
+    m_genome.clear();
+    for (size_t i = 0; i < numGenes; i++)
+    {
+        double value;
+        if (!std::getline(genomeFile, line) || !(std::istringstream(line) >> value))
+        {
+            std::cerr << "Error: not enough genes in \"" << m_genomeFilename << "\"\n";
+            return __LINE__;
+        }
+        m_genome.push_back(value);
+    }
+    // the ENET client treats an empty genome as a failed request
+    if (m_genome.empty())
+    {
+        std::cerr << "Error: \"" << m_genomeFilename << "\" has no genes\n";
+        return __LINE__;
+    }
+    return 0;
+}
+
+// every connection carries a single zero terminated message and gets at most one reply
+int LoopbackServer::RunASIO()
+{
+    asio::io_context ioContext;
+    asio::ip::tcp::acceptor acceptor(ioContext);
+    try
+    {
+        asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), uint16_t(m_port));
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+        acceptor.bind(endpoint);
+        acceptor.listen();
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Error: unable to listen on port " << m_port << " " << e.what() << "\n";
+        return __LINE__;
+    }
+
+    std::function<void()> acceptConnection = [this, &ioContext, &acceptor, &acceptConnection]()
+    {
+        std::shared_ptr<asio::ip::tcp::socket> socket = std::make_shared<asio::ip::tcp::socket>(ioContext);
+        acceptor.async_accept(*socket, [this, socket, &acceptConnection](const asio::error_code &error)
+        {
+            if (error) return;
+            acceptConnection();
+            std::shared_ptr<std::string> buffer = std::make_shared<std::string>();
+            asio::async_read_until(*socket, asio::dynamic_buffer(*buffer), '\0', [this, socket, buffer](const asio::error_code &error, std::size_t n)
+            {
+                if (error) return;
+                std::shared_ptr<std::string> reply = std::make_shared<std::string>(HandleASIOMessage(decode(buffer->substr(0, n - 1))));
+                if (reply->empty()) return;
+                *reply = encode(*reply);
+                asio::async_write(*socket, asio::buffer(*reply), [socket, reply](const asio::error_code &, std::size_t) {});
+            });
+        });
+    };
+
+    asio::steady_timer timer(ioContext);
+    std::function<void()> checkProgress = [this, &ioContext, &timer, &checkProgress]()
+    {
+        timer.expires_after(std::chrono::milliseconds(100));
+        timer.async_wait([this, &ioContext, &checkProgress](const asio::error_code &error)
+        {
+            if (error) return;
+            if (CheckProgress()) ioContext.stop();
+            else checkProgress();
+        });
+    };
+
+    m_startTime = m_lastReportTime = GSUtil::GetTime();
+    StartClients();
+    acceptConnection();
+    checkProgress();
+    ioContext.run();
+    return 0;
+}
+
+std::string LoopbackServer::HandleASIOMessage(const std::string &message)
+{
+    if (message.size() < 16) return std::string();
+    if (m_debug) std::cerr << "HandleASIOMessage " << message.c_str() << " received\n";
+
+    if (std::strncmp(message.data(), "req_gen_", 16) == 0 && message.size() >= sizeof(ASIORequestMessage))
+    {
+        std::string reply = DataMessageReply<ASIODataMessage>("genome", IssueGenomes(1), m_genome, std::string(), m_md5);
+        reinterpret_cast<ASIODataMessage *>(&reply[0])->evolveIdentifier = m_evolveIdentifier;
+        return reply;
+    }
+
+    if (std::strncmp(message.data(), "req_caps", 16) == 0 && message.size() >= sizeof(ASIOBatchRequestMessage) && !m_ignoreCapabilityRequests)
+    {
+        std::string reply(sizeof(ASIOBatchRequestMessage), '\0');
+        ASIOBatchRequestMessage *capabilitiesMessage = reinterpret_cast<ASIOBatchRequestMessage *>(&reply[0]);
+        std::strncpy(capabilitiesMessage->text, "caps", sizeof(capabilitiesMessage->text));
+        capabilitiesMessage->evolveIdentifier = m_evolveIdentifier;
+        capabilitiesMessage->batchSize = uint32_t(m_maxBatchSize);
+        return reply;
+    }
+
+    if (std::strncmp(message.data(), "req_gen_batch", 16) == 0 && message.size() >= sizeof(ASIOBatchRequestMessage) && m_maxBatchSize > 0)
+    {
+        const ASIOBatchRequestMessage *request = reinterpret_cast<const ASIOBatchRequestMessage *>(message.data());
+        size_t batchSize = std::min(std::max(request->batchSize, uint32_t(1)), uint32_t(m_maxBatchSize));
+        size_t recordSize = sizeof(ASIOBatchGenome) + m_genome.size() * sizeof(double);
+        std::string reply(sizeof(ASIOBatchDataMessage) + batchSize * recordSize, '\0');
+        ASIOBatchDataMessage *batchDataMessage = reinterpret_cast<ASIOBatchDataMessage *>(&reply[0]);
+        std::strncpy(batchDataMessage->text, "genome_batch", sizeof(batchDataMessage->text));
+        batchDataMessage->evolveIdentifier = m_evolveIdentifier;
+        batchDataMessage->batchSize = uint32_t(batchSize);
+        batchDataMessage->genomeLength = uint32_t(m_genome.size());
+        std::copy_n(m_md5.data(), 4, batchDataMessage->md5);
+        uint32_t runID = IssueGenomes(batchSize);
+        char *recordPtr = &reply[sizeof(ASIOBatchDataMessage)];
+        for (size_t i = 0; i < batchSize; i++)
+        {
+            reinterpret_cast<ASIOBatchGenome *>(recordPtr)->runID = runID + uint32_t(i);
+            std::copy(m_genome.begin(), m_genome.end(), reinterpret_cast<double *>(recordPtr + sizeof(ASIOBatchGenome)));
+            recordPtr += recordSize;
+        }
+        return reply;
+    }
+
+    if (std::strncmp(message.data(), "req_xml_", 16) == 0)
+    {
+        m_xmlRequests++;
+        std::string reply = DataMessageReply<ASIODataMessage>("xml", 0, std::vector<double>(), m_xml, m_md5);
+        reinterpret_cast<ASIODataMessage *>(&reply[0])->evolveIdentifier = m_evolveIdentifier;
+        return reply;
+    }
+
+    if (std::strncmp(message.data(), "score___", 16) == 0 && message.size() >= sizeof(ASIORequestMessage))
+    {
+        const ASIORequestMessage *request = reinterpret_cast<const ASIORequestMessage *>(message.data());
+        RecordScore(request->runID, request->score);
+        return std::string();
+    }
+
+    if (std::strncmp(message.data(), "score_batch", 16) == 0 && message.size() >= sizeof(ASIOBatchScoreMessage))
+    {
+        const ASIOBatchScoreMessage *request = reinterpret_cast<const ASIOBatchScoreMessage *>(message.data());
+        if (message.size() < sizeof(ASIOBatchScoreMessage) + request->batchSize * sizeof(ASIOBatchScore)) return std::string();
+        const ASIOBatchScore *scores = reinterpret_cast<const ASIOBatchScore *>(message.data() + sizeof(ASIOBatchScoreMessage));
+        for (size_t i = 0; i < request->batchSize; i++) RecordScore(scores[i].runID, scores[i].score);
+        return std::string();
+    }
+
+    std::cerr << "HandleASIOMessage unrecognised message " << message.substr(0, 16).c_str() << "\n";
+    return std::string();
+}
+
+// the clients reset their peer after every exchange so the server needs plenty of peers
+// because the slots are only recovered when the connections time out
+int LoopbackServer::RunENET()
+{
+    if (enet_initialize())
+    {
+        std::cerr << "Error: unable to initialise ENet\n";
+        return __LINE__;
+    }
+    ENetAddress address = {};
+    address.host = ENET_HOST_ANY;
+    address.port = enet_uint16(m_port);
+    size_t peerCount = ENET_PROTOCOL_MAXIMUM_PEER_ID;
+    size_t channelLimit = 2;
+    ENetHost *server = enet_host_create(&address, peerCount, channelLimit, 0, 0);
+    if (!server)
+    {
+        std::cerr << "Error: unable to listen on port " << m_port << "\n";
+        enet_deinitialize();
+        return __LINE__;
+    }
+
+    m_startTime = m_lastReportTime = GSUtil::GetTime();
+    StartClients();
+    while (CheckProgress() == false)
+    {
+        ENetEvent event;
+        enet_uint32 timeout = 100; // milliseconds
+        if (enet_host_service(server, &event, timeout) <= 0 || event.type != ENET_EVENT_TYPE_RECEIVE) continue;
+        std::string reply = HandleENETMessage(reinterpret_cast<const char *>(event.packet->data), event.packet->dataLength);
+        enet_packet_destroy(event.packet);
+        if (reply.empty()) continue;
+        ENetPacket *packet = enet_packet_create(reply.data(), reply.size(), ENET_PACKET_FLAG_RELIABLE);
+        enet_uint8 channelID = 0;
+        if (enet_peer_send(event.peer, channelID, packet))
+        {
+            if (m_debug) std::cerr << "RunENET reply not sent\n";
+            enet_packet_destroy(packet);
+            continue;
+        }
+        enet_host_flush(server);
+    }
+    enet_host_destroy(server);
+    enet_deinitialize();
+    return 0;
+}
+
+std::string LoopbackServer::HandleENETMessage(const char *message, size_t messageLength)
+{
+    if (messageLength < 16) return std::string();
+    if (m_debug) std::cerr << "HandleENETMessage " << message << " received\n";
+
+    if (std::strncmp(message, "reqjob", 16) == 0 && messageLength >= sizeof(TCPIPMessage))
+    {
+        std::string reply(sizeof(TCPIPMessage) + m_genome.size() * sizeof(double), '\0');
+        TCPIPMessage *genomeMessage = reinterpret_cast<TCPIPMessage *>(&reply[0]);
+        std::strncpy(genomeMessage->text, "genome", sizeof(genomeMessage->text));
+        genomeMessage->genomeLength = uint32_t(m_genome.size());
+        genomeMessage->xmlLength = uint32_t(m_xml.size());
+        genomeMessage->runID = IssueGenomes(1);
+        std::copy_n(m_md5.data(), 4, genomeMessage->md5);
+        std::copy(m_genome.begin(), m_genome.end(), reinterpret_cast<double *>(&reply[sizeof(TCPIPMessage)]));
+        return reply;
+    }
+
+    if (std::strncmp(message, "reqcaps", 16) == 0 && messageLength >= sizeof(TCPIPBatchMessage) && !m_ignoreCapabilityRequests)
+    {
+        std::string reply(sizeof(TCPIPBatchMessage), '\0');
+        TCPIPBatchMessage *capabilitiesMessage = reinterpret_cast<TCPIPBatchMessage *>(&reply[0]);
+        std::strncpy(capabilitiesMessage->text, "caps", sizeof(capabilitiesMessage->text));
+        capabilitiesMessage->batchSize = uint32_t(m_maxBatchSize);
+        std::copy_n(m_md5.data(), 4, capabilitiesMessage->md5);
+        return reply;
+    }
+
+    if (std::strncmp(message, "reqbatch", 16) == 0 && messageLength >= sizeof(TCPIPBatchMessage) && m_maxBatchSize > 0)
+    {
+        const TCPIPBatchMessage *request = reinterpret_cast<const TCPIPBatchMessage *>(message);
+        size_t batchSize = std::min(std::max(request->batchSize, uint32_t(1)), uint32_t(m_maxBatchSize));
+        size_t recordSize = sizeof(TCPIPBatchRecord) + m_genome.size() * sizeof(double);
+        std::string reply(sizeof(TCPIPBatchMessage) + batchSize * recordSize, '\0');
+        TCPIPBatchMessage *batchMessage = reinterpret_cast<TCPIPBatchMessage *>(&reply[0]);
+        std::strncpy(batchMessage->text, "batch", sizeof(batchMessage->text));
+        batchMessage->genomeLength = uint32_t(m_genome.size());
+        batchMessage->batchSize = uint32_t(batchSize);
+        std::copy_n(m_md5.data(), 4, batchMessage->md5);
+        uint32_t runID = IssueGenomes(batchSize);
+        char *recordPtr = &reply[sizeof(TCPIPBatchMessage)];
+        for (size_t i = 0; i < batchSize; i++)
+        {
+            reinterpret_cast<TCPIPBatchRecord *>(recordPtr)->runID = runID + uint32_t(i);
+            std::copy(m_genome.begin(), m_genome.end(), reinterpret_cast<double *>(recordPtr + sizeof(TCPIPBatchRecord)));
+            recordPtr += recordSize;
+        }
+        return reply;
+    }
+
+    if (std::strncmp(message, "reqxml", 16) == 0)
+    {
+        m_xmlRequests++;
+        std::string reply(sizeof(TCPIPMessage) + m_xml.size(), '\0');
+        TCPIPMessage *xmlMessage = reinterpret_cast<TCPIPMessage *>(&reply[0]);
+        std::strncpy(xmlMessage->text, "xml", sizeof(xmlMessage->text));
+        xmlMessage->genomeLength = uint32_t(m_genome.size());
+        xmlMessage->xmlLength = uint32_t(m_xml.size());
+        std::copy_n(m_md5.data(), 4, xmlMessage->md5);
+        std::copy(m_xml.begin(), m_xml.end(), &reply[sizeof(TCPIPMessage)]);
+        return reply;
+    }
+
+    if (std::strncmp(message, "result", 16) == 0 && messageLength >= sizeof(TCPIPMessage))
+    {
+        const TCPIPMessage *result = reinterpret_cast<const TCPIPMessage *>(message);
+        RecordScore(result->runID, result->score);
+        return std::string();
+    }
+
+    if (std::strncmp(message, "results", 16) == 0 && messageLength >= sizeof(TCPIPBatchMessage))
+    {
+        const TCPIPBatchMessage *results = reinterpret_cast<const TCPIPBatchMessage *>(message);
+        if (messageLength < sizeof(TCPIPBatchMessage) + results->batchSize * sizeof(TCPIPBatchRecord)) return std::string();
+        const TCPIPBatchRecord *records = reinterpret_cast<const TCPIPBatchRecord *>(message + sizeof(TCPIPBatchMessage));
+        for (size_t i = 0; i < results->batchSize; i++) RecordScore(records[i].runID, records[i].score);
+        return std::string();
+    }
+
+    std::cerr << "HandleENETMessage unrecognised message " << std::string(message, strnlen(message, 16)) << "\n";
+    return std::string();
+}
+
+// each connection carries a single fixed size request and gets at most one reply
+int LoopbackServer::RunTCP()
+{
+    TCPUpDown tcpUpDown;
+    if (tcpUpDown.status())
+    {
+        std::cerr << "Error: unable to initialise TCP\n";
+        return __LINE__;
+    }
+    TCP listener;
+    if (listener.StartServer(m_port))
+    {
+        std::cerr << "Error: unable to listen on port " << m_port << "\n";
+        return __LINE__;
+    }
+    TCPStopServerGuard stopServerGuard(&listener);
+
+    m_startTime = m_lastReportTime = GSUtil::GetTime();
+    StartClients();
+    while (CheckProgress() == false)
+    {
+        if (listener.CheckReceiver(0, 100000) != 1) continue;
+        TCP connection;
+        connection.StartAcceptor(listener.GetSocket());
+        TCPStopAcceptorGuard stopAcceptorGuard(&connection);
+        RequestMessage request = {};
+        if (connection.ReceiveData(request.text, int(sizeof(RequestMessage)), 10, 0) != int(sizeof(RequestMessage))) continue;
+        std::string reply = HandleTCPMessage(request);
+        if (reply.size() && connection.SendData(&reply[0], int(reply.size())) != int(reply.size()))
+        {
+            if (m_debug) std::cerr << "RunTCP reply not sent\n";
+        }
+    }
+    return 0;
+}
+
+std::string LoopbackServer::HandleTCPMessage(const RequestMessage &message)
+{
+    if (m_debug) std::cerr << "HandleTCPMessage " << std::string(message.text, strnlen(message.text, 16)) << " received\n";
+    if (std::strncmp(message.text, "req_genome", 16) == 0) return DataMessageReply<DataMessage>("genome", IssueGenomes(1), m_genome, std::string(), m_md5);
+    if (std::strncmp(message.text, "req_xml", 16) == 0)
+    {
+        m_xmlRequests++;
+        return DataMessageReply<DataMessage>("xml", 0, std::vector<double>(), m_xml, m_md5);
+    }
+    if (std::strncmp(message.text, "result", 16) == 0)
+    {
+        RecordScore(message.runID, message.score);
+        return std::string();
+    }
+    std::cerr << "HandleTCPMessage unrecognised message " << std::string(message.text, strnlen(message.text, 16)) << "\n";
+    return std::string();
+}
+
+// the replies are sent as text packets unless the client asks for forward error correction
+// FEC is only available when UDP.cpp and FEC.cpp are built with NON_THREAD_SAFE_OK
+int LoopbackServer::RunUDP()
+{
+    UDPUpDown udpUpDown;
+    if (udpUpDown.status())
+    {
+        std::cerr << "Error: unable to initialise UDP\n";
+        return __LINE__;
+    }
+    UDP udp;
+    udp.setDebug(m_debug);
+    if (udp.StartListener(uint16_t(m_port)) == -1)
+    {
+        std::cerr << "Error: unable to listen on port " << m_port << "\n";
+        return __LINE__;
+    }
+    StopListenerGuard stopListenerGuard(&udp);
+
+    m_startTime = m_lastReportTime = GSUtil::GetTime();
+    StartClients();
+    while (CheckProgress() == false)
+    {
+        if (udp.CheckReceiver(100000) != 1) continue;
+        udp::RequestItemUDPPacket packet;
+        struct sockaddr_in sender;
+        if (udp.ReceiveUDPPacket(&packet, sizeof(udp::RequestItemUDPPacket), &sender) != int(sizeof(udp::RequestItemUDPPacket)) || packet.type != udp::request_item) continue;
+        std::string reply = HandleUDPRequest(packet.item, packet.runID, packet.score);
+        if (reply.empty()) continue;
+        int numBytes;
+        if (packet.redundancy == 0) numBytes = udp.SendText(packet.packetID, sender, reply);
+        else numBytes = udp.SendFEC(packet.packetID, sender, reply, packet.redundancy);
+        if (numBytes != int(reply.size())) std::cerr << "RunUDP reply not sent" << (packet.redundancy ? " (is FEC enabled?)\n" : "\n");
+    }
+    return 0;
+}
+
+std::string LoopbackServer::HandleUDPRequest(uint32_t item, uint32_t runID, double score)
+{
+    if (m_debug) std::cerr << "HandleUDPRequest item " << item << " received\n";
+    switch (item)
+    {
+    case udp::genome:
+        return DataMessageReply<DataMessage>("genome", IssueGenomes(1), m_genome, std::string(), m_md5);
+    case udp::xml:
+        m_xmlRequests++;
+        return DataMessageReply<DataMessage>("xml", 0, std::vector<double>(), m_xml, m_md5);
+    case udp::score:
+        RecordScore(runID, score);
+        return std::string();
+    }
+    std::cerr << "HandleUDPRequest unrecognised item " << item << "\n";
+    return std::string();
+}
+
+uint32_t LoopbackServer::IssueGenomes(size_t count)
+{
+    double now = GSUtil::GetTime();
+    if (m_firstIssueTime < 0) m_firstIssueTime = now;
+    uint32_t firstRunID = m_nextRunID;
+    m_jobs.push_back({now, count});
+    for (size_t i = 0; i < count; i++) m_runIDJobs[m_nextRunID++] = m_jobs.size() - 1;
+    m_genomesIssued += count;
+    return firstRunID;
+}
+
+void LoopbackServer::RecordScore(uint32_t runID, double score)
+{
+    auto it = m_runIDJobs.find(runID);
+    if (it == m_runIDJobs.end())
+    {
+        m_unknownScores++;
+        return;
+    }
+    double now = GSUtil::GetTime();
+    Job &job = m_jobs[it->second];
+    m_latencies.push_back(now - job.issueTime);
+    job.outstanding--;
+    if (job.outstanding == 0) m_clientBusyTime += now - job.issueTime;
+    m_runIDJobs.erase(it);
+
+    if (m_scoresReceived == 0) { m_minScore = score; m_maxScore = score; }
+    else { m_minScore = std::min(m_minScore, score); m_maxScore = std::max(m_maxScore, score); }
+    m_scoresReceived++;
+}
+
+bool LoopbackServer::CheckProgress()
+{
+    double now = GSUtil::GetTime();
+    if (m_runTimeLimit > 0 && now - m_startTime >= m_runTimeLimit) return true;
+    if (m_reportInterval > 0 && now - m_lastReportTime >= m_reportInterval) Report(false);
+    return false;
+}
+
+// throughput is measured from the first genome handed out so client start up is not included
+// latency is the time from a genome being handed out to its score arriving
+// utilisation is the time the clients spend holding work divided by clients x elapsed time
+// so clients that run several genomes at once can exceed 1
+void LoopbackServer::Report(bool finalReport)
+{
+    double now = GSUtil::GetTime();
+    double elapsed = m_firstIssueTime < 0 ? 0 : now - m_firstIssueTime;
+    double interval = now - m_lastReportTime;
+
+    std::vector<double> latencies(m_latencies);
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) -> double
+    {
+        if (latencies.empty()) return 0;
+        size_t index = size_t(std::ceil(p * double(latencies.size()) / 100.0));
+        return latencies[std::min(std::max(index, size_t(1)), latencies.size()) - 1];
+    };
+
+    std::cout << (finalReport ? "Final" : "Progress") <<
+                 " Time: " << now - m_startTime <<
+                 " Issued: " << m_genomesIssued <<
+                 " Scored: " << m_scoresReceived <<
+                 " Outstanding: " << m_runIDJobs.size() <<
+                 " GenomesPerSecond: " << (elapsed > 0 ? double(m_scoresReceived) / elapsed : 0) <<
+                 " IntervalGenomesPerSecond: " << (interval > 0 ? double(m_scoresReceived - m_scoresAtLastReport) / interval : 0) <<
+                 " LatencyP50: " << percentile(50) <<
+                 " LatencyP90: " << percentile(90) <<
+                 " LatencyP99: " << percentile(99) <<
+                 " LatencyMax: " << (latencies.empty() ? 0 : latencies.back()) <<
+                 " Utilisation: " << (m_expectedClients > 0 && elapsed > 0 ? m_clientBusyTime / (m_expectedClients * elapsed) : 0) <<
+                 "\n";
+    if (finalReport)
+    {
+        std::cout << "XMLRequests: " << m_xmlRequests <<
+                     " UnknownScores: " << m_unknownScores <<
+                     " MinScore: " << m_minScore <<
+                     " MaxScore: " << m_maxScore <<
+                     "\n";
+    }
+    std::cout.flush();
+    m_lastReportTime = now;
+    m_scoresAtLastReport = m_scoresReceived;
+}
+
+// the clients are run through the shell so the command can redirect their output
+void LoopbackServer::StartClients()
+{
+    if (m_clientCommand.empty()) return;
+    for (int i = 0; i < m_numClients; i++)
+    {
+        m_clientThreads.push_back(std::thread([this]()
+        {
+            int status = std::system(m_clientCommand.c_str());
+            if (status && m_debug) std::cerr << "\"" << m_clientCommand << "\" returned " << status << "\n";
+        }));
+    }
+}
+
+void LoopbackServer::JoinClients()
+{
+    for (auto &&it : m_clientThreads) it.join();
+    m_clientThreads.clear();
+}
+
+std::string LoopbackServer::encode(const std::string &input)
+{
+    std::string output;
+    output.reserve(input.size() * 2 + 1);
+    for (size_t i = 0; i < input.size(); i++)
+    {
+        if (input[i] == '\0')
+        {
+            output.push_back('\xff');
+            output.push_back('\x1');
+            continue;
+        }
+        if (input[i] == '\xff')
+        {
+            output.push_back('\xff');
+            output.push_back('\x2');
+            continue;
+        }
+        output.push_back(input[i]);
+    }
+    output.push_back('\0');
+    return output;
+}
+
+std::string LoopbackServer::decode(const std::string &input)
+{
+    std::string output;
+    output.reserve(input.size());
+    for (size_t i = 0; i < input.size(); i++)
+    {
+        if (input[i] != '\xff')
+        {
+            output.push_back(input[i]);
+            continue;
+        }
+        i++;
+        if (i >= input.size()) break;
+        if (input[i] == '\x1') output.push_back('\0');
+        else if (input[i] == '\x2') output.push_back('\xff');
+    }
+    return output;
+}
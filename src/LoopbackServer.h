@@ -0,0 +1,198 @@
+/*
+ *  LoopbackServer.h
+ *  GaitSym2019
+ *
+ */
+
+// LoopbackServer is a stand in for the AsynchronousGA server so that the networked clients can be
+// run and timed locally. It hands out the same genome for a fixed model over and over again using
+// one of the client protocols, collects the scores, and reports genomes per second, round trip
+// latency percentiles and client utilisation. It can also start the local clients itself.
+
+#ifndef LOOPBACKSERVER_H
+#define LOOPBACKSERVER_H
+
+#include "ArgParse.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+
+class LoopbackServer
+{
+public:
+    LoopbackServer(int argc, const char **argv);
+
+    int Run();
+
+    // the messages used by ObjectiveMainASIO and ObjectiveMainASIOAsync
+    // these are sent with a simple escape encoding and terminated with a zero byte
+    struct ASIODataMessage
+    {
+        char text[16];
+        uint64_t evolveIdentifier;
+        uint32_t senderIP;
+        uint32_t senderPort;
+        uint32_t runID;
+        uint32_t genomeLength;
+        uint32_t xmlLength;
+        uint32_t md5[4];
+        union
+        {
+            double genome[1];
+            char xml[1];
+        } payload;
+    };
+
+    struct ASIORequestMessage
+    {
+        char text[16];
+        uint64_t evolveIdentifier;
+        uint32_t senderIP;
+        uint32_t senderPort;
+        uint32_t runID;
+        double score;
+    };
+
+    struct ASIOBatchRequestMessage
+    {
+        char text[16];
+        uint64_t evolveIdentifier;
+        uint32_t senderIP;
+        uint32_t senderPort;
+        uint32_t batchSize;
+        uint32_t padding;
+    };
+
+    struct ASIOBatchDataMessage
+    {
+        char text[16];
+        uint64_t evolveIdentifier;
+        uint32_t senderIP;
+        uint32_t senderPort;
+        uint32_t batchSize;
+        uint32_t genomeLength;
+        uint32_t md5[4];
+    };
+
+    struct ASIOBatchGenome
+    {
+        uint32_t runID;
+        uint32_t padding;
+    };
+
+    struct ASIOBatchScoreMessage
+    {
+        char text[16];
+        uint64_t evolveIdentifier;
+        uint32_t senderIP;
+        uint32_t senderPort;
+        uint32_t batchSize;
+        uint32_t padding;
+    };
+
+    struct ASIOBatchScore
+    {
+        uint32_t runID;
+        uint32_t padding;
+        double score;
+    };
+
+    // the messages used by ObjectiveMainTCP and ObjectiveMainUDP
+    struct DataMessage
+    {
+        char text[16];
+        uint32_t senderIP;
+        uint32_t senderPort;
+        uint32_t runID;
+        uint32_t genomeLength;
+        uint32_t xmlLength;
+        uint32_t md5[4];
+        union
+        {
+            double genome[1];
+            char xml[1];
+        } payload;
+    };
+
+    struct RequestMessage
+    {
+        char text[16];
+        uint32_t senderIP;
+        uint32_t senderPort;
+        uint32_t runID;
+        double score;
+    };
+
+    static std::string encode(const std::string &input);
+    static std::string decode(const std::string &input);
+
+private:
+    int ReadModel();
+    int RunASIO();
+    int RunENET();
+    int RunTCP();
+    int RunUDP();
+
+    // these return the complete reply or an empty string if no reply is needed
+    std::string HandleASIOMessage(const std::string &message);
+    std::string HandleENETMessage(const char *message, size_t messageLength);
+    std::string HandleTCPMessage(const RequestMessage &message);
+    std::string HandleUDPRequest(uint32_t item, uint32_t runID, double score);
+
+    uint32_t IssueGenomes(size_t count); // returns the first runID of the job
+    void RecordScore(uint32_t runID, double score);
+    bool CheckProgress(); // prints the periodic reports and returns true once the run time limit has been reached
+    void Report(bool finalReport);
+
+    void StartClients();
+    void JoinClients();
+
+    ArgParse m_argparse;
+
+    std::string m_protocol;
+    int m_port = 8086;
+    std::string m_configFilename;
+    std::string m_genomeFilename;
+    double m_runTimeLimit = 60;
+    double m_reportInterval = 10;
+    int m_maxBatchSize = 1024;
+    bool m_ignoreCapabilityRequests = false;
+    bool m_debug = false;
+
+    std::string m_clientCommand;
+    int m_numClients = 0;
+    int m_expectedClients = 0;
+    std::vector<std::thread> m_clientThreads;
+
+    std::string m_xml;
+    std::vector<uint32_t> m_md5;
+    std::vector<double> m_genome;
+    uint64_t m_evolveIdentifier = 1;
+
+    // a job is a single genome or a batch of genomes handed out in one message
+    struct Job
+    {
+        double issueTime;
+        size_t outstanding;
+    };
+    std::map<uint32_t, size_t> m_runIDJobs;
+    std::vector<Job> m_jobs;
+    uint32_t m_nextRunID = 1;
+
+    double m_startTime = 0;
+    double m_firstIssueTime = -1;
+    double m_lastReportTime = 0;
+    uint64_t m_genomesIssued = 0;
+    uint64_t m_scoresReceived = 0;
+    uint64_t m_unknownScores = 0;
+    uint64_t m_scoresAtLastReport = 0;
+    uint64_t m_xmlRequests = 0;
+    double m_clientBusyTime = 0;
+    double m_minScore = 0;
+    double m_maxScore = 0;
+    std::vector<double> m_latencies;
+};
+
+#endif // LOOPBACKSERVER_H
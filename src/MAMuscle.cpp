@@ -214,5 +214,19 @@ std::string MAMuscle::dumpToString()
     return ss.str();
 }
 
+bool MAMuscle::dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText)
+{
+    *columnNames = {"Time"s, "VMax"s, "F0"s, "K"s, "Alpha"s, "FCE"s, "LCE"s, "VCE"s, "PMECH"s, "PMET"s};
+    columnText->clear();
+    return true;
+}
+
+void MAMuscle::dumpToValues(std::vector<double> *values)
+{
+    *values = {simulation()->GetTime(), m_VMax, m_F0, m_K, m_Alpha,
+               GetStrap()->GetTension(), GetStrap()->GetLength(), GetStrap()->GetVelocity(),
+               GetStrap()->GetVelocity() * GetStrap()->GetTension(), GetMetabolicPower()};
+}
+
 
 
@@ -39,6 +39,8 @@ public:
     virtual double GetElasticEnergy();
 
     virtual std::string dumpToString();
+    virtual bool dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText);
+    virtual void dumpToValues(std::vector<double> *values);
 
     virtual std::string *createFromAttributes();
     virtual void appendToAttributes();
@@ -28,10 +28,12 @@
 
 #include <sstream>
 #include <cmath>
+#include <algorithm>
 
 using namespace std::string_literals;
 
 static double CalculateForceError (double lce, void *params);
+static double CalculateForceErrorDerivative(const MAMuscleComplete::CalculateForceErrorParams *p);
 
 // constructor
 
@@ -275,6 +277,10 @@ void MAMuscleComplete::SetActivation()
             {
                 m_Params.err = flast;
             }
+            else if (m_solver == Solver::newton && SolveNewton(currentEstimate, flast))
+            {
+                // SolveNewton has set m_Params
+            }
             else
             {
                 double ax = -DBL_MAX, bx = DBL_MAX, r, tol;
@@ -333,6 +339,50 @@ void MAMuscleComplete::SetActivation()
     GetStrap()->SetTension(m_Params.fse);
 }
 
+// safeguarded Newton iteration using the analytic derivative of CalculateForceError
+// once the error changes sign the root is bracketed and any step that leaves the bracket is replaced by bisection
+// returns false if it does not converge so that the bracketing search can be used instead
+// CalculateForceError must have just been called with currentEstimate
+bool MAMuscleComplete::SolveNewton(double currentEstimate, double currentError)
+{
+    double x = currentEstimate, fx = currentError;
+    double a = 0, b = m_Params.len, fa = 0;
+    bool bracketed = false;
+    for (int i = 0; i < m_newtonMaxIterations; i++)
+    {
+        double dfx = CalculateForceErrorDerivative(&m_Params);
+        double xn = (dfx != 0) ? x - fx / dfx : x;
+        if (!(xn > a && xn < b) || !std::isfinite(xn))
+        {
+            if (bracketed) xn = 0.5 * (a + b);
+            else if (dfx != 0 && std::isfinite(xn)) xn = std::max(a, std::min(b, xn));
+            else return false;
+        }
+        double fn = CalculateForceError(xn, &m_Params);
+        if (std::signbit(fn) != std::signbit(fx))
+        {
+            if (x < xn) { a = x; fa = fx; b = xn; }
+            else { a = xn; fa = fn; b = x; }
+            bracketed = true;
+        }
+        else if (bracketed)
+        {
+            if (std::signbit(fn) == std::signbit(fa)) { a = xn; fa = fn; }
+            else { b = xn; }
+        }
+        if (fn == 0 || std::fabs(xn - x) <= m_Tolerance || (bracketed && b - a <= m_Tolerance))
+        {
+            m_Params.err = fn;
+            m_Params.lastlpe = xn;
+            return true;
+        }
+        x = xn;
+        fx = fn;
+    }
+    CalculateForceError(currentEstimate, &m_Params); // restore the starting state for the fallback
+    return false;
+}
+
 // calculate the metabolic power of the muscle
 
 double MAMuscleComplete::GetMetabolicPower()
@@ -490,10 +540,78 @@ double CalculateForceError (double lce, void *params)
 
     double err = p->fce - p->targetFce;
     // std::cerr << "lce = " << lce << " Error = " << err << "\n";
+    p->evaluations++;
     return err;
 
 }
 
+// this is the derivative of CalculateForceError with respect to lce
+// it uses the values stored in params so CalculateForceError must have just been called with the same lce
+static double CalculateForceErrorDerivative(const MAMuscleComplete::CalculateForceErrorParams *p)
+{
+    double dvce = 1 / p->timeIncrement; // d(vce)/d(lpe) and d(vse)/d(lpe) is minus this
+
+    // parallel element
+    double dfpe = 0;
+    if (p->lpe > p->spe && p->fpe > 0)
+    {
+        switch (p->smpe)
+        {
+        case MAMuscleComplete::linear:
+            dfpe = p->epe + p->dpe * dvce;
+            break;
+
+        case MAMuscleComplete::square:
+            dfpe = 2 * p->epe * (p->lpe - p->spe) + p->dpe * dvce;
+            break;
+        }
+    }
+
+    // serial element (uses the same strain model switch as CalculateForceError)
+    double dfse = 0;
+    if (p->lse > p->sse && p->fse > 0)
+    {
+        switch (p->smpe)
+        {
+        case MAMuscleComplete::linear:
+            dfse = -p->ese - p->dse * dvce;
+            break;
+
+        case MAMuscleComplete::square:
+            dfse = -2 * p->ese * (p->lse - p->sse) - p->dse * dvce;
+            break;
+        }
+    }
+
+    // contractile element
+    double dfce = 0;
+    if (p->f0 > 0 && p->alpha != 0)
+    {
+        double df0 = -p->fmax * 8 * (-1 + p->lpe/p->spe) / (p->spe * p->width);
+        double localvce = p->vce;
+        double dlocalvce = dvce;
+        if (localvce > p->vmax) { localvce = p->vmax; dlocalvce = 0; } // velocity sanity limits
+        if (localvce < -p->vmax) { localvce = -p->vmax; dlocalvce = 0; } // velocity sanity limits
+
+        if (localvce > 0) // eccentric
+        {
+            double denominator = 7.56 * localvce + p->k * p->vmax;
+            double g = (localvce - 1.0 * p->vmax) / denominator;
+            double dg = (p->k * p->vmax + 7.56 * p->vmax) / SQUARE(denominator);
+            dfce = p->alpha * (df0 * (1.8 + 0.8 * p->k * g) + p->f0 * 0.8 * p->k * dg * dlocalvce);
+        }
+        else // concentric
+        {
+            double denominator = -localvce + p->k * p->vmax;
+            double h = (localvce + p->vmax) / denominator;
+            double dh = (p->k * p->vmax + p->vmax) / SQUARE(denominator);
+            dfce = p->alpha * p->k * (df0 * h + p->f0 * dh * dlocalvce);
+        }
+    }
+
+    return dfce - (dfse - dfpe);
+}
+
 std::string *MAMuscleComplete::createFromAttributes()
 {
     if (Muscle::createFromAttributes()) return lastErrorPtr();
@@ -562,6 +680,12 @@ std::string *MAMuscleComplete::createFromAttributes()
     this->SetStartActivation(m_startActivation);
     if (findAttribute("MinimumActivation"s, &buf) == nullptr) return lastErrorPtr();
     this->SetMinimumActivation(GSUtil::Double(buf));
+    if (findAttribute("Solver"s, &buf))
+    {
+        if (buf == "Bracket"s) m_solver = MAMuscleComplete::bracket;
+        else if (buf == "Newton"s) m_solver = MAMuscleComplete::newton;
+        else { setLastError("MUSCLE ID=\""s + name() + "\": Invalid Solver"s); return lastErrorPtr(); }
+    }
 
     return nullptr;
 }
@@ -615,6 +739,15 @@ void MAMuscleComplete::appendToAttributes()
     setAttribute("ActivationRate"s, *GSUtil::ToString(m_ActivationRate, &buf));
     setAttribute("StartActivation"s, *GSUtil::ToString(m_startActivation, &buf));
     setAttribute("MinimumActivation"s, *GSUtil::ToString(m_MinimumActivation, &buf));
+    switch (m_solver)
+    {
+    case MAMuscleComplete::bracket:
+        setAttribute("Solver"s, "Bracket"s);
+        break;
+    case MAMuscleComplete::newton:
+        setAttribute("Solver"s, "Newton"s);
+        break;
+    }
 
 }
 
@@ -790,6 +923,22 @@ void MAMuscleComplete::setParallelStrainModel(const std::string &parallelStrainM
     if (parallelStrainModel == "Square"s) m_parallelStrainModel = MAMuscleComplete::square;
 }
 
+MAMuscleComplete::Solver MAMuscleComplete::solver() const
+{
+    return m_solver;
+}
+
+void MAMuscleComplete::setSolver(const Solver &solver)
+{
+    m_solver = solver;
+}
+
+void MAMuscleComplete::setSolver(const std::string &solver)
+{
+    if (solver == "Bracket"s) m_solver = MAMuscleComplete::bracket;
+    if (solver == "Newton"s) m_solver = MAMuscleComplete::newton;
+}
+
 std::string MAMuscleComplete::dumpToString()
 {
     std::stringstream ss;
@@ -811,5 +960,24 @@ std::string MAMuscleComplete::dumpToString()
     return ss.str();
 }
 
+bool MAMuscleComplete::dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText)
+{
+    *columnNames = {"Time"s, "m_Stim"s, "alpha"s, "len"s, "v"s, "lastlpe"s, "fce"s, "lpe"s, "fpe"s, "lse"s, "fse"s, "vce"s, "vse"s, "targetFce"s, "f0"s, "err"s,
+                    "ESE"s, "EPE"s, "PSE"s, "PPE"s, "PCE"s, "tension"s, "length"s, "velocity"s, "PMECH"s, "PMET"s};
+    columnText->clear();
+    return true;
+}
+
+void MAMuscleComplete::dumpToValues(std::vector<double> *values)
+{
+    *values = {simulation()->GetTime(),
+               m_Stim, m_Params.alpha, m_Params.len, m_Params.v, m_Params.lastlpe,
+               m_Params.fce, m_Params.lpe, m_Params.fpe, m_Params.lse, m_Params.fse,
+               m_Params.vce, m_Params.vse, m_Params.targetFce, m_Params.f0, m_Params.err,
+               GetESE(), GetEPE(), GetPSE(), GetPPE(), GetPCE(),
+               GetTension(), GetLength(), GetVelocity(),
+               GetPower(), GetMetabolicPower()};
+}
+
 
 
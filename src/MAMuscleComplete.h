@@ -22,6 +22,8 @@
 #include "Muscle.h"
 #include "SmartEnum.h"
 
+#include <stdint.h>
+
 class Strap;
 class MAMuscle;
 class DampedSpringMuscle;
@@ -33,6 +35,7 @@ class MAMuscleComplete : public Muscle
 public:
     SMART_ENUM(StrainModel, StrainModelStrings, StrainModelCount, linear, square);
 //    enum StrainModel { linear, square };
+    SMART_ENUM(Solver, SolverStrings, SolverCount, bracket, newton); // newton uses the analytic derivative and falls back to bracket on failure
 
     // this struct contains all the paramers required for the CalculateForceError function
     struct CalculateForceErrorParams
@@ -69,6 +72,9 @@ public:
         double targetFce = -2; // fce calculated from elastic elements (N)
         double f0 = -2; // length corrected fmax (N)
         double err = -2; // error term in lpe (m)
+
+        // diagnostic output
+        uint64_t evaluations = 0; // number of times CalculateForceError has been called
     };
 
     MAMuscleComplete();
@@ -108,6 +114,8 @@ public:
     double GetSPE() { return m_Params.spe; }
 
     virtual std::string dumpToString();
+    virtual bool dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText);
+    virtual void dumpToValues(std::vector<double> *values);
     virtual void LateInitialisation();
 
     virtual std::string *createFromAttributes();
@@ -166,7 +174,15 @@ public:
     void setParallelStrainModel(const StrainModel &parallelStrainModel);
     void setParallelStrainModel(const std::string &parallelStrainModel);
 
+    Solver solver() const;
+    void setSolver(const Solver &solver);
+    void setSolver(const std::string &solver);
+
+    uint64_t forceErrorEvaluations() const { return m_Params.evaluations; }
+
 private:
+    bool SolveNewton(double currentEstimate, double currentError);
+
 
     double m_Stim = 0;
     bool m_ActivationKinetics = false;
@@ -182,6 +198,8 @@ private:
 
     CalculateForceErrorParams m_Params;
     double m_Tolerance = 1e-8; // solution tolerance (m) - small because the serial tendons are quite stiff
+    Solver m_solver = Solver::bracket;
+    int m_newtonMaxIterations = 20;
 
     // these values are only used for loading and saving
     StrainModel m_serialStrainModel = StrainModel::linear;
@@ -0,0 +1,75 @@
+/*
+ *  MessageBuffer.h
+ *  GaitSym2019
+ *
+ */
+
+#ifndef MESSAGEBUFFER_H
+#define MESSAGEBUFFER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+// MessageBuffer holds a received message in storage that is aligned for doubles so the
+// message structures and the genomes that follow them can be used where they are.
+// The storage only ever grows so the same buffer can be reused for every message.
+
+class MessageBuffer
+{
+public:
+    // decodes a message escaped with 0xff 0x01 for 0x00 and 0xff 0x02 for 0xff
+    // the terminating zero should not be included
+    void Decode(const char *encoded, size_t encodedLength)
+    {
+        Reserve(encodedLength);
+        char *output = reinterpret_cast<char *>(m_storage.data());
+        size_t n = 0;
+        for (size_t i = 0; i < encodedLength; i++)
+        {
+            if (encoded[i] != '\xff')
+            {
+                output[n++] = encoded[i];
+                continue;
+            }
+            i++;
+            if (i >= encodedLength) break;
+            if (encoded[i] == '\x1') output[n++] = '\0';
+            else if (encoded[i] == '\x2') output[n++] = '\xff';
+        }
+        m_size = n;
+    }
+
+    void clear() { m_size = 0; }
+    void swap(MessageBuffer &other) { m_storage.swap(other.m_storage); std::swap(m_size, other.m_size); }
+
+    const char *data() const { return reinterpret_cast<const char *>(m_storage.data()); }
+    size_t size() const { return m_size; }
+
+    // returns the T at offset or nullptr if the message is too short
+    template<typename T> const T *View(size_t offset = 0) const
+    {
+        if (offset % alignof(T) || offset + sizeof(T) > m_size) return nullptr;
+        return reinterpret_cast<const T *>(data() + offset);
+    }
+
+    // returns count Ts starting at offset or nullptr if the message is too short
+    template<typename T> const T *ViewArray(size_t offset, size_t count) const
+    {
+        if (offset % alignof(T) || offset + count * sizeof(T) > m_size) return nullptr;
+        return reinterpret_cast<const T *>(data() + offset);
+    }
+
+private:
+    void Reserve(size_t size)
+    {
+        size_t words = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        if (words > m_storage.size()) m_storage.resize(words);
+    }
+
+    std::vector<uint64_t> m_storage;
+    size_t m_size = 0;
+};
+
+#endif // MESSAGEBUFFER_H
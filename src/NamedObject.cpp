@@ -44,6 +44,17 @@ std::string NamedObject::dumpToString()
     return s;
 }
 
+// the binary dump needs a fixed set of columns so it is only used by objects that override these functions
+bool NamedObject::dumpLayout(std::vector<std::string> * /*columnNames */, std::vector<std::string> * /* columnText */)
+{
+    return false;
+}
+
+void NamedObject::dumpToValues(std::vector<double> *values)
+{
+    values->clear();
+}
+
 // returns the value of a named attribute
 // using caller provided string
 // returns "" if attribute is not found
@@ -141,6 +152,11 @@ std::string *NamedObject::createFromAttributes()
     if (findAttribute("Colour1"s, &buf)) m_colour1.SetColour(buf);
     if (findAttribute("Colour2"s, &buf)) m_colour2.SetColour(buf);
     if (findAttribute("Colour3"s, &buf)) m_colour3.SetColour(buf);
+    if (findAttribute("DumpInterval"s, &buf)) m_dumpInterval = GSUtil::Int(buf);
+    if (findAttribute("DumpStartTime"s, &buf)) m_dumpStartTime = GSUtil::Double(buf);
+    if (findAttribute("DumpEndTime"s, &buf)) m_dumpEndTime = GSUtil::Double(buf);
+    if (findAttribute("DumpTrigger"s, &buf)) m_dumpTrigger = buf;
+    if (m_dumpInterval < 0) { setLastError("Error: DumpInterval must be >= 0 in ID=\""s + this->name() + "\""s); return lastErrorPtr(); }
     return nullptr;
 }
 
@@ -162,6 +178,11 @@ void NamedObject::appendToAttributes()
     setAttribute("Colour1"s, m_colour1.GetIntColourRGBA());
     setAttribute("Colour2"s, m_colour2.GetIntColourRGBA());
     setAttribute("Colour3"s, m_colour3.GetIntColourRGBA());
+    // the dump controls are rarely used so only write them when they have been set
+    if (m_dumpInterval != 0) setAttribute("DumpInterval"s, *GSUtil::ToString(m_dumpInterval, &buf));
+    if (m_dumpStartTime != -DBL_MAX) setAttribute("DumpStartTime"s, *GSUtil::ToString(m_dumpStartTime, &buf));
+    if (m_dumpEndTime != DBL_MAX) setAttribute("DumpEndTime"s, *GSUtil::ToString(m_dumpEndTime, &buf));
+    if (m_dumpTrigger.size()) setAttribute("DumpTrigger"s, m_dumpTrigger);
 }
 
 void NamedObject::createAttributeMap(const std::map<std::string, std::string> &attributeMap)
@@ -269,6 +290,46 @@ void NamedObject::setFirstDump(bool firstDump)
     m_firstDump = firstDump;
 }
 
+int NamedObject::dumpInterval() const
+{
+    return m_dumpInterval;
+}
+
+void NamedObject::setDumpInterval(int dumpInterval)
+{
+    m_dumpInterval = dumpInterval;
+}
+
+double NamedObject::dumpStartTime() const
+{
+    return m_dumpStartTime;
+}
+
+void NamedObject::setDumpStartTime(double dumpStartTime)
+{
+    m_dumpStartTime = dumpStartTime;
+}
+
+double NamedObject::dumpEndTime() const
+{
+    return m_dumpEndTime;
+}
+
+void NamedObject::setDumpEndTime(double dumpEndTime)
+{
+    m_dumpEndTime = dumpEndTime;
+}
+
+std::string NamedObject::dumpTrigger() const
+{
+    return m_dumpTrigger;
+}
+
+void NamedObject::setDumpTrigger(const std::string &dumpTrigger)
+{
+    m_dumpTrigger = dumpTrigger;
+}
+
 bool NamedObject::redraw() const
 {
     return m_redraw;
@@ -20,6 +20,7 @@
 #include <vector>
 #include <set>
 #include <initializer_list>
+#include <cfloat>
 
 class Simulation;
 
@@ -53,6 +54,8 @@ public:
     std::string className() const; // return value optimisation RVO makes via reference unnecessary
 
     virtual std::string dumpToString();
+    virtual bool dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText); // return true if dumpToValues is supported
+    virtual void dumpToValues(std::vector<double> *values);
     void createAttributeMap(const std::map<std::string, std::string> &attributeMap);
     virtual std::string *createFromAttributes();
     virtual void saveToAttributes();
@@ -102,6 +105,18 @@ public:
     bool dump() const;
     void setDump(bool dumpToString);
     bool firstDump() const;
+    void setFirstDump(bool firstDump);
+
+    // dump decimation controls. The GLOBAL values apply to every object, an object interval or trigger replaces the GLOBAL one
+    // and an object time window is combined with the GLOBAL window
+    int dumpInterval() const; // 0 means use the GLOBAL value
+    void setDumpInterval(int dumpInterval);
+    double dumpStartTime() const;
+    void setDumpStartTime(double dumpStartTime);
+    double dumpEndTime() const;
+    void setDumpEndTime(double dumpEndTime);
+    std::string dumpTrigger() const; // empty means use the GLOBAL value
+    void setDumpTrigger(const std::string &dumpTrigger);
 
     bool redraw() const;
     void setRedraw(bool redraw);
@@ -116,7 +131,6 @@ protected:
     std::string *findAttribute(const std::string &name, std::string *attributeValue);
     void setAttribute(const std::string &name, const std::string &attributeValue);
     void clearAttributeMap();
-    void setFirstDump(bool firstDump);
 
 private:
 
@@ -138,6 +152,10 @@ private:
 
     bool m_dump = false;
     bool m_firstDump = true;
+    int m_dumpInterval = 0;
+    double m_dumpStartTime = -DBL_MAX;
+    double m_dumpEndTime = DBL_MAX;
+    std::string m_dumpTrigger;
 
     std::map<std::string, std::string> m_attributeMap;
     std::string m_tag;
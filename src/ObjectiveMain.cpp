@@ -18,7 +18,9 @@
 #include "Muscle.h"
 #include "Body.h"
 #include "Geom.h"
+#include "Global.h"
 #include "ArgParse.h"
+#include "DumpFile.h"
 
 #define MAX_ARGS 4096
 
@@ -38,7 +40,7 @@ ObjectiveMain::ObjectiveMain(int argc, const char **argv)
     std::string compileTime(__TIME__);
     m_argparse.Initialise(argc, argv, "ObjectiveMain command line interface to GaitSym2019 build "s + compileDate + " "s + compileTime, 0, 0);
     m_argparse.AddArgument("-sc"s, "--score"s, "Score filename"s, ""s, 1, false, ArgParse::String);
-    m_argparse.AddArgument("-co"s, "--config"s, "Config filename"s, ""s, 1, true, ArgParse::String);
+    m_argparse.AddArgument("-co"s, "--config"s, "Config filename"s, ""s, 1, false, ArgParse::String);
     m_argparse.AddArgument("-ow"s, "--outputWarehouse"s, "Output warehouse filename"s, ""s, 1, false, ArgParse::String);
     m_argparse.AddArgument("-iw"s, "--inputWarehouse"s, "Input warehouse filename"s, ""s, 1, false, ArgParse::String);
     m_argparse.AddArgument("-ms"s, "--modelState"s, "Model state filename"s, ""s, 1, false, ArgParse::String);
@@ -48,11 +50,17 @@ ObjectiveMain::ObjectiveMain(int argc, const char **argv)
     m_argparse.AddArgument("-mt"s, "--outputModelStateAtTime"s, "Output model state at this cycle"s, ""s, 1, false, ArgParse::Double);
     m_argparse.AddArgument("-mw"s, "--outputModelStateAtWarehouseDistance"s, "Output model state at this warehouse distance"s, ""s, 1, false, ArgParse::Double);
     m_argparse.AddArgument("-wd"s, "--warehouseFailDistanceAbort"s, "Abort the simulation when the warehouse distance fails"s);
+    m_argparse.AddArgument("-db"s, "--dumpBinary"s, "Binary dump filename"s, ""s, 1, false, ArgParse::String);
+    m_argparse.AddArgument("-di"s, "--dumpInterval"s, "Only dump objects every N steps"s, ""s, 1, false, ArgParse::Int);
+    m_argparse.AddArgument("-dw"s, "--dumpWindow"s, "Only dump objects between these start and end times"s, ""s, 2, false, ArgParse::Double);
+    m_argparse.AddArgument("-dg"s, "--dumpTrigger"s, "Only dump objects when triggered (ContactAbort, DataTargetAbort, Geom ID or DataTarget ID)"s, ""s, 1, false, ArgParse::String);
+    m_argparse.AddArgument("-cd"s, "--convertDump"s, "Convert binary dump file to text files and exit"s, ""s, 1, false, ArgParse::String);
     m_argparse.AddArgument("-de"s, "--debug"s, "Turn debugging on"s);
 
     m_argparse.AddArgument("-ol"s, "--outputList"s, "List of objects to produce output"s, ""s, 1, MAX_ARGS, false, ArgParse::String);
 
     int err = m_argparse.Parse();
+    if (err == 0 && m_argparse.Get("--config"s, &m_configFilename) == false && m_argparse.Get("--convertDump"s, &m_convertDumpFilename) == false) err = 1; // one of these is required
     if (err)
     {
         m_argparse.Usage();
@@ -71,11 +79,28 @@ ObjectiveMain::ObjectiveMain(int argc, const char **argv)
     m_argparse.Get("--modelState"s, &m_outputModelStateFilename);
     m_argparse.Get("--inputWarehouse"s, &m_inputWarehouseFilename);
     m_argparse.Get("--outputWarehouse"s, &m_outputWarehouseFilename);
+    m_argparse.Get("--dumpBinary"s, &m_dumpBinaryFilename);
+    m_argparse.Get("--dumpInterval"s, &m_dumpInterval);
+    m_argparse.Get("--dumpWindow"s, &m_dumpWindow);
+    m_argparse.Get("--dumpTrigger"s, &m_dumpTrigger);
+    m_argparse.Get("--convertDump"s, &m_convertDumpFilename);
     m_argparse.Get("--debug"s, &m_debug);
 }
 
 int ObjectiveMain::Run()
 {
+    if (m_convertDumpFilename.size())
+    {
+        DumpFile dumpFile;
+        std::string *errorMessage = dumpFile.ConvertToText(m_convertDumpFilename, ".tab"s);
+        if (errorMessage)
+        {
+            std::cerr << *errorMessage << "\n";
+            return __LINE__;
+        }
+        return 0;
+    }
+
     if (ReadModel()) return __LINE__;
 
     for (size_t i = 0; i < m_outputList.size(); i++)
@@ -120,14 +145,17 @@ int ObjectiveMain::ReadModel()
     m_simulation = std::make_unique<Simulation>();
     if (m_outputWarehouseFilename.size()) m_simulation->SetOutputWarehouseFile(m_outputWarehouseFilename);
     if (m_outputModelStateFilename.size()) m_simulation->SetOutputModelStateFile(m_outputModelStateFilename);
+    if (m_dumpBinaryFilename.size()) m_simulation->SetOutputDumpFile(m_dumpBinaryFilename);
     if (m_outputModelStateAtTime >= 0) m_simulation->SetOutputModelStateAtTime(m_outputModelStateAtTime);
     if (m_outputModelStateAtCycle >= 0) m_simulation->SetOutputModelStateAtCycle(m_outputModelStateAtCycle);
     if (m_inputWarehouseFilename.size()) m_simulation->AddWarehouse(m_inputWarehouseFilename);
     if (m_outputModelStateAtWarehouseDistance >= 0) m_simulation->SetOutputModelStateAtWarehouseDistance(m_outputModelStateAtWarehouseDistance);
 
     if (m_debug) std::cerr << "Loading model\n";
-    if (m_simulation->LoadModel(myFile.GetRawData(), myFile.GetSize()))
+    std::string *errorMessage = m_simulation->LoadModel(myFile.GetRawData(), myFile.GetSize());
+    if (errorMessage)
     {
+        std::cerr << *errorMessage << "\n";
         m_simulation.reset();
         return 1;
     }
@@ -136,6 +164,18 @@ int ObjectiveMain::ReadModel()
     // late initialisation options
     if (m_simulationTimeLimit >= 0) m_simulation->SetTimeLimit(m_simulationTimeLimit);
     if (m_warehouseFailDistanceAbort != 0) m_simulation->SetWarehouseFailDistanceAbort(m_warehouseFailDistanceAbort);
+    if (m_dumpInterval > 0) m_simulation->GetGlobal()->setDumpInterval(m_dumpInterval);
+    if (m_dumpWindow.size() == 2) { m_simulation->GetGlobal()->setDumpStartTime(m_dumpWindow[0]); m_simulation->GetGlobal()->setDumpEndTime(m_dumpWindow[1]); }
+    if (m_dumpTrigger.size())
+    {
+        if (!m_simulation->DumpTriggerValid(m_dumpTrigger))
+        {
+            std::cerr << "Error: --dumpTrigger \"" << m_dumpTrigger << "\" is not ContactAbort, DataTargetAbort or the ID of a GEOM or DATATARGET\n";
+            m_simulation.reset();
+            return 1;
+        }
+        m_simulation->GetGlobal()->setDumpTrigger(m_dumpTrigger);
+    }
 
     return 0;
 }
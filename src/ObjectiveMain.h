@@ -30,12 +30,17 @@ private:
     double m_outputModelStateAtWarehouseDistance = -1;
     double m_simulationTimeLimit = -1;
     double m_warehouseFailDistanceAbort = 0;
+    int m_dumpInterval = 0;
+    std::vector<double> m_dumpWindow;
+    std::string m_dumpTrigger;
 
     std::string m_configFilename;
     std::string m_outputWarehouseFilename;
     std::string m_outputModelStateFilename;
     std::string m_inputWarehouseFilename;
     std::string m_scoreFilename;
+    std::string m_dumpBinaryFilename;
+    std::string m_convertDumpFilename;
 
     XMLConverter m_XMLConverter;
     ArgParse m_argparse;
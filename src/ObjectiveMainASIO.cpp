@@ -60,6 +60,7 @@ ObjectiveMainASIO::ObjectiveMainASIO(int argc, const char **argv)
     m_argparse.AddArgument("-mw"s, "--outputModelStateAtWarehouseDistance"s, "Output model state at this warehouse distance"s, ""s, 1, false, ArgParse::Double);
     m_argparse.AddArgument("-wd"s, "--warehouseFailDistanceAbort"s, "Abort the simulation when the warehouse distance fails"s, "0"s, 1, false, ArgParse::Bool);
     m_argparse.AddArgument("-de"s, "--debug"s, "Turn debugging on"s);
+    m_argparse.AddArgument("-nt"s, "--threads"s, "Number of simulation threads"s, "1"s, 1, false, ArgParse::Int);
 
     m_argparse.AddArgument("-ol"s, "--outputList"s, "List of objects to produce output"s, ""s, 1, MAX_ARGS, false, ArgParse::String);
 
@@ -85,6 +86,7 @@ ObjectiveMainASIO::ObjectiveMainASIO(int argc, const char **argv)
     m_argparse.Get("--inputWarehouse"s, &m_inputWarehouseFilename);
     m_argparse.Get("--outputWarehouse"s, &m_outputWarehouseFilename);
     m_argparse.Get("--debug"s, &m_debug);
+    m_argparse.Get("--threads"s, &m_threads);
 
     std::vector<std::string> rawHosts;
     std::vector<std::string> result;
@@ -110,6 +112,8 @@ ObjectiveMainASIO::ObjectiveMainASIO(int argc, const char **argv)
 
 int ObjectiveMainASIO::Run()
 {
+    if (m_threads > 1) return RunThreaded();
+
     double startTime = GSUtil::GetTime();
     bool finishedFlag = true;
     double currentTime;
@@ -146,21 +150,17 @@ int ObjectiveMainASIO::Run()
             lastTime = currentTime;
 
             // and apply the new genome
-            DataMessage *dataMessagePtr = reinterpret_cast<DataMessage *>(m_dataMessageRaw.data());
-            m_XMLConverter.ApplyGenome(int(dataMessagePtr->genomeLength), dataMessagePtr->payload.genome);
+            m_XMLConverter.ApplyGenome(int(m_genomeDataMessage->genomeLength), m_genomeDataMessage->payload.genome);
+            // use the pre-parsed elements if possible since this avoids reparsing the whole XML
+            const std::vector<std::unique_ptr<ParseXML::XMLElement>> *elementList = m_XMLConverter.GetFormattedElementList("GAITSYM2019"s);
             std::string xmlString;
-            m_XMLConverter.GetFormattedXML(&xmlString);
+            if (!elementList) m_XMLConverter.GetFormattedXML(&xmlString);
 
             // create the simulation object
             m_simulation = std::make_unique<Simulation>();
-            if (m_outputWarehouseFilename.size()) m_simulation->SetOutputWarehouseFile(m_outputWarehouseFilename);
-            if (m_outputModelStateFilename.size()) m_simulation->SetOutputModelStateFile(m_outputModelStateFilename);
-            if (m_outputModelStateAtTime >= 0) m_simulation->SetOutputModelStateAtTime(m_outputModelStateAtTime);
-            if (m_outputModelStateAtCycle >= 0) m_simulation->SetOutputModelStateAtCycle(m_outputModelStateAtCycle);
-            if (m_inputWarehouseFilename.size()) m_simulation->AddWarehouse(m_inputWarehouseFilename);
-            if (m_outputModelStateAtWarehouseDistance >= 0) m_simulation->SetOutputModelStateAtWarehouseDistance(m_outputModelStateAtWarehouseDistance);
-
-            if (m_simulation->LoadModel(xmlString.c_str(), xmlString.size()))
+            // start from the same ODE random seed as WorkerThread so that -nt 1 and -nt N give the same scores
+            dRandSetSeed(0);
+            if (LoadSimulation(m_simulation.get(), elementList, xmlString))
             {
                 // something is wrong so assume that all my XML files are corrupt and start again
                 m_simulation.reset();
@@ -171,20 +171,6 @@ int ObjectiveMainASIO::Run()
                 continue;
             }
 
-            // late initialisation options
-            if (m_simulationTimeLimit >= 0) m_simulation->SetTimeLimit(m_simulationTimeLimit);
-            if (m_warehouseFailDistanceAbort != 0) m_simulation->SetWarehouseFailDistanceAbort(m_warehouseFailDistanceAbort);
-            for (size_t i = 0; i < m_outputList.size(); i++)
-            {
-                if (m_simulation->GetBodyList()->find(m_outputList[i]) != m_simulation->GetBodyList()->end()) (*m_simulation->GetBodyList())[m_outputList[i]]->setDump(true);
-                if (m_simulation->GetMuscleList()->find(m_outputList[i]) != m_simulation->GetMuscleList()->end()) (*m_simulation->GetMuscleList())[m_outputList[i]]->setDump(true);
-                if (m_simulation->GetGeomList()->find(m_outputList[i]) != m_simulation->GetGeomList()->end()) (*m_simulation->GetGeomList())[m_outputList[i]]->setDump(true);
-                if (m_simulation->GetJointList()->find(m_outputList[i]) != m_simulation->GetJointList()->end()) (*m_simulation->GetJointList())[m_outputList[i]]->setDump(true);
-                if (m_simulation->GetDriverList()->find(m_outputList[i]) != m_simulation->GetDriverList()->end()) (*m_simulation->GetDriverList())[m_outputList[i]]->setDump(true);
-                if (m_simulation->GetDataTargetList()->find(m_outputList[i]) != m_simulation->GetDataTargetList()->end()) (*m_simulation->GetDataTargetList())[m_outputList[i]]->setDump(true);
-                if (m_simulation->GetReporterList()->find(m_outputList[i]) != m_simulation->GetReporterList()->end()) (*m_simulation->GetReporterList())[m_outputList[i]]->setDump(true);
-            }
-
             while (m_simulation->ShouldQuit() == false)
             {
                 m_simulation->UpdateSimulation();
@@ -203,6 +189,208 @@ int ObjectiveMainASIO::Run()
     return 0;
 }
 
+// this version runs the simulations in a pool of worker threads
+// the main thread does all the communication with the server so only a single connection is used
+int ObjectiveMainASIO::RunThreaded()
+{
+    // keep ODE initialised for the lifetime of the pool rather than for each simulation
+    dInitODE2(0);
+    m_stopThreads = false;
+    for (int i = 0; i < m_threads; i++) m_workerThreads.push_back(std::thread(&ObjectiveMainASIO::WorkerThread, this));
+
+    double startTime = GSUtil::GetTime();
+    double runTime = 0;
+    double timeoutMultiplier = 1.0;
+    size_t tasksInProgress = 0;
+    while(m_runTimeLimit == 0 || runTime <= m_runTimeLimit)
+    {
+        runTime = GSUtil::GetTime() - startTime;
+
+        // send back any scores that are ready
+        tasksInProgress -= WriteResults();
+
+        // if all the workers are busy then wait for one to finish
+        if (tasksInProgress >= size_t(m_threads))
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_resultCondition.wait(lock, [this]{ return m_resultQueue.size() > 0; });
+            continue;
+        }
+
+        if (m_xmlMissing) ReadXML();
+        if (m_xmlMissing || ReadGenome())
+        {
+            m_currentHost++;
+            if (m_currentHost >= m_hosts.size()) m_currentHost = 0;
+            // randomly variable increasing sleep time but wake up if a result arrives
+            m_sleepTime = int(m_distrib(m_gen) * 1000.0 * timeoutMultiplier);
+            if (m_debug) std::cerr <<  "timeoutMultiplier = " << timeoutMultiplier << " m_sleepTime = " << m_sleepTime << " ms\n";
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_resultCondition.wait_for(lock, std::chrono::milliseconds(m_sleepTime), [this]{ return m_resultQueue.size() > 0; });
+            if (timeoutMultiplier < 100) timeoutMultiplier++;
+            continue;
+        }
+        timeoutMultiplier = 1.0;
+
+        // apply the genome here because the XMLConverter is shared and the workers get their own copy of the elements
+        std::unique_ptr<Task> task = std::make_unique<Task>();
+        task->runID = m_genomeDataMessage->runID;
+        task->evolveIdentifier = m_genomeDataMessage->evolveIdentifier;
+        m_XMLConverter.ApplyGenome(int(m_genomeDataMessage->genomeLength), m_genomeDataMessage->payload.genome);
+        const std::vector<std::unique_ptr<ParseXML::XMLElement>> *elementList = m_XMLConverter.GetFormattedElementList("GAITSYM2019"s);
+        if (elementList)
+        {
+            task->elementList.reserve(elementList->size());
+            for (auto &&it : *elementList) task->elementList.push_back(std::make_unique<ParseXML::XMLElement>(*it));
+        }
+        else
+        {
+            m_XMLConverter.GetFormattedXML(&task->xmlString);
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_taskQueue.push_back(std::move(task));
+        }
+        m_taskCondition.notify_one();
+        tasksInProgress++;
+    }
+
+    // the tasks that have already been handed out are finished so that their scores are not lost
+    if (tasksInProgress) std::cerr << "Run time limit reached: finishing " << tasksInProgress << " queued and running simulations\n";
+    while (tasksInProgress)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_resultCondition.wait(lock, [this]{ return m_resultQueue.size() > 0; });
+        }
+        tasksInProgress -= WriteResults();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        m_stopThreads = true;
+    }
+    m_taskCondition.notify_all();
+    for (auto &&it : m_workerThreads) it.join();
+    m_workerThreads.clear();
+    dCloseODE();
+    return 0;
+}
+
+// sends back the scores of any finished simulations and returns the number of results that were processed
+size_t ObjectiveMainASIO::WriteResults()
+{
+    std::deque<Result> resultQueue;
+    {
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        resultQueue.swap(m_resultQueue);
+    }
+    for (auto &&result : resultQueue)
+    {
+        if (result.status)
+        {
+            // something is wrong so assume that all my XML files are corrupt and start again
+            m_xmlMissing = true;
+            m_cachedConfigFiles.clear();
+            m_cachedConfigFilesQueue.clear();
+            m_hash = {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF};
+            continue;
+        }
+        m_simulationTime += result.simulationTime;
+        std::cerr << "Simulation Time: " << result.time <<
+                     " Steps: " << result.stepCount <<
+                     " Score: " << result.score <<
+                     " Mechanical Energy: " << result.mechanicalEnergy <<
+                     " Metabolic Energy: " << result.metabolicEnergy <<
+                     " CPUTimeSimulation: " << m_simulationTime <<
+                     "\n";
+        int status = WriteScore(result.score, result.runID, result.evolveIdentifier);
+        if (status && m_debug) std::cerr << "Failed to write output score\n";
+    }
+    return resultQueue.size();
+}
+
+void ObjectiveMainASIO::WorkerThread()
+{
+    dAllocateODEDataForThread(dAllocateMaskAll);
+    while (true)
+    {
+        std::unique_ptr<Task> task;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_taskCondition.wait(lock, [this]{ return m_stopThreads || m_taskQueue.size() > 0; });
+            if (m_stopThreads) break;
+            task = std::move(m_taskQueue.front());
+            m_taskQueue.pop_front();
+        }
+
+        Result result = {};
+        result.runID = task->runID;
+        result.evolveIdentifier = task->evolveIdentifier;
+        double startTime = GSUtil::GetTime();
+        std::unique_ptr<Simulation> simulation = std::make_unique<Simulation>();
+        // the ODE random seed belongs to this thread and every simulation starts from the seed of a new process
+        // so that the score does not depend on which worker ran it or what that worker ran before
+        dRandSetSeed(0);
+        if (LoadSimulation(simulation.get(), task->xmlString.size() ? nullptr : &task->elementList, task->xmlString))
+        {
+            result.status = __LINE__;
+        }
+        else
+        {
+            while (simulation->ShouldQuit() == false)
+            {
+                simulation->UpdateSimulation();
+                if (simulation->TestForCatastrophy()) break;
+            }
+            result.score = simulation->CalculateInstantaneousFitness();
+            result.time = simulation->GetTime();
+            result.stepCount = uint64_t(simulation->GetStepCount());
+            result.mechanicalEnergy = simulation->GetMechanicalEnergy();
+            result.metabolicEnergy = simulation->GetMetabolicEnergy();
+        }
+        simulation.reset();
+        result.simulationTime = GSUtil::GetTime() - startTime;
+
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_resultQueue.push_back(result);
+        }
+        m_resultCondition.notify_one();
+    }
+    dCleanupODEAllDataForThread();
+}
+
+// this routine sets up a new simulation using the command line options
+// it only reads member variables so it can be called from the worker threads
+std::string *ObjectiveMainASIO::LoadSimulation(Simulation *simulation, const std::vector<std::unique_ptr<ParseXML::XMLElement>> *elementList, const std::string &xmlString) const
+{
+    if (m_outputWarehouseFilename.size()) simulation->SetOutputWarehouseFile(m_outputWarehouseFilename);
+    if (m_outputModelStateFilename.size()) simulation->SetOutputModelStateFile(m_outputModelStateFilename);
+    if (m_outputModelStateAtTime >= 0) simulation->SetOutputModelStateAtTime(m_outputModelStateAtTime);
+    if (m_outputModelStateAtCycle >= 0) simulation->SetOutputModelStateAtCycle(m_outputModelStateAtCycle);
+    if (m_inputWarehouseFilename.size()) simulation->AddWarehouse(m_inputWarehouseFilename);
+    if (m_outputModelStateAtWarehouseDistance >= 0) simulation->SetOutputModelStateAtWarehouseDistance(m_outputModelStateAtWarehouseDistance);
+
+    std::string *errorMessage = elementList ? simulation->LoadModel(*elementList) : simulation->LoadModel(xmlString.c_str(), xmlString.size());
+    if (errorMessage) return errorMessage;
+
+    // late initialisation options
+    if (m_simulationTimeLimit >= 0) simulation->SetTimeLimit(m_simulationTimeLimit);
+    if (m_warehouseFailDistanceAbort != 0) simulation->SetWarehouseFailDistanceAbort(m_warehouseFailDistanceAbort);
+    for (size_t i = 0; i < m_outputList.size(); i++)
+    {
+        if (simulation->GetBodyList()->find(m_outputList[i]) != simulation->GetBodyList()->end()) (*simulation->GetBodyList())[m_outputList[i]]->setDump(true);
+        if (simulation->GetMuscleList()->find(m_outputList[i]) != simulation->GetMuscleList()->end()) (*simulation->GetMuscleList())[m_outputList[i]]->setDump(true);
+        if (simulation->GetGeomList()->find(m_outputList[i]) != simulation->GetGeomList()->end()) (*simulation->GetGeomList())[m_outputList[i]]->setDump(true);
+        if (simulation->GetJointList()->find(m_outputList[i]) != simulation->GetJointList()->end()) (*simulation->GetJointList())[m_outputList[i]]->setDump(true);
+        if (simulation->GetDriverList()->find(m_outputList[i]) != simulation->GetDriverList()->end()) (*simulation->GetDriverList())[m_outputList[i]]->setDump(true);
+        if (simulation->GetDataTargetList()->find(m_outputList[i]) != simulation->GetDataTargetList()->end()) (*simulation->GetDataTargetList())[m_outputList[i]]->setDump(true);
+        if (simulation->GetReporterList()->find(m_outputList[i]) != simulation->GetReporterList()->end()) (*simulation->GetReporterList())[m_outputList[i]]->setDump(true);
+    }
+    return nullptr;
+}
+
 // this routine attemps to read the model specification and initialise the simulation
 // it returns zero on success
 int ObjectiveMainASIO::ReadGenome()
@@ -238,25 +426,23 @@ int ObjectiveMainASIO::ReadGenome()
     }
     if (m_debug) std::cerr <<  "ReadGenome req_gen_ sent\n";
 
-    std::string reply;
+    m_genomeDataMessage = nullptr;
     try
     {
-        reply =  decode(m_asioClient.readLine(m_timeout, '\0'));
+        m_asioClient.readMessage(&m_genomeMessage, m_timeout, '\0');
     }
     catch (std::exception& e)
     {
         std::cerr << __LINE__ << " " << e.what() << std::endl;
         return __LINE__;
     }
-    if (m_debug) std::cerr << "ReadGenome genome received " << reply.size() << " characters\n";
-    if (reply.size() < sizeof(DataMessage))
+    if (m_debug) std::cerr << "ReadGenome genome received " << m_genomeMessage.size() << " characters\n";
+    const DataMessage *dataMessagePtr = m_genomeMessage.View<DataMessage>();
+    if (!dataMessagePtr)
     {
-        std::cerr << "ReadGenome reply.size() < sizeof(DataMessage)\n";
+        std::cerr << "ReadGenome m_genomeMessage.size() < sizeof(DataMessage)\n";
         return __LINE__;
     }
-    m_dataMessageRaw.resize(reply.size());
-    std::copy_n(reply.data(), reply.size(), m_dataMessageRaw.data());
-    DataMessage *dataMessagePtr = reinterpret_cast<DataMessage *>(m_dataMessageRaw.data());
     if (m_debug) std::cerr << "ReadGenome " << dataMessagePtr->text << " received\n"
                            << "senderIP = " << dataMessagePtr->senderIP
                            << " senderPort = " << dataMessagePtr->senderPort
@@ -265,12 +451,13 @@ int ObjectiveMainASIO::ReadGenome()
                            << " xmlLength = " << dataMessagePtr->xmlLength
                            << " md5 = " << dataMessagePtr->md5[0] << " " << dataMessagePtr->md5[1] << " "
                            << dataMessagePtr->md5[2] << " " << dataMessagePtr->md5[3] << "\n";
-    if (reply.size() < sizeof(DataMessage) + dataMessagePtr->genomeLength * sizeof(double))
+    if (m_genomeMessage.size() < sizeof(DataMessage) + dataMessagePtr->genomeLength * sizeof(double))
     {
-        std::cerr << "ReadGenome reply.size() < sizeof(DataMessage) + dataMessagePtr->genomeLength * sizeof(double)\n";
+        std::cerr << "ReadGenome m_genomeMessage.size() < sizeof(DataMessage) + dataMessagePtr->genomeLength * sizeof(double)\n";
         return __LINE__;
     }
     m_dataMessage = *dataMessagePtr;
+    m_genomeDataMessage = dataMessagePtr;
 
     // check the current hash
     if (std::equal(std::begin(m_hash), std::end(m_hash), std::begin(dataMessagePtr->md5)) == false)
@@ -327,26 +514,25 @@ int ObjectiveMainASIO::ReadXML()
     }
     if (m_debug) std::cerr << "ReadXML req_xml_ sent\n";
 
-    std::string reply;
     try
     {
-        reply =  decode(m_asioClient.readLine(m_timeout, '\0'));
+        m_asioClient.readMessage(&m_xmlMessage, m_timeout, '\0');
     }
     catch (std::exception& e)
     {
         std::cerr << __LINE__ << " " << e.what() << std::endl;
         return __LINE__;
     }
-    if (m_debug) std::cerr << "ReadXML xml received " << reply.size() << " characters\n";
-    if (reply.size() < sizeof(DataMessage))
+    if (m_debug) std::cerr << "ReadXML xml received " << m_xmlMessage.size() << " characters\n";
+    const DataMessage *dataMessagePtr = m_xmlMessage.View<DataMessage>();
+    if (!dataMessagePtr)
     {
-        std::cerr << "ReadXML reply.size() < sizeof(DataMessage)\n";
+        std::cerr << "ReadXML m_xmlMessage.size() < sizeof(DataMessage)\n";
         return __LINE__;
     }
-    const DataMessage *dataMessagePtr = reinterpret_cast<const DataMessage *>(reply.data());
-    if (reply.size() < sizeof(DataMessage) + dataMessagePtr->xmlLength * sizeof(char))
+    if (m_xmlMessage.size() < sizeof(DataMessage) + dataMessagePtr->xmlLength * sizeof(char))
     {
-        std::cerr << "ReadXML reply.size() < sizeof(DataMessage) + dataMessagePtr->xmlLength * sizeof(char)\n";
+        std::cerr << "ReadXML m_xmlMessage.size() < sizeof(DataMessage) + dataMessagePtr->xmlLength * sizeof(char)\n";
         return __LINE__;
     }
 
@@ -379,6 +565,11 @@ int ObjectiveMainASIO::WriteOutput()
                  " CPUTimeIO: " << m_IOTime <<
                  "\n";
 
+    return WriteScore(score, m_dataMessage.runID, m_dataMessage.evolveIdentifier);
+}
+
+int ObjectiveMainASIO::WriteScore(double score, uint32_t runID, uint64_t evolveIdentifier)
+{
     m_timeout = std::chrono::milliseconds(100000);
     try
     {
@@ -389,15 +580,15 @@ int ObjectiveMainASIO::WriteOutput()
         std::cerr << __LINE__ << " " << e.what() << std::endl;
         return __LINE__;
     }
-    if (m_debug) std::cerr <<  "WriteOutput m_asioClient.connect() OK\n";
+    if (m_debug) std::cerr <<  "WriteScore m_asioClient.connect() OK\n";
 
     m_requestMessage = {};
     m_requestMessage.senderIP = m_asioClient.socket().local_endpoint().address().to_v4().to_uint();
     m_requestMessage.senderPort = m_asioClient.socket().local_endpoint().port();
     strcpy(m_requestMessage.text, "score___");
     m_requestMessage.score = score;
-    m_requestMessage.runID = m_dataMessage.runID;
-    m_requestMessage.evolveIdentifier = m_dataMessage.evolveIdentifier;
+    m_requestMessage.runID = runID;
+    m_requestMessage.evolveIdentifier = evolveIdentifier;
     try
     {
         std::string encodedString = encode(std::string(reinterpret_cast<char *>(&m_requestMessage), sizeof(RequestMessage)));
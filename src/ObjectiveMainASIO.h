@@ -13,6 +13,7 @@
 
 #include "XMLConverter.h"
 #include "ArgParse.h"
+#include "MessageBuffer.h"
 
 #include "asio.hpp"
 
@@ -24,6 +25,9 @@
 #include <memory>
 #include <iostream>
 #include <system_error>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 class Simulation;
 
@@ -89,6 +93,22 @@ public:
         return line;
     }
 
+    // reads an escaped message and decodes it straight into a reusable buffer
+    void readMessage(MessageBuffer *message, std::chrono::steady_clock::duration timeout, char delimiter = '\0')
+    {
+        m_resultError = {};
+        m_resultN = 0;
+        asio::async_read_until(m_socket, asio::dynamic_buffer(m_inputBuffer), delimiter, std::bind(&AsioClient::readHandler, this, std::placeholders::_1, std::placeholders::_2));
+
+        run(timeout);
+
+        if (m_resultError)
+            throw std::system_error(m_resultError);
+
+        message->Decode(m_inputBuffer.data(), m_resultN - 1);
+        m_inputBuffer.erase(0, m_resultN);
+    }
+
     void writeLine(const std::string& line, std::chrono::steady_clock::duration timeout, char delimiter = '\n')
     {
         std::string data = line + delimiter;
@@ -200,14 +220,20 @@ public:
     ObjectiveMainASIO(int argc, const char **argv);
 
     int Run();
+    int RunThreaded();
     int ReadGenome();
     int ReadXML();
     int WriteOutput();
+    int WriteScore(double score, uint32_t runID, uint64_t evolveIdentifier);
 
     static std::string encode(const std::string &input);
     static std::string decode(const std::string &input);
 
 private:
+    std::string *LoadSimulation(Simulation *simulation, const std::vector<std::unique_ptr<ParseXML::XMLElement>> *elementList, const std::string &xmlString) const;
+    void WorkerThread();
+    size_t WriteResults();
+
     std::vector<std::string> m_outputList;
 
     std::unique_ptr<Simulation> m_simulation;
@@ -275,13 +301,48 @@ private:
     size_t m_cachedConfigFilesLimit = 10;
     DataMessage m_dataMessage = {};
     RequestMessage m_requestMessage = {};
-    std::vector<char> m_dataMessageRaw;
+    // the replies are decoded into reusable aligned buffers and the genome is used from there
+    MessageBuffer m_genomeMessage;
+    MessageBuffer m_xmlMessage;
+    const DataMessage *m_genomeDataMessage = nullptr; // points into m_genomeMessage
     bool m_xmlMissing = true;
 
     std::mt19937_64 m_gen;
     std::uniform_real_distribution<double> m_distrib;
 
     bool m_debug = false;
+
+    // the threaded version has a pool of workers that each run their own simulation
+    // the main thread does all the communication and passes complete element lists to the workers
+    struct Task
+    {
+        uint32_t runID;
+        uint64_t evolveIdentifier;
+        std::vector<std::unique_ptr<ParseXML::XMLElement>> elementList;
+        std::string xmlString; // only used if the element list is not available
+    };
+
+    struct Result
+    {
+        uint32_t runID;
+        uint64_t evolveIdentifier;
+        int status;
+        double score;
+        double time;
+        uint64_t stepCount;
+        double mechanicalEnergy;
+        double metabolicEnergy;
+        double simulationTime;
+    };
+
+    int m_threads = 1;
+    std::vector<std::thread> m_workerThreads;
+    std::mutex m_queueMutex;
+    std::condition_variable m_taskCondition;
+    std::condition_variable m_resultCondition;
+    std::deque<std::unique_ptr<Task>> m_taskQueue;
+    std::deque<Result> m_resultQueue;
+    bool m_stopThreads = false;
 };
 
 
@@ -25,6 +25,7 @@
 #include <thread>
 #include <algorithm>
 #include <random>
+#include <limits>
 
 #if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
 #include <WinSock2.h>
@@ -60,6 +61,7 @@ ObjectiveMainASIOAsync::ObjectiveMainASIOAsync(int argc, const char **argv)
     m_argparse.AddArgument("-mw"s, "--outputModelStateAtWarehouseDistance"s, "Output model state at this warehouse distance"s, ""s, 1, false, ArgParse::Double);
     m_argparse.AddArgument("-wd"s, "--warehouseFailDistanceAbort"s, "Abort the simulation when the warehouse distance fails"s, "0"s, 1, false, ArgParse::Bool);
     m_argparse.AddArgument("-de"s, "--debug"s, "Turn debugging on"s);
+    m_argparse.AddArgument("-bs"s, "--batchSize"s, "Number of genomes to request at a time"s, "1"s, 1, false, ArgParse::Int);
 
     m_argparse.AddArgument("-ol"s, "--outputList"s, "List of objects to produce output"s, ""s, 1, MAX_ARGS, false, ArgParse::String);
 
@@ -85,6 +87,7 @@ ObjectiveMainASIOAsync::ObjectiveMainASIOAsync(int argc, const char **argv)
     m_argparse.Get("--inputWarehouse"s, &m_inputWarehouseFilename);
     m_argparse.Get("--outputWarehouse"s, &m_outputWarehouseFilename);
     m_argparse.Get("--debug"s, &m_debug);
+    m_argparse.Get("--batchSize"s, &m_batchSize);
 
     std::string rawHost;
     std::vector<std::string> result;
@@ -118,64 +121,66 @@ int ObjectiveMainASIOAsync::Run()
     while(m_runTimeLimit == 0 || runTime <= m_runTimeLimit)
     {
         // construct the new thread and run it
-        double score = 0;
-        uint32_t runID = std::numeric_limits<uint32_t>::max() - 1;
-        uint64_t evolveIdentifier = 0;
-        std::string xmlCopy;
-        if (m_lastGenomeValid && m_XMLConverter.BaseXMLString().size())
+        // the simulation thread uses the XMLConverter so it must not be changed until the thread finishes
+        if (m_nextBatchValid && m_XMLConverter.BaseXMLString().size())
         {
-            runID = reinterpret_cast<const DataMessage *>(m_lastGenomeDataMessageRaw.data())->runID;
-            evolveIdentifier = reinterpret_cast<const DataMessage *>(m_lastGenomeDataMessageRaw.data())->evolveIdentifier;
-            if (m_debug) std::cerr <<  "Run runID = " << runID << " evolveIdentifier = " << evolveIdentifier << "\n";
-            m_XMLConverter.ApplyGenome(int(reinterpret_cast<const DataMessage *>(m_lastGenomeDataMessageRaw.data())->genomeLength), reinterpret_cast<const DataMessage *>(m_lastGenomeDataMessageRaw.data())->payload.genome);
-            m_XMLConverter.GetFormattedXML(&xmlCopy);
+            std::swap(m_batch, m_nextBatch);
+            if (m_debug) std::cerr <<  "Run batch size = " << m_batch.runIDs.size() << " evolveIdentifier = " << m_batch.evolveIdentifier << "\n";
         }
+        else
+        {
+            m_batch.runIDs.clear();
+            m_batch.genomes.clear();
+        }
+        m_nextBatchValid = false;
+        std::vector<BatchScore> scores;
         m_statusDoSimulation = __LINE__;
-        std::thread simulationThread(&ObjectiveMainASIOAsync::DoSimulation, this, xmlCopy.data(), xmlCopy.size(), &score, &computeTime);
+        std::thread simulationThread(&ObjectiveMainASIOAsync::DoSimulation, this, &m_batch, &scores, &computeTime);
 
-        // while the simulation is running send off the last result and get the new task
-        if (m_scoreToSend)
+        // while the simulation is running send off the last results and get the next batch
+        if (m_scoresToSend.size())
         {
-            status = WriteOutput(m_host, m_port, m_lastEvolveIdentifier, m_lastRunID, m_lastScore);
+            if (m_scoresFromBatchMessage) status = WriteBatchOutput(m_host, m_port, m_lastEvolveIdentifier, m_scoresToSend);
+            else status = WriteOutput(m_host, m_port, m_lastEvolveIdentifier, m_scoresToSend[0].runID, m_scoresToSend[0].score);
             if (status && m_debug) std::cerr << "Failed to write output score\n";
-            m_scoreToSend = false;
+            m_scoresToSend.clear();
         }
-        status = ReadGenome(m_host, m_port, &m_lastGenomeDataMessageRaw);
-        if (status) m_lastGenomeValid = false;
-        else m_lastGenomeValid = true;
-        if (m_lastGenomeValid)
+        const DataMessage *newBaseXML = nullptr;
+        status = ReadGenome(m_host, m_port, &m_nextBatch);
+        if (status) m_nextBatchValid = false;
+        else m_nextBatchValid = true;
+        if (m_nextBatchValid)
         {
-            if (!hashEqual(m_hash.data(), reinterpret_cast<const DataMessage *>(m_lastGenomeDataMessageRaw.data())->md5, m_hash.size()))
+            if (!hashEqual(m_hash.data(), m_nextBatch.md5, m_hash.size()))
             {
-                std::string rawMessage;
-                ReadXML(m_host, m_port, &rawMessage);
-                if (hashEqual(reinterpret_cast<const DataMessage *>(rawMessage.data())->md5, reinterpret_cast<const DataMessage *>(m_lastGenomeDataMessageRaw.data())->md5, m_hash.size())
-                        && reinterpret_cast<const DataMessage *>(rawMessage.data())->evolveIdentifier == reinterpret_cast<const DataMessage *>(m_lastGenomeDataMessageRaw.data())->evolveIdentifier)
+                const DataMessage *xmlMessage = nullptr;
+                if (ReadXML(m_host, m_port, &m_xmlMessage, &xmlMessage) == 0 && hashEqual(xmlMessage->md5, m_nextBatch.md5, m_hash.size())
+                        && xmlMessage->evolveIdentifier == m_nextBatch.evolveIdentifier)
                 {
-                    for (size_t i = 0; i < m_hash.size(); i++) { m_hash[i] = reinterpret_cast<const DataMessage *>(rawMessage.data())->md5[i]; }
-                    m_XMLConverter.LoadBaseXMLString(reinterpret_cast<const DataMessage *>(rawMessage.data())->payload.xml, reinterpret_cast<const DataMessage *>(rawMessage.data())->xmlLength);
+                    for (size_t i = 0; i < m_hash.size(); i++) { m_hash[i] = xmlMessage->md5[i]; }
+                    // the simulation thread may be using the XMLConverter elements so the new XML cannot be loaded until it finishes
+                    // the XML stays in m_xmlMessage until then so it is only copied once into the XMLConverter
+                    newBaseXML = xmlMessage;
                 }
                 else
                 {
-                    m_lastGenomeValid = false;
+                    m_nextBatchValid = false;
                 }
             }
         }
 
         // wait for the simulation thread
         simulationThread.join();
+        if (newBaseXML) m_XMLConverter.LoadBaseXMLString(newBaseXML->payload.xml, newBaseXML->xmlLength);
         if (m_statusDoSimulation == 0)
         {
-            m_scoreToSend = true;
-            m_lastScore = score;
-            m_lastRunID = runID;
-            m_lastEvolveIdentifier = evolveIdentifier;
+            m_scoresToSend = std::move(scores);
+            m_scoresFromBatchMessage = m_batch.fromBatchMessage;
+            m_lastEvolveIdentifier = m_batch.evolveIdentifier;
         }
         else
         {
-            m_scoreToSend = false;
-            m_lastScore = 0;
-            m_lastRunID = std::numeric_limits<uint32_t>::max() - 1;;
+            m_scoresToSend.clear();
             m_lastEvolveIdentifier = 0;
         }
 
@@ -187,9 +192,9 @@ int ObjectiveMainASIOAsync::Run()
     return 0;
 }
 
-void ObjectiveMainASIOAsync::DoSimulation(const char *xmlPtr, size_t xmlLen, double *score, double *computeTime)
+void ObjectiveMainASIOAsync::DoSimulation(const Batch *batch, std::vector<BatchScore> *scores, double *computeTime)
 {
-    if (xmlLen == 0)
+    if (batch->runIDs.size() == 0)
     {
         m_statusDoSimulation = __LINE__;
         return;
@@ -198,56 +203,139 @@ void ObjectiveMainASIOAsync::DoSimulation(const char *xmlPtr, size_t xmlLen, dou
 
     double startTime = GSUtil::GetTime();
 
-    // create the simulation object locally so delete happens before the next one is create otherwise we get problems with ODE error tracking
-    std::unique_ptr<Simulation> simulation = std::make_unique<Simulation>();
-    if (m_outputWarehouseFilename.size()) simulation->SetOutputWarehouseFile(m_outputWarehouseFilename);
-    if (m_outputModelStateFilename.size()) simulation->SetOutputModelStateFile(m_outputModelStateFilename);
-    if (m_outputModelStateAtTime >= 0) simulation->SetOutputModelStateAtTime(m_outputModelStateAtTime);
-    if (m_outputModelStateAtCycle >= 0) simulation->SetOutputModelStateAtCycle(m_outputModelStateAtCycle);
-    if (m_inputWarehouseFilename.size()) simulation->AddWarehouse(m_inputWarehouseFilename);
-    if (m_outputModelStateAtWarehouseDistance >= 0) simulation->SetOutputModelStateAtWarehouseDistance(m_outputModelStateAtWarehouseDistance);
+    for (size_t iGenome = 0; iGenome < batch->runIDs.size(); iGenome++)
+    {
+        m_XMLConverter.ApplyGenome(int(batch->genomeLength), batch->genomes[iGenome]);
+        // use the pre-parsed elements if possible since this avoids reparsing the whole XML
+        const std::vector<std::unique_ptr<ParseXML::XMLElement>> *elementList = m_XMLConverter.GetFormattedElementList("GAITSYM2019"s);
+        std::string xmlString;
+        if (!elementList) m_XMLConverter.GetFormattedXML(&xmlString);
+
+        // create the simulation object locally so delete happens before the next one is create otherwise we get problems with ODE error tracking
+        std::unique_ptr<Simulation> simulation = std::make_unique<Simulation>();
+        if (m_outputWarehouseFilename.size()) simulation->SetOutputWarehouseFile(m_outputWarehouseFilename);
+        if (m_outputModelStateFilename.size()) simulation->SetOutputModelStateFile(m_outputModelStateFilename);
+        if (m_outputModelStateAtTime >= 0) simulation->SetOutputModelStateAtTime(m_outputModelStateAtTime);
+        if (m_outputModelStateAtCycle >= 0) simulation->SetOutputModelStateAtCycle(m_outputModelStateAtCycle);
+        if (m_inputWarehouseFilename.size()) simulation->AddWarehouse(m_inputWarehouseFilename);
+        if (m_outputModelStateAtWarehouseDistance >= 0) simulation->SetOutputModelStateAtWarehouseDistance(m_outputModelStateAtWarehouseDistance);
+
+        if (elementList ? simulation->LoadModel(*elementList) : simulation->LoadModel(xmlString.c_str(), xmlString.size()))
+        {
+            // all the genomes in a batch use the same XML so there is no point carrying on
+            m_statusDoSimulation = __LINE__;
+            break;
+        }
+
+        // late initialisation options
+        if (m_simulationTimeLimit >= 0) simulation->SetTimeLimit(m_simulationTimeLimit);
+        if (m_warehouseFailDistanceAbort != 0) simulation->SetWarehouseFailDistanceAbort(m_warehouseFailDistanceAbort);
+        for (size_t i = 0; i < m_outputList.size(); i++)
+        {
+            if (simulation->GetBodyList()->find(m_outputList[i]) != simulation->GetBodyList()->end()) (*simulation->GetBodyList())[m_outputList[i]]->setDump(true);
+            if (simulation->GetMuscleList()->find(m_outputList[i]) != simulation->GetMuscleList()->end()) (*simulation->GetMuscleList())[m_outputList[i]]->setDump(true);
+            if (simulation->GetGeomList()->find(m_outputList[i]) != simulation->GetGeomList()->end()) (*simulation->GetGeomList())[m_outputList[i]]->setDump(true);
+            if (simulation->GetJointList()->find(m_outputList[i]) != simulation->GetJointList()->end()) (*simulation->GetJointList())[m_outputList[i]]->setDump(true);
+            if (simulation->GetDriverList()->find(m_outputList[i]) != simulation->GetDriverList()->end()) (*simulation->GetDriverList())[m_outputList[i]]->setDump(true);
+            if (simulation->GetDataTargetList()->find(m_outputList[i]) != simulation->GetDataTargetList()->end()) (*simulation->GetDataTargetList())[m_outputList[i]]->setDump(true);
+            if (simulation->GetReporterList()->find(m_outputList[i]) != simulation->GetReporterList()->end()) (*simulation->GetReporterList())[m_outputList[i]]->setDump(true);
+        }
+
+        while (simulation->ShouldQuit() == false)
+        {
+            simulation->UpdateSimulation();
+            if (simulation->TestForCatastrophy()) break;
+        }
+        BatchScore batchScore = {};
+        batchScore.runID = batch->runIDs[iGenome];
+        batchScore.score = simulation->CalculateInstantaneousFitness();
+        scores->push_back(batchScore);
+        std::cerr << "Simulation Time: " << simulation->GetTime() <<
+                     " Steps: " << simulation->GetStepCount() <<
+                     " Score: " << batchScore.score <<
+                     " Mechanical Energy: " << simulation->GetMechanicalEnergy() <<
+                     " Metabolic Energy: " << simulation->GetMetabolicEnergy() <<
+                     "\n";
+    }
+    *computeTime += (GSUtil::GetTime() - startTime);
+}
+
+// this routine asks the server whether it sends batches and sets m_serverBatchSize from the reply
+// it returns zero on success
+int ObjectiveMainASIOAsync::ReadCapabilities(std::string host, uint16_t port)
+{
+    if (m_debug) std::cerr <<  "ReadCapabilities host " << host << " port " << port << "\n";
 
-    if (simulation->LoadModel(xmlPtr, xmlLen))
+    m_timeout = std::chrono::milliseconds(int(10000 * m_distrib(m_gen)));
+    try
     {
-        m_statusDoSimulation = __LINE__;
-        return;
+        m_asioClient.connect(host, std::to_string(port), m_timeout);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << __LINE__ << " " << e.what() << std::endl;
+        return __LINE__;
     }
+    if (m_debug) std::cerr <<  "ReadCapabilities m_asioClient.connect() OK\n";
 
-    // late initialisation options
-    if (m_simulationTimeLimit >= 0) simulation->SetTimeLimit(m_simulationTimeLimit);
-    if (m_warehouseFailDistanceAbort != 0) simulation->SetWarehouseFailDistanceAbort(m_warehouseFailDistanceAbort);
-    for (size_t i = 0; i < m_outputList.size(); i++)
+    BatchRequestMessage requestMessage = {};
+    requestMessage.senderIP = m_asioClient.socket().local_endpoint().address().to_v4().to_uint();
+    requestMessage.senderPort = m_asioClient.socket().local_endpoint().port();
+    requestMessage.batchSize = uint32_t(m_batchSize);
+    strncpy(requestMessage.text, "req_caps", sizeof(requestMessage.text));
+    try
+    {
+        std::string encodedLine = encode(std::string(reinterpret_cast<char *>(&requestMessage), sizeof(BatchRequestMessage)));
+        m_asioClient.writeBuffer(encodedLine.data(), encodedLine.size(), m_timeout);
+    }
+    catch (std::exception& e)
     {
-        if (simulation->GetBodyList()->find(m_outputList[i]) != simulation->GetBodyList()->end()) (*simulation->GetBodyList())[m_outputList[i]]->setDump(true);
-        if (simulation->GetMuscleList()->find(m_outputList[i]) != simulation->GetMuscleList()->end()) (*simulation->GetMuscleList())[m_outputList[i]]->setDump(true);
-        if (simulation->GetGeomList()->find(m_outputList[i]) != simulation->GetGeomList()->end()) (*simulation->GetGeomList())[m_outputList[i]]->setDump(true);
-        if (simulation->GetJointList()->find(m_outputList[i]) != simulation->GetJointList()->end()) (*simulation->GetJointList())[m_outputList[i]]->setDump(true);
-        if (simulation->GetDriverList()->find(m_outputList[i]) != simulation->GetDriverList()->end()) (*simulation->GetDriverList())[m_outputList[i]]->setDump(true);
-        if (simulation->GetDataTargetList()->find(m_outputList[i]) != simulation->GetDataTargetList()->end()) (*simulation->GetDataTargetList())[m_outputList[i]]->setDump(true);
-        if (simulation->GetReporterList()->find(m_outputList[i]) != simulation->GetReporterList()->end()) (*simulation->GetReporterList())[m_outputList[i]]->setDump(true);
+        std::cerr << __LINE__ << " " << e.what() << std::endl;
+        return __LINE__;
     }
+    if (m_debug) std::cerr << "ReadCapabilities req_caps sent\n";
+    m_capabilityRequests++; // only requests that reached the server count towards the limit
 
-    while (simulation->ShouldQuit() == false)
+    MessageBuffer reply;
+    try
     {
-        simulation->UpdateSimulation();
-        if (simulation->TestForCatastrophy()) break;
+        m_asioClient.readMessage(&reply, m_timeout, '\0');
     }
-    *score = simulation->CalculateInstantaneousFitness();
-    std::cerr << "Simulation Time: " << simulation->GetTime() <<
-                 " Steps: " << simulation->GetStepCount() <<
-                 " Score: " << *score <<
-                 " Mechanical Energy: " << simulation->GetMechanicalEnergy() <<
-                 " Metabolic Energy: " << simulation->GetMetabolicEnergy() <<
-                 "\n";
-    *computeTime += (GSUtil::GetTime() - startTime);
+    catch (std::exception& e)
+    {
+        std::cerr << __LINE__ << " " << e.what() << std::endl;
+        return __LINE__;
+    }
+    const BatchRequestMessage *capabilitiesMessagePtr = reply.View<BatchRequestMessage>();
+    if (!capabilitiesMessagePtr || strncmp(capabilitiesMessagePtr->text, "caps", 16) != 0)
+    {
+        std::cerr << "ReadCapabilities caps not received\n";
+        return __LINE__;
+    }
+    m_serverBatchSize = int(std::min(capabilitiesMessagePtr->batchSize, uint32_t(std::numeric_limits<int>::max())));
+    if (m_debug) std::cerr << "ReadCapabilities caps received batchSize = " << m_serverBatchSize << "\n";
+    return 0;
 }
 
 // this routine attemps to read the model specification and initialise the simulation
 // it returns zero on success
-int ObjectiveMainASIOAsync::ReadGenome(std::string host, uint16_t port, std::string *rawMessage)
+int ObjectiveMainASIOAsync::ReadGenome(std::string host, uint16_t port, Batch *batch)
 {
     if (m_debug) std::cerr <<  "ReadGenome  host " << host << " port " << port << "\n";
 
+    // batches are only requested once the server has said that it sends them
+    if (m_batchSize > 1 && m_serverBatchSize < 0 && m_capabilityRequests < m_capabilityRequestLimit)
+    {
+        if (ReadCapabilities(host, port) == 0)
+        {
+            if (m_serverBatchSize <= 1) std::cerr << "ReadGenome server does not send batches so single genomes will be requested\n";
+        }
+        else if (m_capabilityRequests >= m_capabilityRequestLimit)
+        {
+            std::cerr << "ReadGenome no reply to req_caps after " << m_capabilityRequests << " attempts so single genomes will be requested\n";
+        }
+    }
+
     m_timeout = std::chrono::milliseconds(int(10000 * m_distrib(m_gen)));
     try
     {
@@ -261,13 +349,28 @@ int ObjectiveMainASIOAsync::ReadGenome(std::string host, uint16_t port, std::str
     if (m_debug) std::cerr <<  "ReadGenome m_asioClient.connect() OK\n";
 
     // request info from the server
-    RequestMessage m_requestMessage = {};
-    m_requestMessage.senderIP = m_asioClient.socket().local_endpoint().address().to_v4().to_uint();
-    m_requestMessage.senderPort = m_asioClient.socket().local_endpoint().port();
-    strncpy(m_requestMessage.text, "req_gen_", sizeof(m_requestMessage.text));
+    bool batchRequested = (m_batchSize > 1 && m_serverBatchSize > 1);
+    std::string requestString;
+    if (batchRequested)
+    {
+        BatchRequestMessage batchRequestMessage = {};
+        batchRequestMessage.senderIP = m_asioClient.socket().local_endpoint().address().to_v4().to_uint();
+        batchRequestMessage.senderPort = m_asioClient.socket().local_endpoint().port();
+        batchRequestMessage.batchSize = uint32_t(std::min(m_batchSize, m_serverBatchSize));
+        strncpy(batchRequestMessage.text, "req_gen_batch", sizeof(batchRequestMessage.text));
+        requestString.assign(reinterpret_cast<char *>(&batchRequestMessage), sizeof(BatchRequestMessage));
+    }
+    else
+    {
+        RequestMessage m_requestMessage = {};
+        m_requestMessage.senderIP = m_asioClient.socket().local_endpoint().address().to_v4().to_uint();
+        m_requestMessage.senderPort = m_asioClient.socket().local_endpoint().port();
+        strncpy(m_requestMessage.text, "req_gen_", sizeof(m_requestMessage.text));
+        requestString.assign(reinterpret_cast<char *>(&m_requestMessage), sizeof(RequestMessage));
+    }
     try
     {
-        std::string encodedLine = encode(std::string(reinterpret_cast<char *>(&m_requestMessage), sizeof(RequestMessage)));
+        std::string encodedLine = encode(requestString);
         m_asioClient.writeBuffer(encodedLine.data(), encodedLine.size(), m_timeout);
     }
     catch (std::exception& e)
@@ -275,30 +378,61 @@ int ObjectiveMainASIOAsync::ReadGenome(std::string host, uint16_t port, std::str
         std::cerr << __LINE__ << " " << e.what() << std::endl;
         return __LINE__;
     }
-    if (m_debug) std::cerr <<  "ReadGenome req_gen_ sent\n";
+    if (m_debug) std::cerr <<  "ReadGenome " << requestString.c_str() << " sent\n";
 
-    std::string reply;
+    // the reply is decoded straight into the batch's message and the genomes are used from there
+    batch->runIDs.clear();
+    batch->genomes.clear();
+    MessageBuffer *reply = &batch->message;
     try
     {
-        reply =  decode(m_asioClient.readLine(m_timeout, '\0'));
+        m_asioClient.readMessage(reply, m_timeout, '\0');
     }
     catch (std::exception& e)
     {
         std::cerr << __LINE__ << " " << e.what() << std::endl;
         return __LINE__;
     }
-    if (m_debug) std::cerr << "ReadGenome genome received " << reply.size() << " characters\n";
-    if (reply.size() < sizeof(DataMessage))
+    if (m_debug) std::cerr << "ReadGenome genome received " << reply->size() << " characters\n";
+
+    const BatchDataMessage *batchDataMessagePtr = batchRequested ? reply->View<BatchDataMessage>() : nullptr;
+    if (batchDataMessagePtr && strncmp(batchDataMessagePtr->text, "genome_batch", 16) == 0)
+    {
+        if (m_debug) std::cerr << "ReadGenome " << batchDataMessagePtr->text << " received\n"
+                               << "evolveIdentifier = " << batchDataMessagePtr->evolveIdentifier
+                               << " batchSize = " << batchDataMessagePtr->batchSize
+                               << " genomeLength = " << batchDataMessagePtr->genomeLength << "\n";
+        size_t recordSize = sizeof(BatchGenome) + batchDataMessagePtr->genomeLength * sizeof(double);
+        if (batchDataMessagePtr->batchSize == 0 || reply->size() < sizeof(BatchDataMessage) + batchDataMessagePtr->batchSize * recordSize)
+        {
+            std::cerr << "ReadGenome reply->size() < sizeof(BatchDataMessage) + batchDataMessagePtr->batchSize * recordSize\n";
+            return __LINE__;
+        }
+        batch->evolveIdentifier = batchDataMessagePtr->evolveIdentifier;
+        std::copy_n(batchDataMessagePtr->md5, 4, batch->md5);
+        batch->fromBatchMessage = true;
+        batch->genomeLength = batchDataMessagePtr->genomeLength;
+        size_t recordOffset = sizeof(BatchDataMessage);
+        for (size_t i = 0; i < batchDataMessagePtr->batchSize; i++)
+        {
+            batch->runIDs.push_back(reply->View<BatchGenome>(recordOffset)->runID);
+            batch->genomes.push_back(reply->ViewArray<double>(recordOffset + sizeof(BatchGenome), batch->genomeLength));
+            recordOffset += recordSize;
+        }
+        return 0;
+    }
+
+    const DataMessage *dataMessagePtr = reply->View<DataMessage>();
+    if (!dataMessagePtr)
     {
-        std::cerr << "ReadGenome reply.size() < sizeof(DataMessage)\n";
+        std::cerr << "ReadGenome reply->size() < sizeof(DataMessage)\n";
         return __LINE__;
     }
-    if (strncmp(reply.data(), "genome", 16) != 0)
+    if (strncmp(dataMessagePtr->text, "genome", 16) != 0)
     {
-        std::cerr << "ReadGenome strncmp(reply.data(), \"genome\", 16) != 0\n";
+        std::cerr << "ReadGenome strncmp(dataMessagePtr->text, \"genome\", 16) != 0\n";
         return __LINE__;
     }
-    const DataMessage *dataMessagePtr = reinterpret_cast<const DataMessage *>(reply.data());
     if (m_debug) std::cerr << "ReadGenome " << dataMessagePtr->text << " received\n"
                            << "senderIP = " << dataMessagePtr->senderIP
                            << " senderPort = " << dataMessagePtr->senderPort
@@ -308,16 +442,22 @@ int ObjectiveMainASIOAsync::ReadGenome(std::string host, uint16_t port, std::str
                            << " xmlLength = " << dataMessagePtr->xmlLength
                            << " md5 = " << dataMessagePtr->md5[0] << " " << dataMessagePtr->md5[1] << " "
                            << dataMessagePtr->md5[2] << " " << dataMessagePtr->md5[3] << "\n";
-    if (reply.size() < sizeof(DataMessage) + dataMessagePtr->genomeLength * sizeof(double))
+    if (reply->size() < sizeof(DataMessage) + dataMessagePtr->genomeLength * sizeof(double))
     {
-        std::cerr << "ReadGenome reply.size() < sizeof(DataMessage) + dataMessagePtr->genomeLength * sizeof(double)\n";
+        std::cerr << "ReadGenome reply->size() < sizeof(DataMessage) + dataMessagePtr->genomeLength * sizeof(double)\n";
         return __LINE__;
     }
-    *rawMessage = reply;
+    // a single genome is treated as a batch of one
+    batch->evolveIdentifier = dataMessagePtr->evolveIdentifier;
+    std::copy_n(dataMessagePtr->md5, 4, batch->md5);
+    batch->fromBatchMessage = false;
+    batch->genomeLength = dataMessagePtr->genomeLength;
+    batch->runIDs.push_back(dataMessagePtr->runID);
+    batch->genomes.push_back(dataMessagePtr->payload.genome);
     return 0;
 }
 
-int ObjectiveMainASIOAsync::ReadXML(std::string host, uint16_t port, std::string *rawMessage)
+int ObjectiveMainASIOAsync::ReadXML(std::string host, uint16_t port, MessageBuffer *message, const DataMessage **xmlMessage)
 {
     if (m_debug) std::cerr <<  "ReadXML host " << host << " port " << port << "\n";
 
@@ -349,35 +489,34 @@ int ObjectiveMainASIOAsync::ReadXML(std::string host, uint16_t port, std::string
     }
     if (m_debug) std::cerr << "ReadXML req_xml_ sent\n";
 
-    std::string reply;
     try
     {
-        reply =  decode(m_asioClient.readLine(m_timeout, '\0'));
+        m_asioClient.readMessage(message, m_timeout, '\0');
     }
     catch (std::exception& e)
     {
         std::cerr << __LINE__ << " " << e.what() << std::endl;
         return __LINE__;
     }
-    if (m_debug) std::cerr << "ReadXML xml received " << reply.size() << " characters\n";
-    if (reply.size() < sizeof(DataMessage))
+    if (m_debug) std::cerr << "ReadXML xml received " << message->size() << " characters\n";
+    const DataMessage *dataMessagePtr = message->View<DataMessage>();
+    if (!dataMessagePtr)
     {
-        std::cerr << "ReadXML reply.size() < sizeof(DataMessage)\n";
+        std::cerr << "ReadXML message->size() < sizeof(DataMessage)\n";
         return __LINE__;
     }
-    const DataMessage *dataMessagePtr = reinterpret_cast<const DataMessage *>(reply.data());
-    if (reply.size() < sizeof(DataMessage) + dataMessagePtr->xmlLength * sizeof(char))
+    if (message->size() < sizeof(DataMessage) + dataMessagePtr->xmlLength * sizeof(char))
     {
-        std::cerr << "ReadXML reply.size() < sizeof(DataMessage) + dataMessagePtr->xmlLength * sizeof(char)\n";
+        std::cerr << "ReadXML message->size() < sizeof(DataMessage) + dataMessagePtr->xmlLength * sizeof(char)\n";
         return __LINE__;
     }
-    if (strncmp(reply.data(), "xml", 16) != 0)
+    if (strncmp(dataMessagePtr->text, "xml", 16) != 0)
     {
-        std::cerr << "ReadXML strncmp(reply.data(), \"xml\", 16) != 0\n";
+        std::cerr << "ReadXML strncmp(dataMessagePtr->text, \"xml\", 16) != 0\n";
         return __LINE__;
     }
 
-    *rawMessage = reply;
+    *xmlMessage = dataMessagePtr;
     return 0;
 }
 
@@ -419,6 +558,43 @@ int ObjectiveMainASIOAsync::WriteOutput(std::string host, uint16_t port, uint64_
     return 0;
 }
 
+int ObjectiveMainASIOAsync::WriteBatchOutput(std::string host, uint16_t port, uint64_t evolveIdentifier, const std::vector<BatchScore> &scores)
+{
+    m_timeout = std::chrono::milliseconds(int(100000 * m_distrib(m_gen)));
+    try
+    {
+        m_asioClient.connect(host, std::to_string(port), m_timeout);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << __LINE__ << " " << e.what() << std::endl;
+        return __LINE__;
+    }
+    if (m_debug) std::cerr <<  "WriteBatchOutput m_asioClient.connect() OK\n";
+
+    BatchScoreMessage batchScoreMessage = {};
+    batchScoreMessage.senderIP = m_asioClient.socket().local_endpoint().address().to_v4().to_uint();
+    batchScoreMessage.senderPort = m_asioClient.socket().local_endpoint().port();
+    strncpy(batchScoreMessage.text, "score_batch", sizeof(batchScoreMessage.text));
+    batchScoreMessage.evolveIdentifier = evolveIdentifier;
+    batchScoreMessage.batchSize = uint32_t(scores.size());
+    std::string message(reinterpret_cast<char *>(&batchScoreMessage), sizeof(BatchScoreMessage));
+    message.append(reinterpret_cast<const char *>(scores.data()), scores.size() * sizeof(BatchScore));
+    try
+    {
+        std::string encodedString = encode(message);
+        m_asioClient.writeBuffer(encodedString.data(), encodedString.size(), m_timeout);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << __LINE__ << " " << e.what() << std::endl;
+        return __LINE__;
+    }
+    if (m_debug) std::cerr << "WriteBatchOutput " << scores.size() << " scores sent\n";
+
+    return 0;
+}
+
 std::string ObjectiveMainASIOAsync::encode(const std::string &input)
 {
     std::string output;
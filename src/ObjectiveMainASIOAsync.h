@@ -13,6 +13,7 @@
 
 #include "XMLConverter.h"
 #include "ArgParse.h"
+#include "MessageBuffer.h"
 
 #include "asio.hpp"
 
@@ -90,6 +91,22 @@ public:
         return line;
     }
 
+    // reads an escaped message and decodes it straight into a reusable buffer
+    void readMessage(MessageBuffer *message, std::chrono::steady_clock::duration timeout, char delimiter = '\0')
+    {
+        m_resultError = {};
+        m_resultN = 0;
+        asio::async_read_until(m_socket, asio::dynamic_buffer(m_inputBuffer), delimiter, std::bind(&AsioClient::readHandler, this, std::placeholders::_1, std::placeholders::_2));
+
+        run(timeout);
+
+        if (m_resultError)
+            throw std::system_error(m_resultError);
+
+        message->Decode(m_inputBuffer.data(), m_resultN - 1);
+        m_inputBuffer.erase(0, m_resultN);
+    }
+
     void writeLine(const std::string& line, std::chrono::steady_clock::duration timeout, char delimiter = '\n')
     {
         std::string data = line + delimiter;
@@ -235,10 +252,75 @@ private:
         double score;
     };
 
-    int ReadGenome(std::string host, uint16_t port, std::string *rawMessage);
-    int ReadXML(std::string host, uint16_t port, std::string *rawMessage);
+    // the batch messages carry several genomes that share the same evolveIdentifier and md5
+    // they are only used if the batch size is greater than 1 and the server's caps reply says it sends batches
+    // req_caps and its caps reply are also BatchRequestMessages and the batchSize in the reply is the
+    // largest batch the server sends or 0 if it does not understand req_gen_batch
+    struct BatchRequestMessage
+    {
+        char text[16];
+        uint64_t evolveIdentifier;
+        uint32_t senderIP;
+        uint32_t senderPort;
+        uint32_t batchSize; // the maximum number of genomes wanted
+        uint32_t padding;
+    };
+
+    struct BatchDataMessage
+    {
+        char text[16];
+        uint64_t evolveIdentifier;
+        uint32_t senderIP;
+        uint32_t senderPort;
+        uint32_t batchSize; // the number of genomes actually sent
+        uint32_t genomeLength;
+        uint32_t md5[4];
+        // followed by batchSize BatchGenome records each of which is followed by genomeLength doubles
+    };
+
+    struct BatchGenome
+    {
+        uint32_t runID;
+        uint32_t padding;
+    };
+
+    struct BatchScoreMessage
+    {
+        char text[16];
+        uint64_t evolveIdentifier;
+        uint32_t senderIP;
+        uint32_t senderPort;
+        uint32_t batchSize;
+        uint32_t padding;
+        // followed by batchSize BatchScore records
+    };
+
+    struct BatchScore
+    {
+        uint32_t runID;
+        uint32_t padding;
+        double score;
+    };
+
+    // this is the internal version of a batch whichever message it arrived in
+    // the genomes point into the batch's own message so they are used without copying
+    struct Batch
+    {
+        uint64_t evolveIdentifier = 0;
+        uint32_t md5[4] = {};
+        bool fromBatchMessage = false;
+        uint32_t genomeLength = 0;
+        std::vector<uint32_t> runIDs;
+        std::vector<const double *> genomes;
+        MessageBuffer message;
+    };
+
+    int ReadCapabilities(std::string host, uint16_t port);
+    int ReadGenome(std::string host, uint16_t port, Batch *batch);
+    int ReadXML(std::string host, uint16_t port, MessageBuffer *message, const DataMessage **xmlMessage);
     int WriteOutput(std::string host, uint16_t port, uint64_t evolveIdentifier, uint32_t runID, double score);
-    void DoSimulation(const char *xmlPtr, size_t xmlLen, double *score, double *computeTime);
+    int WriteBatchOutput(std::string host, uint16_t port, uint64_t evolveIdentifier, const std::vector<BatchScore> &scores);
+    void DoSimulation(const Batch *batch, std::vector<BatchScore> *scores, double *computeTime);
 
     std::vector<std::string> m_outputList;
 
@@ -262,12 +344,19 @@ private:
     uint16_t m_port = 0;
     int m_sleepTime = 0;
 
-    bool m_scoreToSend = false;
-    double m_lastScore = 0;
-    uint32_t m_lastRunID = std::numeric_limits<uint32_t>::max() - 2;
+    std::vector<BatchScore> m_scoresToSend;
+    bool m_scoresFromBatchMessage = false;
     uint64_t m_lastEvolveIdentifier = 0;
-    std::string m_lastGenomeDataMessageRaw;
-    bool m_lastGenomeValid = false;
+    // the two batches swap each time round so their message buffers are reused
+    Batch m_batch;
+    Batch m_nextBatch;
+    MessageBuffer m_xmlMessage;
+    bool m_nextBatchValid = false;
+    int m_batchSize = 1;
+    // servers that predate req_caps do not reply to it so only the single messages are used until a caps reply arrives
+    int m_serverBatchSize = -1; // from the caps reply and -1 until there has been one
+    int m_capabilityRequests = 0;
+    int m_capabilityRequestLimit = 3;
     int m_statusDoSimulation = 0;
     std::vector<uint32_t> m_hash = {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF};
 
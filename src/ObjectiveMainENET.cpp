@@ -27,6 +27,7 @@
 #include <thread>
 #include <algorithm>
 #include <random>
+#include <limits>
 
 #if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
 #include <WinSock2.h>
@@ -69,6 +70,7 @@ ObjectiveMainENET::ObjectiveMainENET(int argc, const char **argv)
     m_argparse.AddArgument("-mw"s, "--outputModelStateAtWarehouseDistance"s, "Output model state at this warehouse distance"s, ""s, 1, false, ArgParse::Double);
     m_argparse.AddArgument("-wd"s, "--warehouseFailDistanceAbort"s, "Abort the simulation when the warehouse distance fails"s, "0"s, 1, false, ArgParse::Bool);
     m_argparse.AddArgument("-de"s, "--debug"s, "Turn debugging on"s);
+    m_argparse.AddArgument("-bs"s, "--batchSize"s, "Number of genomes to request at a time"s, "1"s, 1, false, ArgParse::Int);
 
     m_argparse.AddArgument("-ol"s, "--outputList"s, "List of objects to produce output"s, ""s, 1, MAX_ARGS, false, ArgParse::String);
 
@@ -93,6 +95,7 @@ ObjectiveMainENET::ObjectiveMainENET(int argc, const char **argv)
     m_argparse.Get("--inputWarehouse"s, &m_inputWarehouseFilename);
     m_argparse.Get("--outputWarehouse"s, &m_outputWarehouseFilename);
     m_argparse.Get("--debug"s, &m_debug);
+    m_argparse.Get("--batchSize"s, &m_batchSize);
 
     std::vector<std::string> rawHosts;
     std::vector<std::string> result;
@@ -161,12 +164,6 @@ int ObjectiveMainENET::Run()
             {
                 finishedFlag = false;
                 timeoutMultiplier = 1;
-
-                for (size_t i = 0; i < m_outputList.size(); i++)
-                {
-                    NamedObject *namedObject = m_simulation->GetNamedObject(m_outputList[i]);
-                    if (namedObject) namedObject->setDump(true);
-                }
             }
             else
             {
@@ -180,17 +177,37 @@ int ObjectiveMainENET::Run()
         }
         else
         {
-            double cpuStartTime = GSUtil::GetTime();
-            while (m_simulation->ShouldQuit() == false)
+            m_batchScores.clear();
+            for (size_t iGenome = 0; iGenome < m_batchGenomes.size(); iGenome++)
             {
-                m_simulation->UpdateSimulation();
-                if (m_simulation->TestForCatastrophy()) break;
+                double cpuStartTime = GSUtil::GetTime();
+                // all the genomes in a batch use the same XML so there is no point carrying on after a failure
+                if (CreateSimulation(m_batchGenomes[iGenome])) break;
+                while (m_simulation->ShouldQuit() == false)
+                {
+                    m_simulation->UpdateSimulation();
+                    if (m_simulation->TestForCatastrophy()) break;
+                }
+                m_simulationTime += (GSUtil::GetTime() - cpuStartTime);
+
+                TCPIPBatchRecord record = {};
+                record.runID = m_batchRunIDs[iGenome];
+                record.score = m_simulation->CalculateInstantaneousFitness();
+                m_batchScores.push_back(record);
+                std::cerr.precision(17);
+                std::cerr << "Simulation Time: " << m_simulation->GetTime() <<
+                             " Steps: " << m_simulation->GetStepCount() <<
+                             " Score: " << record.score <<
+                             " Mechanical Energy: " << m_simulation->GetMechanicalEnergy() <<
+                             " Metabolic Energy: " << m_simulation->GetMetabolicEnergy() <<
+                             " CPUTimeSimulation: " << m_simulationTime <<
+                             " CPUTimeIO: " << m_IOTime <<
+                             "\n";
+                m_simulation.reset();
             }
-            m_simulationTime += (GSUtil::GetTime() - cpuStartTime);
 
             finishedFlag = true;
-            status = WriteOutput();
-            m_simulation.reset();
+            if (m_batchScores.size()) status = WriteOutput();
             if (m_peer)
             {
                 // enet_peer_disconnect_now(m_peer, 0);
@@ -264,6 +281,19 @@ int ObjectiveMainENET::ReadModel()
         }
     }
 
+    // batches are only requested once the server has said that it sends them
+    if (m_batchSize > 1 && m_serverBatchSize < 0 && m_capabilityRequests < m_capabilityRequestLimit)
+    {
+        if (ReadCapabilities() == 0)
+        {
+            if (m_serverBatchSize <= 1) std::cerr << "Server does not send batches so single genomes will be requested\n";
+        }
+        else if (m_capabilityRequests >= m_capabilityRequestLimit)
+        {
+            std::cerr << "No reply to reqcaps after " << m_capabilityRequests << " attempts so single genomes will be requested\n";
+        }
+    }
+
     // request a new genome from the server
     TCPIPMessage message = {};
     strcpy(message.text, "reqjob");
@@ -274,12 +304,27 @@ int ObjectiveMainENET::ReadModel()
     message.senderPort = m_client->address.port;
     message.score = 0;
     enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE; // zero or ENET_PACKET_FLAG_RELIABLE most commonly
-    ENetPacket *packet = enet_packet_create(message.text, sizeof(TCPIPMessage), flags);
+    ENetPacket *packet;
+    bool batchRequested = (m_batchSize > 1 && m_serverBatchSize > 1);
+    if (batchRequested)
+    {
+        TCPIPBatchMessage batchMessage = {};
+        strcpy(batchMessage.text, "reqbatch");
+        batchMessage.batchSize = uint32_t(std::min(m_batchSize, m_serverBatchSize));
+        std::copy(std::begin(m_MD5), std::end(m_MD5), std::begin(batchMessage.md5));
+        batchMessage.senderIP = m_client->address.host;
+        batchMessage.senderPort = m_client->address.port;
+        packet = enet_packet_create(batchMessage.text, sizeof(TCPIPBatchMessage), flags);
+    }
+    else
+    {
+        packet = enet_packet_create(message.text, sizeof(TCPIPMessage), flags);
+    }
     enet_uint8 channelID = 0;
     status = enet_peer_send(m_peer, channelID, packet);
     if (status)
     {
-        std::cerr << "Message " << message.text << " not sent\n";
+        std::cerr << "Message " << (batchRequested ? "reqbatch" : message.text) << " not sent\n";
         return __LINE__;
     }
     else
@@ -287,19 +332,50 @@ int ObjectiveMainENET::ReadModel()
         if (m_debug) std::cerr << "Message " << message.text << " sent to " << GSUtil::ToString(event.peer->address.host, event.peer->address.port) << "\n";
     }
     enet_host_flush(m_client);
-    std::vector<double> genomeData;
+    m_batchRunIDs.clear();
+    m_batchGenomes.clear();
     // wait for a response
+    // a caps reply that arrived too late for ReadCapabilities can come first
     status = enet_host_service(m_client, &event, timeout);
-    if (status > 0 && event.type == ENET_EVENT_TYPE_RECEIVE)
+    while (status > 0 && event.type == ENET_EVENT_TYPE_RECEIVE && HandleCapabilities(event.packet))
+    {
+        enet_packet_destroy(event.packet);
+        status = enet_host_service(m_client, &event, timeout);
+    }
+    if (status > 0 && event.type == ENET_EVENT_TYPE_RECEIVE && batchRequested && event.packet->dataLength >= sizeof(TCPIPBatchMessage) && strcmp(reinterpret_cast<char *>(event.packet->data), "batch") == 0)
+    {
+        TCPIPBatchMessage *batchMessagePtr = reinterpret_cast<TCPIPBatchMessage *>(event.packet->data);
+        size_t recordSize = sizeof(TCPIPBatchRecord) + batchMessagePtr->genomeLength * sizeof(double);
+        if (event.packet->dataLength >= sizeof(TCPIPBatchMessage) + batchMessagePtr->batchSize * recordSize)
+        {
+            const enet_uint8 *recordPtr = event.packet->data + sizeof(TCPIPBatchMessage);
+            for (size_t i = 0; i < batchMessagePtr->batchSize; i++)
+            {
+                const double *doublePtr = reinterpret_cast<const double *>(recordPtr + sizeof(TCPIPBatchRecord));
+                m_batchRunIDs.push_back(reinterpret_cast<const TCPIPBatchRecord *>(recordPtr)->runID);
+                m_batchGenomes.push_back(std::vector<double>(doublePtr, doublePtr + batchMessagePtr->genomeLength));
+                recordPtr += recordSize;
+            }
+        }
+        // the rest of the code only needs the md5 from the genome message
+        m_genomeMessage = {};
+        std::copy(std::begin(batchMessagePtr->md5), std::end(batchMessagePtr->md5), std::begin(m_genomeMessage.md5));
+        m_batchMessage = true;
+        if (m_debug) std::cerr << "Message " << batchMessagePtr->text << " with " << m_batchGenomes.size() << " genomes received from " << GSUtil::ToString(event.peer->address.host, event.peer->address.port) << "\n";
+        enet_packet_destroy(event.packet);
+    }
+    else if (status > 0 && event.type == ENET_EVENT_TYPE_RECEIVE)
     {
         TCPIPMessage *messagePtr = reinterpret_cast<TCPIPMessage *>(event.packet->data);
         double *doublePtr = reinterpret_cast<double *>(event.packet->data + sizeof(TCPIPMessage));
         size_t lenGenome = (event.packet->dataLength - sizeof(TCPIPMessage)) / sizeof(double);
-        genomeData.reserve(lenGenome);
-        std::copy_n(doublePtr, lenGenome, std::back_inserter(genomeData));
+        m_batchRunIDs.push_back(messagePtr->runID);
+        m_batchGenomes.push_back(std::vector<double>(doublePtr, doublePtr + lenGenome));
         m_genomeMessage = *reinterpret_cast<TCPIPMessage *>(event.packet->data);
+        m_batchMessage = false;
         if (m_debug)
         {
+            const std::vector<double> &genomeData = m_batchGenomes.back();
             std::cerr << "Message " << messagePtr->text << " received from " << GSUtil::ToString(event.peer->address.host, event.peer->address.port) << "\n";
             for (size_t i = 0; i < genomeData.size(); i += 10)
             {
@@ -320,7 +396,7 @@ int ObjectiveMainENET::ReadModel()
         return __LINE__;
     }
 
-    if (!genomeData.size())
+    if (!m_batchGenomes.size() || !m_batchGenomes[0].size())
     {
         std::cerr << "Host " << m_currentHost << " no genome data sent\n";
         m_currentHost++;
@@ -398,10 +474,60 @@ int ObjectiveMainENET::ReadModel()
         }
     }
 
-    // and apply the new genome
-    m_XMLConverter.ApplyGenome(int(genomeData.size()), genomeData.data());
+    return 0;
+}
+
+// this routine asks the server on the connected peer whether it sends batches and sets m_serverBatchSize from the reply
+// it returns zero on success
+int ObjectiveMainENET::ReadCapabilities()
+{
+    TCPIPBatchMessage capabilitiesMessage = {};
+    strcpy(capabilitiesMessage.text, "reqcaps");
+    capabilitiesMessage.batchSize = uint32_t(m_batchSize);
+    std::copy(std::begin(m_MD5), std::end(m_MD5), std::begin(capabilitiesMessage.md5));
+    capabilitiesMessage.senderIP = m_client->address.host;
+    capabilitiesMessage.senderPort = m_client->address.port;
+    ENetPacket *packet = enet_packet_create(capabilitiesMessage.text, sizeof(TCPIPBatchMessage), ENET_PACKET_FLAG_RELIABLE);
+    enet_uint8 channelID = 0;
+    if (enet_peer_send(m_peer, channelID, packet))
+    {
+        std::cerr << "Message " << capabilitiesMessage.text << " not sent\n";
+        return __LINE__;
+    }
+    enet_host_flush(m_client);
+    m_capabilityRequests++;
+
+    ENetEvent event = {};
+    int status = enet_host_service(m_client, &event, enet_uint32(m_capabilityTimeout));
+    if (status > 0 && event.type == ENET_EVENT_TYPE_RECEIVE)
+    {
+        bool handled = HandleCapabilities(event.packet);
+        enet_packet_destroy(event.packet);
+        if (handled) return 0;
+    }
+    std::cerr << "Message caps not received\n";
+    return __LINE__;
+}
+
+// returns true if the packet was a caps reply
+bool ObjectiveMainENET::HandleCapabilities(const ENetPacket *packet)
+{
+    if (packet->dataLength < sizeof(TCPIPBatchMessage) || strncmp(reinterpret_cast<const char *>(packet->data), "caps", 16) != 0) return false;
+    const TCPIPBatchMessage *capabilitiesMessagePtr = reinterpret_cast<const TCPIPBatchMessage *>(packet->data);
+    m_serverBatchSize = int(std::min(capabilitiesMessagePtr->batchSize, uint32_t(std::numeric_limits<int>::max())));
+    if (m_debug) std::cerr << "Message caps received batchSize = " << m_serverBatchSize << "\n";
+    return true;
+}
+
+// this routine applies a genome to the current XML and initialises the simulation
+// it returns zero on success
+int ObjectiveMainENET::CreateSimulation(const std::vector<double> &genome)
+{
+    m_XMLConverter.ApplyGenome(int(genome.size()), genome.data());
+    // use the pre-parsed elements if possible since this avoids reparsing the whole XML
+    const std::vector<std::unique_ptr<ParseXML::XMLElement>> *elementList = m_XMLConverter.GetFormattedElementList("GAITSYM2019"s);
     std::string xmlString;
-    m_XMLConverter.GetFormattedXML(&xmlString);
+    if (!elementList) m_XMLConverter.GetFormattedXML(&xmlString);
 
     // create the simulation object
     m_simulation = std::make_unique<Simulation>();
@@ -412,7 +538,7 @@ int ObjectiveMainENET::ReadModel()
     if (m_inputWarehouseFilename.size()) m_simulation->AddWarehouse(m_inputWarehouseFilename);
     if (m_outputModelStateAtWarehouseDistance >= 0) m_simulation->SetOutputModelStateAtWarehouseDistance(m_outputModelStateAtWarehouseDistance);
 
-    if (m_simulation->LoadModel(xmlString.c_str(), xmlString.size()))
+    if (elementList ? m_simulation->LoadModel(*elementList) : m_simulation->LoadModel(xmlString.c_str(), xmlString.size()))
     {
         m_simulation.reset();
         m_currentHost++;
@@ -423,6 +549,11 @@ int ObjectiveMainENET::ReadModel()
     // late initialisation options
     if (m_simulationTimeLimit >= 0) m_simulation->SetTimeLimit(m_simulationTimeLimit);
     if (m_warehouseFailDistanceAbort != 0) m_simulation->SetWarehouseFailDistanceAbort(m_warehouseFailDistanceAbort);
+    for (size_t i = 0; i < m_outputList.size(); i++)
+    {
+        NamedObject *namedObject = m_simulation->GetNamedObject(m_outputList[i]);
+        if (namedObject) namedObject->setDump(true);
+    }
 
     return 0;
 }
@@ -433,17 +564,6 @@ int ObjectiveMainENET::WriteOutput()
 {
     if (m_debug) std::cerr <<  "WriteOutput m_currentHost " << m_currentHost << " host " << m_hosts[m_currentHost]->host << " port " << m_hosts[m_currentHost]->port << "\n";
 
-    double score = m_simulation->CalculateInstantaneousFitness();
-    std::cerr.precision(17);
-    std::cerr << "Simulation Time: " << m_simulation->GetTime() <<
-                 " Steps: " << m_simulation->GetStepCount() <<
-                 " Score: " << score <<
-                 " Mechanical Energy: " << m_simulation->GetMechanicalEnergy() <<
-                 " Metabolic Energy: " << m_simulation->GetMetabolicEnergy() <<
-                 " CPUTimeSimulation: " << m_simulationTime <<
-                 " CPUTimeIO: " << m_IOTime <<
-                 "\n";
-
     ENetAddress address;
     int status = enet_address_set_host(&address, m_hosts[m_currentHost]->host.c_str());
     if (status)
@@ -496,20 +616,40 @@ int ObjectiveMainENET::WriteOutput()
         }
     }
 
-    strcpy(m_genomeMessage.text, "result");
-    m_genomeMessage.score = score;
     enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE; // zero of ENET_PACKET_FLAG_RELIABLE most commonly
-    ENetPacket *packet = enet_packet_create(m_genomeMessage.text, sizeof(TCPIPMessage), flags);
+    ENetPacket *packet;
+    const char *messageText;
+    if (!m_batchMessage)
+    {
+        strcpy(m_genomeMessage.text, "result");
+        m_genomeMessage.score = m_batchScores[0].score;
+        packet = enet_packet_create(m_genomeMessage.text, sizeof(TCPIPMessage), flags);
+        messageText = "result";
+    }
+    else
+    {
+        // results packet is a TCPIPBatchMessage header followed by batchSize TCPIPBatchRecords
+        std::vector<char> resultsData(sizeof(TCPIPBatchMessage) + m_batchScores.size() * sizeof(TCPIPBatchRecord));
+        TCPIPBatchMessage *batchMessagePtr = reinterpret_cast<TCPIPBatchMessage *>(resultsData.data());
+        strcpy(batchMessagePtr->text, "results");
+        batchMessagePtr->batchSize = uint32_t(m_batchScores.size());
+        batchMessagePtr->senderIP = m_client->address.host;
+        batchMessagePtr->senderPort = m_client->address.port;
+        std::copy(std::begin(m_genomeMessage.md5), std::end(m_genomeMessage.md5), std::begin(batchMessagePtr->md5));
+        std::copy(m_batchScores.begin(), m_batchScores.end(), reinterpret_cast<TCPIPBatchRecord *>(resultsData.data() + sizeof(TCPIPBatchMessage)));
+        packet = enet_packet_create(resultsData.data(), resultsData.size(), flags);
+        messageText = "results";
+    }
     enet_uint8 channelID = 0;
     status = enet_peer_send(m_peer, channelID, packet);
     if (status)
     {
-        std::cerr << "Message " << m_genomeMessage.text << " not sent\n";
+        std::cerr << "Message " << messageText << " not sent\n";
         return __LINE__;
     }
     else
     {
-        if (m_debug) std::cerr << "Message " << m_genomeMessage.text << " sent to " << GSUtil::ToString(event.peer->address.host, event.peer->address.port) << "\n";
+        if (m_debug) std::cerr << "Message " << messageText << " sent to " << GSUtil::ToString(event.peer->address.host, event.peer->address.port) << "\n";
     }
     enet_host_flush(m_client);
 
@@ -34,9 +34,13 @@ public:
 
     int Run();
     int ReadModel();
+    int ReadCapabilities();
+    int CreateSimulation(const std::vector<double> &genome);
     int WriteOutput();
 
 private:
+    bool HandleCapabilities(const ENetPacket *packet);
+
     std::vector<std::string> m_outputList;
 
     std::unique_ptr<Simulation> m_simulation;
@@ -73,6 +77,19 @@ private:
     TCPIPMessage m_genomeMessage = {};
     bool m_connected = false;
 
+    // the genomes from the last request which will only contain one genome unless batches are being used
+    int m_batchSize = 1;
+    // reqcaps and its caps reply are TCPIPBatchMessages and the batchSize in the reply is the largest batch the server sends or 0 if it does not understand reqbatch
+    // servers that predate reqcaps do not reply to it so only the single messages are used until a caps reply arrives
+    int m_serverBatchSize = -1; // from the caps reply and -1 until there has been one
+    int m_capabilityRequests = 0;
+    int m_capabilityRequestLimit = 3;
+    int m_capabilityTimeout = 10000; // milliseconds
+    bool m_batchMessage = false;
+    std::vector<uint32_t> m_batchRunIDs;
+    std::vector<std::vector<double>> m_batchGenomes;
+    std::vector<TCPIPBatchRecord> m_batchScores;
+
     std::unique_ptr<std::mt19937_64> m_gen;
     std::unique_ptr<std::uniform_real_distribution<double>> m_distrib;
 
@@ -27,6 +27,7 @@
 #include <thread>
 #include <algorithm>
 #include <random>
+#include <cstddef>
 
 #if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
 #include <WinSock2.h>
@@ -200,10 +201,15 @@ int ObjectiveMainTCP::ReadGenome()
     int numBytes = m_TCP.SendData(m_requestMessage.text, sizeof(RequestMessage));
     if (numBytes != sizeof(RequestMessage)) { return __LINE__; }
     if (m_debug) std::cerr <<  "ReadGenome req_genome sent\n";
-    std::vector<char> dataMessage(sizeof(DataMessage) + m_dataMessage.genomeLength * sizeof(double));
+    // the header says how long the genome is so it has to be read before the payload
+    std::vector<char> dataMessage(sizeof(DataMessage));
+    numBytes = m_TCP.ReceiveData(dataMessage.data(), int(offsetof(DataMessage, payload)), 10, 0);
+    if (numBytes != int(offsetof(DataMessage, payload))) { return __LINE__; }
+    size_t payloadLength = reinterpret_cast<DataMessage *>(dataMessage.data())->genomeLength * sizeof(double);
+    dataMessage.resize(std::max(sizeof(DataMessage), offsetof(DataMessage, payload) + payloadLength));
     DataMessage *dataMessagePtr = reinterpret_cast<DataMessage *>(dataMessage.data());
-    numBytes = m_TCP.ReceiveData(dataMessage.data(), int(dataMessage.size()), 10, 0);
-    if (numBytes != int(dataMessage.size())) { return __LINE__; }
+    numBytes = m_TCP.ReceiveData(dataMessage.data() + offsetof(DataMessage, payload), int(payloadLength), 10, 0);
+    if (numBytes != int(payloadLength)) { return __LINE__; }
     if (m_debug) std::cerr << "ReadGenome " << dataMessagePtr->text << " received\n"
                            << "senderIP = " << dataMessagePtr->senderIP
                            << " senderPort = " << dataMessagePtr->senderPort
@@ -235,8 +241,10 @@ int ObjectiveMainTCP::ReadGenome()
 
     // and apply the new genome
     m_XMLConverter.ApplyGenome(int(dataMessagePtr->genomeLength), dataMessagePtr->payload.genome);
+    // use the pre-parsed elements if possible since this avoids reparsing the whole XML
+    const std::vector<std::unique_ptr<ParseXML::XMLElement>> *elementList = m_XMLConverter.GetFormattedElementList("GAITSYM2019"s);
     std::string xmlString;
-    m_XMLConverter.GetFormattedXML(&xmlString);
+    if (!elementList) m_XMLConverter.GetFormattedXML(&xmlString);
 
     // create the simulation object
     m_simulation = std::make_unique<Simulation>();
@@ -247,7 +255,7 @@ int ObjectiveMainTCP::ReadGenome()
     if (m_inputWarehouseFilename.size()) m_simulation->AddWarehouse(m_inputWarehouseFilename);
     if (m_outputModelStateAtWarehouseDistance >= 0) m_simulation->SetOutputModelStateAtWarehouseDistance(m_outputModelStateAtWarehouseDistance);
 
-    if (m_simulation->LoadModel(xmlString.c_str(), xmlString.size()))
+    if (elementList ? m_simulation->LoadModel(*elementList) : m_simulation->LoadModel(xmlString.c_str(), xmlString.size()))
     {
         m_simulation.reset();
         return __LINE__;
@@ -277,11 +285,15 @@ int ObjectiveMainTCP::ReadXML()
     if (numBytes != sizeof(RequestMessage)) { return __LINE__; }
     if (m_debug) std::cerr << "ReadXML req_xml sent\n";
 
-    std::vector<char> dataMessage(sizeof(DataMessage) + m_dataMessage.xmlLength * sizeof(char));
+    std::vector<char> dataMessage(sizeof(DataMessage));
+    numBytes = m_TCP.ReceiveData(dataMessage.data(), int(offsetof(DataMessage, payload)), 10, 0);
+    if (numBytes != int(offsetof(DataMessage, payload))) { return __LINE__; }
+    size_t payloadLength = reinterpret_cast<DataMessage *>(dataMessage.data())->xmlLength * sizeof(char);
+    dataMessage.resize(std::max(sizeof(DataMessage), offsetof(DataMessage, payload) + payloadLength));
     DataMessage *dataMessagePtr = reinterpret_cast<DataMessage *>(dataMessage.data());
-    numBytes = m_TCP.ReceiveData(dataMessage.data(), int(dataMessage.size()), 10, 0);
-    if (numBytes != int(dataMessage.size())) { return __LINE__; }
-    if (m_debug) std::cerr << "ReadXML xml received " << dataMessage.size() << " characters\n";
+    numBytes = m_TCP.ReceiveData(dataMessage.data() + offsetof(DataMessage, payload), int(payloadLength), 10, 0);
+    if (numBytes != int(payloadLength)) { return __LINE__; }
+    if (m_debug) std::cerr << "ReadXML xml received " << payloadLength << " characters\n";
 
     m_XMLConverter.LoadBaseXMLString(dataMessagePtr->payload.xml, dataMessagePtr->xmlLength);
     std::string xml(dataMessagePtr->payload.xml, dataMessagePtr->xmlLength);
@@ -70,8 +70,8 @@ ObjectiveMainUDP::ObjectiveMainUDP(int argc, const char **argv)
 
     m_argparse.AddArgument("-ol"s, "--outputList"s, "List of objects to produce output"s, ""s, 1, MAX_ARGS, false, ArgParse::String);
 
-    m_argparse.AddArgument("-rx"s, "--redundancyPercentXML"s, "Percentage redundancy in XML receive"s, ""s, 1, false, ArgParse::Double);
-    m_argparse.AddArgument("-rg"s, "--redundancyPercentGenome"s, "Percentage redundancy in genome receive"s, ""s, 1, false, ArgParse::Double);
+    m_argparse.AddArgument("-rx"s, "--redundancyPercentXML"s, "Percentage redundancy in XML receive"s, "0"s, 1, false, ArgParse::Int);
+    m_argparse.AddArgument("-rg"s, "--redundancyPercentGenome"s, "Percentage redundancy in genome receive"s, "0"s, 1, false, ArgParse::Int);
     m_argparse.AddArgument("-hl"s, "--hostsList"s, "List of hosts "s, "localhost:8086"s, 1, MAX_ARGS, true, ArgParse::String);
 
     int err = m_argparse.Parse();
@@ -95,7 +95,7 @@ ObjectiveMainUDP::ObjectiveMainUDP(int argc, const char **argv)
     m_argparse.Get("--outputWarehouse"s, &m_outputWarehouseFilename);
     m_argparse.Get("--debug"s, &m_debug);
 
-    int redundancyPercent;
+    int redundancyPercent = 0;
     m_argparse.Get("--redundancyPercentXML"s, &redundancyPercent);
     m_redundancyPercentXML = uint32_t(redundancyPercent);
     m_argparse.Get("--redundancyPercentGenome"s, &redundancyPercent);
@@ -286,8 +286,10 @@ int ObjectiveMainUDP::ReadGenome()
 
     // and apply the new genome
     m_XMLConverter.ApplyGenome(int(dataMessagePtr->genomeLength), dataMessagePtr->payload.genome);
+    // use the pre-parsed elements if possible since this avoids reparsing the whole XML
+    const std::vector<std::unique_ptr<ParseXML::XMLElement>> *elementList = m_XMLConverter.GetFormattedElementList("GAITSYM2019"s);
     std::string xmlString;
-    m_XMLConverter.GetFormattedXML(&xmlString);
+    if (!elementList) m_XMLConverter.GetFormattedXML(&xmlString);
 
     // create the simulation object
     m_simulation = std::make_unique<Simulation>();
@@ -298,7 +300,7 @@ int ObjectiveMainUDP::ReadGenome()
     if (m_inputWarehouseFilename.size()) m_simulation->AddWarehouse(m_inputWarehouseFilename);
     if (m_outputModelStateAtWarehouseDistance >= 0) m_simulation->SetOutputModelStateAtWarehouseDistance(m_outputModelStateAtWarehouseDistance);
 
-    if (m_simulation->LoadModel(xmlString.c_str(), xmlString.size()))
+    if (elementList ? m_simulation->LoadModel(*elementList) : m_simulation->LoadModel(xmlString.c_str(), xmlString.size()))
     {
         if (m_debug) std::cerr << "Error loading XML file into simulation\n";
         m_simulation.reset();
@@ -59,6 +59,7 @@
 #include "ThreeHingeJointDriver.h"
 #include "TwoHingeJointDriver.h"
 #include "MarkerEllipseDriver.h"
+#include "DumpFile.h"
 
 #include "pystring.h"
 
@@ -73,37 +74,36 @@
 #include <cmath>
 #include <algorithm>
 #include <locale>
+#include <tuple>
 #include <codecvt>
 #include <functional>
 #include <numeric>
+#include <mutex>
 
 using namespace std::string_literals;
 
+// dInitODE and dCloseODE use a non-atomic reference count so simulations created on different threads need to serialise them
+static std::mutex g_odeInitMutex;
+
 // #define _I(i,j) I[(i)*4+(j)]
 // regex _I\(([0-9]+),([0-9]+)\) to I[(\1)*4+(\2)]
 
 Simulation::Simulation()
 {
     // initialise the ODE world
-    dInitODE();
+    {
+        std::lock_guard<std::mutex> lock(g_odeInitMutex);
+        dInitODE();
+        // the ODE handlers are global so they are set to a function that uses the error handler registered for the current thread
+        dSetMessageHandler(ErrorHandler::ODEMessageCallback);
+        dSetErrorHandler(ErrorHandler::ODEMessageCallback);
+        dSetDebugHandler(ErrorHandler::ODEMessageCallback);
+    }
+    ErrorHandler::setThreadErrorHandler(&m_errorHandler);
     m_WorldID = dWorldCreate();
-    m_SpaceID = dHashSpaceCreate(nullptr); // FIX ME hash space is a compromise but this should probably be user controlled
+    // the geoms are held in a simple space while the model is loading and BuildCollisionSpaces replaces it with the GLOBAL SpaceType
+    m_SpaceID = dSimpleSpaceCreate(nullptr);
     m_ContactGroup = dJointGroupCreate(0);
-
-    // glue for calling a C++ callback
-    // Store member function and the instance using std::bind.
-    Callback<void(int, const char *, va_list)>::func = std::bind(&ErrorHandler::ODEMessageTrap, &m_errorHandler, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
-    // Convert callback-function to c-pointer.
-    void (*c_func)(int, const char *, va_list) = static_cast<decltype(c_func)>(Callback<void(int, const char *, va_list)>::callback);
-
-    // c_func is now the required function pointer
-    dSetMessageHandler(c_func);
-    dSetErrorHandler(c_func);
-    dSetDebugHandler(c_func);
-//    dSetMessageHandler(ErrorHandler::ODEMessageTrap);
-//    dSetErrorHandler(ErrorHandler::ODEMessageTrap);
-//    dSetDebugHandler(ErrorHandler::ODEMessageTrap);
-    //    std::cerr << "dGetMessageHandler() = " << size_t(dGetMessageHandler()) << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -111,6 +111,7 @@ Simulation::~Simulation()
 {
     // these need to be cleared before we destroy the ODE world
     m_ContactList.clear();
+    m_ContactPool.clear();
     m_BodyList.clear();
     m_JointList.clear();
     m_GeomList.clear();
@@ -125,12 +126,11 @@ Simulation::~Simulation()
     m_WarehouseList.clear();
 
     // destroy the ODE world
-    dSetMessageHandler(nullptr);
-    dSetErrorHandler(nullptr);
-    dSetDebugHandler(nullptr);
     dJointGroupDestroy(m_ContactGroup);
     dSpaceDestroy(m_SpaceID);
     dWorldDestroy(m_WorldID);
+    if (ErrorHandler::threadErrorHandler() == &m_errorHandler) ErrorHandler::setThreadErrorHandler(nullptr);
+    std::lock_guard<std::mutex> lock(g_odeInitMutex);
     dCloseODE();
 
 }
@@ -140,10 +140,21 @@ std::string *Simulation::LoadModel(const char *buffer, size_t length) // note th
 {
     std::string *ptr = m_parseXML.LoadModel(buffer, length, "GAITSYM2019"s);
     if (ptr) return ptr;
+    return LoadModel(*m_parseXML.elementList());
+}
+
+//----------------------------------------------------------------------------
+std::string *Simulation::LoadModel(const std::vector<std::unique_ptr<ParseXML::XMLElement>> &elementList) // the elements are only read so they can be reused for the next model
+{
+    // keep a copy of the elements so that the model can be reset without the original XML
+    m_resetElementList.clear();
+    m_resetElementOrder.clear();
+    m_resetElementList.reserve(elementList.size());
+    for (auto &&it : elementList) m_resetElementList.push_back(*it);
 
     // this logic allows forward references at the expense of slightly less obvious error messages
-    std::list<ParseXML::XMLElement *> unprocessedList;
-    for (auto &&it : *m_parseXML.elementList()) unprocessedList.push_back(it.get());
+    std::list<size_t> unprocessedList;
+    for (size_t i = 0; i < m_resetElementList.size(); i++) unprocessedList.push_back(i);
     size_t lastSize = 0;
     size_t cycles = 0;
     std::vector<std::string> errorList;
@@ -155,19 +166,7 @@ std::string *Simulation::LoadModel(const char *buffer, size_t length) // note th
         for (auto it = unprocessedList.begin(); it != unprocessedList.end();)
         {
             lastErrorPtr()->clear();
-            if ((*it)->tag == "GLOBAL"s) ParseGlobal(*it);
-            else if ((*it)->tag == "BODY"s) ParseBody(*it);
-            else if ((*it)->tag == "JOINT"s) ParseJoint(*it);
-            else if ((*it)->tag == "GEOM"s) ParseGeom(*it);
-            else if ((*it)->tag == "STRAP"s) ParseStrap(*it);
-            else if ((*it)->tag == "MUSCLE"s) ParseMuscle(*it);
-            else if ((*it)->tag == "DRIVER"s) ParseDriver(*it);
-            else if ((*it)->tag == "DATATARGET"s) ParseDataTarget(*it);
-            else if ((*it)->tag == "MARKER"s) ParseMarker(*it);
-            else if ((*it)->tag == "REPORTER"s) ParseReporter(*it);
-            else if ((*it)->tag == "CONTROLLER"s) ParseController(*it);
-            else if ((*it)->tag == "WAREHOUSE"s) ParseWarehouse(*it);
-            else if ((*it)->tag == "FLUIDSAC"s) ParseFluidSac(*it);
+            ParseElement(&m_resetElementList[*it]);
             if (lastErrorPtr()->size())
             {
                 errorList.push_back(*lastErrorPtr());
@@ -175,6 +174,7 @@ std::string *Simulation::LoadModel(const char *buffer, size_t length) // note th
             }
             else
             {
+                m_resetElementOrder.push_back(*it);
                 it = unprocessedList.erase(it);
             }
         }
@@ -187,6 +187,178 @@ std::string *Simulation::LoadModel(const char *buffer, size_t length) // note th
     if (cycles > 1)
         std::cerr << "Warning: file took " << cycles << " cycles to parse. Consider reordering for speed.\n";
 
+    // dump triggers can refer to objects anywhere in the file so they are checked once everything has been parsed
+    std::vector<NamedObject *> objectList = GetObjectList();
+    if (m_global) objectList.push_back(m_global.get());
+    for (auto &&it : objectList)
+    {
+        if (DumpTriggerValid(it->dumpTrigger())) continue;
+        setLastError("Error: ID=\""s + it->name() + "\" DumpTrigger=\""s + it->dumpTrigger() + "\" is not ContactAbort, DataTargetAbort or the ID of a GEOM or DATATARGET"s);
+        return lastErrorPtr();
+    }
+
+    LateInitialisation();
+
+    // the ODE random number generator is used by the quickstep solver so it needs to be restored for a reset
+    m_resetRandomSeed = dRandGetSeed();
+    return nullptr;
+}
+
+//----------------------------------------------------------------------------
+// this returns the simulation to the state it was in immediately after LoadModel
+// the ODE world, bodies, markers, geoms and warehouses are kept and everything else is recreated from the loaded elements
+// elementList can be used to supply new values but it must contain the same elements in the same order as the loaded model
+// if an error is returned the simulation is no longer usable and needs to be recreated
+std::string *Simulation::Reset(const std::vector<std::unique_ptr<ParseXML::XMLElement>> *elementList)
+{
+    if (elementList)
+    {
+        if (elementList->size() != m_resetElementList.size())
+        {
+            setLastError("Error: Simulation::Reset - element list does not match the loaded model"s);
+            return lastErrorPtr();
+        }
+        for (size_t i = 0; i < elementList->size(); i++)
+        {
+            const ParseXML::XMLElement *element = (*elementList)[i].get();
+            if (element->tag != m_resetElementList[i].tag || NamedObject::searchNames(element->attributes, "ID"s) != NamedObject::searchNames(m_resetElementList[i].attributes, "ID"s))
+            {
+                setLastError("Error: Simulation::Reset - element "s + std::to_string(i) + " does not match the loaded model"s);
+                return lastErrorPtr();
+            }
+            if (element->tag == "WAREHOUSE"s && element->attributes != m_resetElementList[i].attributes)
+            {
+                setLastError("Error: Simulation::Reset - WAREHOUSE ID=\""s + NamedObject::searchNames(element->attributes, "ID"s) + "\" cannot be changed"s);
+                return lastErrorPtr();
+            }
+        }
+        for (size_t i = 0; i < elementList->size(); i++) m_resetElementList[i].attributes = (*elementList)[i]->attributes;
+    }
+
+    // adhesion creates joints that are not tracked so they cannot be removed
+    for (auto &&it : m_GeomList)
+    {
+        if (it.second->GetAdhesion())
+        {
+            setLastError("Error: Simulation::Reset - GEOM ID=\""s + it.first + "\" uses adhesion which is not supported"s);
+            return lastErrorPtr();
+        }
+    }
+
+    // the dump flags are set after loading so they need to be preserved
+    std::set<std::string> dumpSet;
+    for (auto &&it : GetObjectList()) { if (it->dump()) dumpSet.insert(it->name()); }
+
+    // remove the contacts and all the objects that are recreated
+    dJointGroupEmpty(m_ContactGroup);
+    m_ContactList.clear();
+    for (auto &&it : m_GeomList) it.second->ClearContacts();
+    m_JointList.clear();
+    m_MuscleList.clear();
+    m_StrapList.clear();
+    m_FluidSacList.clear();
+    m_DriverList.clear();
+    m_DataTargetList.clear();
+    m_ReporterList.clear();
+    m_ControllerList.clear();
+
+    // collisions are tested in the order the geoms are stored in the space so this order needs to be restored
+    for (size_t index : m_resetElementOrder)
+    {
+        if (m_resetElementList[index].tag != "GEOM"s) continue;
+        Geom *geom = GetGeom(NamedObject::searchNames(m_resetElementList[index].attributes, "ID"s));
+        dSpaceID space = dGeomGetSpace(geom->GetGeomID());
+        dSpaceRemove(space, geom->GetGeomID());
+        dSpaceAdd(space, geom->GetGeomID());
+    }
+    for (auto &&it : m_BodyList)
+    {
+        dBodySetForce(it.second->GetBodyID(), 0, 0, 0);
+        dBodySetTorque(it.second->GetBodyID(), 0, 0, 0);
+        dBodyEnable(it.second->GetBodyID());
+    }
+    dRandSetSeed(m_resetRandomSeed);
+
+    m_SimulationTime = 0;
+    m_StepCount = 0;
+    m_MechanicalEnergy = 0;
+    m_MetabolicEnergy = 0;
+    m_KinematicMatchMiniMaxFitness = 0;
+    m_ClosestWarehouseFitness = -DBL_MAX;
+    m_KinematicMatchFitness = 0;
+    m_SimulationError = false;
+    m_WarehouseDistance = 0;
+    m_OutputWarehouseLastTime = -DBL_MAX;
+    m_DataTargetAbort = false;
+    m_ContactAbort = false;
+    m_DataTargetAbortList.clear();
+    m_ContactAbortList.clear();
+    m_numericalErrorCount = 0;
+    m_PositiveMechanicalWork = 0;
+    m_NegativeMechanicalWork = 0;
+    m_PositiveContractileWork = 0;
+    m_NegativeContractileWork = 0;
+    m_PositiveSerialElasticWork = 0;
+    m_NegativeSerialElasticWork = 0;
+    m_PositiveParallelElasticWork = 0;
+    m_NegativeParallelElasticWork = 0;
+    m_errorHandler.ClearMessage();
+    m_dumpFileStreams.clear();
+    if (m_dumpFile) m_dumpFile->Close(); // it will be reopened by the first dump
+    m_dumpFileIndices.clear();
+
+    // now go through the elements in the order they were originally parsed
+    // the kept objects are reinitialised in place which moves the bodies back to their construction positions
+    for (size_t index : m_resetElementOrder)
+    {
+        const ParseXML::XMLElement *element = &m_resetElementList[index];
+        lastErrorPtr()->clear();
+        NamedObject *namedObject = nullptr;
+        if (element->tag == "BODY"s) namedObject = GetBody(NamedObject::searchNames(element->attributes, "ID"s));
+        else if (element->tag == "MARKER"s) namedObject = GetMarker(NamedObject::searchNames(element->attributes, "ID"s));
+        else if (element->tag == "GEOM"s) namedObject = GetGeom(NamedObject::searchNames(element->attributes, "ID"s));
+        else if (element->tag == "WAREHOUSE"s) continue;
+        else ParseElement(element);
+        if (namedObject)
+        {
+            namedObject->createAttributeMap(element->attributes);
+            std::string *errorMessage = namedObject->createFromAttributes();
+            if (errorMessage) setLastError(*errorMessage);
+        }
+        if (lastErrorPtr()->size()) return lastErrorPtr();
+    }
+
+    for (auto &&it : GetObjectList())
+    {
+        it->setFirstDump(true);
+        if (dumpSet.count(it->name())) it->setDump(true);
+    }
+
+    LateInitialisation();
+    return nullptr;
+}
+
+//----------------------------------------------------------------------------
+void Simulation::ParseElement(const ParseXML::XMLElement *node)
+{
+    if (node->tag == "GLOBAL"s) ParseGlobal(node);
+    else if (node->tag == "BODY"s) ParseBody(node);
+    else if (node->tag == "JOINT"s) ParseJoint(node);
+    else if (node->tag == "GEOM"s) ParseGeom(node);
+    else if (node->tag == "STRAP"s) ParseStrap(node);
+    else if (node->tag == "MUSCLE"s) ParseMuscle(node);
+    else if (node->tag == "DRIVER"s) ParseDriver(node);
+    else if (node->tag == "DATATARGET"s) ParseDataTarget(node);
+    else if (node->tag == "MARKER"s) ParseMarker(node);
+    else if (node->tag == "REPORTER"s) ParseReporter(node);
+    else if (node->tag == "CONTROLLER"s) ParseController(node);
+    else if (node->tag == "WAREHOUSE"s) ParseWarehouse(node);
+    else if (node->tag == "FLUIDSAC"s) ParseFluidSac(node);
+}
+
+//----------------------------------------------------------------------------
+void Simulation::LateInitialisation()
+{
     // joints are created with the bodies in construction poses
     // then the bodies are moved to their starting poses
     for (auto &&it : m_BodyList) it.second->LateInitialisation();
@@ -196,6 +368,12 @@ std::string *Simulation::LoadModel(const char *buffer, size_t length) // note th
     // and some joints require things to be done after the bodies are moved to their start positions
     for (auto &&it :  m_JointList) it.second->LateInitialisation();
 
+    // the joints and geoms are all in place so the collision information can be cached
+    BuildCollisionSpaces();
+    BuildContactPairTable();
+
+    // the warehouses need the current bodies and drivers
+    ResolveWarehouseReferences();
     // for the time being just set the current warehouse to the first one in the list
     if (m_global->CurrentWarehouseFile().length() == 0 && m_WarehouseList.size() > 0) m_global->setCurrentWarehouseFile(m_WarehouseList.begin()->first);
 
@@ -221,14 +399,14 @@ std::string *Simulation::LoadModel(const char *buffer, size_t length) // note th
         m_OutputModelStateAtCycle = -1;
     }
 #endif
-
-    return nullptr;
 }
 
-
 //----------------------------------------------------------------------------
 void Simulation::UpdateSimulation()
 {
+    // ODE messages go to the error handler of the simulation that is stepping on this thread
+    ErrorHandler::setThreadErrorHandler(&m_errorHandler);
+
     // calculate the warehouse and position matching fitnesses before we move to a new location
     while (true)
     {
@@ -239,7 +417,7 @@ void Simulation::UpdateSimulation()
             if (warehouseIter != m_WarehouseList.end())
             {
                 WarehouseUnit *warehouseUnit = warehouseIter->second->GetWarehouseUnit(0); // only interested in the warehouse unit 0 for this measurement
-                warehouseUnit->SetBodyQueryData(m_BodyList);
+                warehouseUnit->SetBodyQueryData();
                 warehouseUnit->DoSearch();
                 m_WarehouseDistance = warehouseUnit->GetNearestNeighbourDistance();
 #ifdef TOTAL_DISTANCE_WAREHOUSE_METRIC // this version calculates a total distance from warehouse metric
@@ -285,26 +463,20 @@ void Simulation::UpdateSimulation()
     m_ContactList.clear();
     for (auto &&geomIter : m_GeomList) geomIter.second->ClearContacts();
     dSpaceCollide(m_SpaceID, this, &NearCallback);
+    // the model sub-space is only tested against itself if internal collisions are wanted
+    if (m_ModelSpaceID && m_global->AllowInternalCollisions()) dSpaceCollide(m_ModelSpaceID, this, &NearCallback);
 
 #ifdef EXPERIMENTAL
     auto warehouseIter = m_WarehouseList.find(m_global->CurrentWarehouseFile());
     if (warehouseIter != m_WarehouseList.end() && m_global->fitnessType() != Global::ClosestWarehouse)
     {
-        warehouseIter->second->DoSearch(m_BodyList);
+        warehouseIter->second->DoSearch();
         m_WarehouseDistance = warehouseIter->second->GetNearestNeighbourDistance();
-        std::vector<std::string> *driverNames = warehouseIter->second->GetDriverNames();
+        std::vector<FixedDriver *> *drivers = warehouseIter->second->GetDrivers(); // these are resolved in ResolveWarehouseReferences
         double *activations = warehouseIter->second->GetCurrentActivations();
-        for (unsigned int iDriver = 0; iDriver < driverNames->size(); iDriver++)
+        for (size_t iDriver = 0; iDriver < drivers->size(); iDriver++)
         {
-            FixedDriver *driver = dynamic_cast<FixedDriver *>(m_DriverList[driverNames->at(iDriver)].get());
-            if (driver)
-            {
-                driver->setValue(activations[iDriver]);
-            }
-            else
-            {
-                std::cerr << "Only FixedDriver currently supported as warehouse targets\n";
-            }
+            if ((*drivers)[iDriver]) (*drivers)[iDriver]->setValue(activations[iDriver]);
         }
         std::cerr << m_SimulationTime << " m_WarehouseDistance=" << m_WarehouseDistance << "\n";
     }
@@ -1386,6 +1558,13 @@ void Simulation::SetOutputModelStateFile(const std::string &filename)
     m_OutputModelStateFile = filename;
 }
 
+void Simulation::SetOutputDumpFile(const std::string &filename)
+{
+    if (m_dumpFile) m_dumpFile->Close();
+    m_dumpFileIndices.clear();
+    m_dumpFilename = filename;
+}
+
 void Simulation::SetOutputWarehouseFile(const std::string &filename)
 {
     if (filename.size() > 0)
@@ -1428,8 +1607,27 @@ void Simulation::AddWarehouse(const std::string &filename)
     int err = warehouseUnit->ImportWarehouseUnit(filename.c_str(), false);
     if (err) { return; }
     warehouse->setName(filename);
-    m_global->setCurrentWarehouseFile(filename);
+    if (m_global) m_global->setCurrentWarehouseFile(filename); // otherwise it is set in LateInitialisation
     m_WarehouseList[filename] = std::move(warehouse);
+    if (m_BodyList.size()) ResolveWarehouseReferences(); // otherwise it happens in LateInitialisation
+#endif
+}
+
+// the warehouses store pointers to the bodies and drivers so this needs calling whenever these might change
+// warehouses with missing bodies are removed since they cannot be searched
+void Simulation::ResolveWarehouseReferences()
+{
+#ifdef EXPERIMENTAL
+    for (auto it = m_WarehouseList.begin(); it != m_WarehouseList.end(); /* no increment */)
+    {
+        std::string *lastError = it->second->ResolveReferences(m_BodyList, m_DriverList);
+        if (lastError)
+        {
+            std::cerr << "Error: " << *lastError << "\n";
+            it = m_WarehouseList.erase(it);
+        }
+        else it++;
+    }
 #endif
 }
 
@@ -1446,25 +1644,108 @@ bool Simulation::ShouldQuit()
 
 void Simulation::NearCallback(void *data, dGeomID o1, dGeomID o2)
 {
+    // this happens when one or both of the objects are sub-spaces
+    if (dGeomIsSpace(o1) || dGeomIsSpace(o2))
+    {
+        dSpaceCollide2(o1, o2, data, &NearCallback);
+        return;
+    }
+
     Simulation *s = reinterpret_cast<Simulation *>(data);
     Geom *g1 = reinterpret_cast<Geom *>(dGeomGetData(o1));
     Geom *g2 = reinterpret_cast<Geom *>(dGeomGetData(o2));
 
     dBodyID b1 = dGeomGetBody(o1);
     dBodyID b2 = dGeomGetBody(o2);
+
+    // use the cached values if possible (geoms added after the table was built or on bodies with adhesion will have a negative index)
+    const ContactPair *contactPair = nullptr;
+    int index1 = g1->contactPairIndex();
+    int index2 = g2->contactPairIndex();
+    if (index1 >= 0 && index2 >= 0)
+    {
+        if (index1 < index2) std::swap(index1, index2);
+        uint64_t key = (uint64_t(index1) << 32) | uint64_t(index2);
+        auto found = s->m_ContactPairMap.find(key);
+        if (found == s->m_ContactPairMap.end()) found = s->m_ContactPairMap.emplace(key, s->MakeContactPair(g1, g2)).first;
+        if (found->second.type == excludedPair) return;
+        if (found->second.type == cachedPair) contactPair = &found->second;
+    }
+    if (!contactPair)
+    {
+        if (s->ContactPairExcluded(g1, g2)) return;
+    }
+
+    // the scratch buffer is reused for every pair and only the geom part is filled in by dCollide
+    if (s->m_ContactBuffer.size() != size_t(s->m_MaxContacts)) s->m_ContactBuffer.resize(size_t(s->m_MaxContacts), dContact{});
+    dContact *contact = s->m_ContactBuffer.data();
+    int numc = dCollide(o1, o2, s->m_MaxContacts, &contact[0].geom, sizeof(dContact));
+    if (numc)
+    {
+        // the surface parameters are the same for all the contacts so only work them out for pairs that actually touch
+        dSurfaceParameters surface;
+        if (contactPair) surface = contactPair->surface;
+        else ContactPairSurface(g1, g2, &surface);
+        for (size_t i = 0; i < size_t(numc); i++)
+        {
+            if (g1->GetAbort()) s->SetContactAbort(g1->name());
+            if (g2->GetAbort()) s->SetContactAbort(g2->name());
+            contact[i].surface = surface;
+            dJointID c;
+            if (g1->GetAdhesion() == false && g2->GetAdhesion() == false)
+            {
+                c = dJointCreateContact(s->m_WorldID, s->m_ContactGroup, &contact[i]);
+                dJointAttach(c, b1, b2);
+                // reuse a Contact from the pool if there is one available
+                if (s->m_ContactList.size() == s->m_ContactPool.size())
+                {
+                    s->m_ContactPool.push_back(std::make_unique<Contact>());
+                    s->m_ContactPool.back()->setSimulation(s);
+                }
+                Contact *myContact = s->m_ContactPool[s->m_ContactList.size()].get();
+                dJointSetFeedback(c, myContact->GetJointFeedback());
+                myContact->SetJointID(c);
+                std::copy_n(contact[i].geom.pos, dV3E__MAX, myContact->GetContactPosition());
+//                // only add the contact information once
+//                // and add it to the non-environment geom
+//                if (g1->GetGeomLocation() == Geom::environment)
+//                    g2->AddContact(myContact.get());
+//                else
+//                    g1->AddContact(myContact.get());
+                // add the contact information to both geoms
+                g1->AddContact(myContact);
+                g2->AddContact(myContact);
+                s->m_ContactList.push_back(myContact);
+            }
+            else
+            {
+                // FIX ME adhesive joints are added permanently and forces cannot be measured
+                c = dJointCreateBall(s->m_WorldID, nullptr);
+                dJointAttach(c, b1, b2);
+                dJointSetBallAnchor(c, contact[i].geom.pos[0], contact[i].geom.pos[1], contact[i].geom.pos[2]);
+            }
+        }
+    }
+}
+
+// returns true if the pair of geoms should never generate contacts
+bool Simulation::ContactPairExcluded(Geom *g1, Geom *g2)
+{
+    dBodyID b1 = dGeomGetBody(g1->GetGeomID());
+    dBodyID b2 = dGeomGetBody(g2->GetGeomID());
     if (b1 == b2)
     {
-        return; // it is never useful for two contacts on the same body to collide [I'm not sure if this every happens - FIX ME - set up a test]
+        return true; // it is never useful for two contacts on the same body to collide [I'm not sure if this every happens - FIX ME - set up a test]
     }
 
-    if (s->m_global->AllowConnectedCollisions() == false)
+    if (m_global->AllowConnectedCollisions() == false)
     {
-        if (b1 && b2 && dAreConnectedExcluding(b1, b2, dJointTypeContact)) return;
+        if (b1 && b2 && dAreConnectedExcluding(b1, b2, dJointTypeContact)) return true;
     }
 
-    if (s->m_global->AllowInternalCollisions() == false)
+    if (m_global->AllowInternalCollisions() == false)
     {
-        if (g1->GetGeomLocation() == g2->GetGeomLocation()) return;
+        if (g1->GetGeomLocation() == g2->GetGeomLocation()) return true;
     }
 
     if (g1->GetExcludeList()->size())
@@ -1472,7 +1753,7 @@ void Simulation::NearCallback(void *data, dGeomID o1, dGeomID o2)
         std::vector<Geom *> *excludeList = g1->GetExcludeList();
         for (size_t i = 0; i < excludeList->size(); i++)
         {
-            if (excludeList->at(i) == g2) return;
+            if (excludeList->at(i) == g2) return true;
         }
     }
     if (g2->GetExcludeList()->size())
@@ -1480,12 +1761,16 @@ void Simulation::NearCallback(void *data, dGeomID o1, dGeomID o2)
         std::vector<Geom *> *excludeList = g2->GetExcludeList();
         for (size_t i = 0; i < excludeList->size(); i++)
         {
-            if (excludeList->at(i) == g1) return;
+            if (excludeList->at(i) == g1) return true;
         }
     }
+    return false;
+}
 
-    std::vector<dContact> contact(size_t(s->m_MaxContacts), dContact{}); // in this case default initialisation is potentially useful
-    // std::unique_ptr<dContact[]> contact = std::make_unique<dContact[]>(size_t(s->m_MaxContacts)); // but this version would be slightly quicker
+// combines the surface values of the two geoms into the values used for their contacts
+void Simulation::ContactPairSurface(Geom *g1, Geom *g2, dSurfaceParameters *surface)
+{
+    *surface = {};
     // the choice of std::max(cfm) and std::min(erp) means that the softest contact should be used
     double cfm = std::max(g1->GetContactSoftCFM(), g2->GetContactSoftCFM());
     double erp = std::min(g1->GetContactSoftERP(), g2->GetContactSoftERP());
@@ -1498,68 +1783,144 @@ void Simulation::NearCallback(void *data, dGeomID o1, dGeomID o2)
         if (g1->GetContactSoftERP() < 0) erp = g2->GetContactSoftERP();
         else erp = g1->GetContactSoftERP();
     }
-    for (size_t i = 0; i < size_t(s->m_MaxContacts); i++)
+    surface->mode = dContactApprox1;
+    surface->mu = mu;
+    if (bounce >= 0)
     {
-        contact[i].surface.mode = dContactApprox1;
-        contact[i].surface.mu = mu;
-        if (bounce >= 0)
-        {
-            contact[i].surface.bounce = bounce;
-            contact[i].surface.mode += dContactBounce;
-        }
-        if (rho >= 0)
+        surface->bounce = bounce;
+        surface->mode += dContactBounce;
+    }
+    if (rho >= 0)
+    {
+        surface->rho = rho;
+        surface->mode += dContactRolling;
+    }
+    if (cfm >= 0)
+    {
+        surface->soft_cfm = cfm;
+        surface->mode += dContactSoftCFM;
+    }
+    if (erp >= 0)
+    {
+        surface->soft_erp = erp;
+        surface->mode += dContactSoftERP;
+    }
+}
+
+// the exclusion decisions and surface parameters only change when the model is edited so they are worked out once for every pair of geoms
+// the ODE category and collide bits are also set so that pairs excluded by location never reach NearCallback
+// the model and environment geoms go into separate sub-spaces so the broadphase never generates
+// pairs within the model unless internal collisions are allowed, and never generates environment pairs
+void Simulation::BuildCollisionSpaces()
+{
+    // collect the geoms in their current space order because this is the order that collisions are tested
+    std::vector<dGeomID> geomIDs;
+    std::vector<dSpaceID> spaces = {m_SpaceID};
+    for (size_t i = 0; i < spaces.size(); i++)
+    {
+        int numGeoms = dSpaceGetNumGeoms(spaces[i]);
+        for (int j = 0; j < numGeoms; j++)
         {
-            contact[i].surface.rho = rho;
-            contact[i].surface.mode += dContactRolling;
+            dGeomID geomID = dSpaceGetGeom(spaces[i], j);
+            if (dGeomIsSpace(geomID)) spaces.push_back(dSpaceID(geomID));
+            else geomIDs.push_back(geomID);
         }
-        if (cfm >= 0)
+    }
+
+    dSpaceID spaceID = CreateSpace(nullptr);
+    dSpaceID modelSpaceID = CreateSpace(spaceID);
+    dSpaceID environmentSpaceID = CreateSpace(spaceID);
+    // geoms are added to the front of a space so add them in reverse to keep the order
+    for (auto it = geomIDs.rbegin(); it != geomIDs.rend(); it++)
+    {
+        dGeomID geomID = *it;
+        Geom *geom = reinterpret_cast<Geom *>(dGeomGetData(geomID));
+        dSpaceRemove(dGeomGetSpace(geomID), geomID);
+        dSpaceAdd(geom->GetGeomLocation() == Geom::environment ? environmentSpaceID : modelSpaceID, geomID);
+    }
+
+    // the old spaces are now empty and destroying the top level space destroys any sub-spaces
+    dSpaceDestroy(m_SpaceID);
+    m_SpaceID = spaceID;
+    m_ModelSpaceID = modelSpaceID;
+    m_EnvironmentSpaceID = environmentSpaceID;
+}
+
+dSpaceID Simulation::CreateSpace(dSpaceID parent)
+{
+    dSpaceID spaceID = nullptr;
+    switch (m_global->spaceType())
+    {
+    case Global::Simple:
+        spaceID = dSimpleSpaceCreate(parent);
+        break;
+    case Global::Hash:
+        spaceID = dHashSpaceCreate(parent);
+        dHashSpaceSetLevels(spaceID, m_global->SpaceHashMinLevel(), m_global->SpaceHashMaxLevel());
+        break;
+    case Global::QuadTree:
         {
-            contact[i].surface.soft_cfm = cfm;
-            contact[i].surface.mode += dContactSoftCFM;
+            pgd::Vector3 center = m_global->SpaceQuadTreeCenter();
+            pgd::Vector3 extents = m_global->SpaceQuadTreeExtents();
+            dVector3 odeCenter = {center.x, center.y, center.z, 0};
+            dVector3 odeExtents = {extents.x, extents.y, extents.z, 0};
+            spaceID = dQuadTreeSpaceCreate(parent, odeCenter, odeExtents, m_global->SpaceQuadTreeDepth());
+            break;
         }
-        if (erp >= 0)
+    case Global::SweepAndPrune:
         {
-            contact[i].surface.soft_erp = erp;
-            contact[i].surface.mode += dContactSoftERP;
+            const int axisOrders[] = {dSAP_AXES_XYZ, dSAP_AXES_XZY, dSAP_AXES_YXZ, dSAP_AXES_YZX, dSAP_AXES_ZXY, dSAP_AXES_ZYX};
+            spaceID = dSweepAndPruneSpaceCreate(parent, axisOrders[m_global->SpaceSweepAndPruneAxes()]);
+            break;
         }
     }
-    int numc = dCollide(o1, o2, s->m_MaxContacts, &contact[0].geom, sizeof(dContact));
-    if (numc)
+    return spaceID;
+}
+
+void Simulation::BuildContactPairTable()
+{
+    // adhesion creates ball joints between bodies during the simulation so any pair involving one of these bodies
+    // can change from unconnected to connected and is given a negative index so that it is never cached
+    std::set<dBodyID> adhesiveBodies;
+    for (auto &&it : m_GeomList)
     {
-        for (size_t i = 0; i < size_t(numc); i++)
+        dBodyID body = dGeomGetBody(it.second->GetGeomID());
+        if (body && it.second->GetAdhesion()) adhesiveBodies.insert(body);
+    }
+    int contactPairIndex = 0;
+    for (auto &&it : m_GeomList)
+    {
+        if (adhesiveBodies.count(dGeomGetBody(it.second->GetGeomID()))) it.second->setContactPairIndex(-1);
+        else it.second->setContactPairIndex(contactPairIndex++);
+        // environment geoms never collide with each other because they both have a null body
+        if (it.second->GetGeomLocation() == Geom::environment)
         {
-            if (g1->GetAbort()) s->SetContactAbort(g1->name());
-            if (g2->GetAbort()) s->SetContactAbort(g2->name());
-            dJointID c;
-            if (g1->GetAdhesion() == false && g2->GetAdhesion() == false)
-            {
-                c = dJointCreateContact(s->m_WorldID, s->m_ContactGroup, &contact[i]);
-                dJointAttach(c, b1, b2);
-                std::unique_ptr<Contact> myContact = std::make_unique<Contact>();
-                myContact->setSimulation(s);
-                dJointSetFeedback(c, myContact->GetJointFeedback());
-                myContact->SetJointID(c);
-                std::copy_n(contact[i].geom.pos, dV3E__MAX, myContact->GetContactPosition());
-//                // only add the contact information once
-//                // and add it to the non-environment geom
-//                if (g1->GetGeomLocation() == Geom::environment)
-//                    g2->AddContact(myContact.get());
-//                else
-//                    g1->AddContact(myContact.get());
-                // add the contact information to both geoms
-                g1->AddContact(myContact.get());
-                g2->AddContact(myContact.get());
-                s->m_ContactList.push_back(std::move(myContact));
-            }
-            else
-            {
-                // FIX ME adhesive joints are added permanently and forces cannot be measured
-                c = dJointCreateBall(s->m_WorldID, nullptr);
-                dJointAttach(c, b1, b2);
-                dJointSetBallAnchor(c, contact[i].geom.pos[0], contact[i].geom.pos[1], contact[i].geom.pos[2]);
-            }
+            dGeomSetCategoryBits(it.second->GetGeomID(), 1);
+            dGeomSetCollideBits(it.second->GetGeomID(), 2);
         }
+        else
+        {
+            dGeomSetCategoryBits(it.second->GetGeomID(), 2);
+            dGeomSetCollideBits(it.second->GetGeomID(), m_global->AllowInternalCollisions() ? 3 : 1);
+        }
+    }
+
+    // the pairs are filled in by NearCallback as they are encountered
+    m_ContactPairMap.clear();
+}
+
+Simulation::ContactPair Simulation::MakeContactPair(Geom *g1, Geom *g2)
+{
+    ContactPair contactPair = {};
+    // adhesive geoms on bodies are never cached (see BuildContactPairTable) but environment ones get here
+    if (g1->GetAdhesion() || g2->GetAdhesion()) contactPair.type = uncachedPair;
+    else if (ContactPairExcluded(g1, g2)) contactPair.type = excludedPair;
+    else
+    {
+        contactPair.type = cachedPair;
+        ContactPairSurface(g1, g2, &contactPair.surface);
     }
+    return contactPair;
 }
 
 Body *Simulation::GetBody(const std::string &name)
@@ -1684,8 +2045,32 @@ void Simulation::DumpObjects()
 
 void Simulation::DumpObject(NamedObject *namedObject)
 {
-    if (namedObject->dump())
+    if (namedObject->dump() && DumpRequired(namedObject))
     {
+        // the binary dump avoids all the text formatting so use it if possible
+        if (m_dumpFilename.size())
+        {
+            if (namedObject->firstDump() && namedObject->dumpLayout(&m_dumpColumnNames, &m_dumpColumnText))
+            {
+                if (!m_dumpFile) m_dumpFile = std::make_unique<DumpFile>();
+                if (!m_dumpFile->isOpen())
+                {
+                    std::string *errorMessage = m_dumpFile->Open(m_dumpFilename);
+                    if (errorMessage) std::cerr << *errorMessage << "\n";
+                }
+                uint32_t index = uint32_t(m_dumpFileIndices.size());
+                m_dumpFileIndices[namedObject] = index;
+                m_dumpFile->WriteLayout(index, namedObject->name(), m_dumpColumnNames, m_dumpColumnText);
+                namedObject->setFirstDump(false);
+            }
+            auto indexIt = m_dumpFileIndices.find(namedObject);
+            if (indexIt != m_dumpFileIndices.end())
+            {
+                namedObject->dumpToValues(&m_dumpValues);
+                m_dumpFile->WriteValues(indexIt->second, m_dumpValues);
+                return;
+            }
+        }
         if (namedObject->firstDump())
         {
             std::ofstream output;
@@ -1716,6 +2101,36 @@ void Simulation::DumpObject(NamedObject *namedObject)
     }
 }
 
+// the GLOBAL dump controls apply to all objects and the object controls can restrict them further
+bool Simulation::DumpRequired(NamedObject *namedObject)
+{
+    int dumpInterval = namedObject->dumpInterval() ? namedObject->dumpInterval() : m_global->dumpInterval();
+    if (dumpInterval > 1 && m_StepCount % dumpInterval != 0) return false;
+    if (m_SimulationTime < m_global->dumpStartTime() || m_SimulationTime < namedObject->dumpStartTime()) return false;
+    if (m_SimulationTime > m_global->dumpEndTime() || m_SimulationTime > namedObject->dumpEndTime()) return false;
+    std::string dumpTrigger = namedObject->dumpTrigger();
+    if (dumpTrigger.empty()) dumpTrigger = m_global->dumpTrigger();
+    return DumpTriggered(dumpTrigger);
+}
+
+bool Simulation::DumpTriggerValid(const std::string &trigger) const
+{
+    if (trigger.empty() || trigger == "ContactAbort"s || trigger == "DataTargetAbort"s) return true;
+    return m_GeomList.count(trigger) || m_DataTargetList.count(trigger);
+}
+
+// a trigger can be ContactAbort, DataTargetAbort, the ID of a DataTarget that has crossed its abort threshold
+// or the ID of a Geom that currently has contacts
+bool Simulation::DumpTriggered(const std::string &trigger)
+{
+    if (trigger.empty()) return true;
+    if (trigger == "ContactAbort"s) return m_ContactAbort;
+    if (trigger == "DataTargetAbort"s) return m_DataTargetAbort;
+    auto geomIt = m_GeomList.find(trigger);
+    if (geomIt != m_GeomList.end()) return geomIt->second->GetContactList()->size() > 0;
+    return std::find(m_DataTargetAbortList.begin(), m_DataTargetAbortList.end(), trigger) != m_DataTargetAbortList.end();
+}
+
 std::vector<std::string> Simulation::GetNameList() const
 {
     std::vector<std::string> output;
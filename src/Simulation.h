@@ -43,6 +43,7 @@ class Warehouse;
 class SimulationWindow;
 class MainWindow;
 class Drivable;
+class DumpFile;
 
 class Simulation : NamedObject
 {
@@ -57,6 +58,8 @@ public:
     static void NearCallback(void *data, dGeomID o1, dGeomID o2);
 
     std::string *LoadModel(const char *buffer, size_t length);  // load parameters from the XML configuration file
+    std::string *LoadModel(const std::vector<std::unique_ptr<ParseXML::XMLElement>> &elementList);  // load parameters from a pre-parsed XML configuration
+    std::string *Reset(const std::vector<std::unique_ptr<ParseXML::XMLElement>> *elementList = nullptr);  // return to the state immediately after LoadModel optionally with new values
     void UpdateSimulation(void);     // called at each iteration through simulation
 
     // get hold of various variables
@@ -94,8 +97,15 @@ public:
     void SetOutputModelStateFile(const std::string &filename);
     void SetOutputWarehouseFile(const std::string &filename);
     void SetWarehouseFailDistanceAbort(double warehouseFailDistanceAbort);
+    void SetOutputDumpFile(const std::string &filename); // objects that support it are dumped to a single binary file rather than individual text files
+    bool DumpTriggerValid(const std::string &trigger) const; // true if the trigger is empty, one of the abort conditions or an existing GEOM or DATATARGET ID
 
     void AddWarehouse(const std::string &filename);
+    void ResolveWarehouseReferences(); // the warehouses cache body and driver pointers so this is needed if they are recreated
+
+    // the per geom pair collision cache is emptied and the geoms numbered in LateInitialisation but this needs redoing if the geoms are edited
+    void BuildContactPairTable();
+    void BuildCollisionSpaces(); // recreates the collision spaces using the GLOBAL settings and sorts the geoms into them
 
     // get hold of the internal lists (HANDLE WITH CARE)
     std::map<std::string, std::unique_ptr<Body>> *GetBodyList() { return &m_BodyList; }
@@ -110,7 +120,7 @@ public:
     std::map<std::string, std::unique_ptr<Reporter>> *GetReporterList() { return &m_ReporterList; }
     std::map<std::string, std::unique_ptr<Controller>> *GetControllerList() { return &m_ControllerList; }
     std::map<std::string, std::unique_ptr<Warehouse>> *GetWarehouseList() { return &m_WarehouseList; }
-    std::vector<std::unique_ptr<Contact>> *GetContactList() { return &m_ContactList; }
+    std::vector<Contact *> *GetContactList() { return &m_ContactList; }
 
     std::vector<std::string> GetNameList() const;
     std::set<std::string> GetNameSet() const;
@@ -150,12 +160,34 @@ private:
     std::string *ParseReporter(const ParseXML::XMLElement *node);
     std::string *ParseController(const ParseXML::XMLElement *node);
     std::string *ParseWarehouse(const ParseXML::XMLElement *node);
+    void ParseElement(const ParseXML::XMLElement *node);
+    void LateInitialisation();
+
+    dSpaceID CreateSpace(dSpaceID parent);
+
+    bool ContactPairExcluded(Geom *g1, Geom *g2);
+    static void ContactPairSurface(Geom *g1, Geom *g2, dSurfaceParameters *surface);
+
+    enum ContactPairType { cachedPair, excludedPair, uncachedPair };
+    struct ContactPair
+    {
+        ContactPairType type;
+        dSurfaceParameters surface; // only valid for cachedPair
+    };
+    ContactPair MakeContactPair(Geom *g1, Geom *g2);
 
     void DumpObjects();
     void DumpObject(NamedObject *namedObject);
+    bool DumpRequired(NamedObject *namedObject);
+    bool DumpTriggered(const std::string &trigger);
 
     ParseXML m_parseXML;
 
+    // a copy of the loaded elements and the order they were parsed which is needed for Reset
+    std::vector<ParseXML::XMLElement> m_resetElementList;
+    std::vector<size_t> m_resetElementOrder;
+    unsigned long m_resetRandomSeed = 0;
+
    // these are the internal lists that are all owners of their respective objects
     std::map<std::string, std::unique_ptr<Body>> m_BodyList;
     std::map<std::string, std::unique_ptr<Joint>> m_JointList;
@@ -171,11 +203,21 @@ private:
     std::map<std::string, std::unique_ptr<Warehouse>> m_WarehouseList;
 
     // this is a list of contacts that are active at the current time step
-    std::vector<std::unique_ptr<Contact>> m_ContactList;
+    // the contacts are owned by m_ContactPool which is only ever grown so that the Contact objects are reused every step
+    std::vector<Contact *> m_ContactList;
+    std::vector<std::unique_ptr<Contact>> m_ContactPool;
+    std::vector<dContact> m_ContactBuffer; // scratch space for dCollide
+
+    // the collision information for a geom pair is worked out the first time the broadphase reports the pair
+    // so only pairs that come close enough to touch are stored
+    // the key is the larger geom contactPairIndex in the high 32 bits and the smaller one in the low 32 bits
+    std::unordered_map<uint64_t, ContactPair> m_ContactPairMap;
 
     // Simulation variables
     dWorldID m_WorldID;
     dSpaceID m_SpaceID;
+    dSpaceID m_ModelSpaceID = nullptr; // sub-space of m_SpaceID containing the geoms attached to bodies
+    dSpaceID m_EnvironmentSpaceID = nullptr; // sub-space of m_SpaceID containing the geoms attached to the world
     dJointGroupID m_ContactGroup;
     int m_MaxContacts = 64;
     std::unique_ptr<Global> m_global;
@@ -232,6 +274,12 @@ private:
     // values for dump output
     std::string m_dumpExtension = {".tab"};
     std::map<std::string, std::ofstream> m_dumpFileStreams;
+    std::string m_dumpFilename;
+    std::unique_ptr<DumpFile> m_dumpFile;
+    std::unordered_map<NamedObject *, uint32_t> m_dumpFileIndices;
+    std::vector<std::string> m_dumpColumnNames;
+    std::vector<std::string> m_dumpColumnText;
+    std::vector<double> m_dumpValues;
     ErrorHandler m_errorHandler;
 
 };
@@ -254,6 +254,45 @@ std::string Strap::dumpToString()
     return ss.str();
 }
 
+// the body and marker names do not change so they are stored in the layout
+bool Strap::dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText)
+{
+    *columnNames = {"Time"s, "Length"s};
+    columnText->assign(columnNames->size(), ""s);
+    for (auto &&it : m_pointForceList)
+    {
+        columnNames->insert(columnNames->end(), {"Body"s, "XP"s, "YP"s, "ZP"s, "FX"s, "FY"s, "FZ"s});
+        columnText->push_back(it->body->name());
+        columnText->resize(columnNames->size());
+    }
+    for (auto &&it : m_torqueMarkerList)
+    {
+        columnNames->insert(columnNames->end(), {"Marker"s, "WTX"s, "WTY"s, "WTZ"s, "MTX"s, "MTY"s, "MTZ"s, "WMAX"s, "WMAY"s, "WMAZ"s, "MMAX"s, "MMAY"s, "MMAZ"s});
+        columnText->push_back(it->name());
+        columnText->resize(columnNames->size());
+    }
+    return true;
+}
+
+void Strap::dumpToValues(std::vector<double> *values)
+{
+    values->clear();
+    values->push_back(simulation()->GetTime());
+    values->push_back(GetLength());
+    for (auto &&it: m_pointForceList)
+    {
+        values->insert(values->end(), {it->point[0], it->point[1], it->point[2],
+                                       it->vector[0] * m_tension, it->vector[1] * m_tension, it->vector[2] * m_tension});
+    }
+    pgd::Vector3 worldTorque,markerTorque, worldMomentArm, markerMomentArm;
+    for (auto &&it: m_torqueMarkerList)
+    {
+        GetTorque(*it, &worldTorque, &markerTorque, &worldMomentArm, &markerMomentArm);
+        values->insert(values->end(), {worldTorque.x, worldTorque.y, worldTorque.z, markerTorque.x, markerTorque.y, markerTorque.z,
+                                       worldMomentArm.x, worldMomentArm.y, worldMomentArm.z, markerMomentArm.x, markerMomentArm.y, markerMomentArm.z});
+    }
+}
+
 
 
 
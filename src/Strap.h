@@ -47,6 +47,8 @@ public:
 //    virtual int SanityCheck(Strap *otherStrap, Simulation::AxisType axis, const std::string &sanityCheckLeft, const std::string &sanityCheckRight) = 0;
 
     virtual std::string dumpToString();
+    virtual bool dumpLayout(std::vector<std::string> *columnNames, std::vector<std::string> *columnText);
+    virtual void dumpToValues(std::vector<double> *values);
 
     virtual std::string *createFromAttributes();
     virtual void saveToAttributes();
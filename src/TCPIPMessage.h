@@ -24,4 +24,26 @@ struct TCPIPMessage
     double score;
 };
 
+// the batch messages carry several genomes that share the same md5
+// a "reqbatch" request sets batchSize to the maximum number of genomes wanted
+// a "batch" reply is followed by batchSize TCPIPBatchRecord each followed by genomeLength doubles
+// a "results" message is followed by batchSize TCPIPBatchRecord containing the scores
+// a "reqcaps" request gets a "caps" reply whose batchSize is the largest batch the server sends or 0 if it does not understand "reqbatch"
+struct TCPIPBatchMessage
+{
+    char text[16];
+    uint32_t genomeLength;
+    uint32_t batchSize;
+    uint32_t senderIP;
+    uint32_t senderPort;
+    uint32_t md5[4];
+};
+
+struct TCPIPBatchRecord
+{
+    uint32_t runID;
+    uint32_t padding;
+    double score;
+};
+
 #endif
@@ -15,6 +15,7 @@
 #include "Body.h"
 #include "PGDMath.h"
 #include "Simulation.h"
+#include "FixedDriver.h"
 #include "PCA.h"
 
 #include "ANN/ANN.h"
@@ -24,6 +25,7 @@
 #include <string>
 #include <algorithm>
 #include <sstream>
+#include <fstream>
 
 using namespace std::string_literals;
 
@@ -66,6 +68,18 @@ WarehouseUnit::~WarehouseUnit()
 // read the warehouse data file and create the ANN structures
 int WarehouseUnit::ImportWarehouseUnit(const char *filename, bool appendFlag)
 {
+    // binary files start with a zero uint32_t which cannot occur at the start of a text file
+    {
+#if (defined(_WIN32) || defined(WIN32)) && !defined(__MINGW32__)
+        std::ifstream binaryFile(DataFile::ConvertUTF8ToWide(filename), std::ios::binary);
+#else
+        std::ifstream binaryFile(filename, std::ios::binary);
+#endif
+        uint32_t formatID = 1;
+        binaryFile.read(reinterpret_cast<char *>(&formatID), sizeof(formatID));
+        if (binaryFile && formatID == 0) return ImportBinaryWarehouseUnit(binaryFile, appendFlag);
+    }
+
     DataFile file;
     if (file.ReadFile(filename)) return __LINE__;
     char *fileData = file.GetRawData();
@@ -149,6 +163,95 @@ int WarehouseUnit::ImportWarehouseUnit(char *fileData, int fileDataLen, bool app
     return 0;
 }
 
+// read a binary warehouse file as written by Simulation::OutputWarehouse
+// the stream should be positioned after the leading uint32_t 0
+// the rest of the header is
+// uint32_t numDrivers then size_t nameLength, char name[nameLength] for each driver
+// uint32_t numBodies then size_t nameLength, char name[nameLength] for each body
+// followed by contiguous rows of doubles: time, numDrivers activations, 13 values per body
+int WarehouseUnit::ImportBinaryWarehouseUnit(std::istream &file, bool appendFlag)
+{
+    std::streamoff position = file.tellg();
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = uint64_t(file.tellg());
+    file.seekg(position);
+
+    auto readNames = [&file, fileSize](std::vector<std::string> *names) -> bool
+    {
+        uint32_t numNames = 0;
+        if (!file.read(reinterpret_cast<char *>(&numNames), sizeof(numNames))) return false;
+        names->clear();
+        for (uint32_t i = 0; i < numNames; i++)
+        {
+            size_t nameLength = 0;
+            if (!file.read(reinterpret_cast<char *>(&nameLength), sizeof(nameLength))) return false;
+            if (nameLength > fileSize) return false;
+            std::string name(nameLength, ' ');
+            if (!file.read(&name[0], std::streamsize(nameLength))) return false;
+            names->push_back(name);
+        }
+        return true;
+    };
+    std::vector<std::string> driverNames, bodyNames;
+    if (!readNames(&driverNames) || !readNames(&bodyNames)) return __LINE__;
+
+    int numDrivers = int(driverNames.size());
+    int numBodies = int(bodyNames.size());
+    int numValuesPerBody = 13; // hardwired for import
+    int nDim = numBodies * numValuesPerBody;
+    size_t lineLength = size_t(1 + numDrivers + nDim);
+    uint64_t dataSize = fileSize - uint64_t(file.tellg());
+    if (dataSize % (lineLength * sizeof(double))) return __LINE__;
+    int nPts = int(dataSize / (lineLength * sizeof(double)));
+    if (appendFlag && (numDrivers != m_numDrivers || numBodies != m_numBodies)) return __LINE__;
+
+    int oldPts = appendFlag ? m_nPts : 0;
+    std::unique_ptr<double []> activations = std::make_unique<double []>(size_t(oldPts + nPts) * size_t(numDrivers));
+    std::unique_ptr<double []> bodyData = std::make_unique<double []>(size_t(oldPts + nPts) * size_t(nDim));
+    if (oldPts)
+    {
+        std::copy_n(m_activations, size_t(oldPts) * size_t(numDrivers), activations.get());
+        std::copy_n(m_bodyData, size_t(oldPts) * size_t(nDim), bodyData.get());
+    }
+
+    // the rows interleave the time, activations and body data so they are read in large blocks and split up
+    const size_t rowsPerBlock = 4096;
+    std::vector<double> block(std::min(size_t(nPts), rowsPerBlock) * lineLength);
+    for (size_t row = 0; row < size_t(nPts); row += rowsPerBlock)
+    {
+        size_t numRows = std::min(rowsPerBlock, size_t(nPts) - row);
+        if (!file.read(reinterpret_cast<char *>(block.data()), std::streamsize(numRows * lineLength * sizeof(double)))) return __LINE__;
+        for (size_t i = 0; i < numRows; i++)
+        {
+            const double *line = block.data() + i * lineLength;
+            size_t index = size_t(oldPts) + row + i;
+            std::copy_n(line + 1, numDrivers, activations.get() + index * size_t(numDrivers));
+            std::copy_n(line + 1 + numDrivers, nDim, bodyData.get() + index * size_t(nDim));
+        }
+    }
+
+    if (appendFlag == false)
+    {
+        m_numDrivers = numDrivers;
+        m_numBodies = numBodies;
+        m_numValuesPerBody = numValuesPerBody;
+        m_nDim = nDim;
+        m_driverNames = driverNames;
+        m_bodyNames = bodyNames;
+        if (m_weights) delete [] m_weights;
+        m_weights = new double[m_nDim];
+        std::fill_n(m_weights, m_nDim, 1.0);
+    }
+    m_nPts = oldPts + nPts;
+    if (m_activations) delete [] m_activations;
+    m_activations = activations.release();
+    if (m_bodyData) delete [] m_bodyData;
+    m_bodyData = bodyData.release();
+
+    InitaliseWarehouse();
+    return 0;
+}
+
 void WarehouseUnit::SetDriverIDs(const char *nameList)
 {
     int len = strlen(nameList);
@@ -290,13 +393,13 @@ void WarehouseUnit::InitaliseWarehouse()
 }
 
 // set up the query from the current body positions
-void WarehouseUnit::SetBodyQueryData(const std::map<std::string, std::unique_ptr<Body> > &bodyMap)
+void WarehouseUnit::SetBodyQueryData()
 {
     int i = 0;
     Body *rootBody, *body;
 
     // this code is modified from the WarehouseSave function to fill out the query routine
-    rootBody = bodyMap.at(m_bodyNames[0]).get();
+    rootBody = m_bodies[0];
     pgd::Vector3 pos, vel, avel;
     pgd::Quaternion quat;
     rootBody->GetRelativePosition(nullptr, &pos);
@@ -310,9 +413,9 @@ void WarehouseUnit::SetBodyQueryData(const std::map<std::string, std::unique_ptr
     m_bodyQueryData[i++] = vel.x; m_bodyQueryData[i++] = vel.y; m_bodyQueryData[i++] = vel.z;
     m_bodyQueryData[i++] = avel.x; m_bodyQueryData[i++] = avel.y; m_bodyQueryData[i++] = avel.z;
     // and now the rest of the bodies
-    for (unsigned int j = 1; j < m_bodyNames.size(); j++)
+    for (unsigned int j = 1; j < m_bodies.size(); j++)
     {
-        body = bodyMap.at(m_bodyNames[j]).get();
+        body = m_bodies[j];
         body->GetRelativePosition(rootBody, &pos);
         body->GetRelativeQuaternion(rootBody, &quat);
         body->GetRelativeLinearVelocity(rootBody, &vel);
@@ -332,22 +435,28 @@ void WarehouseUnit::SetBodyQueryData(double *bodyQueryData)
     for (int iDim = 0; iDim < m_nDim; iDim++) m_bodyQueryData[iDim] = bodyQueryData[iDim];
 }
 
-// do the search
-int WarehouseUnit::DoSearch()
+// convert the body query into the (possibly reduced) search space
+void WarehouseUnit::SetQueryPoint(const double *bodyQueryData)
 {
     int j;
     if (m_usePCA)
     {
         ColumnMajorArray data(1, m_nDim);
         ColumnMajorArray scores(1, m_numDimensionsWanted);
-        for (j = 0; j < m_nDim; j++) data.Set(0, j, m_bodyQueryData[j] * m_weights[j]);
+        for (j = 0; j < m_nDim; j++) data.Set(0, j, bodyQueryData[j] * m_weights[j]);
         m_pca.CalculateScores(data, 0, m_numDimensionsWanted, &scores);
         for (j = 0; j < m_numDimensionsWanted; j++) m_queryPt[j] = scores.Get(0, j);
     }
     else
     {
-        for (j = 0; j < m_nDim; j++) m_queryPt[j] = m_bodyQueryData[j] * m_weights[j];
+        for (j = 0; j < m_nDim; j++) m_queryPt[j] = bodyQueryData[j] * m_weights[j];
     }
+}
+
+// do the search
+int WarehouseUnit::DoSearch(const double *bodyQueryData)
+{
+    SetQueryPoint(bodyQueryData ? bodyQueryData : m_bodyQueryData);
 
     // do the query
 
@@ -363,6 +472,24 @@ int WarehouseUnit::DoSearch()
     return m_nNN;
 }
 
+// do a fixed radius search which can prune most of the tree when there is no match
+// radius uses the same (squared) units as GetNearestNeighbourDistance
+// returns true and sets the nearest neighbour if there is a point within radius
+bool WarehouseUnit::DoRadiusSearch(double radius, const double *bodyQueryData)
+{
+    SetQueryPoint(bodyQueryData ? bodyQueryData : m_bodyQueryData);
+
+    int numFound = m_kdTree->annkFRSearch(     // search
+                                          m_queryPt,           // query point
+                                          radius,              // squared radius
+                                          m_nNN,               // number of near neighbors
+                                          m_nnIdx,             // nearest neighbors (returned)
+                                          m_dists,             // distance (returned)
+                                          m_eps);              // error bound
+
+    return numFound > 0;
+}
+
 // returns the pointer to the currently selected group of activations
 double* WarehouseUnit::GetCurrentActivations()
 {
@@ -371,15 +498,17 @@ double* WarehouseUnit::GetCurrentActivations()
 
 
 // do an ANN search using the current body positions
-int Warehouse::DoSearch(const std::map<std::string, std::unique_ptr<Body>> &bodyMap)
+// only the primary unit needs a full search because the other units are only of interest if they are within threshold
+int Warehouse::DoSearch()
 {
     double distance, primaryDistance = 0;
     unsigned int i;
+    // the body query is only calculated once if all the units use the same bodies
+    if (m_SharedBodyQuery) m_warehouseList[0]->SetBodyQueryData();
     // are we currently using the primary unit?
     if (m_CurrentUnit == 0)
     {
-        m_warehouseList[m_CurrentUnit]->SetBodyQueryData(bodyMap);
-        m_warehouseList[m_CurrentUnit]->DoSearch();
+        m_warehouseList[m_CurrentUnit]->DoSearch(QueryData(m_CurrentUnit));
         primaryDistance = m_warehouseList[m_CurrentUnit]->GetNearestNeighbourDistance();
         if (primaryDistance <= m_UnitIncreaseThreshold)
         {
@@ -390,12 +519,9 @@ int Warehouse::DoSearch(const std::map<std::string, std::unique_ptr<Body>> &body
         // poor match to primary so try the other units in turn
         for (i = m_CurrentUnit + 1; i < m_warehouseList.size(); i++)
         {
-            m_warehouseList[i]->SetBodyQueryData(bodyMap);
-            m_warehouseList[i]->DoSearch();
-            distance = m_warehouseList[i]->GetNearestNeighbourDistance();
-            if (distance <= m_UnitIncreaseThreshold)
+            if (m_warehouseList[i]->DoRadiusSearch(m_UnitIncreaseThreshold, QueryData(i)))
             {
-                m_NearestNeighbourDistance = distance; //change to a new unit
+                m_NearestNeighbourDistance = m_warehouseList[i]->GetNearestNeighbourDistance(); //change to a new unit
                 m_CurrentUnit = i;
                 m_LastSearchResult = 1;
                 return m_LastSearchResult;
@@ -408,12 +534,13 @@ int Warehouse::DoSearch(const std::map<std::string, std::unique_ptr<Body>> &body
     }
 
     // check to see whether we should move back to a higher priority unit
+    m_warehouseList[0]->DoSearch(QueryData(0)); // the primary distance is needed for the fall back
+    primaryDistance = m_warehouseList[0]->GetNearestNeighbourDistance();
     for (i = 0; i < m_CurrentUnit; i++)
     {
-        m_warehouseList[i]->SetBodyQueryData(bodyMap);
-        m_warehouseList[i]->DoSearch();
-        distance = m_warehouseList[i]->GetNearestNeighbourDistance();
-        if (i == 0) primaryDistance = distance;
+        if (i == 0) distance = primaryDistance;
+        else if (m_warehouseList[i]->DoRadiusSearch(m_UnitIncreaseThreshold * m_UnitDecreaseThresholdFactor, QueryData(i))) distance = m_warehouseList[i]->GetNearestNeighbourDistance();
+        else continue;
         if (distance <= m_UnitIncreaseThreshold * m_UnitDecreaseThresholdFactor)
         {
             m_NearestNeighbourDistance = distance; //change to a new unit
@@ -424,12 +551,9 @@ int Warehouse::DoSearch(const std::map<std::string, std::unique_ptr<Body>> &body
     }
 
     // check whether we should stay where we are
-    m_warehouseList[m_CurrentUnit]->SetBodyQueryData(bodyMap);
-    m_warehouseList[m_CurrentUnit]->DoSearch();
-    distance = m_warehouseList[m_CurrentUnit]->GetNearestNeighbourDistance();
-    if (distance <= m_UnitIncreaseThreshold)
+    if (m_warehouseList[m_CurrentUnit]->DoRadiusSearch(m_UnitIncreaseThreshold, QueryData(m_CurrentUnit)))
     {
-        m_NearestNeighbourDistance = distance; // business as usual
+        m_NearestNeighbourDistance = m_warehouseList[m_CurrentUnit]->GetNearestNeighbourDistance(); // business as usual
         m_LastSearchResult = 4;
         return m_LastSearchResult;
     }
@@ -437,12 +561,9 @@ int Warehouse::DoSearch(const std::map<std::string, std::unique_ptr<Body>> &body
     // poor match to current so try the other units in turn
     for (i = m_CurrentUnit + 1; i < m_warehouseList.size(); i++)
     {
-        m_warehouseList[i]->SetBodyQueryData(bodyMap);
-        m_warehouseList[i]->DoSearch();
-        distance = m_warehouseList[i]->GetNearestNeighbourDistance();
-        if (distance <= m_UnitIncreaseThreshold)
+        if (m_warehouseList[i]->DoRadiusSearch(m_UnitIncreaseThreshold, QueryData(i)))
         {
-            m_NearestNeighbourDistance = distance; //change to a new unit
+            m_NearestNeighbourDistance = m_warehouseList[i]->GetNearestNeighbourDistance(); //change to a new unit
             m_CurrentUnit = i;
             m_LastSearchResult = 5;
             return m_LastSearchResult;
@@ -455,6 +576,49 @@ int Warehouse::DoSearch(const std::map<std::string, std::unique_ptr<Body>> &body
     return m_LastSearchResult;
 }
 
+// returns the body query for a unit
+const double *Warehouse::QueryData(unsigned int index)
+{
+    if (m_SharedBodyQuery) return m_warehouseList[0]->GetBodyQueryData();
+    m_warehouseList[index]->SetBodyQueryData();
+    return m_warehouseList[index]->GetBodyQueryData();
+}
+
+// look up the bodies and drivers once so that the searches do not need to use the names
+// it returns nullptr on success and a pointer to lastError() on failure
+std::string *Warehouse::ResolveReferences(const std::map<std::string, std::unique_ptr<Body>> &bodyMap, const std::map<std::string, std::unique_ptr<Driver>> &driverMap)
+{
+    m_SharedBodyQuery = true;
+    for (auto &&unit : m_warehouseList)
+    {
+        std::vector<Body *> bodies;
+        for (auto &&bodyName : *unit->GetBodyNames())
+        {
+            auto it = bodyMap.find(bodyName);
+            if (it == bodyMap.end())
+            {
+                setLastError("Warehouse ID=\""s + name() + "\" BODY \""s + bodyName + "\" not found"s);
+                return lastErrorPtr();
+            }
+            bodies.push_back(it->second.get());
+        }
+        unit->SetBodies(bodies);
+
+        std::vector<FixedDriver *> drivers;
+        for (auto &&driverName : *unit->GetDriverNames())
+        {
+            auto it = driverMap.find(driverName);
+            FixedDriver *driver = (it == driverMap.end()) ? nullptr : dynamic_cast<FixedDriver *>(it->second.get());
+            if (driver == nullptr) std::cerr << "Warning: Warehouse ID=\"" << name() << "\" DRIVER \"" << driverName << "\" ignored: only FixedDriver currently supported as warehouse targets\n";
+            drivers.push_back(driver);
+        }
+        unit->SetDrivers(drivers);
+
+        if (*unit->GetBodyNames() != *m_warehouseList[0]->GetBodyNames()) m_SharedBodyQuery = false;
+    }
+    return nullptr;
+}
+
 WarehouseUnit *Warehouse::NewWarehouseUnit(unsigned int index)
 {
     if (index != m_warehouseList.size()) return nullptr;
@@ -22,8 +22,11 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <istream>
 
 class Body;
+class Driver;
+class FixedDriver;
 
 class WarehouseUnit : public NamedObject
 {
@@ -33,8 +36,10 @@ public:
 
     int ImportWarehouseUnit(const char *filename, bool appendFlag);
     int ImportWarehouseUnit(char *fileData, int fileDataLen, bool appendFlag);
+    int ImportBinaryWarehouseUnit(std::istream &file, bool appendFlag);
     void InitaliseWarehouse();
-    int DoSearch();
+    int DoSearch(const double *bodyQueryData = nullptr); // uses m_bodyQueryData unless a shared query is supplied
+    bool DoRadiusSearch(double radius, const double *bodyQueryData = nullptr); // only finds the nearest neighbour if it is within radius
 
     std::vector<std::string> *GetDriverNames() { return &m_driverNames; }
     std::vector<std::string> *GetBodyNames() { return &m_bodyNames; }
@@ -48,6 +53,7 @@ public:
     double *GetBodyData(int *numPoints, int *numBodies, int *numValuesPerBody) { *numPoints = m_nPts; *numBodies = m_numBodies; *numValuesPerBody = m_numValuesPerBody; return m_bodyData; }
     double *GetWeights(int *numBodies, int *numValuesPerBody) { *numBodies = m_numBodies; *numValuesPerBody = m_numValuesPerBody; return m_weights; }
     double *GetBodyQueryData() { return m_bodyQueryData; }
+    std::vector<FixedDriver *> *GetDrivers() { return &m_drivers; }
 
     double* GetCurrentActivations();
     double GetNearestNeighbourDistance() { return m_dists[0]; }
@@ -59,10 +65,14 @@ public:
     void SetActivations(int numPoints, int numDrivers, double *activations);
     void SetBodyData(int numPoints, int numBodies, int numValuesPerBody, double *bodyData);
     void SetWeights(int numBodies, int numValuesPerBody, double *weights);
-    void SetBodyQueryData(const std::map<std::string, std::unique_ptr<Body>> &bodyMap);
+    void SetBodyQueryData(); // uses the bodies set by SetBodies
     void SetBodyQueryData(double *bodyQueryData);
+    void SetBodies(const std::vector<Body *> &bodies) { m_bodies = bodies; }
+    void SetDrivers(const std::vector<FixedDriver *> &drivers) { m_drivers = drivers; }
 
 private:
+    void SetQueryPoint(const double *bodyQueryData);
+
     int                 m_nPts;                         // actual number of data points
     int                 m_nDim;                         // dimensionality of search space
     int                 m_nNN;                          // number of nearest neighbours to return
@@ -84,6 +94,8 @@ private:
 
     std::vector<std::string> m_driverNames;             // list of driver names
     std::vector<std::string> m_bodyNames;               // list of bodies
+    std::vector<Body *> m_bodies;                       // bodies matching m_bodyNames
+    std::vector<FixedDriver *> m_drivers;               // drivers matching m_driverNames (nullptr if not a FixedDriver)
 
     PCA m_pca;                                          // store the PCA values
     int m_numDimensionsWanted;                          // the number of dimensions wanted
@@ -104,11 +116,13 @@ public:
     }
     ~Warehouse() { for (unsigned int i = 0; i < m_warehouseList.size(); i++) delete m_warehouseList[i]; }
 
-    int DoSearch(const std::map<std::string, std::unique_ptr<Body> > &bodyMap);
+    std::string *ResolveReferences(const std::map<std::string, std::unique_ptr<Body>> &bodyMap, const std::map<std::string, std::unique_ptr<Driver>> &driverMap);
+    int DoSearch();
     double GetNearestNeighbourDistance() { return m_warehouseList[m_CurrentUnit]->GetNearestNeighbourDistance(); }
     double *GetCurrentActivations() { return m_warehouseList[m_CurrentUnit]->GetCurrentActivations(); }
     std::vector<std::string> *GetDriverNames() { return m_warehouseList[m_CurrentUnit]->GetDriverNames(); }
     std::vector<std::string> *GetBodyNames() { return m_warehouseList[m_CurrentUnit]->GetBodyNames(); }
+    std::vector<FixedDriver *> *GetDrivers() { return m_warehouseList[m_CurrentUnit]->GetDrivers(); }
 
     WarehouseUnit *NewWarehouseUnit(unsigned int index);
     WarehouseUnit *GetWarehouseUnit(unsigned int index) { if (index >= m_warehouseList.size()) return nullptr; return m_warehouseList[index]; }
@@ -122,6 +136,8 @@ public:
     virtual void saveToAttributes();
 
 private:
+    const double *QueryData(unsigned int index);
+
     std::vector <WarehouseUnit *> m_warehouseList;
     double m_UnitIncreaseThreshold;
     double m_UnitDecreaseThresholdFactor;
@@ -129,6 +145,7 @@ private:
     int m_LastSearchResult;
     double m_NearestNeighbourDistance;
     bool m_UsePCA;
+    bool m_SharedBodyQuery = false;
 };
 
 #endif // WAREHOUSE_H
@@ -11,21 +11,36 @@
 #include "DataFile.h"
 
 #include "exprtk.hpp"
+#include "rapidxml.hpp"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <sstream>
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 #include <assert.h>
 #include <iostream>
 #include <sstream>
 
+using namespace std::literals::string_literals;
+
+struct XMLConverterCompiledExpressions
+{
+    exprtk::symbol_table<double> symbolTable;
+    std::vector<exprtk::expression<double>> expressions;
+    std::vector<bool> valid;
+};
+
 XMLConverter::XMLConverter()
 {
 }
 
+XMLConverter::~XMLConverter()
+{
+}
+
 // load the base file for smart substitution file
 int XMLConverter::LoadBaseXMLFile(const char *filename)
 {
@@ -41,24 +56,34 @@ void XMLConverter::Clear()
     m_SmartSubstitutionParserText.clear();
     m_SmartSubstitutionValues.clear();
     m_BaseXMLString.clear();
+    m_CompiledExpressions.reset();
+    m_Genome.clear();
+    m_TemplateRootTag.clear();
+    m_TemplateElementList.clear();
+    m_TemplateSlots.clear();
+    m_TemplateValid = false;
 }
 
 // load the base XML for smart substitution file
+// this is the only copy of the XML that is made and the text between the substitutions is referenced by offset
 int XMLConverter::LoadBaseXMLString(const char *dataPtr, size_t length)
 {
     m_SmartSubstitutionTextComponents.clear();
     m_SmartSubstitutionParserText.clear();
     m_SmartSubstitutionValues.clear();
+    m_CompiledExpressions.reset();
+    m_Genome.clear();
     m_BaseXMLString.assign(dataPtr, length);
 
-    const char *ptr1 = dataPtr;
+    // the search uses the copy because it is guaranteed to be null terminated
+    const char *base = m_BaseXMLString.c_str();
+    const char *ptr1 = base;
     const char *ptr2 = strstr(ptr1, "[[");
     m_SmartSubstitutionTextComponentsSize = 0;
     while (ptr2)
     {
-        std::string s(ptr1, static_cast<size_t>(ptr2 - ptr1));
-        m_SmartSubstitutionTextComponentsSize += s.size();
-        m_SmartSubstitutionTextComponents.push_back(std::move(s));
+        m_SmartSubstitutionTextComponents.push_back(std::make_pair(static_cast<size_t>(ptr1 - base), static_cast<size_t>(ptr2 - ptr1)));
+        m_SmartSubstitutionTextComponentsSize += static_cast<size_t>(ptr2 - ptr1);
 
         ptr2 += 2;
         ptr1 = strstr(ptr2, "]]");
@@ -73,9 +98,11 @@ int XMLConverter::LoadBaseXMLString(const char *dataPtr, size_t length)
         ptr1 += 2;
         ptr2 = strstr(ptr1, "[[");
     }
-    std::string s(ptr1);
-    m_SmartSubstitutionTextComponentsSize += s.size();
-    m_SmartSubstitutionTextComponents.push_back(std::move(s));
+    m_SmartSubstitutionTextComponents.push_back(std::make_pair(static_cast<size_t>(ptr1 - base), strlen(ptr1)));
+    m_SmartSubstitutionTextComponentsSize += strlen(ptr1);
+
+    // this needs the original expression text so it must be done before the brackets are altered
+    CreateElementTemplate();
 
     // get the vector brackets in the right format for exprtk if necessary
     ConvertVectorBrackets();
@@ -90,55 +117,140 @@ void XMLConverter::GetFormattedXML(std::string *formattedXML)
     char buffer[32];
     for (size_t i = 0; i < m_SmartSubstitutionValues.size(); i++)
     {
-        formattedXML->append(m_SmartSubstitutionTextComponents[i]);
+        formattedXML->append(m_BaseXMLString, m_SmartSubstitutionTextComponents[i].first, m_SmartSubstitutionTextComponents[i].second);
         int l = snprintf(buffer, sizeof(buffer), "%.18g", m_SmartSubstitutionValues[i]);
         formattedXML->append(buffer, l);
     }
-    formattedXML->append(m_SmartSubstitutionTextComponents[m_SmartSubstitutionValues.size()]);
+    formattedXML->append(m_BaseXMLString, m_SmartSubstitutionTextComponents.back().first, m_SmartSubstitutionTextComponents.back().second);
+}
+
+// returns the base XML as a list of elements with the current substitution values
+// or nullptr if the base XML cannot be handled this way and GetFormattedXML needs to be used instead
+const std::vector<std::unique_ptr<ParseXML::XMLElement>> *XMLConverter::GetFormattedElementList(const std::string &rootNodeTag)
+{
+    if (!m_TemplateValid || rootNodeTag != m_TemplateRootTag) return nullptr;
+    char buffer[32];
+    for (auto &&slot : m_TemplateSlots)
+    {
+        slot.attributeValue->clear();
+        for (size_t i = 0; i < slot.substitutionIndices.size(); i++)
+        {
+            slot.attributeValue->append(slot.textComponents[i]);
+            int l = snprintf(buffer, sizeof(buffer), "%.18g", m_SmartSubstitutionValues[slot.substitutionIndices[i]]);
+            slot.attributeValue->append(buffer, l);
+        }
+        slot.attributeValue->append(slot.textComponents.back());
+    }
+    return &m_TemplateElementList;
 }
 
 // this needs to be customised depending on how the genome interacts with
 // the XML file specifying the simulation
 int XMLConverter::ApplyGenome(int genomeSize, const double *genomeData)
 {
-    exprtk::symbol_table<double> *symbol_table;
-    exprtk::expression<double> *expression;
-    exprtk::parser<double> *parser;
+    // the expressions only need compiling when the base XML or the genome size changes
+    if (!m_CompiledExpressions || m_Genome.size() != size_t(genomeSize)) CompileExpressions(size_t(genomeSize));
 
-    for (unsigned int i = 0; i < m_SmartSubstitutionParserText.size(); i++)
+    std::copy(genomeData, genomeData + genomeSize, m_Genome.begin());
+    for (size_t i = 0; i < m_CompiledExpressions->expressions.size(); i++)
     {
-        // set up the genome as a function g(locus) and evaluate
-
-        symbol_table = new exprtk::symbol_table<double>();
-        expression = new exprtk::expression<double>();
-        parser = new exprtk::parser<double>();
+        if (m_CompiledExpressions->valid[i]) m_SmartSubstitutionValues[i] = m_CompiledExpressions->expressions[i].value();
+        else m_SmartSubstitutionValues[i] = 0;
+//        std::cerr << "substitution value " << i << " = " << m_SmartSubstitutionValues[i] << "\n";
+    }
 
-        symbol_table->add_vector("g", const_cast<double *>(genomeData), size_t(genomeSize)); // const_cast is needed because add_vector requires non const (but does not alter the values)
-        symbol_table->add_constants();
+    return 0;
+}
 
-        expression->register_symbol_table(*symbol_table);
+// set up the genome as a vector g(locus) and compile all the substitution expressions against it
+void XMLConverter::CompileExpressions(size_t genomeSize)
+{
+    m_CompiledExpressions = std::make_unique<XMLConverterCompiledExpressions>();
+    m_Genome.assign(genomeSize, 0); // m_Genome must not be resized after this point because the symbol table holds a pointer to its data
 
-//        std::cerr << "substitution text " << i << ": " << *m_SmartSubstitutionParserText[i] << "\n";
-        bool success = parser->compile(m_SmartSubstitutionParserText[i], *expression);
+    m_CompiledExpressions->symbolTable.add_vector("g", m_Genome);
+    m_CompiledExpressions->symbolTable.add_constants();
 
-        if (success)
-        {
-            m_SmartSubstitutionValues[i] = expression->value();
-//            std::cerr << "substitution value " << i << " = " << m_SmartSubstitutionValues[i] << "\n";
-        }
-        else
+    exprtk::parser<double> parser;
+    m_CompiledExpressions->expressions.resize(m_SmartSubstitutionParserText.size());
+    m_CompiledExpressions->valid.resize(m_SmartSubstitutionParserText.size());
+    for (size_t i = 0; i < m_SmartSubstitutionParserText.size(); i++)
+    {
+        exprtk::expression<double> &expression = m_CompiledExpressions->expressions[i];
+        expression.register_symbol_table(m_CompiledExpressions->symbolTable);
+//        std::cerr << "substitution text " << i << ": " << m_SmartSubstitutionParserText[i] << "\n";
+        m_CompiledExpressions->valid[i] = parser.compile(m_SmartSubstitutionParserText[i], expression);
+        if (!m_CompiledExpressions->valid[i])
         {
-            std::cerr << "Error: XMLConverter::ApplyGenome m_SmartSubstitutionParserComponents[" << i << "] does not evaluate to a number\n";
+            std::cerr << "Error: XMLConverter::CompileExpressions m_SmartSubstitutionParserText[" << i << "] does not evaluate to a number\n";
             std::cerr << "Applying standard fix up and setting to zero\n";
-            m_SmartSubstitutionValues[i] = 0;
         }
+    }
+}
+
+// parse the base XML into elements and record where the substitutions go
+// this only works if every [[ ]] is wholly within an attribute value and has not been altered by the XML parser
+// otherwise the template is marked invalid and the text route is used
+void XMLConverter::CreateElementTemplate()
+{
+    m_TemplateRootTag.clear();
+    m_TemplateElementList.clear();
+    m_TemplateSlots.clear();
+    m_TemplateValid = false;
 
-        delete parser;
-        delete expression;
-        delete symbol_table;
+    std::vector<char> data(m_BaseXMLString.begin(), m_BaseXMLString.end());
+    data.push_back(0);
+    rapidxml::xml_document<char> doc;
+    try
+    {
+        doc.parse<rapidxml::parse_no_data_nodes | rapidxml::parse_no_element_values>(data.data());
+    }
+    catch (...)
+    {
+        return; // the error will be reported when the text version is parsed
     }
+    rapidxml::xml_node<char> *cur = doc.first_node();
+    if (cur == nullptr) return;
+    m_TemplateRootTag.assign(cur->name(), cur->name_size());
 
-    return 0;
+    size_t substitutionIndex = 0;
+    for (cur = cur->first_node(); cur; cur = cur->next_sibling())
+    {
+        auto xmlElement = std::make_unique<ParseXML::XMLElement>();
+        xmlElement->tag.assign(cur->name(), cur->name_size());
+        for (rapidxml::xml_attribute<char> *attr = cur->first_attribute(); attr; attr = attr->next_attribute())
+        {
+            std::string value(attr->value(), attr->value_size());
+            auto inserted = xmlElement->attributes.emplace(std::string(attr->name(), attr->name_size()), std::string());
+            if (!inserted.second) return; // repeated attributes are too ambiguous to handle here
+            std::string &attributeValue = inserted.first->second;
+            size_t start = value.find("[["s);
+            if (start == std::string::npos)
+            {
+                attributeValue = std::move(value);
+                continue;
+            }
+            TemplateSlot slot;
+            slot.attributeValue = &attributeValue; // std::map does not move its values so this pointer stays valid
+            size_t last = 0;
+            while (start != std::string::npos)
+            {
+                size_t end = value.find("]]"s, start + 2);
+                if (end == std::string::npos || substitutionIndex >= m_SmartSubstitutionParserText.size() ||
+                        value.compare(start + 2, end - start - 2, m_SmartSubstitutionParserText[substitutionIndex]) != 0) return;
+                slot.textComponents.push_back(value.substr(last, start - last));
+                slot.substitutionIndices.push_back(substitutionIndex++);
+                last = end + 2;
+                start = value.find("[["s, last);
+            }
+            slot.textComponents.push_back(value.substr(last));
+            m_TemplateSlots.push_back(std::move(slot));
+        }
+        m_TemplateElementList.push_back(std::move(xmlElement));
+    }
+    // any substitutions outside attribute values (e.g. in comments) mean the template does not match the text
+    if (substitutionIndex != m_SmartSubstitutionParserText.size()) return;
+    m_TemplateValid = true;
 }
 
 // exprtk requires [] around vector indices whereas my parser used ()
@@ -10,22 +10,29 @@
 #ifndef XMLConverter_h
 #define XMLConverter_h
 
+#include "ParseXML.h"
+
 #include <vector>
 #include <string>
+#include <memory>
+#include <utility>
 
 class Genome;
 class DataFile;
 class ExpressionParser;
+struct XMLConverterCompiledExpressions;
 
 class XMLConverter
 {
 public:
     XMLConverter();
+    ~XMLConverter();
 
     int LoadBaseXMLFile(const char *filename);
     int LoadBaseXMLString(const char *dataPtr, size_t length);
     int ApplyGenome(int genomeSize, const double *genomeData);
     void GetFormattedXML(std::string *formattedXML);
+    const std::vector<std::unique_ptr<ParseXML::XMLElement>> *GetFormattedElementList(const std::string &rootNodeTag);
 
     const std::string &BaseXMLString() const;
 
@@ -34,12 +41,31 @@ public:
 private:
 
     void ConvertVectorBrackets();
+    void CompileExpressions(size_t genomeSize);
+    void CreateElementTemplate();
+
+    struct TemplateSlot
+    {
+        std::string *attributeValue;
+        std::vector<std::string> textComponents;
+        std::vector<size_t> substitutionIndices;
+    };
 
     std::string m_BaseXMLString;
-    std::vector<std::string> m_SmartSubstitutionTextComponents;
+    std::vector<std::pair<size_t, size_t>> m_SmartSubstitutionTextComponents; // offset and length in m_BaseXMLString
     std::vector<std::string> m_SmartSubstitutionParserText;
     std::vector<double> m_SmartSubstitutionValues;
     size_t m_SmartSubstitutionTextComponentsSize = 0;
+
+    // the expressions are compiled once and bound to m_Genome so that ApplyGenome only needs to copy and evaluate
+    std::unique_ptr<XMLConverterCompiledExpressions> m_CompiledExpressions;
+    std::vector<double> m_Genome;
+
+    // the base XML is also parsed once into elements and only the attributes containing substitutions are rewritten for each genome
+    std::string m_TemplateRootTag;
+    std::vector<std::unique_ptr<ParseXML::XMLElement>> m_TemplateElementList;
+    std::vector<TemplateSlot> m_TemplateSlots;
+    bool m_TemplateValid = false;
 };
 
 
@@ -0,0 +1,93 @@
+/*
+ *  BenchmarkBroadphase.cpp
+ *  GaitSym2019
+ *
+ */
+
+// times Simulation::UpdateSimulation on the generated worm with each of the GLOBAL SpaceType values
+// so that the collision spaces can be compared as the number of geoms grows
+// the quad tree is centred on the worm and the sweep and prune axes start with the long axis of the worm
+
+#include "TestModels.h"
+#include "Simulation.h"
+#include "Global.h"
+#include "ArgParse.h"
+#include "GSUtil.h"
+
+#include "ode/ode.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std::string_literals;
+
+int main(int argc, const char **argv)
+{
+    ArgParse argparse;
+    argparse.Initialise(argc, argv, "BenchmarkBroadphase time per step for each collision space type"s, 0, 0);
+    argparse.AddArgument("-ns"s, "--numSegments"s, "Numbers of segments in the generated models (each has six spheres) [10 40 160]"s, ""s, 1, SIZE_MAX, false, ArgParse::Int);
+    argparse.AddArgument("-st"s, "--stepType"s, "Step type of the generated model (World or Quick)"s, "Quick"s, 1, false, ArgParse::String);
+    argparse.AddArgument("-ws"s, "--warmupSteps"s, "Number of steps before timing starts (the worm lands after about 800)"s, "1000"s, 1, false, ArgParse::Int);
+    argparse.AddArgument("-ts"s, "--timedSteps"s, "Number of timed steps in each repeat"s, "500"s, 1, false, ArgParse::Int);
+    argparse.AddArgument("-nr"s, "--numRepeats"s, "Number of repeats (the fastest is reported)"s, "3"s, 1, false, ArgParse::Int);
+    if (argparse.Parse())
+    {
+        argparse.Usage();
+        return 1;
+    }
+    std::vector<int> numSegmentsList = {10, 40, 160};
+    int warmupSteps = 0, timedSteps = 0, numRepeats = 0;
+    std::string stepType;
+    argparse.Get("--numSegments"s, &numSegmentsList);
+    argparse.Get("--stepType"s, &stepType);
+    argparse.Get("--warmupSteps"s, &warmupSteps);
+    argparse.Get("--timedSteps"s, &timedSteps);
+    argparse.Get("--numRepeats"s, &numRepeats);
+
+    std::cout.precision(6);
+    for (auto &&numSegments : numSegmentsList)
+    {
+        WormModelOptions options;
+        options.numSegments = size_t(numSegments);
+        options.stepType = stepType;
+        options.timeLimit = 1e6; // the step count controls the length of the run
+        double length = 0.2 * numSegments;
+        for (size_t spaceType = 0; spaceType < Global::spaceTypeCount; spaceType++)
+        {
+            options.spaceAttributes = "SpaceType=\""s + Global::spaceTypeStrings(spaceType) + "\""s;
+            if (Global::SpaceType(spaceType) == Global::QuadTree)
+                options.spaceAttributes += " SpaceQuadTreeCenter=\""s + GSUtil::ToString(length / 2) + " 0 0\" SpaceQuadTreeExtents=\""s + GSUtil::ToString(length + 1) + " 2 2\""s;
+            std::string xml = WormModel(options);
+            std::vector<double> stepTimes;
+            double contacts = 0;
+            for (int repeat = 0; repeat < numRepeats; repeat++)
+            {
+                Simulation simulation;
+                dRandSetSeed(0); // the quick step uses the ODE random number generator so every run starts with the same seed
+                std::string *errorMessage = simulation.LoadModel(xml.data(), xml.size());
+                if (errorMessage)
+                {
+                    std::cerr << *errorMessage << "\n";
+                    return 1;
+                }
+                for (int i = 0; i < warmupSteps; i++) simulation.UpdateSimulation();
+                contacts = 0;
+                double startTime = GSUtil::GetTime();
+                for (int i = 0; i < timedSteps; i++)
+                {
+                    simulation.UpdateSimulation();
+                    contacts += simulation.GetContactList()->size();
+                }
+                stepTimes.push_back((GSUtil::GetTime() - startTime) / timedSteps);
+                if (simulation.TestForCatastrophy()) std::cerr << "Warning: the simulation failed during repeat " << repeat << "\n";
+            }
+            std::cout << "Segments " << numSegments << " " << Global::spaceTypeStrings(spaceType) << ": "
+                      << *std::min_element(stepTimes.begin(), stepTimes.end()) * 1e6 << " us per step, "
+                      << contacts / timedSteps << " contacts per step\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ *  BenchmarkFixedJointStress.cpp
+ *  GaitSym2019
+ *
+ */
+
+// times the FixedJoint spring stress calculation for cross section bitmaps from 32x32 to 1024x1024
+// the model is a cantilever fixed to the world at one end so that the joint carries both a force and a bending torque
+// the cross section is a tube (a circle with a hole) which fills about 60% of the bitmap
+
+#include "Simulation.h"
+#include "FixedJoint.h"
+#include "ArgParse.h"
+#include "GSUtil.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std::string_literals;
+
+static std::string CantileverModel(int n)
+{
+    const double diameter = 0.05;
+    std::string bitmap;
+    bitmap.reserve(size_t(n) * size_t(n + 1));
+    for (int iy = 0; iy < n; iy++)
+    {
+        for (int ix = 0; ix < n; ix++)
+        {
+            double x = (ix + 0.5) / n - 0.5;
+            double y = (iy + 0.5) / n - 0.5;
+            double r2 = x * x + y * y;
+            bitmap.push_back(r2 <= 0.25 && r2 >= 0.0625 ? '1' : '0');
+        }
+        bitmap.push_back(' ');
+    }
+    std::string pixelSize = GSUtil::ToString(diameter / n);
+    std::string xml =
+        "<GAITSYM2019>\n"
+        "<GLOBAL ID=\"global\" AllowInternalCollisions=\"false\" AllowConnectedCollisions=\"false\" BMR=\"0\" CFM=\"1e-10\" ContactMaxCorrectingVel=\"100\" "
+        "ContactSurfaceLayer=\"0.001\" DistanceTravelledBodyID=\"Beam\" ERP=\"0.2\" FitnessType=\"KinematicMatch\" GravityVector=\"0.0 0.0 -9.81\" "
+        "IntegrationStepSize=\"1e-4\" MechanicalEnergyLimit=\"0\" MetabolicEnergyLimit=\"0\" TimeLimit=\"1\" StepType=\"World\"/>\n"
+        "<MARKER ID=\"WorldMarker\" BodyID=\"World\" Position=\"World 0 0 1\" Quaternion=\"World 0.7071067811865476 0 0.7071067811865476 0\"/>\n"
+        "<BODY ID=\"Beam\" Mass=\"1\" MOI=\"0.001 0.01 0.01 0 0 0\" Position=\"World 0.2 0 1\" ConstructionPosition=\"World 0.2 0 1\" Quaternion=\"World 1 0 0 0\" "
+        "LinearVelocity=\"0 0 0\" AngularVelocity=\"0 0 0\" ConstructionDensity=\"1000\" PositionLowBound=\"-100 -100 -100\" PositionHighBound=\"100 100 100\" "
+        "LinearVelocityLowBound=\"-100 -100 -100\" LinearVelocityHighBound=\"100 100 100\" AngularVelocityLowBound=\"-1000 -1000 -1000\" AngularVelocityHighBound=\"1000 1000 1000\"/>\n"
+        "<MARKER ID=\"BeamMarker\" BodyID=\"Beam\" Position=\"World 0 0 1\" Quaternion=\"World 0.7071067811865476 0 0.7071067811865476 0\"/>\n"
+        "<JOINT ID=\"Root\" Type=\"Fixed\" Body1MarkerID=\"BeamMarker\" Body2MarkerID=\"WorldMarker\" StressCalculationType=\"Spring\" LowPassType=\"NoLowPass\" "
+        "StressLimit=\"1e30\" StressBitmapPixelSize=\""s + pixelSize + " "s + pixelSize + "\" StressBitmapDimensions=\""s + std::to_string(n) + " "s + std::to_string(n) +
+        "\" StressBitmap=\""s + bitmap + "\"/>\n"
+        "</GAITSYM2019>\n"s;
+    return xml;
+}
+
+int main(int argc, const char **argv)
+{
+    ArgParse argparse;
+    argparse.Initialise(argc, argv, "BenchmarkFixedJointStress time for the FixedJoint spring stress calculation"s, 0, 0);
+    argparse.AddArgument("-bs"s, "--bitmapSizes"s, "Widths of the square cross section bitmaps [32 64 128 256 512 1024]"s, ""s, 1, SIZE_MAX, false, ArgParse::Int);
+    argparse.AddArgument("-mt"s, "--minimumTime"s, "Minimum time for each measurement (s)"s, "0.2"s, 1, false, ArgParse::Double);
+    argparse.AddArgument("-nr"s, "--numRepeats"s, "Number of repeats (the fastest is reported)"s, "5"s, 1, false, ArgParse::Int);
+    if (argparse.Parse())
+    {
+        argparse.Usage();
+        return 1;
+    }
+    std::vector<int> bitmapSizes = {32, 64, 128, 256, 512, 1024};
+    double minimumTime = 0;
+    int numRepeats = 0;
+    argparse.Get("--bitmapSizes"s, &bitmapSizes);
+    argparse.Get("--minimumTime"s, &minimumTime);
+    argparse.Get("--numRepeats"s, &numRepeats);
+
+    std::cout.precision(6);
+    for (auto &&n : bitmapSizes)
+    {
+        std::string xml = CantileverModel(n);
+        Simulation simulation;
+        std::string *errorMessage = simulation.LoadModel(xml.data(), xml.size());
+        if (errorMessage)
+        {
+            std::cerr << *errorMessage << "\n";
+            return 1;
+        }
+        // a few steps so that the joint feedback has the cantilever loads
+        for (int i = 0; i < 10; i++) simulation.UpdateSimulation();
+        FixedJoint *joint = dynamic_cast<FixedJoint *>(simulation.GetJointList()->at("Root"s).get());
+        size_t activePixels = 0;
+        for (auto &&it : joint->stiffness()) if (it) activePixels++;
+
+        // the number of calls per measurement is doubled until a measurement takes at least minimumTime
+        size_t calls = 1;
+        double elapsed = 0;
+        while (true)
+        {
+            double startTime = GSUtil::GetTime();
+            for (size_t i = 0; i < calls; i++) joint->Update();
+            elapsed = GSUtil::GetTime() - startTime;
+            if (elapsed >= minimumTime) break;
+            calls *= 2;
+        }
+        std::vector<double> callTimes = {elapsed / calls};
+        for (int repeat = 1; repeat < numRepeats; repeat++)
+        {
+            double startTime = GSUtil::GetTime();
+            for (size_t i = 0; i < calls; i++) joint->Update();
+            callTimes.push_back((GSUtil::GetTime() - startTime) / calls);
+        }
+        double fastest = *std::min_element(callTimes.begin(), callTimes.end());
+        std::cout << n << "x" << n << ": " << activePixels << " springs, " << fastest * 1e6 << " us per calculation, "
+                  << fastest / activePixels * 1e9 << " ns per spring, stress " << joint->GetMinStress() << " to " << joint->GetMaxStress() << "\n";
+    }
+    return 0;
+}
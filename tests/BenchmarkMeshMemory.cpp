@@ -0,0 +1,104 @@
+/*
+ *  BenchmarkMeshMemory.cpp
+ *  GaitSym2019
+ *
+ */
+
+// loads every mesh file the requested number of times the way DrawBody does (parse then move by the construction position)
+// and reports the growth in resident memory and the load time so that mesh sharing through MeshStore can be checked
+// FacetedObject and MeshStore need Qt so this is built with GaitSymQt/BenchmarkMeshMemory.pro rather than the makefile
+// run it once per instance count because memory that has been freed is not always given back to the operating system
+
+#include "FacetedObject.h"
+#include "Preferences.h"
+#include "ArgParse.h"
+#include "GSUtil.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdlib>
+#include <cstdint>
+
+using namespace std::string_literals;
+
+// resident set size in kB or -1 if it is not available on this platform
+static long ResidentMemory()
+{
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmRSS:", 0) == 0) return std::atol(line.c_str() + 6);
+    }
+#endif
+    return -1;
+}
+
+int main(int argc, const char **argv)
+{
+    ArgParse argparse;
+    argparse.Initialise(argc, argv, "BenchmarkMeshMemory resident memory and load time for repeated meshes (the end arguments are the mesh files)"s, SIZE_MAX, 1);
+    argparse.AddArgument("-ni"s, "--numInstances"s, "Number of objects made from each mesh file"s, "1"s, 1, false, ArgParse::Int);
+    if (argparse.Parse())
+    {
+        argparse.Usage();
+        return 1;
+    }
+    std::vector<std::string> meshFiles;
+    int numInstances = 0;
+    argparse.Get("--numInstances"s, &numInstances);
+    // ArgParse only reads the end arguments that follow an option
+    if (!argparse.Get(&meshFiles))
+    {
+        std::cerr << "Error: no mesh files found after the options (e.g. BenchmarkMeshMemory -ni 1 *.obj)\n";
+        return 1;
+    }
+
+    Preferences::Read(); // the MeshStore memory budget is a preference
+
+    long startMemory = ResidentMemory();
+    double startTime = GSUtil::GetTime();
+    std::vector<std::unique_ptr<FacetedObject>> objects;
+    size_t numTriangles = 0;
+    for (int instance = 0; instance < numInstances; instance++)
+    {
+        for (auto &&meshFile : meshFiles)
+        {
+            auto object = std::make_unique<FacetedObject>();
+            if (object->ParseOBJFile(meshFile))
+            {
+                std::cerr << "Error reading \"" << meshFile << "\"\n";
+                return 1;
+            }
+            object->Move(-0.1, -0.2, -0.3); // DrawBody moves each mesh by the construction position of its body
+            numTriangles += object->GetNumTriangles();
+            objects.push_back(std::move(object));
+        }
+    }
+    double loadTime = GSUtil::GetTime() - startTime;
+    long endMemory = ResidentMemory();
+
+    // the checksum should not change when only the way the meshes are stored changes
+    double checksum = 0;
+    double triangle[9];
+    for (auto &&object : objects)
+    {
+        for (size_t i = 0; i < object->GetNumTriangles(); i++)
+        {
+            object->GetTriangle(i, triangle);
+            for (size_t j = 0; j < 9; j++) checksum += double(float(triangle[j])) * double(j + 1);
+        }
+    }
+
+    std::cout.precision(17);
+    std::cout << objects.size() << " objects, " << numTriangles << " triangles, checksum " << checksum << "\n";
+    std::cout.precision(6);
+    if (startMemory < 0 || endMemory < 0) std::cout << "Resident memory is not available on this platform, ";
+    else std::cout << "Resident memory growth " << double(endMemory - startMemory) / 1024 << " MB, ";
+    std::cout << "load time " << loadTime << " s\n";
+    return 0;
+}
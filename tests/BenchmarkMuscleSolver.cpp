@@ -0,0 +1,128 @@
+/*
+ *  BenchmarkMuscleSolver.cpp
+ *  GaitSym2019
+ *
+ */
+
+// compares the MAMuscleComplete lpe solvers by running the same model with every muscle set to each solver
+// and reporting the force error evaluations per muscle per step, the run time and the energies
+// the muscle solver cannot be timed on its own so the time difference between the runs is reported per muscle step
+// the quick step is used by default so that the muscles are a larger share of each step
+
+#include "TestModels.h"
+#include "Simulation.h"
+#include "MAMuscleComplete.h"
+#include "ArgParse.h"
+#include "GSUtil.h"
+
+#include "ode/ode.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cctype>
+
+using namespace std::string_literals;
+
+struct SolverResult
+{
+    double evaluationsPerMuscleStep = 0;
+    double fastestTime = 0;
+    double muscleSteps = 0;
+    double mechanicalEnergy = 0;
+    double metabolicEnergy = 0;
+};
+
+static int RunSolver(const WormModelOptions &options, int numRepeats, SolverResult *result)
+{
+    std::string xml = WormModel(options);
+    std::vector<double> times;
+    for (int repeat = 0; repeat < numRepeats; repeat++)
+    {
+        Simulation simulation;
+        dRandSetSeed(0); // the quick step uses the ODE random number generator so every run starts with the same seed
+        std::string *errorMessage = simulation.LoadModel(xml.data(), xml.size());
+        if (errorMessage)
+        {
+            std::cerr << *errorMessage << "\n";
+            return __LINE__;
+        }
+        // the evaluations made during LoadModel are not part of the steps
+        uint64_t startEvaluations = 0;
+        for (auto &&it : *simulation.GetMuscleList())
+        {
+            MAMuscleComplete *muscle = dynamic_cast<MAMuscleComplete *>(it.second.get());
+            if (muscle) startEvaluations += muscle->forceErrorEvaluations();
+        }
+        double startTime = GSUtil::GetTime();
+        while (!simulation.ShouldQuit())
+        {
+            simulation.UpdateSimulation();
+            if (simulation.TestForCatastrophy()) break;
+        }
+        times.push_back(GSUtil::GetTime() - startTime);
+        uint64_t evaluations = 0;
+        size_t numMuscles = 0;
+        for (auto &&it : *simulation.GetMuscleList())
+        {
+            MAMuscleComplete *muscle = dynamic_cast<MAMuscleComplete *>(it.second.get());
+            if (!muscle) continue;
+            evaluations += muscle->forceErrorEvaluations();
+            numMuscles++;
+        }
+        result->muscleSteps = double(numMuscles) * double(simulation.GetStepCount());
+        result->evaluationsPerMuscleStep = double(evaluations - startEvaluations) / result->muscleSteps;
+        result->mechanicalEnergy = simulation.GetMechanicalEnergy();
+        result->metabolicEnergy = simulation.GetMetabolicEnergy();
+    }
+    result->fastestTime = *std::min_element(times.begin(), times.end());
+    return 0;
+}
+
+int main(int argc, const char **argv)
+{
+    ArgParse argparse;
+    argparse.Initialise(argc, argv, "BenchmarkMuscleSolver force error evaluations and time for the MAMuscleComplete solvers"s, 0, 0);
+    argparse.AddArgument("-ns"s, "--numSegments"s, "Number of segments in the generated model"s, "10"s, 1, false, ArgParse::Int);
+    argparse.AddArgument("-st"s, "--stepType"s, "Step type of the generated model (World or Quick)"s, "Quick"s, 1, false, ArgParse::String);
+    argparse.AddArgument("-tl"s, "--timeLimit"s, "Simulation time limit"s, "0.5"s, 1, false, ArgParse::Double);
+    argparse.AddArgument("-nr"s, "--numRepeats"s, "Number of repeats (the fastest is reported)"s, "3"s, 1, false, ArgParse::Int);
+    if (argparse.Parse())
+    {
+        argparse.Usage();
+        return 1;
+    }
+    int numSegments = 0, numRepeats = 0;
+    double timeLimit = 0;
+    std::string stepType;
+    argparse.Get("--numSegments"s, &numSegments);
+    argparse.Get("--stepType"s, &stepType);
+    argparse.Get("--timeLimit"s, &timeLimit);
+    argparse.Get("--numRepeats"s, &numRepeats);
+
+    WormModelOptions options;
+    options.numSegments = size_t(numSegments);
+    options.stepType = stepType;
+    options.timeLimit = timeLimit;
+
+    std::vector<SolverResult> results(size_t(MAMuscleComplete::SolverCount));
+    std::cout.precision(9);
+    for (size_t i = 0; i < MAMuscleComplete::SolverCount; i++)
+    {
+        // the XML values are capitalised versions of the enum names
+        std::string solver = MAMuscleComplete::SolverStrings(i);
+        solver[0] = char(std::toupper(solver[0]));
+        options.solver = solver;
+        if (RunSolver(options, numRepeats, &results[i])) return 1;
+        std::cout << solver << ": " << results[i].evaluationsPerMuscleStep << " evaluations per muscle step, "
+                  << results[i].fastestTime << " s, Mechanical Energy " << results[i].mechanicalEnergy
+                  << " Metabolic Energy " << results[i].metabolicEnergy << "\n";
+    }
+    for (size_t i = 1; i < MAMuscleComplete::SolverCount; i++)
+    {
+        std::cout << MAMuscleComplete::SolverStrings(i) << " - " << MAMuscleComplete::SolverStrings(size_t(0)) << ": "
+                  << (results[i].fastestTime - results[0].fastestTime) / results[0].muscleSteps * 1e9 << " ns per muscle step\n";
+    }
+    return 0;
+}
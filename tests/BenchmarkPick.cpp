@@ -0,0 +1,215 @@
+/*
+ *  BenchmarkPick.cpp
+ *  GaitSym2019
+ *
+ */
+
+// times ray picking on OBJ meshes with the MeshBVH candidate search and with a test of every triangle
+// the rays are aimed at random points in the bounding box of all the meshes from random points in front of it
+// the triangle test is the same as FacetedObject::RayIntersectsTriangle and both searches must find the same hits
+// e.g. BenchmarkPick -nc 1 "tutorials/01 Blender Export/"*.obj (ArgParse needs an option before the end arguments)
+
+#include "MeshBVH.h"
+#include "ArgParse.h"
+#include "GSUtil.h"
+#include "PGDMath.h"
+
+#include "pystring.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cfloat>
+#include <cstdint>
+
+using namespace std::string_literals;
+
+struct Mesh
+{
+    std::vector<float> vertices; // x, y, z
+    std::vector<uint32_t> indices;
+};
+
+// only the vertices and faces are read and polygons are split into fans
+static int ReadOBJFile(const std::string &filename, Mesh *mesh)
+{
+    std::ifstream file(filename);
+    if (!file) return __LINE__;
+    size_t firstVertex = mesh->vertices.size() / 3;
+    std::string line;
+    std::vector<std::string> tokens;
+    std::vector<uint32_t> face;
+    while (std::getline(file, line))
+    {
+        pystring::split(line, tokens);
+        if (tokens.size() >= 4 && tokens[0] == "v"s)
+        {
+            for (size_t i = 1; i < 4; i++) mesh->vertices.push_back(float(GSUtil::Double(tokens[i])));
+        }
+        else if (tokens.size() >= 4 && tokens[0] == "f"s)
+        {
+            face.clear();
+            for (size_t i = 1; i < tokens.size(); i++)
+            {
+                long index = std::stol(tokens[i]); // stops at the first '/'
+                size_t numVertices = mesh->vertices.size() / 3 - firstVertex;
+                face.push_back(uint32_t(firstVertex + (index < 0 ? numVertices + size_t(index) : size_t(index - 1))));
+            }
+            for (size_t i = 2; i < face.size(); i++)
+            {
+                mesh->indices.push_back(face[0]);
+                mesh->indices.push_back(face[i - 1]);
+                mesh->indices.push_back(face[i]);
+            }
+        }
+    }
+    return 0;
+}
+
+static bool RayIntersectsTriangle(const pgd::Vector3 &rayOrigin, const pgd::Vector3 &rayVector,
+                                  const pgd::Vector3 &vertex0, const pgd::Vector3 &vertex1, const pgd::Vector3 &vertex2)
+{
+    const double EPSILON = 1e-10;
+    pgd::Vector3 edge1 = vertex1 - vertex0;
+    pgd::Vector3 edge2 = vertex2 - vertex0;
+    pgd::Vector3 h = rayVector.Cross(edge2);
+    double a = edge1.Dot(h);
+    if (a > -EPSILON && a < EPSILON) return false;
+    double f = 1.0 / a;
+    pgd::Vector3 s = rayOrigin - vertex0;
+    double u = f * s.Dot(h);
+    if (u < 0.0 || u > 1.0) return false;
+    pgd::Vector3 q = s.Cross(edge1);
+    double v = f * rayVector.Dot(q);
+    if (v < 0.0 || u + v > 1.0) return false;
+    double t = f * edge2.Dot(q);
+    return (t > EPSILON && t < 1 / EPSILON);
+}
+
+static void TestTriangles(const Mesh &mesh, const pgd::Vector3 &origin, const pgd::Vector3 &vector, const std::vector<uint32_t> &triangles, std::vector<uint32_t> *hits)
+{
+    hits->clear();
+    pgd::Vector3 v[3];
+    for (auto &&i : triangles)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            const float *vertex = &mesh.vertices[size_t(mesh.indices[size_t(i) * 3 + j]) * 3];
+            v[j].Set(double(vertex[0]), double(vertex[1]), double(vertex[2]));
+        }
+        if (RayIntersectsTriangle(origin, vector, v[0], v[1], v[2])) hits->push_back(i);
+    }
+}
+
+static void Report(const std::string &name, std::vector<double> times)
+{
+    std::sort(times.begin(), times.end());
+    double mean = std::accumulate(times.begin(), times.end(), 0.0) / double(times.size());
+    std::cout << name << ": mean " << mean * 1e3 << " ms, median " << times[times.size() / 2] * 1e3
+              << " ms, 99th percentile " << times[times.size() * 99 / 100] * 1e3 << " ms\n";
+}
+
+int main(int argc, const char **argv)
+{
+    ArgParse argparse;
+    argparse.Initialise(argc, argv, "BenchmarkPick ray pick latency with and without the MeshBVH (the end arguments are OBJ files)"s, SIZE_MAX, 1);
+    argparse.AddArgument("-nr"s, "--numRays"s, "Number of rays"s, "1000"s, 1, false, ArgParse::Int);
+    argparse.AddArgument("-nc"s, "--numCopies"s, "Number of side by side copies of the meshes"s, "1"s, 1, false, ArgParse::Int);
+    if (argparse.Parse())
+    {
+        argparse.Usage();
+        return 1;
+    }
+    std::vector<std::string> filenames;
+    int numRays = 0, numCopies = 0;
+    argparse.Get("--numRays"s, &numRays);
+    argparse.Get("--numCopies"s, &numCopies);
+    // ArgParse only reads the end arguments that follow an option
+    if (!argparse.Get(&filenames))
+    {
+        std::cerr << "Error: no OBJ files found after the options (e.g. BenchmarkPick -nc 1 *.obj)\n";
+        return 1;
+    }
+
+    Mesh mesh;
+    for (auto &&filename : filenames)
+    {
+        if (ReadOBJFile(filename, &mesh))
+        {
+            std::cerr << "Error reading \"" << filename << "\"\n";
+            return 1;
+        }
+    }
+    // the copies are spaced along x so that the rays pass through more triangles
+    size_t numVertices = mesh.vertices.size() / 3, numIndices = mesh.indices.size();
+    for (int copy = 1; copy < numCopies; copy++)
+    {
+        for (size_t i = 0; i < numVertices * 3; i++) mesh.vertices.push_back(mesh.vertices[i] + (i % 3 == 0 ? 0.5f * float(copy) : 0.0f));
+        for (size_t i = 0; i < numIndices; i++) mesh.indices.push_back(mesh.indices[i] + uint32_t(numVertices * size_t(copy)));
+    }
+    size_t numTriangles = mesh.indices.size() / 3;
+    float lower[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float upper[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+    {
+        lower[i % 3] = std::min(lower[i % 3], mesh.vertices[i]);
+        upper[i % 3] = std::max(upper[i % 3], mesh.vertices[i]);
+    }
+
+    std::mt19937_64 generator(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<pgd::Vector3> origins, vectors;
+    for (int i = 0; i < numRays; i++)
+    {
+        pgd::Vector3 target(lower[0] + uniform(generator) * (upper[0] - lower[0]), lower[1] + uniform(generator) * (upper[1] - lower[1]), lower[2] + uniform(generator) * (upper[2] - lower[2]));
+        pgd::Vector3 origin(target.x + 10 * (uniform(generator) - 0.5), target.y - 10, target.z + 10 * (uniform(generator) - 0.5));
+        pgd::Vector3 vector = target - origin;
+        vector.Normalize();
+        origins.push_back(origin);
+        vectors.push_back(vector);
+    }
+
+    // the hierarchy is built on the first pick in the GUI so its build time is part of the first pick latency
+    double startTime = GSUtil::GetTime();
+    MeshBVH bvh(mesh.vertices.data(), 3, nullptr, mesh.indices.data(), numTriangles);
+    double buildTime = GSUtil::GetTime() - startTime;
+
+    std::vector<uint32_t> allTriangles(numTriangles);
+    std::iota(allTriangles.begin(), allTriangles.end(), 0);
+    std::vector<uint32_t> candidates, bvhHits, allHits;
+    std::vector<double> bvhTimes, allTimes;
+    size_t numCandidates = 0, numHits = 0, numMismatches = 0;
+    for (int i = 0; i < numRays; i++)
+    {
+        startTime = GSUtil::GetTime();
+        bvh.FindCandidates(origins[size_t(i)].constData(), vectors[size_t(i)].constData(), &candidates);
+        TestTriangles(mesh, origins[size_t(i)], vectors[size_t(i)], candidates, &bvhHits);
+        bvhTimes.push_back(GSUtil::GetTime() - startTime);
+
+        startTime = GSUtil::GetTime();
+        TestTriangles(mesh, origins[size_t(i)], vectors[size_t(i)], allTriangles, &allHits);
+        allTimes.push_back(GSUtil::GetTime() - startTime);
+
+        numCandidates += candidates.size();
+        numHits += allHits.size();
+        std::sort(bvhHits.begin(), bvhHits.end());
+        if (bvhHits != allHits) numMismatches++;
+    }
+
+    std::cout.precision(4);
+    std::cout << numTriangles << " triangles, " << numRays << " rays, " << double(numHits) / numRays << " hits and "
+              << double(numCandidates) / numRays << " candidates per ray\n";
+    std::cout << "MeshBVH build " << buildTime * 1e3 << " ms, " << double(bvh.size()) / (1024 * 1024) << " MB\n";
+    Report("MeshBVH pick"s, bvhTimes);
+    Report("Every triangle pick"s, allTimes);
+    if (numMismatches)
+    {
+        std::cerr << "Error: the MeshBVH missed hits on " << numMismatches << " rays\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ *  BenchmarkStep.cpp
+ *  GaitSym2019
+ *
+ */
+
+// times Simulation::UpdateSimulation on a contact heavy model and counts the heap allocations made
+// per step once the simulation has warmed up so that changes to the contact generation can be compared
+// the default is the generated worm with 40 segments which rests on 240 spheres
+
+#include "TestModels.h"
+#include "Simulation.h"
+#include "ArgParse.h"
+#include "GSUtil.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std::string_literals;
+
+// every allocation in the program is counted so the allocations made by a step can be reported
+static std::atomic<uint64_t> g_allocations(0);
+
+void *operator new(std::size_t size)
+{
+    g_allocations++;
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+int main(int argc, const char **argv)
+{
+    ArgParse argparse;
+    argparse.Initialise(argc, argv, "BenchmarkStep time per step and allocations per step on a contact heavy model"s, 1, 0);
+    argparse.AddArgument("-ns"s, "--numSegments"s, "Number of segments in the generated model"s, "40"s, 1, false, ArgParse::Int);
+    argparse.AddArgument("-st"s, "--stepType"s, "Step type of the generated model (World or Quick)"s, "Quick"s, 1, false, ArgParse::String);
+    argparse.AddArgument("-ws"s, "--warmupSteps"s, "Number of steps before timing starts (the worm lands after about 800)"s, "1000"s, 1, false, ArgParse::Int);
+    argparse.AddArgument("-ts"s, "--timedSteps"s, "Number of timed steps in each repeat"s, "1000"s, 1, false, ArgParse::Int);
+    argparse.AddArgument("-nr"s, "--numRepeats"s, "Number of repeats (the fastest is reported as well as the mean)"s, "5"s, 1, false, ArgParse::Int);
+    if (argparse.Parse())
+    {
+        argparse.Usage();
+        return 1;
+    }
+    int numSegments = 0, warmupSteps = 0, timedSteps = 0, numRepeats = 0;
+    std::string stepType, filename;
+    argparse.Get("--numSegments"s, &numSegments);
+    argparse.Get("--stepType"s, &stepType);
+    argparse.Get("--warmupSteps"s, &warmupSteps);
+    argparse.Get("--timedSteps"s, &timedSteps);
+    argparse.Get("--numRepeats"s, &numRepeats);
+    argparse.Get(&filename);
+
+    WormModelOptions options;
+    options.numSegments = size_t(numSegments);
+    options.stepType = stepType;
+    options.timeLimit = 1e6; // the step count controls the length of the run
+    std::string xml = ModelFromArgument(filename, options);
+    if (xml.empty()) return 1;
+
+    std::vector<double> stepTimes;
+    uint64_t allocations = 0;
+    uint64_t contacts = 0;
+    for (int repeat = 0; repeat < numRepeats; repeat++)
+    {
+        Simulation simulation;
+        std::string *errorMessage = simulation.LoadModel(xml.data(), xml.size());
+        if (errorMessage)
+        {
+            std::cerr << *errorMessage << "\n";
+            return 1;
+        }
+        for (int i = 0; i < warmupSteps; i++) simulation.UpdateSimulation();
+
+        uint64_t allocationsAtStart = g_allocations;
+        double startTime = GSUtil::GetTime();
+        for (int i = 0; i < timedSteps; i++)
+        {
+            simulation.UpdateSimulation();
+            contacts += simulation.GetContactList()->size();
+        }
+        stepTimes.push_back((GSUtil::GetTime() - startTime) / timedSteps);
+        allocations += g_allocations - allocationsAtStart;
+        if (simulation.TestForCatastrophy()) std::cerr << "Warning: the simulation failed during repeat " << repeat << "\n";
+    }
+
+    double meanTime = 0;
+    for (auto &&it : stepTimes) meanTime += it;
+    meanTime /= stepTimes.size();
+    double totalSteps = double(timedSteps) * double(numRepeats);
+    std::cout << "Steps: " << timedSteps << " x " << numRepeats << " after " << warmupSteps << " warmup steps\n";
+    std::cout << "Contacts per step: " << double(contacts) / totalSteps << "\n";
+    std::cout << "Allocations per step: " << double(allocations) / totalSteps << "\n";
+    std::cout << "Mean: " << meanTime * 1e6 << " us per step\n";
+    std::cout << "Fastest: " << *std::min_element(stepTimes.begin(), stepTimes.end()) * 1e6 << " us per step\n";
+    return 0;
+}
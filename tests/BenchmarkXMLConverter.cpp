@@ -0,0 +1,141 @@
+/*
+ *  BenchmarkXMLConverter.cpp
+ *  GaitSym2019
+ *
+ */
+
+// compares the per genome cost of compiling every substitution for every genome, which is what
+// XMLConverter::ApplyGenome used to do, with the precompiled expressions that it uses now
+
+#include "TestModels.h"
+#include "XMLConverter.h"
+#include "ArgParse.h"
+#include "GSUtil.h"
+
+#include "exprtk.hpp"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdio>
+
+using namespace std::string_literals;
+
+// the old ApplyGenome followed by GetFormattedXML
+static void RecompilingApplyGenome(const std::vector<std::string> &textComponents, const std::vector<std::string> &parserText, const std::vector<double> &genome, std::string *formattedXML)
+{
+    formattedXML->clear();
+    char buffer[32];
+    for (size_t i = 0; i < parserText.size(); i++)
+    {
+        exprtk::symbol_table<double> symbolTable;
+        exprtk::expression<double> expression;
+        exprtk::parser<double> parser;
+        symbolTable.add_vector("g", const_cast<double *>(genome.data()), genome.size());
+        symbolTable.add_constants();
+        expression.register_symbol_table(symbolTable);
+        double value = parser.compile(parserText[i], expression) ? expression.value() : 0;
+        formattedXML->append(textComponents[i]);
+        int l = snprintf(buffer, sizeof(buffer), "%.18g", value);
+        formattedXML->append(buffer, size_t(l));
+    }
+    formattedXML->append(textComponents.back());
+}
+
+// splits the XML at the [[ ]] in the same way as XMLConverter::LoadBaseXMLString
+// only the simple g(n) form of the vector brackets is converted
+static void SplitSubstitutions(const std::string &xml, std::vector<std::string> *textComponents, std::vector<std::string> *parserText)
+{
+    size_t start = 0;
+    while (true)
+    {
+        size_t open = xml.find("[["s, start);
+        if (open == std::string::npos) break;
+        size_t close = xml.find("]]"s, open + 2);
+        if (close == std::string::npos) break;
+        textComponents->push_back(xml.substr(start, open - start));
+        std::string text = xml.substr(open + 2, close - open - 2);
+        for (size_t j = 0; j + 1 < text.size(); j++)
+        {
+            if (text[j] != 'g' || text[j + 1] != '(') continue;
+            size_t k = text.find(')', j + 2);
+            if (k == std::string::npos) break;
+            text[j + 1] = '[';
+            text[k] = ']';
+        }
+        parserText->push_back(text);
+        start = close + 2;
+    }
+    textComponents->push_back(xml.substr(start));
+}
+
+int main(int argc, const char **argv)
+{
+    ArgParse argparse;
+    argparse.Initialise(argc, argv, "BenchmarkXMLConverter per genome cost of the XML substitutions"s, 1, 0);
+    argparse.AddArgument("-ns"s, "--numSegments"s, "Number of segments in the generated model"s, "40"s, 1, false, ArgParse::Int);
+    argparse.AddArgument("-gl"s, "--genomeLength"s, "Number of genes"s, "40"s, 1, false, ArgParse::Int);
+    argparse.AddArgument("-ng"s, "--numGenomes"s, "Number of genomes to apply with the precompiled expressions"s, "2000"s, 1, false, ArgParse::Int);
+    argparse.AddArgument("-nr"s, "--numRecompiledGenomes"s, "Number of genomes to apply by recompiling"s, "20"s, 1, false, ArgParse::Int);
+    if (argparse.Parse())
+    {
+        argparse.Usage();
+        return 1;
+    }
+    int numSegments = 0, genomeLength = 0, numGenomes = 0, numRecompiledGenomes = 0;
+    std::string filename;
+    argparse.Get("--numSegments"s, &numSegments);
+    argparse.Get("--genomeLength"s, &genomeLength);
+    argparse.Get("--numGenomes"s, &numGenomes);
+    argparse.Get("--numRecompiledGenomes"s, &numRecompiledGenomes);
+    argparse.Get(&filename);
+
+    WormModelOptions options;
+    options.numSegments = size_t(numSegments);
+    options.genomeLength = size_t(genomeLength);
+    std::string xml = ModelFromArgument(filename, options);
+    if (xml.empty()) return 1;
+
+    std::vector<std::string> textComponents, parserText;
+    SplitSubstitutions(xml, &textComponents, &parserText);
+    std::cout << "Substitutions: " << parserText.size() << " Genome length: " << genomeLength << "\n";
+
+    XMLConverter converter;
+    converter.LoadBaseXMLString(xml.data(), xml.size());
+    std::vector<double> genome(static_cast<size_t>(genomeLength));
+    std::string formattedXML, recompiledXML;
+
+    // check that both routes give the same text before timing them
+    for (size_t i = 0; i < genome.size(); i++) genome[i] = 0.01 * double(i);
+    converter.ApplyGenome(int(genome.size()), genome.data());
+    converter.GetFormattedXML(&formattedXML);
+    RecompilingApplyGenome(textComponents, parserText, genome, &recompiledXML);
+    if (formattedXML != recompiledXML)
+    {
+        std::cerr << "Error: the precompiled and recompiled XML are different\n";
+        return 1;
+    }
+
+    double startTime = GSUtil::GetTime();
+    for (int i = 0; i < numRecompiledGenomes; i++)
+    {
+        genome[0] = 0.001 * i;
+        RecompilingApplyGenome(textComponents, parserText, genome, &recompiledXML);
+    }
+    double recompiledTime = (GSUtil::GetTime() - startTime) / numRecompiledGenomes;
+
+    startTime = GSUtil::GetTime();
+    for (int i = 0; i < numGenomes; i++)
+    {
+        genome[0] = 0.001 * i;
+        converter.ApplyGenome(int(genome.size()), genome.data());
+        converter.GetFormattedXML(&formattedXML);
+    }
+    double precompiledTime = (GSUtil::GetTime() - startTime) / numGenomes;
+
+    std::cout << "Recompiled: " << recompiledTime * 1e6 << " us per genome (" << numRecompiledGenomes << " genomes)\n";
+    std::cout << "Precompiled: " << precompiledTime * 1e6 << " us per genome (" << numGenomes << " genomes)\n";
+    std::cout << "Speedup: " << recompiledTime / precompiledTime << "\n";
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ *  TestModels.cpp
+ *  GaitSym2019
+ *
+ */
+
+#include "TestModels.h"
+#include "DataFile.h"
+
+#include <cstdio>
+#include <cstdarg>
+#include <iostream>
+
+namespace
+{
+
+class WormWriter
+{
+public:
+    WormWriter(const WormModelOptions &options) : m_options(options) {}
+
+    // with a genome the value is multiplied by (1 + gene) so that an all zero genome gives the plain model
+    std::string Value(double value)
+    {
+        char buffer[64];
+        if (m_options.genomeLength == 0) snprintf(buffer, sizeof(buffer), "%.17g", value);
+        else snprintf(buffer, sizeof(buffer), "[[%.17g * (1 + g(%zu))]]", value, (m_gene++) % m_options.genomeLength);
+        return buffer;
+    }
+
+    void Add(const char *format, ...)
+    {
+        char buffer[2048];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        m_xml.append(buffer);
+        m_xml.append("\n");
+    }
+
+    const std::string &xml() const { return m_xml; }
+
+private:
+    const WormModelOptions &m_options;
+    std::string m_xml;
+    size_t m_gene = 0;
+};
+
+}
+
+std::string WormModel(const WormModelOptions &options)
+{
+    WormWriter w(options);
+    const double segmentLength = 0.2;
+    std::string solver = options.solver.size() ? " Solver=\"" + options.solver + "\"" : std::string();
+    w.Add("<GAITSYM2019>");
+    w.Add("<GLOBAL ID=\"global\" AllowInternalCollisions=\"false\" AllowConnectedCollisions=\"false\" BMR=\"0\" CFM=\"1e-10\" ContactMaxCorrectingVel=\"100\" "
+          "ContactSurfaceLayer=\"0.001\" DistanceTravelledBodyID=\"B0\" ERP=\"0.2\" FitnessType=\"KinematicMatch\" GravityVector=\"0.0 0.0 -9.81\" "
+          "IntegrationStepSize=\"1e-4\" MechanicalEnergyLimit=\"0\" MetabolicEnergyLimit=\"0\" TimeLimit=\"%.17g\" StepType=\"%s\" %s/>", options.timeLimit, options.stepType.c_str(), options.spaceAttributes.c_str());
+    w.Add("<MARKER ID=\"GroundMarker\" BodyID=\"World\" Position=\"World 0 0 0\" Quaternion=\"World 1 0 0 0\"/>");
+    w.Add("<GEOM ID=\"Ground\" Type=\"Plane\" MarkerID=\"GroundMarker\" ERP=\"0.2\" CFM=\"1e-7\" Bounce=\"0\" Mu=\"1\" Abort=\"false\" Adhesion=\"false\"/>");
+    for (size_t i = 0; i < options.numSegments; i++)
+    {
+        double x = double(i) * segmentLength + segmentLength / 2;
+        w.Add("<BODY ID=\"B%zu\" Mass=\"%s\" MOI=\"0.01 0.01 0.01 0 0 0\" Position=\"World %.17g 0 0.1\" ConstructionPosition=\"World %.17g 0 0.1\" Quaternion=\"World 1 0 0 0\" "
+              "LinearVelocity=\"0 0 0\" AngularVelocity=\"0 0 0\" ConstructionDensity=\"1000\" PositionLowBound=\"-100 -100 -100\" PositionHighBound=\"100 100 100\" "
+              "LinearVelocityLowBound=\"-100 -100 -100\" LinearVelocityHighBound=\"100 100 100\" AngularVelocityLowBound=\"-1000 -1000 -1000\" AngularVelocityHighBound=\"1000 1000 1000\"/>",
+              i, w.Value(1.0).c_str(), x, x);
+        const double dxs[3] = {-0.08, 0.0, 0.08};
+        const double dys[2] = {-0.03, 0.03};
+        for (size_t k = 0; k < 3; k++)
+        {
+            for (size_t k2 = 0; k2 < 2; k2++)
+            {
+                w.Add("<MARKER ID=\"B%zuS%zu_%zu\" BodyID=\"B%zu\" Position=\"B%zu %.17g %.17g -0.05\" Quaternion=\"B%zu 1 0 0 0\"/>", i, k, k2, i, i, dxs[k], dys[k2], i);
+                w.Add("<GEOM ID=\"G%zu_%zu_%zu\" Type=\"Sphere\" Radius=\"%s\" MarkerID=\"B%zuS%zu_%zu\" ERP=\"0.2\" CFM=\"1e-7\" Bounce=\"0\" Mu=\"1\" Abort=\"false\" Adhesion=\"false\"/>",
+                      i, k, k2, w.Value(0.02).c_str(), i, k, k2);
+            }
+        }
+        w.Add("<MARKER ID=\"B%zuTop0\" BodyID=\"B%zu\" Position=\"B%zu -0.07 0 0.03\" Quaternion=\"B%zu 1 0 0 0\"/>", i, i, i, i);
+        w.Add("<MARKER ID=\"B%zuTop1\" BodyID=\"B%zu\" Position=\"B%zu 0.07 0 0.03\" Quaternion=\"B%zu 1 0 0 0\"/>", i, i, i, i);
+        w.Add("<MARKER ID=\"B%zuBot0\" BodyID=\"B%zu\" Position=\"B%zu -0.07 0 -0.03\" Quaternion=\"B%zu 1 0 0 0\"/>", i, i, i, i);
+        w.Add("<MARKER ID=\"B%zuBot1\" BodyID=\"B%zu\" Position=\"B%zu 0.07 0 -0.03\" Quaternion=\"B%zu 1 0 0 0\"/>", i, i, i, i);
+    }
+    for (size_t i = 0; i + 1 < options.numSegments; i++)
+    {
+        double x = double(i + 1) * segmentLength;
+        w.Add("<MARKER ID=\"J%zuM1\" BodyID=\"B%zu\" Position=\"World %.17g 0 0.1\" Quaternion=\"World 0.7071067811865476 0 0 0.7071067811865476\"/>", i, i, x);
+        w.Add("<MARKER ID=\"J%zuM2\" BodyID=\"B%zu\" Position=\"World %.17g 0 0.1\" Quaternion=\"World 0.7071067811865476 0 0 0.7071067811865476\"/>", i, i + 1, x);
+        w.Add("<JOINT ID=\"J%zu\" Type=\"Hinge\" Body1MarkerID=\"J%zuM1\" Body2MarkerID=\"J%zuM2\" LowStop=\"-1\" HighStop=\"1\"/>", i, i, i);
+        const char *sides[2] = {"Top", "Bot"};
+        for (size_t j = 0; j < 2; j++)
+        {
+            const char *side = sides[j];
+            w.Add("<STRAP ID=\"S%s%zu\" Type=\"TwoPoint\" OriginMarkerID=\"B%zu%s1\" InsertionMarkerID=\"B%zu%s0\" Length=\"0.06\"/>", side, i, i, side, i + 1, side);
+            w.Add("<MUSCLE ID=\"M%s%zu\" Type=\"MinettiAlexanderComplete\" StrapID=\"S%s%zu\" ForcePerUnitArea=\"300000\" VMaxFactor=\"%s\" PCA=\"0.001\" FibreLength=\"0.04\" "
+                  "ActivationK=\"0.17\" Width=\"0.5\" TendonLength=\"0.02\" SerialStrainAtFmax=\"0.06\" SerialStrainRateAtFmax=\"0\" SerialStrainModel=\"Square\" "
+                  "ParallelStrainAtFmax=\"0.6\" ParallelStrainRateAtFmax=\"0\" ParallelStrainModel=\"Square\" ActivationKinetics=\"false\" InitialFibreLength=\"0.04\" "
+                  "ActivationRate=\"0\" StartActivation=\"0\" MinimumActivation=\"0.001\"%s/>", side, i, side, i, w.Value(8.4).c_str(), solver.c_str());
+            std::string high = w.Value(0.8);
+            std::string low = w.Value(0.05);
+            w.Add("<DRIVER ID=\"D%s%zu\" Type=\"Cyclic\" TargetIDList=\"M%s%zu\" Values=\"%s %s\" Durations=\"0.2 0.2\" PhaseDelay=\"%s\"/>",
+                  side, i, side, i, high.c_str(), low.c_str(), j == 0 ? "0" : "0.5");
+        }
+    }
+    w.Add("</GAITSYM2019>");
+    return w.xml();
+}
+
+std::string ModelFromArgument(const std::string &filename, const WormModelOptions &options)
+{
+    if (filename.empty()) return WormModel(options);
+    DataFile file;
+    if (file.ReadFile(filename))
+    {
+        std::cerr << "Error reading \"" << filename << "\"\n";
+        return std::string();
+    }
+    return std::string(file.GetRawData(), file.GetSize());
+}
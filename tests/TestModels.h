@@ -0,0 +1,31 @@
+/*
+ *  TestModels.h
+ *  GaitSym2019
+ *
+ */
+
+#ifndef TESTMODELS_H
+#define TESTMODELS_H
+
+#include <string>
+
+// TestModels generates the models used by the tests and benchmarks so that they do not depend on
+// model files that are not part of the repository. The worm is a chain of bodies joined by hinges,
+// each resting on six spheres and bent by a pair of cyclically driven muscles.
+
+struct WormModelOptions
+{
+    size_t numSegments = 10;
+    size_t genomeLength = 0; // if not zero every numerical parameter is written as a [[ ]] substitution using this many genes
+    double timeLimit = 0.5;
+    std::string stepType = "World"; // World or Quick
+    std::string solver; // MUSCLE Solver attribute (Bracket or Newton) which is left out if empty
+    std::string spaceAttributes; // extra GLOBAL attributes such as SpaceType="QuadTree" which are added as they are
+};
+
+std::string WormModel(const WormModelOptions &options);
+
+// the end argument if there is one otherwise the generated model
+std::string ModelFromArgument(const std::string &filename, const WormModelOptions &options);
+
+#endif // TESTMODELS_H
@@ -0,0 +1,143 @@
+/*
+ *  TestSimulationReset.cpp
+ *  GaitSym2019
+ *
+ */
+
+// checks that a run after Simulation::Reset gives bit identical results to a run of a freshly loaded model
+// for both step types, for resets with and without new values, and for resets from the middle of a run
+// the quickstep solver uses the ODE random number generator so the seed is set to the value it has
+// in a new process before every LoadModel
+
+#include "TestModels.h"
+#include "Simulation.h"
+#include "XMLConverter.h"
+#include "Body.h"
+#include "Muscle.h"
+
+#include "ode/ode.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+
+using namespace std::string_literals;
+
+// everything that a run produces that is compared
+static std::vector<double> Run(Simulation *simulation, double stopTime = 0)
+{
+    while (!simulation->ShouldQuit())
+    {
+        if (stopTime > 0 && simulation->GetTime() >= stopTime) break;
+        simulation->UpdateSimulation();
+        if (simulation->TestForCatastrophy()) break;
+    }
+    std::vector<double> results = {simulation->GetTime(), double(simulation->GetStepCount()), simulation->CalculateInstantaneousFitness(),
+                                   simulation->GetMechanicalEnergy(), simulation->GetMetabolicEnergy()};
+    for (auto &&it : *simulation->GetBodyList())
+    {
+        const double *p;
+        p = it.second->GetPosition(); results.insert(results.end(), p, p + 3);
+        p = it.second->GetQuaternion(); results.insert(results.end(), p, p + 4);
+        p = it.second->GetLinearVelocity(); results.insert(results.end(), p, p + 3);
+        p = it.second->GetAngularVelocity(); results.insert(results.end(), p, p + 3);
+    }
+    for (auto &&it : *simulation->GetMuscleList())
+    {
+        results.push_back(it.second->GetLength());
+        results.push_back(it.second->GetTension());
+        results.push_back(it.second->GetActivation());
+    }
+    return results;
+}
+
+static bool Identical(const std::vector<double> &a, const std::vector<double> &b)
+{
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0;
+}
+
+static int TestStepType(const std::string &stepType)
+{
+    WormModelOptions options;
+    options.numSegments = 6;
+    options.genomeLength = 8;
+    options.timeLimit = 0.2;
+    options.stepType = stepType;
+    std::string xml = WormModel(options);
+    XMLConverter converter;
+    converter.LoadBaseXMLString(xml.data(), xml.size());
+
+    const size_t numGenomes = 3;
+    std::vector<std::vector<double>> genomes(numGenomes, std::vector<double>(options.genomeLength, 0));
+    for (size_t i = 1; i < numGenomes; i++)
+        for (size_t j = 0; j < options.genomeLength; j++) genomes[i][j] = 0.01 * double(i) * double(j % 3);
+
+    std::vector<std::vector<double>> freshResults;
+    for (size_t i = 0; i < numGenomes; i++)
+    {
+        converter.ApplyGenome(int(genomes[i].size()), genomes[i].data());
+        Simulation simulation;
+        dRandSetSeed(0);
+        std::string *errorMessage = simulation.LoadModel(*converter.GetFormattedElementList("GAITSYM2019"s));
+        if (errorMessage)
+        {
+            std::cerr << *errorMessage << "\n";
+            return __LINE__;
+        }
+        freshResults.push_back(Run(&simulation));
+    }
+    if (Identical(freshResults[0], freshResults[1]))
+    {
+        std::cerr << "Error: " << stepType << " different genomes give the same results so the test cannot detect stale values\n";
+        return __LINE__;
+    }
+
+    converter.ApplyGenome(int(genomes[0].size()), genomes[0].data());
+    Simulation simulation;
+    dRandSetSeed(0);
+    std::string *errorMessage = simulation.LoadModel(*converter.GetFormattedElementList("GAITSYM2019"s));
+    if (errorMessage)
+    {
+        std::cerr << *errorMessage << "\n";
+        return __LINE__;
+    }
+    Run(&simulation);
+
+    // each entry is the genome to reset with (or -1 to reset with the current values), whether to stop half way, and the expected results
+    struct ResetCase { int genome; bool partial; size_t expected; };
+    const ResetCase cases[] = {{-1, false, 0}, {1, false, 1}, {2, true, 2}, {2, false, 2}, {-1, false, 2}, {0, true, 0}, {0, false, 0}};
+    int failures = 0;
+    for (auto &&it : cases)
+    {
+        if (it.genome < 0) errorMessage = simulation.Reset();
+        else
+        {
+            converter.ApplyGenome(int(genomes[size_t(it.genome)].size()), genomes[size_t(it.genome)].data());
+            errorMessage = simulation.Reset(converter.GetFormattedElementList("GAITSYM2019"s));
+        }
+        if (errorMessage)
+        {
+            std::cerr << *errorMessage << "\n";
+            return __LINE__;
+        }
+        if (it.partial)
+        {
+            Run(&simulation, options.timeLimit / 2);
+            continue; // the next case resets from the middle of this run
+        }
+        bool identical = Identical(Run(&simulation), freshResults[it.expected]);
+        std::cout << stepType << " reset " << (it.genome < 0 ? "without values"s : "to genome "s + std::to_string(it.genome))
+                  << (identical ? " identical\n" : " DIFFERENT\n");
+        if (!identical) failures++;
+    }
+    return failures;
+}
+
+int main(int /* argc */, const char ** /* argv */)
+{
+    int failures = 0;
+    for (auto &&stepType : {"World"s, "Quick"s}) failures += TestStepType(stepType);
+    std::cout << (failures ? "TestSimulationReset FAILED\n" : "TestSimulationReset passed\n");
+    return failures ? 1 : 0;
+}